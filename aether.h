@@ -94,6 +94,21 @@
 	#define AE_ENABLE_SOURCE_INFO 0
 #endif
 
+//------------------------------------------------------------------------------
+// AE_SIMD define
+//------------------------------------------------------------------------------
+//! When AE_SIMD=1 some hot loops, such as ae::Skin::ApplyPoseToMesh(), are
+//! implemented with SSE2 or NEON intrinsics. This is enabled by default when
+//! the compiler targets SSE2 or NEON. Define AE_SIMD=0 to always use the
+//! portable scalar implementations.
+#ifndef AE_SIMD
+	#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) || defined(__ARM_NEON) || defined(__aarch64__)
+		#define AE_SIMD 1
+	#else
+		#define AE_SIMD 0
+	#endif
+#endif
+
 //------------------------------------------------------------------------------
 // Platform defines
 //------------------------------------------------------------------------------
@@ -135,6 +150,12 @@
 	#define _AE_DEBUG_ 0
 #endif
 
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	#define _AE_BIG_ENDIAN_ 1
+#else
+	#define _AE_BIG_ENDIAN_ 0
+#endif
+
 //------------------------------------------------------------------------------
 // Warnings
 //------------------------------------------------------------------------------
@@ -174,9 +195,11 @@
 //------------------------------------------------------------------------------
 #include <algorithm>
 #include <array> // @TODO: Remove. For _GetTypeName().
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -186,6 +209,7 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <ostream>
 #include <sstream>
 #include <thread> // @TODO: Remove. For Globals::allocatorThread.
@@ -1378,6 +1402,54 @@ private:
 	double m_frameStart = 0.0;
 };
 
+//------------------------------------------------------------------------------
+// ae::WorkerPool
+//! A fixed set of worker threads for splitting up batches of independent work,
+//! such as updating many animated characters. The thread that calls
+//! ae::WorkerPool::Run() also takes part in the work and blocks until all of
+//! it is finished. With Emscripten builds no threads are created and all work
+//! is done on the calling thread.
+//------------------------------------------------------------------------------
+class WorkerPool
+{
+public:
+	WorkerPool( const ae::Tag& tag );
+	~WorkerPool();
+
+	//! Starts \p workerCount threads in addition to the calling thread. A good
+	//! default is ae::GetMaxConcurrentThreads() - 1. Zero is valid, in which
+	//! case ae::WorkerPool::Run() does all work on the calling thread.
+	void Initialize( uint32_t workerCount );
+	//! Joins all worker threads. Called automatically by ~ae::WorkerPool().
+	void Terminate();
+
+	//! Splits [0, \p count) into ranges of up to \p batchSize elements and
+	//! calls \p fn( begin, end ) once for each range from any of the worker
+	//! threads or the calling thread. Returns once all ranges are complete.
+	//! \p fn must be safe to call concurrently. Run() is not reentrant.
+	void Run( uint32_t count, uint32_t batchSize, const std::function< void( uint32_t begin, uint32_t end ) >& fn );
+	//! Returns the number of threads started by ae::WorkerPool::Initialize().
+	uint32_t GetWorkerCount() const { return m_workerCount; }
+
+private:
+	AE_DISABLE_COPY_ASSIGNMENT( WorkerPool );
+	void m_Work();
+	void m_WorkerLoop();
+	const ae::Tag m_tag;
+	std::thread* m_threads = nullptr;
+	uint32_t m_workerCount = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+	uint32_t m_generation = 0;
+	uint32_t m_busyCount = 0;
+	bool m_terminate = false;
+	const std::function< void( uint32_t, uint32_t ) >* m_fn = nullptr;
+	uint32_t m_count = 0;
+	uint32_t m_batchSize = 1;
+	std::atomic< uint32_t > m_next = { 0 };
+};
+
 //! \defgroup DataStructures
 //! @{
 
@@ -3377,6 +3449,12 @@ public:
 	//! how much data will be received in advance. If you are using ae::Socket::QueueMsg()
 	//! and ae::Socket::ReceiveMsg() the returned value will include all message headers.
 	uint32_t ReceiveDataLength();
+	//! Returns all received data that has not been read yet as a single
+	//! contiguous span, and writes its length to \p lengthOut. Returns null if
+	//! no data is available. Advance past the data with ae::Socket::DiscardData().
+	//! The returned pointer is valid until the next non-const call to this
+	//! ae::Socket.
+	const uint8_t* PeekReceivedData( uint32_t* lengthOut );
 
 	//! Queues data for sending. A two byte (network order) message header is
 	//! prepended to the given message. Ideally you should call ae::Socket::QueueMsg()
@@ -3393,13 +3471,34 @@ public:
 	//! Discards one received message sent with ae::Socket::QueueMsg(). Uses the
 	//! two byte (network order) message header to determine discard data size.
 	bool DiscardMsg();
+	//! Returns the next complete message sent with ae::Socket::QueueMsg() in
+	//! place, without copying it, and writes its length to \p lengthOut.
+	//! Returns null if no complete message has been received. Call
+	//! ae::Socket::DiscardMsg() when done with the message. The returned
+	//! pointer is valid until the next non-const call to this ae::Socket.
+	const uint8_t* PeekMsg( uint16_t* lengthOut );
 
 	//! Returns the number of bytes sent. Sends all queued data from ae::Socket::QueueData()
 	//! and ae::Socket::QueueMsg(). If the connection is lost all pending sent
 	//! data will be discarded. See ae::Socket::Connect() for more information.
 	//! For a real time multiplayer game this could be called 10 to 30 times
-	//! per second, each time all data and messages have been queued.
+	//! per second, each time all data and messages have been queued. If the
+	//! system send buffer is full the remaining data stays queued and is sent
+	//! by the next call, see ae::Socket::GetPendingSendLength(). Queued messages
+	//! are sent together in as few system calls as possible.
 	uint32_t SendAll();
+	//! Returns the number of queued bytes that have not been sent yet. This
+	//! can be used to detect slow receivers, or with ae::SocketPoller write
+	//! interest to know when to call ae::Socket::SendAll() again.
+	uint32_t GetPendingSendLength() const { return m_sendData.Length() - m_sendHead; }
+	//! TCP only. Nagle's algorithm is disabled by default (\p noDelay is true)
+	//! so that small messages are sent immediately. Returns false on failure.
+	bool SetNoDelay( bool noDelay );
+	//! TCP only. While corked the system only sends full packets, which is
+	//! useful when many small writes should be combined. Uncorking sends any
+	//! remaining partial packet. Uses TCP_CORK on Linux and TCP_NOPUSH on
+	//! Apple platforms. Returns false if unsupported.
+	bool SetCork( bool cork );
 	
 	//! Returns the most recent remote address that this socket had or attempted
 	//! a connection to.
@@ -3428,10 +3527,18 @@ private:
 	void* m_addrInfo = nullptr;
 	void* m_currAddrInfo = nullptr;
 	ae::Str128 m_resolvedAddress;
+	bool m_Receive( uint32_t length );
 	// Data buffers
-	uint32_t m_readHead = 0;
+	//! Data before m_sendHead has already been sent
 	ae::Array< uint8_t > m_sendData;
+	uint32_t m_sendHead = 0;
+	//! Unread data is between m_readHead and m_recvEnd. The array length is
+	//! the buffer capacity, unread data is moved to the front of the buffer
+	//! only when more space is needed.
 	ae::Array< uint8_t > m_recvData;
+	uint32_t m_readHead = 0;
+	uint32_t m_recvEnd = 0;
+	friend class SocketPoller;
 public: // Internal
 	Socket( ae::Tag tag, int s, Protocol proto, const char* addr, uint16_t port );
 };
@@ -3495,6 +3602,184 @@ private:
 	uint16_t m_port = 0;
 	uint32_t m_maxConnections = 0;
 	ae::Array< ae::Socket* > m_connections;
+	friend class SocketPoller;
+};
+
+//------------------------------------------------------------------------------
+// ae::SocketPoller class
+//! Waits on many ae::Sockets and ae::ListenerSockets at once, and reports only
+//! the ones that need attention. This avoids polling every connection each
+//! frame. Uses epoll on Linux and poll elsewhere. Sockets are registered by
+//! their current system handle, so an ae::Socket must be added again after
+//! ae::Socket::Connect() creates a new connection, and must be removed before
+//! it is destroyed.
+//------------------------------------------------------------------------------
+class SocketPoller
+{
+public:
+	struct Event
+	{
+		//! Set for events of sockets added with ae::SocketPoller::Add( ae::Socket* )
+		ae::Socket* socket = nullptr;
+		//! Set for events of listeners added with ae::SocketPoller::Add( ae::ListenerSocket* )
+		ae::ListenerSocket* listener = nullptr;
+		//! Data can be received or, for listeners, ae::ListenerSocket::Accept()
+		//! should be called. Receive until no more data is available.
+		bool readable = false;
+		//! Queued data can be sent. Only reported when requested with
+		//! ae::SocketPoller::SetWriteInterest().
+		bool writable = false;
+		//! The connection was closed or had an error. Remaining received data
+		//! can still be read before the socket is cleaned up. Without epoll an
+		//! orderly shutdown by the remote host may only be reported as
+		//! readable, in which case ae::Socket::IsConnected() will return false
+		//! after receiving.
+		bool closed = false;
+	};
+
+	SocketPoller( const ae::Tag& tag );
+	~SocketPoller();
+	
+	//! Starts reporting events for \p socket. Returns false if \p socket has
+	//! not started connecting.
+	bool Add( ae::Socket* socket, bool writeInterest = false );
+	//! Starts reporting events for \p listener.
+	bool Add( ae::ListenerSocket* listener );
+	void Remove( ae::Socket* socket );
+	void Remove( ae::ListenerSocket* listener );
+	//! Writable events are only reported while \p writeInterest is true, which
+	//! is usually only while ae::Socket has data that could not be sent.
+	void SetWriteInterest( ae::Socket* socket, bool writeInterest );
+	
+	//! Waits up to \p timeoutSec for any registered socket to become ready.
+	//! Returns the number of events, which can be accessed with
+	//! ae::SocketPoller::GetEvent(). A \p timeoutSec of zero returns
+	//! immediately, and negative values wait indefinitely.
+	uint32_t Wait( float timeoutSec );
+	const Event& GetEvent( uint32_t index ) const { return m_events[ index ]; }
+	uint32_t GetEventCount() const { return m_events.Length(); }
+	//! Returns the number of registered ae::Sockets and ae::ListenerSockets.
+	uint32_t GetCount() const { return m_sockets.Length() + m_listeners.Length(); }
+
+private:
+	SocketPoller( const SocketPoller& ) = delete;
+	struct Listener
+	{
+		ae::ListenerSocket* listener;
+		int socks[ 2 ];
+	};
+	struct Entry
+	{
+		ae::Socket* socket;
+		ae::ListenerSocket* listener;
+		bool writeInterest;
+	};
+	bool m_Register( int sock, const Entry& entry, bool modify );
+	void m_Unregister( int sock, const void* owner );
+	void m_UpdateListeners();
+	ae::Tag m_tag;
+	int m_epoll = -1;
+	//! Socket handle to registration
+	ae::Map< int32_t, Entry > m_entries;
+	ae::Map< ae::Socket*, int32_t > m_sockets;
+	ae::Array< Listener > m_listeners;
+	ae::Array< Event > m_events;
+	//! Platform event buffer, epoll_event or pollfd
+	void* m_pollBuffer = nullptr;
+	uint32_t m_pollBufferSize = 0;
+};
+
+//------------------------------------------------------------------------------
+// ae::DatagramSocket class
+//! An unconnected UDP socket that sends and receives individual datagrams to
+//! and from any number of remote hosts, ie. for unreliable snapshot traffic.
+//! Unlike ae::Socket with ae::Socket::Protocol::UDP, datagram boundaries and
+//! source addresses are preserved. Sends and receives are batched with
+//! sendmmsg()/recvmmsg() where available, so many datagrams only require a
+//! single system call.
+//------------------------------------------------------------------------------
+class DatagramSocket
+{
+public:
+	//! An IPv4 or IPv6 address and port. IPv4 addresses are always stored as
+	//! sockaddr_in, including those received by dual stack sockets, so they
+	//! can be compared with addresses from ae::DatagramSocket::GetAddress().
+	struct Address
+	{
+		bool operator == ( const Address& other ) const { return size == other.size && memcmp( data, other.data, size ) == 0; }
+		bool operator != ( const Address& other ) const { return !( *this == other ); }
+		ae::Str64 GetAddressString() const;
+		uint16_t GetPort() const;
+		alignas( 8 ) uint8_t data[ 28 ]; // sockaddr_in or sockaddr_in6
+		uint32_t size = 0;
+	};
+	//! A received datagram. \p data is valid until the next call to
+	//! ae::DatagramSocket::Receive().
+	struct Datagram
+	{
+		const uint8_t* data;
+		uint32_t length;
+		Address address;
+	};
+	
+	DatagramSocket( ae::Tag tag );
+	~DatagramSocket();
+	//! Binds to \p port, or any available port when \p port is zero. When
+	//! \p allowRemote is false only datagrams from this device are received
+	//! over IPv4 loopback, otherwise IPv4 and IPv6 datagrams are received.
+	//! Received datagrams longer than \p maxDatagramSize are discarded.
+	bool Open( bool allowRemote, uint16_t port, uint32_t maxDatagramSize = 1500 );
+	void Close();
+	bool IsOpen() const { return m_sock >= 0; }
+	//! Returns the local port that this socket is bound to or 0 if not open.
+	uint16_t GetPort() const { return m_port; }
+	//! Resolves \p host and \p port to an address that can be used with
+	//! ae::DatagramSocket::QueueDatagram(). IPv4 addresses are preferred.
+	static bool GetAddress( const char* host, uint16_t port, Address* addressOut );
+	
+	//! Queues a single datagram to be sent with ae::DatagramSocket::SendAll().
+	//! \p length must not be larger than the maxDatagramSize given to
+	//! ae::DatagramSocket::Open().
+	bool QueueDatagram( const Address& address, const void* data, uint32_t length );
+	//! Sends queued datagrams and returns the number sent. Datagrams that
+	//! could not be sent because the system send buffer is full stay queued.
+	uint32_t SendAll();
+	//! Returns the number of queued datagrams that have not been sent yet.
+	uint32_t GetPendingSendCount() const { return m_sendDatagrams.Length() - m_sendHead; }
+	//! Receives all pending datagrams, up to an internal maximum, and returns
+	//! the number received. Received datagrams can be accessed with
+	//! ae::DatagramSocket::GetDatagram(). Datagrams from previous calls are
+	//! discarded.
+	uint32_t Receive();
+	const Datagram& GetDatagram( uint32_t index ) const { return m_recvDatagrams[ index ]; }
+	uint32_t GetDatagramCount() const { return m_recvDatagrams.Length(); }
+	
+	//! The max number of datagrams per system call
+	static constexpr uint32_t kBatchSize = 64;
+	//! The max number of datagrams per call to ae::DatagramSocket::Receive()
+	static constexpr uint32_t kMaxReceiveCount = 256;
+
+private:
+	DatagramSocket( const DatagramSocket& ) = delete;
+	bool m_ToSocketAddress( const Address& address, Address* addressOut ) const;
+	static void m_FromSocketAddress( const void* addr, uint32_t addrLength, Address* addressOut );
+	int m_sock = -1;
+	int m_family = 0;
+	uint16_t m_port = 0;
+	uint32_t m_maxDatagramSize = 0;
+	// Sending
+	struct Pending
+	{
+		Address address;
+		uint32_t offset;
+		uint32_t length;
+	};
+	ae::Array< uint8_t > m_sendData;
+	ae::Array< Pending > m_sendDatagrams;
+	uint32_t m_sendHead = 0;
+	// Receiving, kMaxReceiveCount slots of m_maxDatagramSize + 1 bytes
+	ae::Array< uint8_t > m_recvData;
+	ae::Array< Datagram > m_recvDatagrams;
 };
 
 //------------------------------------------------------------------------------
@@ -4520,6 +4805,10 @@ public:
 	Animation( const ae::Tag& tag ) : keyframes( tag ) {}
 	ae::Keyframe GetKeyframeByTime( const char* boneName, float time ) const;
 	ae::Keyframe GetKeyframeByPercent( const char* boneName, float percent ) const;
+	//! Same as ae::Animation::GetKeyframeByPercent(), but samples the given
+	//! track directly to avoid looking up the bone by name. \p boneKeyframes
+	//! should be an entry of ae::Animation::keyframes or null.
+	ae::Keyframe SampleKeyframes( const ae::Array< ae::Keyframe >* boneKeyframes, float percent ) const;
 	void AnimateByTime( class Skeleton* target, float time, float strength, const Bone** mask, uint32_t maskCount ) const;
 	void AnimateByPercent( class Skeleton* target, float percent, float strength, const Bone** mask, uint32_t maskCount ) const;
 	
@@ -4534,24 +4823,158 @@ public:
 class Skeleton
 {
 public:
-	Skeleton( const ae::Tag& tag ) : m_bones( tag ) {}
+	Skeleton( const ae::Tag& tag ) : m_bones( tag ), m_parents( tag ), m_dirty( tag ) {}
 	void Initialize( uint32_t maxBones );
 	void Initialize( const Skeleton* otherPose );
 	const Bone* AddBone( const Bone* parent, const char* name, const ae::Matrix4& localTransform );
+	//! Sets the local transforms of \p targets and then updates the model
+	//! space transforms of only \p targets and their descendants. Prefer
+	//! setting many bones in one call over many calls with one bone each.
 	void SetLocalTransforms( const Bone** targets, const ae::Matrix4* localTransforms, uint32_t count );
 	void SetLocalTransform( const Bone* target, const ae::Matrix4& localTransform );
+	//! Sets the model space transforms of \p targets. Descendants keep their
+	//! model space transforms, so only the local transforms of \p targets and
+	//! their direct children are updated.
 	void SetTransforms( const Bone** targets, const ae::Matrix4* transforms, uint32_t count );
 	void SetTransform( const Bone* target, const ae::Matrix4& transform );
+	//! Sets the local transform of every bone from \p pose and then updates
+	//! all model space transforms in a single pass. \p pose must have been
+	//! initialized with this skeleton or one with a matching hierarchy.
+	void SetLocalPose( const class PoseBuffer& pose );
 	
 	const Bone* GetRoot() const;
 	const Bone* GetBoneByName( const char* name ) const;
 	const Bone* GetBoneByIndex( uint32_t index ) const;
 	const Bone* GetBones() const;
 	uint32_t GetBoneCount() const;
+	//! Returns the ae::Bone::index of each bone's parent, indexed by
+	//! ae::Bone::index. The root's parent index is ae::Skeleton::kInvalidIndex.
+	//! Parents always come before their children.
+	const uint32_t* GetParentIndices() const { return m_parents.Data(); }
+	static constexpr uint32_t kInvalidIndex = ~0u;
 	
 private:
 	Skeleton( const Skeleton& ) = delete;
 	ae::Array< ae::Bone > m_bones;
+	// Flat hierarchy and per bone dirty flags, indexed by ae::Bone::index
+	ae::Array< uint32_t > m_parents;
+	ae::Array< uint8_t > m_dirty;
+};
+
+//------------------------------------------------------------------------------
+// ae::PoseBuffer class
+//! Local (parent to child) bone transforms stored as separate translation,
+//! rotation, and scale arrays, indexed by ae::Bone::index. Sampling and
+//! blending into an ae::PoseBuffer never touches model space transforms, so
+//! many blends can be combined before calling ae::Skeleton::SetLocalPose()
+//! once at the end. All of the blend functions allow \p poseOut to be one of
+//! the input poses.
+//------------------------------------------------------------------------------
+class PoseBuffer
+{
+public:
+	PoseBuffer( const ae::Tag& tag ) : translations( tag ), rotations( tag ), scales( tag ) {}
+	//! Resizes the buffer to \p skeleton's bone count and copies its local transforms.
+	void Initialize( const ae::Skeleton* skeleton );
+	//! Resizes the buffer to \p boneCount and sets all transforms to identity.
+	void Initialize( uint32_t boneCount );
+	uint32_t GetBoneCount() const { return translations.Length(); }
+
+	ae::Keyframe GetKeyframe( uint32_t index ) const;
+	void SetKeyframe( uint32_t index, const ae::Keyframe& keyframe );
+
+	//! Interpolates every bone from \p pose0 to \p pose1 by \p t.
+	static void Lerp( const PoseBuffer& pose0, const PoseBuffer& pose1, float t, PoseBuffer* poseOut );
+	//! Applies the difference between \p additive and \p reference on top of
+	//! \p base, scaled by \p weight. \p reference is usually the first frame of
+	//! the additive animation or the bind pose.
+	static void Additive( const PoseBuffer& base, const PoseBuffer& additive, const PoseBuffer& reference, float weight, PoseBuffer* poseOut );
+	//! Interpolates from \p base to \p layer by \p weight multiplied by the
+	//! per bone \p boneWeights. \p boneWeights must contain one value per bone
+	//! and may be null, in which case this is the same as ae::PoseBuffer::Lerp().
+	static void Layer( const PoseBuffer& base, const PoseBuffer& layer, const float* boneWeights, float weight, PoseBuffer* poseOut );
+
+	ae::Array< ae::Vec3 > translations;
+	ae::Array< ae::Quaternion > rotations;
+	ae::Array< ae::Vec3 > scales;
+};
+
+//------------------------------------------------------------------------------
+// ae::BlendTree class
+//! Describes how animations are sampled and blended together for one skeleton
+//! hierarchy. Nodes are added bottom up, so each node can only reference nodes
+//! that were added before it, and the last node added is the output of the
+//! tree. The tree itself is immutable while evaluating, so one ae::BlendTree
+//! can be shared between any number of characters which each provide their
+//! own parameters. Each node has a single float parameter:
+//! - Clip: the animation percent, see ae::Animation::GetKeyframeByPercent()
+//! - Lerp: the interpolation value from the first to the second node
+//! - Additive: the strength of the additive node
+//! - Layer: the strength of the layer, multiplied by the per bone weights
+//------------------------------------------------------------------------------
+class BlendTree
+{
+public:
+	enum class NodeType
+	{
+		Clip,
+		Lerp,
+		Additive,
+		Layer
+	};
+	//! A single character to be updated by ae::BlendTree::Update().
+	struct Character
+	{
+		//! One value per node, see ae::BlendTree::GetNodeCount()
+		const float* params = nullptr;
+		//! The final pose is written here with ae::Skeleton::SetLocalPose()
+		ae::Skeleton* skeleton = nullptr;
+	};
+
+	BlendTree( const ae::Tag& tag );
+	//! Clears all nodes. Animation tracks are matched to the bones of
+	//! \p bindPose by name when clips are added.
+	void Initialize( const ae::Skeleton* bindPose );
+	//! Returns the index of the new node.
+	uint32_t AddClip( const ae::Animation* animation );
+	//! Returns the index of the new node.
+	uint32_t AddLerp( uint32_t node0, uint32_t node1 );
+	//! Returns the index of the new node. See ae::PoseBuffer::Additive().
+	uint32_t AddAdditive( uint32_t base, uint32_t additive, uint32_t reference );
+	//! Returns the index of the new node. \p boneWeights must contain one
+	//! value per bone of the bind pose, see ae::PoseBuffer::Layer().
+	uint32_t AddLayer( uint32_t base, uint32_t layer, const float* boneWeights );
+
+	uint32_t GetNodeCount() const { return m_nodes.Length(); }
+	NodeType GetNodeType( uint32_t node ) const { return m_nodes[ node ].type; }
+	uint32_t GetBoneCount() const { return m_boneCount; }
+
+	//! Evaluates the tree with \p params (one value per node) and writes the
+	//! local pose to \p poseOut. \p scratch is used for intermediate results
+	//! and should be reused between calls to avoid allocations.
+	void Evaluate( const float* params, ae::Array< ae::PoseBuffer >* scratch, ae::PoseBuffer* poseOut ) const;
+	//! Evaluates the tree for each of \p characters and applies the result to
+	//! each character's skeleton, so model space transforms are only computed
+	//! once per character. Characters are split between the threads of
+	//! \p workerPool when provided, in which case each character must have
+	//! a unique ae::Skeleton.
+	void Update( const Character* characters, uint32_t count, ae::WorkerPool* workerPool = nullptr ) const;
+
+private:
+	BlendTree( const BlendTree& ) = delete;
+	struct Node
+	{
+		NodeType type = NodeType::Clip;
+		uint32_t inputs[ 3 ] = { 0, 0, 0 };
+		const ae::Animation* animation = nullptr;
+		uint32_t tracksOffset = 0; // Into m_tracks for clips, or m_boneWeights for layers
+	};
+	const ae::Tag m_tag;
+	uint32_t m_boneCount = 0;
+	ae::Array< Node > m_nodes;
+	ae::Array< const ae::Array< ae::Keyframe >* > m_tracks;
+	ae::Array< float > m_boneWeights;
+	ae::Array< ae::Str64 > m_boneNames;
 };
 
 //------------------------------------------------------------------------------
@@ -4579,6 +5002,16 @@ struct IKConstraints
 	float twistLimits[ 2 ] = { -ae::QuarterPi, ae::QuarterPi };
 };
 
+//! \cond INTERNAL
+struct _IKBone
+{
+	ae::Vec3 pos;
+	ae::Quaternion rotation;
+	float length; // Fixed distance between pos and parent pos
+	float defaultTwist; // The bind pose twist angle between this bone and its parent
+};
+//! \endcond
+
 //------------------------------------------------------------------------------
 // ae::IK struct
 //------------------------------------------------------------------------------
@@ -4629,6 +5062,97 @@ struct IK
 	}
 };
 
+//------------------------------------------------------------------------------
+// ae::IKSolver class
+//! Solves many independent IK chains (feet, hands, look-at, etc) across many
+//! characters. Chains are solved in place on the ae::Skeleton they were added
+//! with, and each chain starts from its previous solution relative to the
+//! chain's parent bone so that only a few iterations are needed each frame.
+//! Chains that share an ae::Skeleton are solved in the order they were added
+//! on the same thread, while separate ae::Skeletons may be solved in parallel.
+//------------------------------------------------------------------------------
+class IKSolver
+{
+public:
+	struct Stats
+	{
+		//! The number of chains solved by the last call to ae::IKSolver::Solve()
+		uint32_t chainCount = 0;
+		//! The total number of iterations of all chains
+		uint32_t iterationCount = 0;
+		//! The number of chains whose extent ended within the tolerance of its target
+		uint32_t convergedCount = 0;
+		//! The number of chains that were stopped early because of the time budget
+		uint32_t budgetExceededCount = 0;
+		//! Wall time in seconds spent in ae::IKSolver::Solve()
+		double solveTime = 0.0;
+		float GetAverageIterations() const { return chainCount ? iterationCount / (float)chainCount : 0.0f; }
+	};
+
+	IKSolver( const ae::Tag& tag );
+	//! Adds a chain of \p boneCount bone indices, ordered from root to extent,
+	//! which will be solved in place on \p pose. \p bindPose is referenced for
+	//! bone lengths and joint limits. \p joints may be null to use the default
+	//! ae::IKConstraints, have a single entry which is used for all bones, or
+	//! have one entry per chain bone. Returns an index to be used with
+	//! ae::IKSolver::SetTarget(). \p pose and \p bindPose must outlive the
+	//! chain.
+	uint32_t AddChain( ae::Skeleton* pose, const ae::Skeleton* bindPose, const uint32_t* bones, uint32_t boneCount, const ae::IKConstraints* joints = nullptr, uint32_t jointCount = 0 );
+	//! Sets the model space transform that the extent of \p chain will reach for.
+	void SetTarget( uint32_t chain, const ae::Matrix4& targetTransform );
+	//! The next solve of \p chain will start from its ae::Skeleton pose
+	//! instead of its previous solution, ie. after a character teleports.
+	void Reset( uint32_t chain );
+	//! Removes all chains.
+	void Clear();
+	uint32_t GetChainCount() const { return m_chains.Length(); }
+	
+	//! Solves every chain and writes the results to their ae::Skeletons. Chains
+	//! stop iterating once their extent is within \p tolerance of their target,
+	//! after \p maxIterations, or once \p timeBudget seconds have passed since
+	//! this function was called (zero for no limit). Every chain is iterated at
+	//! least once unless its previous solution is already within tolerance.
+	//! When \p workerPool is provided separate ae::Skeletons are solved in
+	//! parallel.
+	void Solve( ae::WorkerPool* workerPool = nullptr );
+	const Stats& GetStats() const { return m_stats; }
+
+	uint32_t maxIterations = 10;
+	float tolerance = 0.001f;
+	double timeBudget = 0.0;
+
+private:
+	IKSolver( const IKSolver& ) = delete;
+	void m_SolveChain( uint32_t index, double deadline );
+	struct Chain
+	{
+		ae::Skeleton* pose;
+		const ae::Skeleton* bindPose;
+		ae::Matrix4 targetTransform;
+		uint32_t bonesOffset;
+		uint32_t boneCount;
+		uint32_t jointsOffset;
+		uint32_t jointCount;
+		uint32_t next; // Next chain with the same pose
+		bool warm;
+		// Results of the last solve
+		uint32_t iterations;
+		bool converged;
+		bool budgetExceeded;
+	};
+	ae::Tag m_tag;
+	ae::Array< Chain > m_chains;
+	ae::Array< uint32_t > m_bones;
+	ae::Array< ae::IKConstraints > m_joints;
+	//! Solved chain bones relative to each chain's parent bone, used as the
+	//! starting point of the next solve. Indexed by Chain::bonesOffset.
+	ae::Array< ae::_IKBone > m_solutions;
+	ae::Array< ae::_IKBone > m_working;
+	//! The first chain of each ae::Skeleton, followed by Chain::next
+	ae::Map< const ae::Skeleton*, uint32_t > m_groups;
+	Stats m_stats;
+};
+
 //------------------------------------------------------------------------------
 // ae::Skin class
 //------------------------------------------------------------------------------
@@ -4643,22 +5167,64 @@ public:
 		uint16_t bones[ kMaxSkinWeights ];
 		uint8_t weights[ kMaxSkinWeights ] = { 0 };
 	};
+	//! How bone transforms are blended for each vertex.
+	enum class Mode
+	{
+		//! Bone matrices are blended linearly. Supports bone scale.
+		LinearBlend,
+		//! Bone transforms are blended as dual quaternions, which preserves
+		//! volume around twisting joints. Bone scale is ignored.
+		DualQuaternion
+	};
+	//! A compact affine bone transform, the first three rows of the column
+	//! major ae::Matrix4 from bind pose to posed model space. An array of these
+	//! can be uploaded as-is with ae::InstanceData::UploadData() (stride 48,
+	//! three vec4 attributes) or to a vec4 uniform array for GPU skinning,
+	//! where position = vec3( dot( row0, p ), dot( row1, p ), dot( row2, p ) )
+	//! with p = vec4( position, 1.0 ).
+	struct Bone3x4
+	{
+		ae::Vec4 rows[ 3 ];
+	};
+	//! A rigid bone transform from bind pose to posed model space, stored as a
+	//! unit dual quaternion. Can be uploaded as two vec4's per bone.
+	struct BoneDualQuaternion
+	{
+		ae::Quaternion real;
+		ae::Quaternion dual;
+	};
 	
 	Skin( const ae::Tag& tag ) : m_bindPose( tag ), m_verts( tag ) {}
 	void Initialize( const Skeleton& bindPose, const ae::Skin::Vertex* vertices, uint32_t vertexCount );
+	//! Selects how ae::Skin::ApplyPoseToMesh() blends bones. Defaults to
+	//! ae::Skin::Mode::LinearBlend.
+	void SetMode( ae::Skin::Mode mode ) { m_mode = mode; }
+	ae::Skin::Mode GetMode() const { return m_mode; }
 	
 	const class Skeleton& GetBindPose() const;
 	const ae::Matrix4& GetInvBindPose( const char* name ) const;
 	
-	void ApplyPoseToMesh( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count ) const;
+	//! Writes the skinned position and normal of each vertex to \p positionsOut
+	//! and \p normalsOut. Influences with a weight of zero are skipped, and the
+	//! bone transforms of each vertex are blended before transforming it. When
+	//! \p workerPool is provided vertices are skinned in parallel chunks.
+	void ApplyPoseToMesh( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool = nullptr ) const;
+	//! Writes one entry per bone (see ae::Skin::GetBoneCount()) to \p paletteOut.
+	void GetPalette( const Skeleton* pose, ae::Skin::Bone3x4* paletteOut ) const;
+	//! Writes one entry per bone (see ae::Skin::GetBoneCount()) to \p paletteOut.
+	void GetPalette( const Skeleton* pose, ae::Skin::BoneDualQuaternion* paletteOut ) const;
 	
 	uint32_t GetBoneCount() const { return m_bindPose.GetBoneCount(); }
 	uint32_t GetVertCount() const { return m_verts.Length(); }
 	
 private:
 	Skin( const Skin& ) = delete;
+	ae::Matrix4 m_GetSkinTransform( const Skeleton* pose, uint32_t index ) const;
+	void m_ApplyLinearBlend( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool ) const;
+	void m_ApplyDualQuaternion( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool ) const;
 	Skeleton m_bindPose;
 	ae::Array< Vertex > m_verts;
+	ae::Skin::Mode m_mode = ae::Skin::Mode::LinearBlend;
 };
 
 //------------------------------------------------------------------------------
@@ -4831,6 +5397,44 @@ public:
 	//! writing. Use this with caution as platforms will have different struct
 	//! packing, byte order, and alignment.
 	void SerializeRaw( void* dataInOut, uint32_t length );
+	
+	//! Serialize the low \p bitCount bits (1-32) of \p valInOut. Consecutive
+	//! calls to SerializeBits() (and the quantized functions below) are packed
+	//! together, and all other serialization functions start at the next byte.
+	void SerializeBits( uint32_t& valInOut, uint32_t bitCount );
+	//! Serialize an unsigned integer as a variable length LEB128 integer, using
+	//! 1 byte for values less than 128 and at most 5 bytes (10 bytes for 64 bit
+	//! values). Use for lengths, counts, ids, etc. that are usually small.
+	void SerializeVarUint32( uint32_t& valInOut );
+	void SerializeVarUint64( uint64_t& valInOut );
+	//! Serialize a signed integer as a zig-zag encoded variable length integer,
+	//! so that values close to zero (positive or negative) use fewer bytes.
+	void SerializeVarInt32( int32_t& valInOut );
+	void SerializeVarInt64( int64_t& valInOut );
+	//! Serialize \p valInOut with \p bitCount bits (1-32), where the value is
+	//! clamped between \p min and \p max. The precision of read values is
+	//! ( max - min ) / ( 2^bitCount - 1 ). \p min, \p max, and \p bitCount must
+	//! match when reading and writing.
+	void SerializeQuantizedFloat( float& valInOut, float min, float max, uint32_t bitCount );
+	//! Serialize a normalized quaternion with the 'smallest three' method,
+	//! using 2 + 3 * \p bitsPerComponent bits. The sign of the read quaternion
+	//! may be flipped, which represents the same rotation.
+	void SerializeQuaternion( ae::Quaternion& valInOut, uint32_t bitsPerComponent = 10 );
+	//! Serialize \p count elements of \p dataInOut with a single bounds check.
+	//! The count is not serialized, so the same count must be used for reading
+	//! and writing. T may be an arithmetic type, ae::Vec2, ae::Vec3, ae::Vec4,
+	//! ae::Quaternion, ae::Matrix4, ae::Color, ae::Int2, or ae::Int3. Elements
+	//! are stored as tightly packed little endian values (ae::Vec3 is stored as
+	//! 12 bytes), so unlike SerializeRaw() the data is portable. On little
+	//! endian platforms this is a single memcpy for all types except ae::Vec3
+	//! and ae::Int3.
+	template< typename T > void SerializeArray( T* dataInOut, uint32_t count );
+	//! Serialize the length of \p arrayInOut as a variable length integer
+	//! followed by all elements as in SerializeArray( T*, uint32_t ). When
+	//! reading, \p arrayInOut is replaced with the read elements. The stream is
+	//! invalidated if the read length exceeds the remaining stream data or the
+	//! size of a static array.
+	template< typename T, uint32_t N > void SerializeArray( ae::Array< T, N >& arrayInOut );
 
 	//! Invalidates the stream for future reading and writing. Use this when
 	//! a serialization issue is detected. Use in conjunction with IsValid().
@@ -4868,12 +5472,17 @@ protected:
 	uint8_t* m_data = nullptr;
 	uint32_t m_length = 0;
 	uint32_t m_offset = 0;
+	uint32_t m_bitOffset = 0; // Bits used in the last byte by SerializeBits()
 	Array< uint8_t >* m_extArray = nullptr;
 	BinaryStream() = default;
 	BinaryStream( Mode mode, void* data, uint32_t size ); // Read or write
 	BinaryStream( Mode mode, const void* data, uint32_t size ); // Read only
 	BinaryStream( Array< uint8_t >*array ); // Write only
 	AE_DISABLE_COPY_ASSIGNMENT( BinaryStream );
+	// Serializes count elements of stride bytes, each made of componentCount
+	// little endian values of componentSize bytes
+	void m_SerializeElements( void* data, uint32_t count, uint32_t stride, uint32_t componentSize, uint32_t componentCount );
+	void m_SerializeScalar( void* data, uint32_t size );
 	// Prevent Serialize functions from being called accidentally through automatic conversions
 	template < typename T > void SerializeUint8( T ) = delete;
 	template < typename T > void SerializeUint16( T ) = delete;
@@ -4887,6 +5496,10 @@ protected:
 	template < typename T > void SerializeDouble( T ) = delete;
 	template < typename T > void SerializeBool( T ) = delete;
 	template < typename T > void SerializeString( T ) = delete;
+	template < typename T > void SerializeVarUint32( T ) = delete;
+	template < typename T > void SerializeVarUint64( T ) = delete;
+	template < typename T > void SerializeVarInt32( T ) = delete;
+	template < typename T > void SerializeVarInt64( T ) = delete;
 };
 
 //------------------------------------------------------------------------------
@@ -4928,6 +5541,21 @@ public:
 	//! Use this with caution as platforms will have different struct packing,
 	//! byte order, and alignment.
 	void SerializeRaw( const void* dataIn, uint32_t length );
+	//! See ae::BinaryStream::SerializeBits().
+	void SerializeBits( const uint32_t& valIn, uint32_t bitCount );
+	//! See ae::BinaryStream::SerializeVarUint32().
+	void SerializeVarUint32( const uint32_t& valIn );
+	void SerializeVarUint64( const uint64_t& valIn );
+	//! See ae::BinaryStream::SerializeVarInt32().
+	void SerializeVarInt32( const int32_t& valIn );
+	void SerializeVarInt64( const int64_t& valIn );
+	//! See ae::BinaryStream::SerializeQuantizedFloat().
+	void SerializeQuantizedFloat( const float& valIn, float min, float max, uint32_t bitCount );
+	//! See ae::BinaryStream::SerializeQuaternion().
+	void SerializeQuaternion( const ae::Quaternion& valIn, uint32_t bitsPerComponent = 10 );
+	//! See ae::BinaryStream::SerializeArray().
+	template< typename T > void SerializeArray( const T* dataIn, uint32_t count );
+	template< typename T, uint32_t N > void SerializeArray( const ae::Array< T, N >& arrayIn );
 
 	//! See ae::BinaryStream::SerializeString(). This function only prevents
 	//! shadowing of the base class function.
@@ -4975,8 +5603,8 @@ struct NetId
 	bool operator!=( const NetId& o ) const { return o.m_id != m_id; }
 	explicit operator bool () const { return m_id != 0; }
 	uint32_t GetInternalId() const { return m_id; }
-	void Serialize( BinaryStream* s ) { s->SerializeUint32( m_id ); }
-	void Serialize( BinaryWriter* w ) const { w->SerializeUint32( m_id ); }
+	void Serialize( BinaryStream* s ) { s->SerializeVarUint32( m_id ); }
+	void Serialize( BinaryWriter* w ) const { w->SerializeVarUint32( m_id ); }
 private:
 	uint32_t m_id = 0;
 };
@@ -5013,7 +5641,12 @@ public:
 	//! call ae::NetObject::GetInitData() to get the data set here.
 	void SetInitData( const void* initData, uint32_t initDataLength );
 	//! Call SetSyncData each frame to update that state of the clients NetObject.
-	//! Only the most recent data is sent. Data is only sent when changed.
+	//! Only the most recent data is sent. Data is only sent when changed (the
+	//! data is compared to the current sync data here, so calling this with
+	//! unchanged data is cheap and idle objects cost nothing in
+	//! ae::NetObjectServer::UpdateSendData()), and
+	//! is delta compressed against the data last sent to each connection, so
+	//! small changes to large sync data only cost a few bytes.
 	void SetSyncData( const void* data, uint32_t length );
 	//! Call as many times as necessary each tick
 	void SendMessage( const void* data, uint32_t length );
@@ -5056,8 +5689,7 @@ private:
 	void m_SetClientData( const uint8_t* data, uint32_t length );
 	void m_ReceiveMessages( const uint8_t* data, uint32_t length );
 	void m_FlagForDestruction() { m_isPendingDestroy = true; }
-	void m_UpdateHash();
-	bool m_Changed() const { return m_hash != m_prevHash; }
+	bool m_Changed() const { return m_changed; }
 
 	NetId m_id;
 	bool m_local = false;
@@ -5065,9 +5697,24 @@ private:
 	ae::Array< uint8_t > m_data = AE_ALLOC_TAG_NET;
 	ae::Array< uint8_t > m_messageDataOut = AE_ALLOC_TAG_NET;
 	ae::Array< uint8_t > m_messageDataIn = AE_ALLOC_TAG_NET;
+	ae::Array< uint8_t > m_syncBaseline = AE_ALLOC_TAG_NET; // Client only, last received sync data that deltas are applied to
 	uint32_t m_messageDataInOffset = 0;
-	uint32_t m_hash = 0;
-	uint32_t m_prevHash = 0;
+	// Server only, update data shared by all connections
+	class NetObjectServer* m_server = nullptr;
+	bool m_dirty = false; // In NetObjectServer::m_dirtyObjects
+	bool m_changed = false; // Sync data changed this tick
+	struct SharedEntry
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
+	};
+	ae::Array< uint8_t > m_prevData = AE_ALLOC_TAG_NET; // Sync data from the previous tick
+	uint32_t m_version = 0; // Incremented each tick the sync data changes
+	uint32_t m_slot = ~0u; // Index of this object in each connections interest
+	SharedEntry m_deltaEntry; // Delta from m_prevData, valid when changed this tick
+	SharedEntry m_fullEntry; // Valid when m_fullEntryTick is the current tick
+	SharedEntry m_messageEntry;
+	uint32_t m_fullEntryTick = 0;
 	bool m_isPendingInit = true;
 	bool m_isPendingDestroy = false;
 };
@@ -5116,21 +5763,69 @@ class NetObjectConnection
 public:
 	//! This data should be sent to a client with and consumed with
 	//! ae::NetObjectClient::ReceiveData(). Call ae::NetObjectServer::UpdateSendData()
-	//! once each network tick before calling this.
+	//! once each network tick before calling this. The data must be delivered
+	//! reliably and in order, as sync data is delta compressed against the
+	//! data previously sent to this connection.
 	const uint8_t* GetSendData() const;
 	//! The length of the data that should be sent to a client with and consumed
 	//! with ae::NetObjectClient::ReceiveData(). Call ae::NetObjectServer::UpdateSendData()
 	//! once each network tick before calling this.
 	uint32_t GetSendLength() const;
+	
+	//! Called for each ae::NetObject during ae::NetObjectServer::UpdateSendData()
+	//! to get its priority for this connection, ie. based on the distance to
+	//! the connection's player. Objects are only created on this connection's
+	//! client while \p fn returns a priority greater than zero, and are
+	//! destroyed on the client when it returns zero or less. Unsent creates
+	//! and updates accumulate their priority each tick, so lower priority
+	//! objects are eventually sent when the bandwidth budget is limited. All
+	//! objects have a priority of 1 if no function is set.
+	void SetPriorityFn( std::function< float( const ae::NetObject* netObject ) > fn ) { m_priorityFn = fn; }
+	//! Limits the creates and updates sent to this connection each tick to
+	//! about \p bytesPerTick, sending the highest priority objects first. At
+	//! least one create or update is always sent each tick. Destroy events and
+	//! messages are not limited. Zero (the default) means no limit.
+	void SetBandwidthBudget( uint32_t bytesPerTick ) { m_bandwidthBudget = bytesPerTick; }
+	//! Returns true if \p netObject has been created on this connection's
+	//! client. Messages sent with ae::NetObject::SendMessage() are only sent to
+	//! connections where the object has been created.
+	bool IsReplicated( const ae::NetObject* netObject ) const;
 
 public:
 	void m_UpdateSendData();
 	void m_ClearPending();
+	void m_DestroyNetObject( const NetObject* netObject );
 
 	bool m_first = true;
 	class NetObjectServer* m_replicaDB = nullptr;
 	bool m_pendingClear = false;
 	ae::Array< uint8_t > m_connData = AE_ALLOC_TAG_NET;
+	ae::Array< uint8_t > m_createData = AE_ALLOC_TAG_NET;
+	ae::Array< uint8_t > m_updateData = AE_ALLOC_TAG_NET;
+	// Interest in each NetObject, indexed by NetObject::m_slot
+	struct Interest
+	{
+		enum class State : uint8_t
+		{
+			None,
+			Pending, // Relevant but not created on the client yet
+			Created
+		};
+		float priority = 0.0f;
+		uint32_t version = 0; // NetObject::m_version last sent to the client
+		State state = State::None;
+	};
+	struct Candidate
+	{
+		NetObject* netObject;
+		float priority;
+	};
+	ae::Array< Interest > m_interest = AE_ALLOC_TAG_NET;
+	ae::Array< Candidate > m_candidates = AE_ALLOC_TAG_NET;
+	// All objects were created and up to date after the previous tick
+	bool m_upToDate = false;
+	std::function< float( const ae::NetObject* ) > m_priorityFn;
+	uint32_t m_bandwidthBudget = 0;
 	// Internal
 	enum class EventType : uint8_t
 	{
@@ -5169,8 +5864,24 @@ public:
 	void DestroyConnection( NetObjectConnection* connection );
 
 private:
+	friend class NetObject;
+	friend class NetObjectConnection;
+	const NetObject::SharedEntry& m_GetFullEntry( NetObject* netObject );
 	uint32_t m_signature = 0;
 	uint32_t m_lastNetId = 0;
+	uint32_t m_tick = 0;
+	// Update and message entries encoded once each tick and copied into
+	// each connection's send data
+	ae::Array< uint8_t > m_sharedData = AE_ALLOC_TAG_NET;
+	// Objects with modified sync data or messages since the last tick
+	ae::Array< NetObject* > m_dirtyObjects = AE_ALLOC_TAG_NET;
+	ae::Array< NetObject* > m_messageObjects = AE_ALLOC_TAG_NET;
+	// Objects created or with changed sync data this tick
+	ae::Array< NetObject* > m_newObjects = AE_ALLOC_TAG_NET;
+	ae::Array< NetObject* > m_changedObjects = AE_ALLOC_TAG_NET;
+	// Connection interest indices, see NetObject::m_slot
+	uint32_t m_slotCount = 0;
+	ae::Array< uint32_t > m_freeSlots = AE_ALLOC_TAG_NET;
 	ae::Array< NetObject* > m_pendingCreate = AE_ALLOC_TAG_NET;
 	ae::Map< NetId, NetObject*, 0, ae::MapMode::Stable > m_netObjects = AE_ALLOC_TAG_NET;
 	ae::Array< NetObjectConnection* > m_connections = AE_ALLOC_TAG_NET; // @TODO: Rename m_connections
@@ -5371,9 +6082,10 @@ const ae::TypeId kInvalidTypeId = 0;
 //! This value can be overridden by defining AE_MAX_META_TYPES_CONFIG. See
 //! AE_CONFIG_FILE for more details.
 const uint32_t kMaxMetaTypes = AE_MAX_META_TYPES_CONFIG;
-//! The maximum number of variables that can be registered per type with
-//! AE_REGISTER_CLASS_VAR(). This value can be overridden by defining
-//! AE_MAX_META_VARS_CONFIG. See AE_CONFIG_FILE for more details.
+//! Deprecated, the number of vars that can be registered per type with
+//! AE_REGISTER_CLASS_VAR() is no longer limited. Defining
+//! AE_MAX_META_VARS_CONFIG has no effect and this value is only kept so
+//! existing references still compile.
 const uint32_t kMaxMetaVars = AE_MAX_META_VARS_CONFIG;
 //! The maximum number of enum types that can be registered with the
 //! AE_REGISTER_ENUM*() functions. This value can be overridden by defining
@@ -5446,6 +6158,12 @@ const class Enum* GetEnum( const char* enumName );
 ae::TypeId GetObjectTypeId( const ae::Object* obj );
 //! Get a registered ae::TypeId from a type name
 ae::TypeId GetTypeIdFromName( const char* name );
+//! Allows ae::BinaryStream::SerializeObject() to be called with any registered
+//! type that doesn't implement its own Serialize() function. See
+//! ae::Type::SerializeObject() for more info.
+void Serialize( ae::BinaryStream* stream, ae::Object* obj );
+void Serialize( ae::BinaryWriter* stream, const ae::Object* obj );
+inline void Serialize( ae::BinaryWriter* stream, ae::Object* obj ) { Serialize( stream, (const ae::Object*)obj ); }
 	
 //------------------------------------------------------------------------------
 // ae::Enum class
@@ -5689,10 +6407,47 @@ public:
 	//bool HasPropertyValue( const char* propName, const char* value ) const; // @TODO
 		
 	// Vars
+	//! Returns the number of vars registered with AE_REGISTER_CLASS_VAR() on
+	//! this type, including vars of all parent types when \p parents is true.
 	uint32_t GetVarCount( bool parents ) const;
+	//! When \p parents is true vars of parent types come first, so index 0 is
+	//! the first var of the root type. Vars of each type are ordered by offset.
 	const ae::Var* GetVarByIndex( uint32_t i, bool parents ) const;
+	//! Hashed lookup of the var named \p name. When \p parents is true and
+	//! multiple types in the hierarchy have a var named \p name, the var of
+	//! the most derived type is returned.
 	const ae::Var* GetVarByName( const char* name, bool parents ) const;
 
+	// Binary serialization
+	//! Reads or writes all registered vars of \p obj (including parent vars)
+	//! directly from/to \p stream without string conversion. Each var is
+	//! tagged with a hash of its name and its ae::BasicType, so vars that have
+	//! been added, removed, reordered, or changed type since the data was
+	//! written are skipped. Vars are also tagged with the inheritance depth of
+	//! the type that declares them, so vars that shadow a parent var with the
+	//! same name are read back into the correct var. Class vars are serialized
+	//! recursively. Pointer and CustomRef vars are converted to strings with
+	//! ae::Var::Serializer as with ae::Var::GetObjectValueAsString(). \p obj
+	//! must be this type or inherit from it.
+	void SerializeObject( ae::BinaryStream* stream, ae::Object* obj ) const;
+	void SerializeObject( ae::BinaryWriter* stream, const ae::Object* obj ) const;
+	void SerializeObject( ae::BinaryWriter* stream, ae::Object* obj ) const { SerializeObject( stream, (const ae::Object*)obj ); }
+	//! Writes only the given \p vars of \p obj in the same format as
+	//! SerializeObject(). Reading the result with SerializeObject() sets just
+	//! these vars and leaves all other vars unchanged, which is useful for
+	//! sending modifications. Each var must be a var of this type or one of its
+	//! parents.
+	void SerializeVars( ae::BinaryWriter* stream, const ae::Object* obj, const ae::Var* const* vars, uint32_t varCount ) const;
+
+	// Copying
+	//! Copies all registered vars (including parent vars) from \p src to
+	//! \p dst, which must both be this type or inherit from it. Adjacent
+	//! trivially copyable vars are copied together with a single memcpy.
+	//! Dynamic arrays are resized to match, Class vars are copied recursively
+	//! with their own registered vars, and CustomRef vars are copied through
+	//! their string representation. Unregistered members are not modified.
+	void CopyVars( ae::Object* dst, const ae::Object* src ) const;
+
 	// C++ type info
 	template < typename T = ae::Object > T* New( void* obj ) const;
 	//! Creates a temporary instance of this type and copies the vtable from
@@ -5710,8 +6465,25 @@ public:
 	// Inheritance info
 	const char* GetParentTypeName() const;
 	const Type* GetParentType() const;
+	//! Returns the number of registered ancestors of this type, so 0 for
+	//! ae::Object and types with an unregistered parent.
+	uint32_t GetInheritanceDepth() const;
+	//! Returns true if this type is \p otherType or inherits from it. This is
+	//! a constant time check against cached inheritance ranges, which are
+	//! rebuilt on first use after any types are registered or unregistered.
 	bool IsType( const Type* otherType ) const;
 	template < typename T > bool IsType() const;
+
+	// Cached info
+	//! Marks the cached inheritance info and var tables of all types as out of
+	//! date, so they're rebuilt by the next ae::Type accessor call. This
+	//! happens automatically when types, vars, or enums are registered or
+	//! unregistered. Rebuilding is locked so the first accessor calls after
+	//! this can be made from multiple threads at once. Calling this or
+	//! registering/unregistering types while other threads are using any
+	//! ae::Type is not supported, because threads that are already reading
+	//! the cached info aren't synchronized with the rebuild.
+	static void InvalidateCachedInfo();
 		
 	//------------------------------------------------------------------------------
 	// Internal
@@ -5725,18 +6497,98 @@ public:
 	void m_AddProp( const char* prop, const char* value );
 	void m_AddVar( const Var& var );
 private:
+	static void m_UpdateHierarchy();
+	uint32_t m_NumberHierarchy( uint32_t preOrder, uint32_t depth ) const;
 	ae::Object* ( *m_placementNew )( ae::Object* ) = nullptr;
 	ae::Str64 m_name;
 	ae::TypeId m_id = ae::kInvalidTypeId;
 	uint32_t m_size = 0;
 	uint32_t m_align = 0;
 	ae::Map< ae::Str32, ae::Array< ae::Str32, kMaxMetaPropListLength >, kMaxMetaProps > m_props;
-	ae::Array< Var, kMaxMetaVars > m_vars;
+	// Vars are registered during static initialization before a custom
+	// ae::Allocator can be set, so they are stored in a std::vector
+	std::vector< Var > m_vars;
 	ae::Str32 m_parent;
 	bool m_isAbstract = false;
 	bool m_isPolymorphic = false;
 	bool m_isDefaultConstructible = false;
 	bool m_isFinal = false;
+	// Inheritance info cached by m_UpdateHierarchy(). Descendants of this type
+	// are numbered m_preOrder + 1 through m_lastDescendant.
+	mutable const Type* m_parentType = nullptr;
+	mutable const Type* m_firstChild = nullptr;
+	mutable const Type* m_nextSibling = nullptr;
+	mutable uint32_t m_depth = 0;
+	mutable uint32_t m_preOrder = 0;
+	mutable uint32_t m_lastDescendant = 0;
+	// All vars including parent vars, and an open addressing hash table of
+	// m_allVars indices by var name (-1 for empty slots)
+	mutable std::vector< const Var* > m_allVars;
+	mutable std::vector< int32_t > m_varLookup;
+	// Binary serialization plan for each var in m_allVars
+	struct SerializeOp
+	{
+		const ae::Var* var;
+		const ae::VarTypeArray* array; // Null for non-array vars
+		const ae::Type* subType; // Class vars only
+		uint32_t nameHash;
+		uint8_t ownerDepth; // Distinguishes shadowed vars with the same name
+		uint32_t offset;
+		uint32_t size; // Size of each element
+		uint32_t wireSize; // Size of each serialized element, 0 when variable
+		uint8_t tag; // ae::BasicType and kArrayTag
+		bool isSigned; // Enum vars only
+	};
+	static const uint8_t kArrayTag = 0x80;
+	mutable std::vector< SerializeOp > m_serializeOps;
+	void m_SerializeOp( ae::BinaryStream* stream, const SerializeOp& op, ae::Object* obj ) const;
+	static void m_SerializeElements( ae::BinaryStream* stream, const SerializeOp& op, ae::Object* obj, void* data, uint32_t count );
+	static void m_SkipObject( ae::BinaryReader* stream );
+	static void m_SkipOp( ae::BinaryReader* stream, uint8_t tag, uint32_t count = 1 );
+	// CopyVars() plan. Runs of adjacent trivially copyable vars are merged
+	// into a single op with a negative serializeOp index.
+	struct CopyOp
+	{
+		int32_t serializeOp;
+		uint32_t offset;
+		uint32_t size;
+	};
+	mutable std::vector< CopyOp > m_copyOps;
+	static void m_CopyElements( const SerializeOp& op, void* dst, const void* src, uint32_t count );
+};
+
+//------------------------------------------------------------------------------
+// ae::VarAccessor class
+//! Typed access to a registered ae::Var without the per call checks of
+//! ae::Var::GetObjectValue() and ae::Var::SetObjectValue(). The var is
+//! validated once by Bind(), after which Get() and Set() only offset into the
+//! given object. T must be the exact registered type of the var, so a var
+//! declared as 'ae::Array< float, 8 > weights' is accessed with
+//! ae::VarAccessor< ae::Array< float, 8 > >. CustomRef vars can't be bound.
+//------------------------------------------------------------------------------
+template < typename T >
+class VarAccessor
+{
+public:
+	VarAccessor() = default;
+	//! Calls Bind() with \p var
+	VarAccessor( const ae::Var* var );
+	//! Returns true if \p var is not null and its registered type is T,
+	//! otherwise the accessor is unbound and false is returned.
+	bool Bind( const ae::Var* var );
+	bool IsBound() const { return m_var != nullptr; }
+	const ae::Var* GetVar() const { return m_var; }
+
+	//! Returns a reference to the bound var of \p obj. The accessor must be
+	//! bound and \p obj must be the var's owner type or inherit from it.
+	T& Get( ae::Object* obj ) const;
+	const T& Get( const ae::Object* obj ) const;
+	//! Sets the bound var of \p obj to \p value. See Get().
+	void Set( ae::Object* obj, const T& value ) const { Get( obj ) = value; }
+
+private:
+	const ae::Var* m_var = nullptr;
+	uint32_t m_offset = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -5856,6 +6708,12 @@ struct _Globals
 
 	// Reflection
 	uint32_t metaCacheSeq = 0;
+	// metaCacheSeq when the ae::Type inheritance info and var tables were last
+	// built. They're built lazily by the first const ae::Type accessor called,
+	// which can happen on multiple threads at once, so building is locked.
+	// Readers of the built info aren't locked, see ae::Type::InvalidateCachedInfo().
+	std::atomic< uint32_t > typeHierarchySeq = { ~0u };
+	std::mutex typeHierarchyLock;
 	ae::Map< std::string, Enum, kMaxMetaEnumTypes > enums;
 	ae::Map< ae::Str64, Type*, kMaxMetaTypes > typeNameMap;
 	ae::Map< ae::TypeId, Type*, kMaxMetaTypes > typeIdMap;
@@ -8372,10 +9230,21 @@ T* Array< T, N >::AppendArray( const T* values, uint32_t count )
 	Reserve( m_length + count );
 	AE_DEBUG_ASSERT( m_size >= m_length + count );
 	T* result = m_array + m_length;
-	for ( uint32_t i = 0; i < count; i++ )
+	if constexpr( std::is_trivially_copyable< T >::value )
 	{
-		new ( &m_array[ m_length ] ) T ( values[ i ] );
-		m_length++;
+		if ( count )
+		{
+			memcpy( (void*)result, values, count * sizeof(T) );
+		}
+		m_length += count;
+	}
+	else
+	{
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			new ( &m_array[ m_length ] ) T ( values[ i ] );
+			m_length++;
+		}
 	}
 	return result;
 }
@@ -11141,14 +12010,14 @@ template< typename E >
 void BinaryStream::SerializeEnum( E& v )
 {
 	AE_STATIC_ASSERT( std::is_enum< E >::value );
-	SerializeRaw( &v, sizeof( E ) );
+	m_SerializeScalar( &v, sizeof( E ) );
 }
 
 template< typename E >
 void BinaryWriter::SerializeEnum( const E& v )
 {
 	AE_STATIC_ASSERT( std::is_enum< E >::value );
-	SerializeRaw( &v, sizeof( E ) );
+	m_SerializeScalar( const_cast< E* >( &v ), sizeof( E ) );
 }
 
 template < uint32_t N >
@@ -11186,6 +12055,70 @@ void BinaryWriter::SerializeString( const Str< N >& strIn )
 	SerializeRaw( strIn.c_str(), strIn.Length() + 1 );
 }
 
+//! Element types supported by ae::BinaryStream::SerializeArray()
+template< typename T, typename = void > struct _BinaryStreamElement { static constexpr uint32_t componentSize = 0, componentCount = 0; };
+template< typename T > struct _BinaryStreamElement< T, typename std::enable_if< std::is_arithmetic< T >::value >::type > { static constexpr uint32_t componentSize = sizeof( T ), componentCount = 1; };
+template<> struct _BinaryStreamElement< ae::Vec2 > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 2; };
+template<> struct _BinaryStreamElement< ae::Vec3 > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 3; };
+template<> struct _BinaryStreamElement< ae::Vec4 > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 4; };
+template<> struct _BinaryStreamElement< ae::Quaternion > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 4; };
+template<> struct _BinaryStreamElement< ae::Matrix4 > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 16; };
+template<> struct _BinaryStreamElement< ae::Color > { static constexpr uint32_t componentSize = sizeof( float ), componentCount = 4; };
+template<> struct _BinaryStreamElement< ae::Int2 > { static constexpr uint32_t componentSize = sizeof( int32_t ), componentCount = 2; };
+template<> struct _BinaryStreamElement< ae::Int3 > { static constexpr uint32_t componentSize = sizeof( int32_t ), componentCount = 3; };
+
+template< typename T >
+void BinaryStream::SerializeArray( T* dataInOut, uint32_t count )
+{
+	typedef _BinaryStreamElement< typename std::remove_const< T >::type > Element;
+	AE_STATIC_ASSERT_MSG( Element::componentCount, "Unsupported ae::BinaryStream::SerializeArray() element type" );
+	AE_STATIC_ASSERT( Element::componentSize * Element::componentCount <= sizeof( T ) );
+	m_SerializeElements( (void*)dataInOut, count, sizeof( T ), Element::componentSize, Element::componentCount );
+}
+
+template< typename T, uint32_t N >
+void BinaryStream::SerializeArray( ae::Array< T, N >& arrayInOut )
+{
+	typedef _BinaryStreamElement< T > Element;
+	uint32_t length = arrayInOut.Length();
+	SerializeVarUint32( length );
+	if( !IsValid() )
+	{
+		return;
+	}
+	else if( AsReader() )
+	{
+		// Check the length once up front so a corrupt length can't cause a huge allocation
+		const uint64_t byteLength = (uint64_t)length * Element::componentSize * Element::componentCount;
+		if( byteLength > GetRemainingBytes() || ( N && length > N ) )
+		{
+			Invalidate();
+			return;
+		}
+		arrayInOut.Clear();
+		if( length )
+		{
+			SerializeArray( arrayInOut.Append( T(), length ), length );
+		}
+	}
+	else
+	{
+		SerializeArray( arrayInOut.Data(), length );
+	}
+}
+
+template< typename T >
+void BinaryWriter::SerializeArray( const T* dataIn, uint32_t count )
+{
+	BinaryStream::SerializeArray( const_cast< T* >( dataIn ), count );
+}
+
+template< typename T, uint32_t N >
+void BinaryWriter::SerializeArray( const ae::Array< T, N >& arrayIn )
+{
+	BinaryStream::SerializeArray( const_cast< ae::Array< T, N >& >( arrayIn ) );
+}
+
 template < class C >
 struct HasSerializeMethod
 {
@@ -11547,6 +12480,7 @@ struct ae::VarType< t > : public ae::VarTypeBase { \
 	const char* GetName() const override { return s; } \
 	uint32_t GetSize() const override { return sizeof(t); } \
 	static ae::VarTypeBase* Get() { static ae::VarType< t > s_type; return &s_type; }\
+	static_assert( std::is_trivially_copyable< t >::value, "ae::Type::CopyVars() copies " s " vars with memcpy" ); \
 };
 
 // @TODO: Should these names be the actual type or enum? eg. int32_t has multiple aliases
@@ -11947,6 +12881,38 @@ const T* ae::Var::GetPointer( const ae::Object* obj, int32_t arrayIdx ) const
 	return nullptr;
 }
 
+template < typename T >
+ae::VarAccessor< T >::VarAccessor( const ae::Var* var )
+{
+	Bind( var );
+}
+
+template < typename T >
+bool ae::VarAccessor< T >::Bind( const ae::Var* var )
+{
+	// VarType< T >::Get() returns a single instance per type, so this also
+	// distinguishes types that share a BasicType (eg. ae::Str16 and ae::Str32)
+	const bool valid = var && var->m_type != ae::BasicType::CustomRef && var->m_varType == ae::VarType< T >::Get();
+	m_var = valid ? var : nullptr;
+	m_offset = valid ? var->m_offset : 0;
+	return valid;
+}
+
+template < typename T >
+T& ae::VarAccessor< T >::Get( ae::Object* obj ) const
+{
+	return const_cast< T& >( Get( const_cast< const ae::Object* >( obj ) ) );
+}
+
+template < typename T >
+const T& ae::VarAccessor< T >::Get( const ae::Object* obj ) const
+{
+	AE_DEBUG_ASSERT( m_var );
+	AE_DEBUG_ASSERT( obj );
+	AE_DEBUG_ASSERT_MSG( ae::GetTypeFromObject( obj )->IsType( m_var->m_owner ), "Attempting to access var '#' of '#' with unrelated type '#'", m_var->GetName(), m_var->m_owner->GetName(), ae::GetTypeFromObject( obj )->GetName() );
+	return *reinterpret_cast< const T* >( reinterpret_cast< const uint8_t* >( obj ) + m_offset );
+}
+
 template< typename T, typename C >
 const T* ae::Cast( const C* obj )
 {
@@ -12065,6 +13031,32 @@ T* ae::Cast( C* obj )
 #include <inttypes.h>
 #include <thread>
 #include <random>
+// SIMD
+#define _AE_SIMD_SSE_ 0
+#define _AE_SIMD_NEON_ 0
+#if AE_SIMD
+	#if defined(__ARM_NEON) || defined(__aarch64__)
+		#include <arm_neon.h>
+		#undef _AE_SIMD_NEON_
+		#define _AE_SIMD_NEON_ 1
+		typedef float32x4_t _ae_f4;
+		#define _ae_f4_zero() vdupq_n_f32( 0.0f )
+		#define _ae_f4_load( _p ) vld1q_f32( _p )
+		#define _ae_f4_splat( _f ) vdupq_n_f32( _f )
+		#define _ae_f4_madd( _a, _b, _c ) vmlaq_f32( _a, _b, _c ) // a + b * c
+		#define _ae_f4_store( _p, _v ) vst1q_f32( _p, _v )
+	#else
+		#include <emmintrin.h>
+		#undef _AE_SIMD_SSE_
+		#define _AE_SIMD_SSE_ 1
+		typedef __m128 _ae_f4;
+		#define _ae_f4_zero() _mm_setzero_ps()
+		#define _ae_f4_load( _p ) _mm_loadu_ps( _p )
+		#define _ae_f4_splat( _f ) _mm_set1_ps( _f )
+		#define _ae_f4_madd( _a, _b, _c ) _mm_add_ps( _a, _mm_mul_ps( _b, _c ) ) // a + b * c
+		#define _ae_f4_store( _p, _v ) _mm_storeu_ps( _p, _v )
+	#endif
+#endif
 // Socket
 #if _AE_WINDOWS_
 	#include <WinSock2.h>
@@ -12084,6 +13076,9 @@ T* ae::Cast( C* obj )
 	#include <poll.h>
 	#include <netinet/tcp.h>
 	#include <fcntl.h>
+	#if _AE_LINUX_
+		#include <sys/epoll.h>
+	#endif
 	typedef sa_family_t _ae_sa_family_t;
 	typedef int _ae_sock_err_t;
 	typedef pollfd _ae_poll_fd_t;
@@ -14613,73 +15608,196 @@ void TimeStep::Tick()
 }
 
 //------------------------------------------------------------------------------
-// ae::OpaquePool member functions
+// ae::WorkerPool member functions
 //------------------------------------------------------------------------------
-#define _AE_POOL_ELEMENT( _arr, _idx ) ( (uint8_t*)_arr + (intptr_t)_idx * m_objectSize )
+WorkerPool::WorkerPool( const ae::Tag& tag ) :
+	m_tag( tag )
+{}
 
-OpaquePool::OpaquePool( const ae::Tag& tag, uint32_t objectSize, uint32_t objectAlignment, uint32_t size, bool paged ) :
-	m_firstPage( tag, size )
+WorkerPool::~WorkerPool()
 {
-	AE_ASSERT( tag != ae::Tag() );
-	AE_ASSERT( size > 0 );
-	m_tag = tag;
-	m_pageSize = size;
-	m_paged = paged;
-	m_objectSize = objectSize;
-	m_objectAlignment = objectAlignment;
-	m_length = 0;
-	m_seq = 0;
+	Terminate();
 }
 
-OpaquePool::~OpaquePool()
+void WorkerPool::Initialize( uint32_t workerCount )
 {
-	AE_ASSERT_MSG( Length() == 0, "ae::OpaquePool can't be destructed while objects are allocated (count:# size:#)", Length(), m_objectSize );
+	Terminate();
+#if !_AE_EMSCRIPTEN_
+	if ( workerCount )
+	{
+		m_terminate = false;
+		m_workerCount = workerCount;
+		m_threads = ae::NewArray< std::thread >( m_tag, workerCount );
+		for ( uint32_t i = 0; i < workerCount; i++ )
+		{
+			m_threads[ i ] = std::thread( &WorkerPool::m_WorkerLoop, this );
+		}
+	}
+#endif
 }
 
-void* OpaquePool::Allocate()
+void WorkerPool::Terminate()
 {
-	Page* page = m_pages.FindFn( []( const Page* page ) { return page->freeList.HasFree(); } );
-	if ( !page )
+	if ( !m_threads )
 	{
-		if ( !m_firstPage.node.GetList() )
-		{
-			AE_DEBUG_ASSERT( m_firstPage.freeList.Length() == 0 );
-			page = &m_firstPage;
-			page->objects = ae::Allocate( m_tag, m_pageSize * m_objectSize, m_objectAlignment );
-			m_pages.Append( page->node );
-		}
-		else if ( m_paged )
-		{
-			page = ae::New< Page >( m_tag, m_tag, m_pageSize );
-			page->objects = ae::Allocate( m_tag, m_pageSize * m_objectSize, m_objectAlignment );
-			m_pages.Append( page->node );
-		}
+		return;
 	}
-	if ( page )
 	{
-		int32_t index = page->freeList.Allocate();
-		AE_ASSERT( index >= 0 );
-		m_length++;
-		m_seq++;
-		return _AE_POOL_ELEMENT( page->objects, index );
+		std::lock_guard< std::mutex > lock( m_mutex );
+		m_terminate = true;
 	}
-	return nullptr;
+	m_wakeCondition.notify_all();
+	for ( uint32_t i = 0; i < m_workerCount; i++ )
+	{
+		m_threads[ i ].join();
+	}
+	ae::Delete( m_threads );
+	m_threads = nullptr;
+	m_workerCount = 0;
 }
 
-void OpaquePool::Free( void* obj )
+void WorkerPool::Run( uint32_t count, uint32_t batchSize, const std::function< void( uint32_t, uint32_t ) >& fn )
 {
-	if ( !obj )
+	batchSize = ae::Max( 1u, batchSize );
+	if ( !count )
 	{
 		return;
 	}
-	AE_DEBUG_ASSERT( (intptr_t)obj % m_objectAlignment == 0 );
-
-	int32_t index = -1;
-	Page* page = m_pages.GetFirst();
-	while ( page )
+	else if ( !m_workerCount || count <= batchSize )
 	{
-		index = (int32_t)( ( (uint8_t*)obj - (uint8_t*)page->objects ) / m_objectSize );
-		bool found = ( 0 <= index && index < (int32_t)m_pageSize );
+		for ( uint32_t begin = 0; begin < count; begin += batchSize )
+		{
+			fn( begin, ae::Min( begin + batchSize, count ) );
+		}
+		return;
+	}
+
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+		AE_ASSERT_MSG( !m_fn, "ae::WorkerPool::Run() is not reentrant" );
+		m_fn = &fn;
+		m_count = count;
+		m_batchSize = batchSize;
+		m_next = 0;
+		m_busyCount = m_workerCount;
+		m_generation++;
+	}
+	m_wakeCondition.notify_all();
+
+	m_Work();
+
+	std::unique_lock< std::mutex > lock( m_mutex );
+	m_doneCondition.wait( lock, [ this ](){ return m_busyCount == 0; } );
+	m_fn = nullptr;
+}
+
+void WorkerPool::m_Work()
+{
+	while ( true )
+	{
+		const uint32_t begin = m_next.fetch_add( m_batchSize );
+		if ( begin >= m_count )
+		{
+			break;
+		}
+		(*m_fn)( begin, ae::Min( begin + m_batchSize, m_count ) );
+	}
+}
+
+void WorkerPool::m_WorkerLoop()
+{
+	uint32_t generation = 0;
+	while ( true )
+	{
+		{
+			std::unique_lock< std::mutex > lock( m_mutex );
+			m_wakeCondition.wait( lock, [ this, generation ](){ return m_terminate || m_generation != generation; } );
+			if ( m_terminate )
+			{
+				return;
+			}
+			generation = m_generation;
+		}
+		m_Work();
+		{
+			std::lock_guard< std::mutex > lock( m_mutex );
+			m_busyCount--;
+			if ( !m_busyCount )
+			{
+				m_doneCondition.notify_one();
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::OpaquePool member functions
+//------------------------------------------------------------------------------
+#define _AE_POOL_ELEMENT( _arr, _idx ) ( (uint8_t*)_arr + (intptr_t)_idx * m_objectSize )
+
+OpaquePool::OpaquePool( const ae::Tag& tag, uint32_t objectSize, uint32_t objectAlignment, uint32_t size, bool paged ) :
+	m_firstPage( tag, size )
+{
+	AE_ASSERT( tag != ae::Tag() );
+	AE_ASSERT( size > 0 );
+	m_tag = tag;
+	m_pageSize = size;
+	m_paged = paged;
+	m_objectSize = objectSize;
+	m_objectAlignment = objectAlignment;
+	m_length = 0;
+	m_seq = 0;
+}
+
+OpaquePool::~OpaquePool()
+{
+	AE_ASSERT_MSG( Length() == 0, "ae::OpaquePool can't be destructed while objects are allocated (count:# size:#)", Length(), m_objectSize );
+}
+
+void* OpaquePool::Allocate()
+{
+	Page* page = m_pages.FindFn( []( const Page* page ) { return page->freeList.HasFree(); } );
+	if ( !page )
+	{
+		if ( !m_firstPage.node.GetList() )
+		{
+			AE_DEBUG_ASSERT( m_firstPage.freeList.Length() == 0 );
+			page = &m_firstPage;
+			page->objects = ae::Allocate( m_tag, m_pageSize * m_objectSize, m_objectAlignment );
+			m_pages.Append( page->node );
+		}
+		else if ( m_paged )
+		{
+			page = ae::New< Page >( m_tag, m_tag, m_pageSize );
+			page->objects = ae::Allocate( m_tag, m_pageSize * m_objectSize, m_objectAlignment );
+			m_pages.Append( page->node );
+		}
+	}
+	if ( page )
+	{
+		int32_t index = page->freeList.Allocate();
+		AE_ASSERT( index >= 0 );
+		m_length++;
+		m_seq++;
+		return _AE_POOL_ELEMENT( page->objects, index );
+	}
+	return nullptr;
+}
+
+void OpaquePool::Free( void* obj )
+{
+	if ( !obj )
+	{
+		return;
+	}
+	AE_DEBUG_ASSERT( (intptr_t)obj % m_objectAlignment == 0 );
+
+	int32_t index = -1;
+	Page* page = m_pages.GetFirst();
+	while ( page )
+	{
+		index = (int32_t)( ( (uint8_t*)obj - (uint8_t*)page->objects ) / m_objectSize );
+		bool found = ( 0 <= index && index < (int32_t)m_pageSize );
 		if ( found )
 		{
 			break;
@@ -18789,21 +19907,37 @@ bool _DisableBlocking( int sock )
 #endif
 }
 
-bool _DisableNagles( int sock )
+bool _SetTCPOption( int sock, int option, bool enabled )
 {
 	if ( sock < 0 )
 	{
 		return false;
 	}
 #if _AE_WINDOWS_
-	const char* yes = "1";
+	const char* value = enabled ? "1" : "0";
 	socklen_t optlen = 1;
 #else
-	int yesValue = 1;
-	int* yes = &yesValue;
+	int intValue = enabled ? 1 : 0;
+	int* value = &intValue;
 	socklen_t optlen = sizeof(int);
 #endif
-	return setsockopt( sock, SOL_SOCKET, TCP_NODELAY, yes, optlen ) != -1;
+	return setsockopt( sock, IPPROTO_TCP, option, value, optlen ) != -1;
+}
+
+bool _SetNoDelay( int sock, bool noDelay )
+{
+	return _SetTCPOption( sock, TCP_NODELAY, noDelay );
+}
+
+bool _SetCork( int sock, bool cork )
+{
+#if _AE_LINUX_
+	return _SetTCPOption( sock, TCP_CORK, cork );
+#elif _AE_APPLE_
+	return _SetTCPOption( sock, TCP_NOPUSH, cork );
+#else
+	return false;
+#endif
 }
 
 bool _ReuseAddress( int sock )
@@ -18928,6 +20062,8 @@ Socket::~Socket()
 bool Socket::Connect( ae::Socket::Protocol proto, const char* address, uint16_t port )
 {
 	m_readHead = 0;
+	m_recvEnd = 0;
+	m_sendHead = 0;
 	m_sendData.Clear();
 	m_recvData.Clear();
 	
@@ -18986,7 +20122,7 @@ bool Socket::Connect( ae::Socket::Protocol proto, const char* address, uint16_t
 		}
 		
 		if ( !_DisableBlocking( m_sock )
-			|| !_DisableNagles( m_sock )
+			|| ( proto == ae::Socket::Protocol::TCP && !_SetNoDelay( m_sock, true ) )
 			|| ( connect( m_sock, addrInfo->ai_addr, addrInfo->ai_addrlen ) == -1
 				&& errno != EAGAIN && errno != EALREADY && errno != EINPROGRESS && errno != EISCONN ) )
 		{
@@ -19059,90 +20195,67 @@ bool Socket::QueueData( const void* data, uint32_t length )
 	return true;
 }
 
-bool Socket::PeekData( void* dataOut, uint16_t length, uint32_t offset )
+bool Socket::m_Receive( uint32_t length )
 {
-	if ( !length )
-	{
-		return false;
-	}
-	
-	while ( IsConnected() && m_recvData.Length() < m_readHead + offset + length )
+	// Reads as much as fits in the buffer with each call to recv(), instead of
+	// querying the pending size with FIONREAD first
+	const uint32_t kMinRecvSize = ( m_protocol == Protocol::UDP ) ? 65536 : 16384; // Fit any udp datagram
+	while ( IsConnected() && m_recvEnd - m_readHead < length )
 	{
-#if _AE_WINDOWS_
-		u_long readSize = 0;
-#else
-		int readSize = 0;
-#endif
-		if ( _ae_ioctl( m_sock, FIONREAD, &readSize ) == -1 )
-		{
-			Disconnect();
-			return false;
-		}
-		
-		if ( readSize == 0 )
+		const uint32_t unread = m_recvEnd - m_readHead;
+		const uint32_t minSpace = ae::Max( length - unread, kMinRecvSize );
+		if ( m_recvData.Length() - m_recvEnd < minSpace )
 		{
-			// Check for closed connection
-			if ( m_protocol == Protocol::TCP )
+			if ( m_readHead )
 			{
-				_ae_sock_buff_t buffer;
-				const int32_t result = (int32_t)recv( m_sock, &buffer, 1, MSG_PEEK );
-				if ( result == 0 || ( result == -1 && errno != EWOULDBLOCK && errno != EAGAIN ) )
-				{
-					Disconnect();
-				}
+				memmove( m_recvData.Data(), m_recvData.Data() + m_readHead, unread );
+				m_readHead = 0;
+				m_recvEnd = unread;
 			}
-			else if ( m_protocol == Protocol::UDP )
+			const uint32_t space = m_recvData.Length() - m_recvEnd;
+			if ( space < minSpace )
 			{
-				_ae_sock_buff_t buffer;
-				const int32_t result = (int32_t)recv( m_sock, &buffer, 1, MSG_PEEK );
-				if ( result == -1 && errno != EWOULDBLOCK && errno != EAGAIN )
-				{
-					Disconnect();
-				}
-				else if ( result == 0 )
-				{
-					// Discard zero length packet
-					if ( recv( m_sock, &buffer, 0, 0 ) != 0 )
-					{
-						Disconnect();
-					}
-					continue;
-				}
+				m_recvData.Append( 0, minSpace - space );
 			}
-			return false;
 		}
-
-		AE_ASSERT( readSize );
-		uint32_t totalSize = m_recvData.Length() + readSize;
-		m_recvData.Reserve( totalSize );
-		_ae_sock_buff_t* buffer = (_ae_sock_buff_t*)m_recvData.end();
-		while ( m_recvData.Length() < totalSize ) { m_recvData.Append( {} ); } // @TODO: Should be single function call
-		AE_ASSERT( buffer == (_ae_sock_buff_t*)m_recvData.end() - readSize );
 		
-		const int32_t result = (int32_t)recv( m_sock, buffer, readSize, 0 );
-		if ( result < 0 && ( errno == EWOULDBLOCK || errno == EAGAIN ) )
+		_ae_sock_buff_t* buffer = (_ae_sock_buff_t*)( m_recvData.Data() + m_recvEnd );
+		const int32_t result = (int32_t)recv( m_sock, buffer, m_recvData.Length() - m_recvEnd, 0 );
+		if ( result > 0 )
 		{
-			return false;
+			m_recvEnd += result;
 		}
-		else if ( result == 0 && m_protocol == Protocol::TCP )
+		else if ( result == 0 )
+		{
+			if ( m_protocol == Protocol::TCP )
+			{
+				Disconnect(); // Orderly shutdown
+				return false;
+			}
+			// Discard zero length udp packet
+		}
+		else if ( errno == EWOULDBLOCK || errno == EAGAIN )
 		{
-			Disconnect(); // Orderly shutdown
 			return false;
 		}
-		else if ( result )
+		else
 		{
-			AE_ASSERT( result <= (int32_t)readSize );
-			// ioctl with FIONREAD includes udp headers on some platforms so use actual read length here
-			if ( result < (int32_t)readSize )
-			{
-				totalSize -= ( readSize - result );
-				while ( m_recvData.Length() > totalSize ) { m_recvData.Remove( m_recvData.Length() - 1 ); } // @TODO: Should be single function call
-			}
-			break; // Received new data!
+			Disconnect();
+			return false;
 		}
 	}
+	return ( m_recvEnd - m_readHead >= length );
+}
+
+bool Socket::PeekData( void* dataOut, uint16_t length, uint32_t offset )
+{
+	if ( !length )
+	{
+		return false;
+	}
 	
-	if ( m_recvData.Length() >= m_readHead + offset + length )
+	m_Receive( offset + length );
+	if ( m_recvEnd >= m_readHead + offset + length )
 	{
 		if ( dataOut )
 		{
@@ -19166,13 +20279,14 @@ bool Socket::ReceiveData( void* dataOut, uint16_t length )
 
 bool Socket::DiscardData( uint16_t length )
 {
-	if ( m_recvData.Length() >= m_readHead + length )
+	if ( m_recvEnd >= m_readHead + length )
 	{
 		m_readHead += length;
-		if ( m_readHead == m_recvData.Length() )
+		if ( m_readHead == m_recvEnd )
 		{
-			m_recvData.Clear();
+			// Keep the buffer allocated
 			m_readHead = 0;
+			m_recvEnd = 0;
 		}
 		return true;
 	}
@@ -19181,8 +20295,14 @@ bool Socket::DiscardData( uint16_t length )
 
 uint32_t Socket::ReceiveDataLength()
 {
-	PeekData( nullptr, 1, 0 );
-	return m_recvData.Length() - m_readHead;
+	m_Receive( 1 );
+	return m_recvEnd - m_readHead;
+}
+
+const uint8_t* Socket::PeekReceivedData( uint32_t* lengthOut )
+{
+	*lengthOut = ReceiveDataLength();
+	return *lengthOut ? m_recvData.Data() + m_readHead : nullptr;
 }
 
 bool Socket::QueueMsg( const void* data, uint16_t length )
@@ -19208,8 +20328,9 @@ uint16_t Socket::ReceiveMsg( void* dataOut, uint16_t maxLength )
 		{
 			return length;
 		}
-		else if ( PeekData( dataOut, length, 2 ) )
+		else if ( length && m_Receive( 2 + length ) )
 		{
+			memcpy( dataOut, m_recvData.Data() + m_readHead + 2, length );
 			DiscardData( length + 2 );
 			return length;
 		}
@@ -19220,21 +20341,34 @@ uint16_t Socket::ReceiveMsg( void* dataOut, uint16_t maxLength )
 bool Socket::DiscardMsg()
 {
 	uint16_t length = 0;
-	if ( PeekData( &length, sizeof(length), 0 ) )
+	if ( PeekMsg( &length ) )
 	{
-		length = ntohs( length );
-		if ( PeekData( nullptr, length, 2 ) )
-		{
-			DiscardData( length + 2 );
-			return true;
-		}
+		DiscardData( length + 2 );
+		return true;
 	}
 	return false;
 }
 
+const uint8_t* Socket::PeekMsg( uint16_t* lengthOut )
+{
+	uint16_t length = 0;
+	*lengthOut = 0;
+	if ( !PeekData( &length, sizeof(length), 0 ) )
+	{
+		return nullptr;
+	}
+	length = ntohs( length );
+	if ( length && !m_Receive( 2 + length ) )
+	{
+		return nullptr;
+	}
+	*lengthOut = length;
+	return m_recvData.Data() + m_readHead + 2;
+}
+
 uint32_t Socket::SendAll()
 {
-	if ( !IsConnected() || !m_sendData.Length() )
+	if ( !IsConnected() || !GetPendingSendLength() )
 	{
 		return 0;
 	}
@@ -19243,19 +20377,57 @@ uint32_t Socket::SendAll()
 #if !_AE_WINDOWS_
 	sendFlags |= MSG_NOSIGNAL;
 #endif
-	int32_t result = (int32_t)send( m_sock, (const _ae_sock_buff_t*)m_sendData.Data(), m_sendData.Length(), sendFlags );
-	if ( result == -1 && errno != EAGAIN && errno != EWOULDBLOCK )
+	// All queued messages are already contiguous, so each send() call writes
+	// as many of them as the system will accept
+	uint32_t sent = 0;
+	while ( m_sendHead < m_sendData.Length() )
 	{
-		Disconnect();
-		return 0;
+		const _ae_sock_buff_t* data = (const _ae_sock_buff_t*)( m_sendData.Data() + m_sendHead );
+		const int32_t result = (int32_t)send( m_sock, data, m_sendData.Length() - m_sendHead, sendFlags );
+		if ( result > 0 )
+		{
+			m_sendHead += result;
+			sent += result;
+		}
+		else if ( result == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+		{
+			break; // Send buffer is full, try again later
+		}
+		else if ( result == -1 && errno == EINTR )
+		{
+			continue;
+		}
+		else
+		{
+			Disconnect();
+			m_sendData.Clear();
+			m_sendHead = 0;
+			return sent;
+		}
 	}
-	else
+	
+	if ( m_sendHead == m_sendData.Length() )
 	{
-		AE_ASSERT( m_sendData.Length() == result );
-		m_sendData.Clear();
-		return result;
+		m_sendData.Clear(); // Keep allocation
+		m_sendHead = 0;
 	}
-	return 0;
+	else if ( m_sendHead >= m_sendData.Length() / 2 )
+	{
+		// Only move pending data when most of the buffer has been sent
+		m_sendData.Remove( 0, m_sendHead );
+		m_sendHead = 0;
+	}
+	return sent;
+}
+
+bool Socket::SetNoDelay( bool noDelay )
+{
+	return ( m_protocol == Protocol::TCP ) && _SetNoDelay( m_sock, noDelay );
+}
+
+bool Socket::SetCork( bool cork )
+{
+	return ( m_protocol == Protocol::TCP ) && _SetCork( m_sock, cork );
 }
 
 //------------------------------------------------------------------------------
@@ -19393,7 +20565,7 @@ ae::Socket* ListenerSocket::Accept()
 			
 			if ( ( m_connections.Length() >= m_maxConnections )
 				|| !_DisableBlocking( newSock )
-				|| !_DisableNagles( newSock ) )
+				|| !_SetNoDelay( newSock, true ) )
 			{
 				_CloseSocket( newSock );
 				newSock = -1;
@@ -19439,7 +20611,6 @@ ae::Socket* ListenerSocket::Accept()
 			// Connect and give old listening socket to new ae::Socket
 			newSock = listenSock;
 			if ( !_DisableBlocking( newSock )
-				|| !_DisableNagles( newSock )
 				|| ( connect( newSock, (sockaddr*)&sockAddr, sockAddrLen ) == -1 ) )
 			{
 				_CloseSocket( newSock );
@@ -19512,46 +20683,626 @@ uint32_t ListenerSocket::GetConnectionCount() const
 	return m_connections.Length();
 }
 
-}  // ae end
-
 //------------------------------------------------------------------------------
-// OpenGL includes
+// ae::SocketPoller member functions
 //------------------------------------------------------------------------------
-#if _AE_WINDOWS_
-	#pragma comment (lib, "opengl32.lib")
-	#pragma comment (lib, "glu32.lib")
-	#include <gl/GL.h>
-	#include <gl/GLU.h>
-#elif _AE_EMSCRIPTEN_
-	#include <GLES3/gl3.h>
-#elif _AE_LINUX_
-	#define GL_GLEXT_PROTOTYPES 1
-	#include <GL/glcorearb.h>
-#elif _AE_IOS_
-	#include <OpenGLES/ES3/gl.h>
+#if _AE_LINUX_
+	#define _AE_EPOLL_ 1
+	typedef epoll_event _ae_poll_event_t;
 #else
-	#include <OpenGL/glext.h>
-	#include <OpenGL/gl3.h>
-	#include <OpenGL/gl3ext.h>
+	#define _AE_EPOLL_ 0
+	typedef _ae_poll_fd_t _ae_poll_event_t;
 #endif
 
-namespace ae
+SocketPoller::SocketPoller( const ae::Tag& tag ) :
+	m_tag( tag ),
+	m_entries( tag ),
+	m_sockets( tag ),
+	m_listeners( tag ),
+	m_events( tag )
+{
+	_WinsockInit();
+#if _AE_EPOLL_
+	m_epoll = epoll_create1( EPOLL_CLOEXEC );
+	AE_ASSERT_MSG( m_epoll >= 0, "Failed to create epoll instance" );
+#endif
+}
+
+SocketPoller::~SocketPoller()
 {
-#if _AE_IOS_ || _AE_EMSCRIPTEN_
-	uint32_t GLMajorVersion = 3;
-	uint32_t GLMinorVersion = 0;
-#else
-	uint32_t GLMajorVersion = 4;
-	uint32_t GLMinorVersion = 1;
+#if _AE_EPOLL_
+	close( m_epoll );
 #endif
-bool ReverseZ = false;
-}  // ae end
+	ae::Free( m_pollBuffer );
+}
 
-#if _AE_WINDOWS_
-// OpenGL function pointers
-typedef char GLchar;
-typedef intptr_t GLsizeiptr;
-typedef intptr_t GLintptr;
+bool SocketPoller::Add( ae::Socket* socket, bool writeInterest )
+{
+	AE_ASSERT( socket );
+	Remove( socket );
+	if ( socket->m_sock < 0 )
+	{
+		return false;
+	}
+	Entry entry;
+	entry.socket = socket;
+	entry.listener = nullptr;
+	entry.writeInterest = writeInterest;
+	if ( !m_Register( socket->m_sock, entry, false ) )
+	{
+		return false;
+	}
+	m_sockets.Set( socket, socket->m_sock );
+	return true;
+}
+
+bool SocketPoller::Add( ae::ListenerSocket* listener )
+{
+	AE_ASSERT( listener );
+	Remove( listener );
+	Listener* l = &m_listeners.Append( {} );
+	l->listener = listener;
+	l->socks[ 0 ] = -1;
+	l->socks[ 1 ] = -1;
+	m_UpdateListeners();
+	return listener->IsListening();
+}
+
+void SocketPoller::Remove( ae::Socket* socket )
+{
+	int32_t sock = -1;
+	if ( m_sockets.Remove( socket, &sock ) )
+	{
+		m_Unregister( sock, socket );
+	}
+}
+
+void SocketPoller::Remove( ae::ListenerSocket* listener )
+{
+	const int32_t idx = m_listeners.FindFn( [ listener ]( const Listener& l ){ return l.listener == listener; } );
+	if ( idx >= 0 )
+	{
+		for ( int sock : m_listeners[ idx ].socks )
+		{
+			m_Unregister( sock, listener );
+		}
+		m_listeners.Remove( idx );
+	}
+}
+
+void SocketPoller::SetWriteInterest( ae::Socket* socket, bool writeInterest )
+{
+	const int32_t* sock = m_sockets.TryGet( socket );
+	Entry* entry = sock ? m_entries.TryGet( *sock ) : nullptr;
+	if ( entry && entry->writeInterest != writeInterest )
+	{
+		entry->writeInterest = writeInterest;
+		m_Register( *sock, *entry, true );
+	}
+}
+
+uint32_t SocketPoller::Wait( float timeoutSec )
+{
+	m_events.Clear();
+	m_UpdateListeners();
+	const uint32_t count = m_entries.Length();
+	if ( m_pollBufferSize < count )
+	{
+		m_pollBufferSize = ae::Max( 16u, count * 2 );
+		ae::Free( m_pollBuffer );
+		m_pollBuffer = ae::Allocate( m_tag, m_pollBufferSize * sizeof(_ae_poll_event_t), alignof(_ae_poll_event_t) );
+	}
+	const int timeoutMs = ( timeoutSec < 0.0f ) ? -1 : (int)( timeoutSec * 1000.0f );
+	_ae_poll_event_t* pollEvents = (_ae_poll_event_t*)m_pollBuffer;
+	
+#if _AE_EPOLL_
+	const int result = epoll_wait( m_epoll, pollEvents, (int)m_pollBufferSize, timeoutMs );
+	for ( int i = 0; i < result; i++ )
+	{
+		const Entry* entry = m_entries.TryGet( pollEvents[ i ].data.fd );
+		if ( !entry )
+		{
+			continue;
+		}
+		const uint32_t flags = pollEvents[ i ].events;
+		Event* event = &m_events.Append( {} );
+		event->socket = entry->socket;
+		event->listener = entry->listener;
+		event->readable = ( flags & EPOLLIN );
+		event->writable = ( flags & EPOLLOUT );
+		event->closed = ( flags & ( EPOLLHUP | EPOLLRDHUP | EPOLLERR ) );
+	}
+#else
+	// @NOTE: poll() has no persistent registration so the handle array is
+	// rebuilt from the registered sockets on each call
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		const Entry& entry = m_entries.GetValue( i );
+		_ae_poll_fd_t* pollParam = &pollEvents[ i ];
+		memset( pollParam, 0, sizeof(*pollParam) );
+		pollParam->fd = m_entries.GetKey( i );
+		pollParam->events = POLLIN | ( entry.writeInterest ? POLLOUT : 0 );
+	}
+	const int result = count ? _ae_sock_poll( pollEvents, count, timeoutMs ) : 0;
+	for ( uint32_t i = 0; result > 0 && i < count; i++ )
+	{
+		const uint32_t flags = pollEvents[ i ].revents;
+		if ( !flags )
+		{
+			continue;
+		}
+		const Entry& entry = m_entries.GetValue( i );
+		Event* event = &m_events.Append( {} );
+		event->socket = entry.socket;
+		event->listener = entry.listener;
+		event->readable = ( flags & POLLIN );
+		event->writable = ( flags & POLLOUT );
+		event->closed = ( flags & ( POLLHUP | POLLERR | POLLNVAL ) );
+	}
+#endif
+	// Multiple handles can belong to one listener
+	for ( int32_t i = (int32_t)m_events.Length() - 1; i > 0; i-- )
+	{
+		const Event& event = m_events[ i ];
+		if ( event.listener && m_events.FindFn( [ &event ]( const Event& e ){ return e.listener == event.listener; } ) < i )
+		{
+			m_events.Remove( i );
+		}
+	}
+	return m_events.Length();
+}
+
+bool SocketPoller::m_Register( int sock, const Entry& entry, bool modify )
+{
+#if _AE_EPOLL_
+	epoll_event event;
+	memset( &event, 0, sizeof(event) );
+	event.events = EPOLLIN | EPOLLRDHUP | ( entry.writeInterest ? (uint32_t)EPOLLOUT : 0u );
+	event.data.fd = sock;
+	if ( epoll_ctl( m_epoll, modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &event ) == -1 )
+	{
+		// Closed handles are removed from epoll automatically, and the same
+		// value may have been reused since
+		if ( modify || errno != EEXIST || epoll_ctl( m_epoll, EPOLL_CTL_MOD, sock, &event ) == -1 )
+		{
+			return false;
+		}
+	}
+#endif
+	// A reused handle replaces its previous owner
+	if ( !modify )
+	{
+		if ( const Entry* prev = m_entries.TryGet( sock ) )
+		{
+			if ( prev->socket )
+			{
+				m_sockets.Remove( prev->socket );
+			}
+		}
+	}
+	m_entries.Set( sock, entry );
+	return true;
+}
+
+void SocketPoller::m_Unregister( int sock, const void* owner )
+{
+	// The handle may have been closed and reused by another registration
+	const Entry* entry = ( sock >= 0 ) ? m_entries.TryGet( sock ) : nullptr;
+	if ( !entry || ( entry->socket != owner && entry->listener != owner ) )
+	{
+		return;
+	}
+	m_entries.Remove( sock );
+#if _AE_EPOLL_
+	epoll_ctl( m_epoll, EPOLL_CTL_DEL, sock, nullptr );
+#endif
+}
+
+void SocketPoller::m_UpdateListeners()
+{
+	// UDP listeners replace their listening socket each time a connection is
+	// accepted, so handles are checked for changes
+	for ( Listener& l : m_listeners )
+	{
+		const int socks[] = { l.listener->m_sock4, l.listener->m_sock6 };
+		for ( uint32_t i = 0; i < countof(socks); i++ )
+		{
+			if ( l.socks[ i ] == socks[ i ] )
+			{
+				continue;
+			}
+			m_Unregister( l.socks[ i ], l.listener );
+			l.socks[ i ] = -1;
+			Entry entry;
+			entry.socket = nullptr;
+			entry.listener = l.listener;
+			entry.writeInterest = false;
+			if ( socks[ i ] >= 0 && m_Register( socks[ i ], entry, false ) )
+			{
+				l.socks[ i ] = socks[ i ];
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::DatagramSocket member functions
+//------------------------------------------------------------------------------
+#if _AE_LINUX_
+	#define _AE_MMSG_ 1
+#else
+	#define _AE_MMSG_ 0
+#endif
+
+ae::Str64 DatagramSocket::Address::GetAddressString() const
+{
+	char addrStr[ INET6_ADDRSTRLEN ];
+	if ( size && _GetAddressString( (const sockaddr*)data, addrStr ) )
+	{
+		return addrStr;
+	}
+	return "";
+}
+
+uint16_t DatagramSocket::Address::GetPort() const
+{
+	return size ? _GetPort( (const sockaddr*)data ) : 0;
+}
+
+DatagramSocket::DatagramSocket( ae::Tag tag ) :
+	m_sendData( tag ),
+	m_sendDatagrams( tag ),
+	m_recvData( tag ),
+	m_recvDatagrams( tag )
+{
+	AE_STATIC_ASSERT( sizeof(Address::data) >= sizeof(sockaddr_in6) );
+	AE_STATIC_ASSERT( sizeof(Address::data) >= sizeof(sockaddr_in) );
+}
+
+DatagramSocket::~DatagramSocket()
+{
+	Close();
+}
+
+bool DatagramSocket::Open( bool allowRemote, uint16_t port, uint32_t maxDatagramSize )
+{
+	Close();
+	if ( !_WinsockInit() || !maxDatagramSize )
+	{
+		return false;
+	}
+	
+	sockaddr_storage addr;
+	socklen_t addrLen = 0;
+	memset( &addr, 0, sizeof(addr) );
+	if ( allowRemote )
+	{
+		// Dual stack, receives IPv4 as mapped IPv6 addresses
+		m_sock = (int)socket( AF_INET6, SOCK_DGRAM, 0 );
+		if ( m_sock >= 0 )
+		{
+#if _AE_WINDOWS_
+			const char* no = "\0\0\0\0";
+#else
+			int noValue = 0;
+			int* no = &noValue;
+#endif
+			setsockopt( m_sock, IPPROTO_IPV6, IPV6_V6ONLY, no, sizeof(int) );
+			sockaddr_in6* addr6 = (sockaddr_in6*)&addr;
+			addr6->sin6_family = AF_INET6;
+			addr6->sin6_addr = in6addr_any;
+			addr6->sin6_port = htons( port );
+			addrLen = sizeof(sockaddr_in6);
+			m_family = AF_INET6;
+		}
+	}
+	if ( m_sock < 0 )
+	{
+		m_sock = (int)socket( AF_INET, SOCK_DGRAM, 0 );
+		sockaddr_in* addr4 = (sockaddr_in*)&addr;
+		addr4->sin_family = AF_INET;
+		addr4->sin_addr.s_addr = htonl( allowRemote ? INADDR_ANY : INADDR_LOOPBACK );
+		addr4->sin_port = htons( port );
+		addrLen = sizeof(sockaddr_in);
+		m_family = AF_INET;
+	}
+	
+	if ( m_sock < 0
+		|| !_DisableBlocking( m_sock )
+		|| bind( m_sock, (sockaddr*)&addr, addrLen ) == -1
+		|| getsockname( m_sock, (sockaddr*)&addr, &addrLen ) == -1 )
+	{
+		Close();
+		return false;
+	}
+	m_port = _GetPort( (sockaddr*)&addr );
+	m_maxDatagramSize = maxDatagramSize;
+	m_recvData.Clear();
+	m_recvData.Append( 0, kMaxReceiveCount * ( maxDatagramSize + 1 ) );
+	return true;
+}
+
+void DatagramSocket::Close()
+{
+	_CloseSocket( m_sock );
+	m_sock = -1;
+	m_family = 0;
+	m_port = 0;
+	m_sendData.Clear();
+	m_sendDatagrams.Clear();
+	m_sendHead = 0;
+	m_recvDatagrams.Clear();
+}
+
+bool DatagramSocket::GetAddress( const char* host, uint16_t port, Address* addressOut )
+{
+	if ( !_WinsockInit() )
+	{
+		return false;
+	}
+	addrinfo hints;
+	memset( &hints, 0, sizeof(hints) );
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_NUMERICSERV;
+	addrinfo* addrInfo = nullptr;
+	const ae::Str16 portStr = ae::Str16::Format( "#", port );
+	if ( getaddrinfo( host, portStr.c_str(), &hints, &addrInfo ) != 0 )
+	{
+		return false;
+	}
+	const addrinfo* result = nullptr;
+	for ( const addrinfo* info = addrInfo; info; info = info->ai_next )
+	{
+		if ( info->ai_family == AF_INET || ( info->ai_family == AF_INET6 && !result ) )
+		{
+			result = info;
+			if ( info->ai_family == AF_INET )
+			{
+				break;
+			}
+		}
+	}
+	if ( result )
+	{
+		memset( addressOut->data, 0, sizeof(addressOut->data) );
+		memcpy( addressOut->data, result->ai_addr, result->ai_addrlen );
+		addressOut->size = (uint32_t)result->ai_addrlen;
+	}
+	freeaddrinfo( addrInfo );
+	return result != nullptr;
+}
+
+bool DatagramSocket::m_ToSocketAddress( const Address& address, Address* addressOut ) const
+{
+	const _ae_sa_family_t family = ( (const sockaddr*)address.data )->sa_family;
+	if ( family == m_family )
+	{
+		*addressOut = address;
+		return true;
+	}
+	else if ( family == AF_INET && m_family == AF_INET6 )
+	{
+		// IPv4 mapped IPv6 address, ie. ::ffff:127.0.0.1
+		const sockaddr_in* addr4 = (const sockaddr_in*)address.data;
+		sockaddr_in6 addr6;
+		memset( &addr6, 0, sizeof(addr6) );
+		addr6.sin6_family = AF_INET6;
+		addr6.sin6_port = addr4->sin_port;
+		uint8_t* bytes = (uint8_t*)&addr6.sin6_addr;
+		bytes[ 10 ] = 0xff;
+		bytes[ 11 ] = 0xff;
+		memcpy( bytes + 12, &addr4->sin_addr, 4 );
+		memset( addressOut->data, 0, sizeof(addressOut->data) );
+		memcpy( addressOut->data, &addr6, sizeof(addr6) );
+		addressOut->size = sizeof(addr6);
+		return true;
+	}
+	return false;
+}
+
+void DatagramSocket::m_FromSocketAddress( const void* addr, uint32_t addrLength, Address* addressOut )
+{
+	memset( addressOut->data, 0, sizeof(addressOut->data) );
+	const sockaddr_in6* addr6 = (const sockaddr_in6*)addr;
+	const uint8_t* bytes = (const uint8_t*)&addr6->sin6_addr;
+	const uint8_t kMappedPrefix[ 12 ] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+	if ( addr6->sin6_family == AF_INET6 && addrLength >= sizeof(sockaddr_in6) && memcmp( bytes, kMappedPrefix, sizeof(kMappedPrefix) ) == 0 )
+	{
+		// IPv4 mapped IPv6 address from a dual stack socket, see m_ToSocketAddress()
+		sockaddr_in addr4;
+		memset( &addr4, 0, sizeof(addr4) );
+		addr4.sin_family = AF_INET;
+		addr4.sin_port = addr6->sin6_port;
+		memcpy( &addr4.sin_addr, bytes + 12, 4 );
+		memcpy( addressOut->data, &addr4, sizeof(addr4) );
+		addressOut->size = sizeof(addr4);
+		return;
+	}
+	addressOut->size = ae::Min( addrLength, (uint32_t)sizeof(addressOut->data) );
+	memcpy( addressOut->data, addr, addressOut->size );
+}
+
+bool DatagramSocket::QueueDatagram( const Address& address, const void* data, uint32_t length )
+{
+	AE_ASSERT_MSG( length <= m_maxDatagramSize, "Datagram length # exceeds max size #", length, m_maxDatagramSize );
+	Pending pending;
+	if ( !IsOpen() || !m_ToSocketAddress( address, &pending.address ) )
+	{
+		return false;
+	}
+	pending.offset = m_sendData.Length();
+	pending.length = length;
+	m_sendData.AppendArray( (const uint8_t*)data, length );
+	m_sendDatagrams.Append( pending );
+	return true;
+}
+
+uint32_t DatagramSocket::SendAll()
+{
+	if ( !IsOpen() )
+	{
+		return 0;
+	}
+	
+	int sendFlags = 0;
+#if !_AE_WINDOWS_
+	sendFlags |= MSG_NOSIGNAL;
+#endif
+	uint32_t sent = 0;
+	while ( m_sendHead < m_sendDatagrams.Length() )
+	{
+#if _AE_MMSG_
+		mmsghdr msgs[ kBatchSize ];
+		iovec iovecs[ kBatchSize ];
+		const uint32_t count = ae::Min( kBatchSize, m_sendDatagrams.Length() - m_sendHead );
+		memset( msgs, 0, sizeof(mmsghdr) * count );
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			Pending* pending = &m_sendDatagrams[ m_sendHead + i ];
+			iovecs[ i ].iov_base = m_sendData.Data() + pending->offset;
+			iovecs[ i ].iov_len = pending->length;
+			msgs[ i ].msg_hdr.msg_name = pending->address.data;
+			msgs[ i ].msg_hdr.msg_namelen = pending->address.size;
+			msgs[ i ].msg_hdr.msg_iov = &iovecs[ i ];
+			msgs[ i ].msg_hdr.msg_iovlen = 1;
+		}
+		const int result = sendmmsg( m_sock, msgs, count, sendFlags );
+#else
+		const Pending& pending = m_sendDatagrams[ m_sendHead ];
+		const int result = ( sendto( m_sock, (const _ae_sock_buff_t*)( m_sendData.Data() + pending.offset ), pending.length, sendFlags, (const sockaddr*)pending.address.data, pending.address.size ) >= 0 ) ? 1 : -1;
+#endif
+		if ( result > 0 )
+		{
+			m_sendHead += result;
+			sent += result;
+		}
+		else if ( errno == EAGAIN || errno == EWOULDBLOCK )
+		{
+			break; // Send buffer is full, try again later
+		}
+		else if ( errno != EINTR )
+		{
+			m_sendHead++; // Skip datagrams that can't be sent, ie. unreachable address
+		}
+	}
+	
+	if ( m_sendHead == m_sendDatagrams.Length() )
+	{
+		m_sendData.Clear();
+		m_sendDatagrams.Clear();
+		m_sendHead = 0;
+	}
+	return sent;
+}
+
+uint32_t DatagramSocket::Receive()
+{
+	m_recvDatagrams.Clear();
+	if ( !IsOpen() )
+	{
+		return 0;
+	}
+	
+	// Each slot has one extra byte so datagrams that are too long can be
+	// detected and discarded on all platforms
+	const uint32_t slotSize = m_maxDatagramSize + 1;
+	uint32_t slot = 0;
+	while ( slot < kMaxReceiveCount )
+	{
+		const uint32_t count = ae::Min( kBatchSize, kMaxReceiveCount - slot );
+		sockaddr_storage addrs[ kBatchSize ];
+		uint32_t lengths[ kBatchSize ];
+		socklen_t addrLengths[ kBatchSize ];
+#if _AE_MMSG_
+		mmsghdr msgs[ kBatchSize ];
+		iovec iovecs[ kBatchSize ];
+		memset( msgs, 0, sizeof(mmsghdr) * count );
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			iovecs[ i ].iov_base = m_recvData.Data() + ( slot + i ) * slotSize;
+			iovecs[ i ].iov_len = slotSize;
+			msgs[ i ].msg_hdr.msg_name = &addrs[ i ];
+			msgs[ i ].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+			msgs[ i ].msg_hdr.msg_iov = &iovecs[ i ];
+			msgs[ i ].msg_hdr.msg_iovlen = 1;
+		}
+		const int result = recvmmsg( m_sock, msgs, count, MSG_DONTWAIT, nullptr );
+		for ( int i = 0; i < result; i++ )
+		{
+			lengths[ i ] = msgs[ i ].msg_len;
+			addrLengths[ i ] = msgs[ i ].msg_hdr.msg_namelen;
+		}
+#else
+		addrLengths[ 0 ] = sizeof(sockaddr_storage);
+		const int32_t length = (int32_t)recvfrom( m_sock, (_ae_sock_buff_t*)( m_recvData.Data() + slot * slotSize ), slotSize, 0, (sockaddr*)&addrs[ 0 ], &addrLengths[ 0 ] );
+		const int result = ( length >= 0 ) ? 1 : -1;
+		lengths[ 0 ] = (uint32_t)length;
+#endif
+		if ( result <= 0 )
+		{
+			if ( result < 0 && errno == EINTR )
+			{
+				continue;
+			}
+			break; // EAGAIN or error, nothing more to receive
+		}
+		for ( int i = 0; i < result; i++ )
+		{
+			if ( lengths[ i ] > m_maxDatagramSize )
+			{
+				continue; // Truncated
+			}
+			Datagram* datagram = &m_recvDatagrams.Append( {} );
+			datagram->data = m_recvData.Data() + ( slot + i ) * slotSize;
+			datagram->length = lengths[ i ];
+			m_FromSocketAddress( &addrs[ i ], (uint32_t)addrLengths[ i ], &datagram->address );
+		}
+		slot += result;
+	}
+	return m_recvDatagrams.Length();
+}
+
+}  // ae end
+
+//------------------------------------------------------------------------------
+// OpenGL includes
+//------------------------------------------------------------------------------
+#if _AE_WINDOWS_
+	#pragma comment (lib, "opengl32.lib")
+	#pragma comment (lib, "glu32.lib")
+	#include <gl/GL.h>
+	#include <gl/GLU.h>
+#elif _AE_EMSCRIPTEN_
+	#include <GLES3/gl3.h>
+#elif _AE_LINUX_
+	#define GL_GLEXT_PROTOTYPES 1
+	#include <GL/glcorearb.h>
+#elif _AE_IOS_
+	#include <OpenGLES/ES3/gl.h>
+#else
+	#include <OpenGL/glext.h>
+	#include <OpenGL/gl3.h>
+	#include <OpenGL/gl3ext.h>
+#endif
+
+namespace ae
+{
+#if _AE_IOS_ || _AE_EMSCRIPTEN_
+	uint32_t GLMajorVersion = 3;
+	uint32_t GLMinorVersion = 0;
+#else
+	uint32_t GLMajorVersion = 4;
+	uint32_t GLMinorVersion = 1;
+#endif
+bool ReverseZ = false;
+}  // ae end
+
+#if _AE_WINDOWS_
+// OpenGL function pointers
+typedef char GLchar;
+typedef intptr_t GLsizeiptr;
+typedef intptr_t GLintptr;
 
 // GL_VERSION_1_2
 #define GL_TEXTURE_3D                     0x806F
@@ -23446,9 +25197,13 @@ Keyframe::Keyframe( const ae::Matrix4& transform )
 
 ae::Matrix4 Keyframe::GetLocalTransform() const
 {
-	ae::Matrix4 rot = ae::Matrix4::Identity();
-	rot.SetRotation( rotation );
-	return ae::Matrix4::Translation( translation ) * rot * ae::Matrix4::Scaling( scale );
+	// Equivalent to Translation( translation ) * rotation * Scaling( scale )
+	ae::Matrix4 result = rotation.GetTransformMatrix();
+	result.columns[ 0 ] *= scale.x;
+	result.columns[ 1 ] *= scale.y;
+	result.columns[ 2 ] *= scale.z;
+	result.SetTranslation( translation );
+	return result;
 }
 
 Keyframe Keyframe::Lerp( const Keyframe& target, float t ) const
@@ -23470,7 +25225,11 @@ ae::Keyframe Animation::GetKeyframeByTime( const char* boneName, float time ) co
 
 ae::Keyframe Animation::GetKeyframeByPercent( const char* boneName, float percent ) const
 {
-	const ae::Array< ae::Keyframe >* boneKeyframes = keyframes.TryGet( boneName );
+	return SampleKeyframes( keyframes.TryGet( boneName ), percent );
+}
+
+ae::Keyframe Animation::SampleKeyframes( const ae::Array< ae::Keyframe >* boneKeyframes, float percent ) const
+{
 	if ( !boneKeyframes || !boneKeyframes->Length() )
 	{
 		return ae::Keyframe();
@@ -23536,6 +25295,10 @@ void Skeleton::Initialize( uint32_t maxBones )
 {
 	m_bones.Clear();
 	m_bones.Reserve( maxBones );
+	m_parents.Clear();
+	m_parents.Reserve( maxBones );
+	m_dirty.Clear();
+	m_dirty.Reserve( maxBones );
 	
 	Bone* bone = &m_bones.Append( {} );
 	bone->name = "root";
@@ -23543,6 +25306,8 @@ void Skeleton::Initialize( uint32_t maxBones )
 	bone->transform = ae::Matrix4::Identity();
 	bone->localTransform = ae::Matrix4::Identity();
 	bone->parent = nullptr;
+	m_parents.Append( kInvalidIndex );
+	m_dirty.Append( 0 );
 }
 
 void Skeleton::Initialize( const Skeleton* otherPose )
@@ -23582,6 +25347,8 @@ const Bone* Skeleton::AddBone( const Bone* _parent, const char* name, const ae::
 	bone->localTransform = localTransform;
 	bone->inverseTransform = bone->transform.GetInverse();
 	bone->parent = parent;
+	m_parents.Append( parent->index );
+	m_dirty.Append( 0 );
 	
 	Bone** children = &parent->firstChild;
 	while ( *children )
@@ -23600,88 +25367,361 @@ void Skeleton::SetLocalTransforms( const Bone** targets, const ae::Matrix4* loca
 		return;
 	}
 	
+	uint32_t first = m_bones.Length();
 	for ( uint32_t i = 0; i < count; i++ )
 	{
 		ae::Bone* bone = const_cast< ae::Bone* >( targets[ i ] );
 		AE_ASSERT_MSG( bone, "Null bone passed to skeleton when setting transforms" );
 		AE_ASSERT_MSG( m_bones.begin() <= bone && bone < m_bones.end(), "Transform target '#' is not part of this skeleton", bone->name );
 		bone->localTransform = localTransforms[ i ];
+		m_dirty[ bone->index ] = 1;
+		first = ae::Min( first, bone->index );
+	}
+	
+	// Parents always precede their children, so a single forward pass starting
+	// at the first modified bone propagates dirty flags down each subtree.
+	// Clean bones only cost a flag check.
+	const uint32_t* parents = m_parents.Data();
+	uint8_t* dirty = m_dirty.Data();
+	ae::Bone* bones = m_bones.Data();
+	const uint32_t boneCount = m_bones.Length();
+	for ( uint32_t i = first; i < boneCount; i++ )
+	{
+		const uint32_t parent = parents[ i ];
+		if ( parent != kInvalidIndex && dirty[ parent ] )
+		{
+			dirty[ i ] = 1;
+		}
+		if ( !dirty[ i ] )
+		{
+			continue;
+		}
+		ae::Bone* bone = &bones[ i ];
+		bone->transform = ( parent != kInvalidIndex ) ? bones[ parent ].transform * bone->localTransform : bone->localTransform;
+		bone->inverseTransform = bone->transform.GetInverse();
+	}
+	memset( dirty + first, 0, boneCount - first );
+}
+
+void Skeleton::SetTransforms( const Bone** targets, const ae::Matrix4* transforms, uint32_t count )
+{
+	if ( !count )
+	{
+		return;
+	}
+	
+	uint32_t first = m_bones.Length();
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		ae::Bone* bone = const_cast< ae::Bone* >( targets[ i ] );
+		AE_ASSERT_MSG( bone, "Null bone passed to skeleton when setting transforms" );
+		AE_ASSERT_MSG( m_bones.begin() <= bone && bone < m_bones.end(), "Transform target '#' is not part of this skeleton", bone->name );
+		bone->transform = transforms[ i ];
+		bone->inverseTransform = bone->transform.GetInverse();
+		m_dirty[ bone->index ] = 1;
+		first = ae::Min( first, bone->index );
+	}
+	
+	// Only modified bones and their direct children have new local transforms
+	const uint32_t* parents = m_parents.Data();
+	uint8_t* dirty = m_dirty.Data();
+	ae::Bone* bones = m_bones.Data();
+	const uint32_t boneCount = m_bones.Length();
+	for ( uint32_t i = first; i < boneCount; i++ )
+	{
+		const uint32_t parent = parents[ i ];
+		if ( parent == kInvalidIndex )
+		{
+			if ( dirty[ i ] )
+			{
+				bones[ i ].localTransform = bones[ i ].transform;
+			}
+		}
+		else if ( dirty[ i ] || dirty[ parent ] )
+		{
+			bones[ i ].localTransform = bones[ parent ].inverseTransform * bones[ i ].transform;
+		}
+	}
+	memset( dirty + first, 0, boneCount - first );
+}
+
+void Skeleton::SetLocalTransform( const Bone* target, const ae::Matrix4& localTransform )
+{
+	SetLocalTransforms( &target, &localTransform, 1 );
+}
+
+void Skeleton::SetTransform( const Bone* target, const ae::Matrix4& transform )
+{
+	SetTransforms( &target, &transform, 1 );
+}
+
+void Skeleton::SetLocalPose( const PoseBuffer& pose )
+{
+	AE_ASSERT_MSG( pose.GetBoneCount() == m_bones.Length(), "Pose bone count (#) does not match skeleton (#)", pose.GetBoneCount(), m_bones.Length() );
+	const uint32_t* parents = m_parents.Data();
+	ae::Bone* bones = m_bones.Data();
+	for ( uint32_t i = 0; i < m_bones.Length(); i++ )
+	{
+		ae::Bone* bone = &bones[ i ];
+		bone->localTransform = pose.GetKeyframe( i ).GetLocalTransform();
+		const uint32_t parent = parents[ i ];
+		bone->transform = ( parent != kInvalidIndex ) ? bones[ parent ].transform * bone->localTransform : bone->localTransform;
+		bone->inverseTransform = bone->transform.GetInverse();
+	}
+}
+
+const Bone* Skeleton::GetRoot() const
+{
+	return m_bones.Data();
+}
+
+const Bone* Skeleton::GetBoneByName( const char* name ) const
+{
+	int32_t idx = m_bones.FindFn( [ name ]( const Bone& b ){ return b.name == name; } );
+	return ( idx >= 0 ) ? &m_bones[ idx ] : nullptr;
+}
+
+const Bone* Skeleton::GetBoneByIndex( uint32_t index ) const
+{
+#if _AE_DEBUG_
+	AE_ASSERT( m_bones[ index ].index == index );
+#endif
+	return &m_bones[ index ];
+}
+
+const Bone* Skeleton::GetBones() const
+{
+	return m_bones.Data();
+}
+
+uint32_t Skeleton::GetBoneCount() const
+{
+	return m_bones.Length();
+}
+
+//------------------------------------------------------------------------------
+// ae::PoseBuffer member functions
+//------------------------------------------------------------------------------
+void PoseBuffer::Initialize( const ae::Skeleton* skeleton )
+{
+	const uint32_t boneCount = skeleton->GetBoneCount();
+	Initialize( boneCount );
+	for ( uint32_t i = 0; i < boneCount; i++ )
+	{
+		SetKeyframe( i, ae::Keyframe( skeleton->GetBoneByIndex( i )->localTransform ) );
+	}
+}
+
+void PoseBuffer::Initialize( uint32_t boneCount )
+{
+	translations.Clear();
+	rotations.Clear();
+	scales.Clear();
+	translations.Append( ae::Vec3( 0.0f ), boneCount );
+	rotations.Append( ae::Quaternion::Identity(), boneCount );
+	scales.Append( ae::Vec3( 1.0f ), boneCount );
+}
+
+ae::Keyframe PoseBuffer::GetKeyframe( uint32_t index ) const
+{
+	ae::Keyframe result;
+	result.translation = translations[ index ];
+	result.rotation = rotations[ index ];
+	result.scale = scales[ index ];
+	return result;
+}
+
+void PoseBuffer::SetKeyframe( uint32_t index, const ae::Keyframe& keyframe )
+{
+	translations[ index ] = keyframe.translation;
+	rotations[ index ] = keyframe.rotation;
+	scales[ index ] = keyframe.scale;
+}
+
+void PoseBuffer::Lerp( const PoseBuffer& pose0, const PoseBuffer& pose1, float t, PoseBuffer* poseOut )
+{
+	Layer( pose0, pose1, nullptr, t, poseOut );
+}
+
+void PoseBuffer::Additive( const PoseBuffer& base, const PoseBuffer& additive, const PoseBuffer& reference, float weight, PoseBuffer* poseOut )
+{
+	const uint32_t boneCount = base.GetBoneCount();
+	AE_ASSERT( additive.GetBoneCount() == boneCount );
+	AE_ASSERT( reference.GetBoneCount() == boneCount );
+	if ( poseOut->GetBoneCount() != boneCount )
+	{
+		poseOut->Initialize( boneCount );
 	}
-	
-	m_bones[ 0 ].transform = m_bones[ 0 ].localTransform;
-	for ( uint32_t i = 1; i < m_bones.Length(); i++ )
+	const ae::Quaternion identity = ae::Quaternion::Identity();
+	for ( uint32_t i = 0; i < boneCount; i++ )
 	{
-		ae::Bone* bone = &m_bones[ i ];
-		AE_ASSERT( bone->parent );
-		AE_ASSERT( bone->parent < bone );
-		bone->transform = bone->parent->transform * bone->localTransform;
-		bone->inverseTransform = bone->transform.GetInverse();
+		const ae::Quaternion deltaRotation = additive.rotations[ i ].RelativeCopy( reference.rotations[ i ] );
+		const ae::Vec3 deltaScale = additive.scales[ i ] / reference.scales[ i ];
+		poseOut->translations[ i ] = base.translations[ i ] + ( additive.translations[ i ] - reference.translations[ i ] ) * weight;
+		poseOut->rotations[ i ] = base.rotations[ i ] * identity.Nlerp( deltaRotation, weight );
+		poseOut->scales[ i ] = base.scales[ i ] * ae::Vec3( 1.0f ).Lerp( deltaScale, weight );
 	}
 }
 
-void Skeleton::SetTransforms( const Bone** targets, const ae::Matrix4* transforms, uint32_t count )
+void PoseBuffer::Layer( const PoseBuffer& base, const PoseBuffer& layer, const float* boneWeights, float weight, PoseBuffer* poseOut )
 {
-	if ( !count )
-	{
-		return;
-	}
-	
-	for ( uint32_t i = 0; i < count; i++ )
+	const uint32_t boneCount = base.GetBoneCount();
+	AE_ASSERT( layer.GetBoneCount() == boneCount );
+	if ( poseOut->GetBoneCount() != boneCount )
 	{
-		ae::Bone* bone = const_cast< ae::Bone* >( targets[ i ] );
-		AE_ASSERT_MSG( bone, "Null bone passed to skeleton when setting transforms" );
-		AE_ASSERT_MSG( m_bones.begin() <= bone && bone < m_bones.end(), "Transform target '#' is not part of this skeleton", bone->name );
-		bone->transform = transforms[ i ];
-		bone->inverseTransform = bone->transform.GetInverse();
+		poseOut->Initialize( boneCount );
 	}
-	
-	m_bones[ 0 ].transform = m_bones[ 0 ].localTransform;
-	for ( uint32_t i = 1; i < m_bones.Length(); i++ )
+	for ( uint32_t i = 0; i < boneCount; i++ )
 	{
-		ae::Bone* bone = &m_bones[ i ];
-		AE_ASSERT( bone->parent );
-		AE_ASSERT( bone->parent < bone );
-		bone->localTransform = bone->parent->inverseTransform * bone->transform;
+		const float t = boneWeights ? weight * boneWeights[ i ] : weight;
+		poseOut->translations[ i ] = base.translations[ i ].Lerp( layer.translations[ i ], t );
+		poseOut->rotations[ i ] = base.rotations[ i ].Nlerp( layer.rotations[ i ], t );
+		poseOut->scales[ i ] = base.scales[ i ].Lerp( layer.scales[ i ], t );
 	}
 }
 
-void Skeleton::SetLocalTransform( const Bone* target, const ae::Matrix4& localTransform )
+//------------------------------------------------------------------------------
+// ae::BlendTree member functions
+//------------------------------------------------------------------------------
+BlendTree::BlendTree( const ae::Tag& tag ) :
+	m_tag( tag ),
+	m_nodes( tag ),
+	m_tracks( tag ),
+	m_boneWeights( tag ),
+	m_boneNames( tag )
+{}
+
+void BlendTree::Initialize( const ae::Skeleton* bindPose )
 {
-	SetLocalTransforms( &target, &localTransform, 1 );
+	m_nodes.Clear();
+	m_tracks.Clear();
+	m_boneWeights.Clear();
+	m_boneNames.Clear();
+	m_boneCount = bindPose->GetBoneCount();
+	for ( uint32_t i = 0; i < m_boneCount; i++ )
+	{
+		m_boneNames.Append( bindPose->GetBoneByIndex( i )->name );
+	}
 }
 
-void Skeleton::SetTransform( const Bone* target, const ae::Matrix4& transform )
+uint32_t BlendTree::AddClip( const ae::Animation* animation )
 {
-	SetTransforms( &target, &transform, 1 );
+	AE_ASSERT( animation );
+	Node node;
+	node.type = NodeType::Clip;
+	node.animation = animation;
+	node.tracksOffset = m_tracks.Length();
+	for ( const ae::Str64& boneName : m_boneNames )
+	{
+		m_tracks.Append( animation->keyframes.TryGet( boneName ) );
+	}
+	m_nodes.Append( node );
+	return m_nodes.Length() - 1;
 }
 
-const Bone* Skeleton::GetRoot() const
+uint32_t BlendTree::AddLerp( uint32_t node0, uint32_t node1 )
 {
-	return m_bones.Data();
+	AE_ASSERT_MSG( node0 < m_nodes.Length() && node1 < m_nodes.Length(), "Blend tree nodes can only reference previously added nodes" );
+	Node node;
+	node.type = NodeType::Lerp;
+	node.inputs[ 0 ] = node0;
+	node.inputs[ 1 ] = node1;
+	m_nodes.Append( node );
+	return m_nodes.Length() - 1;
 }
 
-const Bone* Skeleton::GetBoneByName( const char* name ) const
+uint32_t BlendTree::AddAdditive( uint32_t base, uint32_t additive, uint32_t reference )
 {
-	int32_t idx = m_bones.FindFn( [ name ]( const Bone& b ){ return b.name == name; } );
-	return ( idx >= 0 ) ? &m_bones[ idx ] : nullptr;
+	AE_ASSERT_MSG( base < m_nodes.Length() && additive < m_nodes.Length() && reference < m_nodes.Length(), "Blend tree nodes can only reference previously added nodes" );
+	Node node;
+	node.type = NodeType::Additive;
+	node.inputs[ 0 ] = base;
+	node.inputs[ 1 ] = additive;
+	node.inputs[ 2 ] = reference;
+	m_nodes.Append( node );
+	return m_nodes.Length() - 1;
 }
 
-const Bone* Skeleton::GetBoneByIndex( uint32_t index ) const
+uint32_t BlendTree::AddLayer( uint32_t base, uint32_t layer, const float* boneWeights )
 {
-#if _AE_DEBUG_
-	AE_ASSERT( m_bones[ index ].index == index );
-#endif
-	return &m_bones[ index ];
+	AE_ASSERT_MSG( base < m_nodes.Length() && layer < m_nodes.Length(), "Blend tree nodes can only reference previously added nodes" );
+	AE_ASSERT( boneWeights );
+	Node node;
+	node.type = NodeType::Layer;
+	node.inputs[ 0 ] = base;
+	node.inputs[ 1 ] = layer;
+	node.tracksOffset = m_boneWeights.Length();
+	m_boneWeights.AppendArray( boneWeights, m_boneCount );
+	m_nodes.Append( node );
+	return m_nodes.Length() - 1;
 }
 
-const Bone* Skeleton::GetBones() const
+void BlendTree::Evaluate( const float* params, ae::Array< ae::PoseBuffer >* scratch, ae::PoseBuffer* poseOut ) const
 {
-	return m_bones.Data();
+	AE_ASSERT_MSG( m_nodes.Length(), "Blend tree has no nodes" );
+	while ( scratch->Length() < m_nodes.Length() )
+	{
+		scratch->Append( ae::PoseBuffer( scratch->Tag() ) );
+	}
+	
+	for ( uint32_t i = 0; i < m_nodes.Length(); i++ )
+	{
+		const Node& node = m_nodes[ i ];
+		const float param = params[ i ];
+		ae::PoseBuffer* out = &(*scratch)[ i ];
+		switch ( node.type )
+		{
+			case NodeType::Clip:
+			{
+				if ( out->GetBoneCount() != m_boneCount )
+				{
+					out->Initialize( m_boneCount );
+				}
+				const ae::Array< ae::Keyframe >* const* tracks = m_tracks.Data() + node.tracksOffset;
+				for ( uint32_t j = 0; j < m_boneCount; j++ )
+				{
+					out->SetKeyframe( j, node.animation->SampleKeyframes( tracks[ j ], param ) );
+				}
+				break;
+			}
+			case NodeType::Lerp:
+				ae::PoseBuffer::Lerp( (*scratch)[ node.inputs[ 0 ] ], (*scratch)[ node.inputs[ 1 ] ], param, out );
+				break;
+			case NodeType::Additive:
+				ae::PoseBuffer::Additive( (*scratch)[ node.inputs[ 0 ] ], (*scratch)[ node.inputs[ 1 ] ], (*scratch)[ node.inputs[ 2 ] ], param, out );
+				break;
+			case NodeType::Layer:
+				ae::PoseBuffer::Layer( (*scratch)[ node.inputs[ 0 ] ], (*scratch)[ node.inputs[ 1 ] ], m_boneWeights.Data() + node.tracksOffset, param, out );
+				break;
+		}
+	}
+	*poseOut = (*scratch)[ m_nodes.Length() - 1 ];
 }
 
-uint32_t Skeleton::GetBoneCount() const
+void BlendTree::Update( const Character* characters, uint32_t count, ae::WorkerPool* workerPool ) const
 {
-	return m_bones.Length();
+	auto updateFn = [ this, characters ]( uint32_t begin, uint32_t end )
+	{
+		// Scratch poses are allocated once per batch and reused for every character in it
+		ae::Array< ae::PoseBuffer > scratch = m_tag;
+		ae::PoseBuffer pose = m_tag;
+		for ( uint32_t i = begin; i < end; i++ )
+		{
+			const Character& character = characters[ i ];
+			AE_ASSERT( character.params && character.skeleton );
+			Evaluate( character.params, &scratch, &pose );
+			character.skeleton->SetLocalPose( pose );
+		}
+	};
+	if ( workerPool )
+	{
+		const uint32_t threadCount = workerPool->GetWorkerCount() + 1;
+		workerPool->Run( count, ae::Max( 1u, count / ( threadCount * 4 ) ), updateFn );
+	}
+	else
+	{
+		updateFn( 0, count );
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -23872,78 +25912,84 @@ IK::IK( ae::Tag tag ) :
 	pose( tag )
 {}
 
-void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* debugLines )
+//! \cond INTERNAL
+static const ae::IKConstraints& _GetIKConstraints( const ae::IKConstraints* joints, uint32_t jointCount, uint32_t idx )
 {
-	AE_ASSERT( !chain.Length() || pose.GetBoneCount() );
-	AE_ASSERT_MSG( bindPose, "A bind pose is required to run IK" );
-	// @TODO: More thorough validation
-	AE_ASSERT_MSG( bindPose->GetBoneCount() == pose.GetBoneCount(), "Bind pose and pose hierarchy must match" );
-
-	struct IKBone
-	{
-		ae::Vec3 pos;
-		ae::Quaternion rotation;
-		float length; // Fixed distance between pos and parent pos
-		float defaultTwist; // The bind pose twist angle between this bone and its parent
-	};
-
-	//AE_ASSERT( joints.Length() == 0 || joints.Length() == 1 || joints.Length() == bones.Length() );
-	auto GetConstraints = [ this ]( uint32_t idx ) -> const ae::IKConstraints&
+	switch ( jointCount )
 	{
-		switch ( joints.Length() )
+		case 0:
 		{
-			case 0:
-			{
-				static const ae::IKConstraints s_default;
-				return s_default;
-			}
-			case 1: return joints[ 0 ];
-			default: return joints[ idx ];
+			static const ae::IKConstraints s_default;
+			return s_default;
 		}
-	};
+		case 1: return joints[ 0 ];
+		default: return joints[ idx ];
+	}
+}
 
-	// (a) The initial configuration of the manipulator and the target
-	ae::Array< IKBone > bones( tag, pose.GetBoneCount() );
-	for ( uint32_t i = 0; i < chain.Length(); i++ )
+// (a) The initial configuration of the manipulator and the target
+static void _InitIKBones( const ae::Skeleton* bindPose, const ae::Skeleton* pose, const uint32_t* chain, uint32_t chainLength, const ae::IKConstraints* joints, uint32_t jointCount, ae::_IKBone* bonesOut )
+{
+	for ( uint32_t i = 0; i < chainLength; i++ )
 	{
 		const Bone* bindBone = bindPose->GetBoneByIndex( chain[ i ] );
-		const Bone* currentBone = pose.GetBoneByIndex( chain[ i ] );
+		const Bone* currentBone = pose->GetBoneByIndex( chain[ i ] );
 		AE_ASSERT( currentBone->parent );
 		AE_ASSERT( bindBone->parent );
-		IKBone ikBone;
-		ikBone.pos = currentBone->transform.GetTranslation();
-		ikBone.rotation = currentBone->transform.GetRotation();
-		ikBone.length = ( bindBone->transform.GetTranslation() - bindBone->parent->transform.GetTranslation() ).Length();
+		ae::_IKBone* ikBone = &bonesOut[ i ];
+		ikBone->pos = currentBone->transform.GetTranslation();
+		ikBone->rotation = currentBone->transform.GetRotation();
+		ikBone->length = ( bindBone->transform.GetTranslation() - bindBone->parent->transform.GetTranslation() ).Length();
 
 		ae::Quaternion twist;
-		float twistAngle = 0.0f;
-		const ae::Vec3 primaryAxis = GetAxisVector( GetConstraints( i ).primaryAxis );
+		const ae::Vec3 primaryAxis = ae::IK::GetAxisVector( _GetIKConstraints( joints, jointCount, i ).primaryAxis );
 		const ae::Quaternion bindRot = bindBone->transform.GetRotation().RelativeCopy( bindBone->parent->transform.GetRotation() );
 		bindRot.GetTwistSwing( primaryAxis, &twist, nullptr );
-		twist.GetAxisAngle( nullptr, &ikBone.defaultTwist );
-		
-		bones.Append( ikBone );
+		twist.GetAxisAngle( nullptr, &ikBone->defaultTwist );
 	}
+}
 
+// Iterates until the extent of the chain is within \p tolerance of the
+// target, \p iterationCount is reached, or \p deadline (from ae::GetTime()) has
+// passed. Returns the number of iterations performed.
+static uint32_t _SolveIK( ae::_IKBone* bones, uint32_t boneCount, const ae::IKConstraints* joints, uint32_t jointCount, const ae::Matrix4& targetTransform, uint32_t minIterations, uint32_t iterationCount, float tolerance, double deadline, bool* budgetExceededOut, ae::DebugLines* debugLines )
+{
+	auto GetConstraints = [ joints, jointCount ]( uint32_t idx ) -> const ae::IKConstraints&
+	{
+		return _GetIKConstraints( joints, jointCount, idx );
+	};
+	*budgetExceededOut = false;
 	const ae::Vec3 rootPos = bones[ 0 ].pos;
 	const ae::Vec3 targetPos = targetTransform.GetTranslation();
 	const ae::Quaternion targetRot = targetTransform.GetRotation();
 
 	uint32_t iters = 0;
-	while ( iters == 0 || ( ( bones[ bones.Length() - 1 ].pos - targetPos ).Length() > 0.001f && iters < iterationCount ) )
+	while ( iters < iterationCount )
 	{
+		if ( iters >= minIterations )
+		{
+			if ( ( bones[ boneCount - 1 ].pos - targetPos ).Length() <= tolerance )
+			{
+				break;
+			}
+			if ( deadline > 0.0 && ae::GetTime() > deadline )
+			{
+				*budgetExceededOut = true;
+				break;
+			}
+		}
 		// Start from end and iterate to root to move toward target
 		// (b) relocate and reorient joint p4 to target t
-		bones[ bones.Length() - 1 ].pos = targetPos;
-		bones[ bones.Length() - 1 ].rotation = targetRot;
-		for ( int32_t i = bones.Length() - 2; i >= 0; i-- )
+		bones[ boneCount - 1 ].pos = targetPos;
+		bones[ boneCount - 1 ].rotation = targetRot;
+		for ( int32_t i = boneCount - 2; i >= 0; i-- )
 		{
-			IKBone* parentBone = i ? &bones[ i - 1 ] : nullptr;
-			IKBone* currentBone = &bones[ i ];
-			IKBone* childBone = &bones[ i + 1 ];
+			ae::_IKBone* parentBone = i ? &bones[ i - 1 ] : nullptr;
+			ae::_IKBone* currentBone = &bones[ i ];
+			ae::_IKBone* childBone = &bones[ i + 1 ];
 			const ae::IKConstraints& currentConstraints = GetConstraints( i );
 			const ae::IKConstraints& childConstraints = GetConstraints( i + 1 );
-			const ae::Vec3 currentPrimaryAxis = GetAxisVector( currentConstraints.primaryAxis );
+			const ae::Vec3 currentPrimaryAxis = ae::IK::GetAxisVector( currentConstraints.primaryAxis );
 
 			// (c) move joint p0 to p0', which lies on the line that passes through the points p1' and p0 and has distance d0 from p1'
 			currentBone->pos = childBone->pos + ( currentBone->pos - childBone->pos ).SafeNormalizeCopy() * childBone->length;
@@ -23968,7 +26014,7 @@ void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* de
 				currentBone->rotation = parentBone->rotation * relative1;
 
 				// (e) the rotational constraints: the allowed regions shown as a shaded composite ellipsoidal shape
-				currentBone->pos -= ClipJoint(
+				currentBone->pos -= ae::IK::ClipJoint(
 					childBone->length,
 					currentBone->pos,
 					parentBone->rotation,
@@ -23996,14 +26042,14 @@ void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* de
 		
 		// Iterate from root to reposition joints
 		bones[ 0 ].pos = rootPos;
-		for ( uint32_t i = 0; i < bones.Length() - 1; i++ )
+		for ( uint32_t i = 0; i < boneCount - 1; i++ )
 		{
-			IKBone* parentBone = i ? &bones[ i - 1 ] : nullptr;
-			IKBone* currentBone = &bones[ i ];
-			IKBone* childBone = &bones[ i + 1 ];
+			ae::_IKBone* parentBone = i ? &bones[ i - 1 ] : nullptr;
+			ae::_IKBone* currentBone = &bones[ i ];
+			ae::_IKBone* childBone = &bones[ i + 1 ];
 			const ae::IKConstraints& currentConstraints = GetConstraints( i );
 			const ae::IKConstraints& childConstraints = GetConstraints( i + 1 );
-			const ae::Vec3 currentPrimaryAxis = GetAxisVector( currentConstraints.primaryAxis );
+			const ae::Vec3 currentPrimaryAxis = ae::IK::GetAxisVector( currentConstraints.primaryAxis );
 
 			// (c) move joint p0 to p0', which lies on the line that passes through the points p1' and p0 and has distance d0 from p1'
 			childBone->pos = currentBone->pos + ( childBone->pos - currentBone->pos ).SafeNormalizeCopy() * childBone->length;
@@ -24029,7 +26075,7 @@ void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* de
 				childBone->pos = currentBone->pos + currentBone->rotation.Rotate( currentPrimaryAxis ) * childBone->length;
 
 				// // (e) the rotational constraints: the allowed regions shown as a shaded composite ellipsoidal shape
-				childBone->pos += ClipJoint(
+				childBone->pos += ae::IK::ClipJoint(
 					childBone->length,
 					currentBone->pos,
 					parentBone->rotation,
@@ -24054,93 +26100,464 @@ void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* de
 				debugLines->AddLine( childBone->pos, currentBone->pos, ae::Color::Red() );
 			}
 		}
-		
-		iters++;
+		
+		iters++;
+	}
+	return iters;
+}
+
+static void _ApplyIK( const ae::Tag& tag, const ae::_IKBone* bones, const uint32_t* chain, uint32_t chainLength, const ae::Matrix4& targetTransform, ae::Skeleton* poseOut )
+{
+	ae::Array< const ae::Bone* > outBones( tag, chainLength );
+	ae::Array< ae::Matrix4 > outTransforms( tag, chainLength );
+	for ( uint32_t i = 0; i < chainLength; i++ )
+	{
+		outBones.Append( poseOut->GetBoneByIndex( chain[ i ] ) );
+		ae::Matrix4 transform = bones[ i ].rotation.GetTransformMatrix();
+		transform.SetTranslation( bones[ i ].pos );
+		outTransforms.Append( transform );
+	}
+	ae::Matrix4* finalTransform = &outTransforms[ chainLength - 1 ];
+	*finalTransform = targetTransform;
+	// @TODO: Maintain the old bones scale
+	finalTransform->SetTranslation( bones[ chainLength - 1 ].pos );
+	poseOut->SetTransforms( outBones.Data(), outTransforms.Data(), chainLength );
+}
+//! \endcond
+
+void IK::Run( uint32_t iterationCount, ae::Skeleton* poseOut, ae::DebugLines* debugLines )
+{
+	AE_ASSERT( !chain.Length() || pose.GetBoneCount() );
+	AE_ASSERT_MSG( bindPose, "A bind pose is required to run IK" );
+	// @TODO: More thorough validation
+	AE_ASSERT_MSG( bindPose->GetBoneCount() == pose.GetBoneCount(), "Bind pose and pose hierarchy must match" );
+	//AE_ASSERT( joints.Length() == 0 || joints.Length() == 1 || joints.Length() == bones.Length() );
+
+	ae::Array< ae::_IKBone > bones( tag, ae::_IKBone(), chain.Length() );
+	_InitIKBones( bindPose, &pose, chain.Data(), chain.Length(), joints.Data(), joints.Length(), bones.Data() );
+	bool budgetExceeded = false;
+	_SolveIK( bones.Data(), bones.Length(), joints.Data(), joints.Length(), targetTransform, 1, ae::Max( 1u, iterationCount ), 0.001f, 0.0, &budgetExceeded, debugLines );
+
+	poseOut->Initialize( &pose );
+	_ApplyIK( tag, bones.Data(), chain.Data(), chain.Length(), targetTransform, poseOut );
+}
+
+//------------------------------------------------------------------------------
+// ae::IKSolver member functions
+//------------------------------------------------------------------------------
+IKSolver::IKSolver( const ae::Tag& tag ) :
+	m_tag( tag ),
+	m_chains( tag ),
+	m_bones( tag ),
+	m_joints( tag ),
+	m_solutions( tag ),
+	m_working( tag ),
+	m_groups( tag )
+{}
+
+uint32_t IKSolver::AddChain( ae::Skeleton* pose, const ae::Skeleton* bindPose, const uint32_t* bones, uint32_t boneCount, const ae::IKConstraints* joints, uint32_t jointCount )
+{
+	AE_ASSERT( pose );
+	AE_ASSERT_MSG( bindPose, "A bind pose is required to run IK" );
+	AE_ASSERT_MSG( bindPose->GetBoneCount() == pose->GetBoneCount(), "Bind pose and pose hierarchy must match" );
+	AE_ASSERT_MSG( boneCount, "IK chains require at least one bone" );
+	AE_ASSERT_MSG( jointCount == 0 || jointCount == 1 || jointCount == boneCount, "Expected 0, 1, or # IK joints, got #", boneCount, jointCount );
+	for ( uint32_t i = 0; i < boneCount; i++ )
+	{
+		AE_ASSERT_MSG( bones[ i ] < pose->GetBoneCount() && pose->GetBoneByIndex( bones[ i ] )->parent, "Invalid IK chain bone index: #", bones[ i ] );
+	}
+	
+	const uint32_t index = m_chains.Length();
+	Chain* chain = &m_chains.Append( {} );
+	chain->pose = pose;
+	chain->bindPose = bindPose;
+	chain->targetTransform = pose->GetBoneByIndex( bones[ boneCount - 1 ] )->transform;
+	chain->bonesOffset = m_bones.Length();
+	chain->boneCount = boneCount;
+	chain->jointsOffset = m_joints.Length();
+	chain->jointCount = jointCount;
+	chain->next = ae::Skeleton::kInvalidIndex;
+	chain->warm = false;
+	chain->iterations = 0;
+	chain->converged = false;
+	chain->budgetExceeded = false;
+	m_bones.AppendArray( bones, boneCount );
+	m_joints.AppendArray( joints, jointCount );
+	m_solutions.Append( ae::_IKBone(), boneCount );
+	m_working.Append( ae::_IKBone(), boneCount );
+	
+	// Chains sharing a skeleton are linked so they are solved on the same thread
+	if ( uint32_t* first = m_groups.TryGet( pose ) )
+	{
+		uint32_t last = *first;
+		while ( m_chains[ last ].next != ae::Skeleton::kInvalidIndex )
+		{
+			last = m_chains[ last ].next;
+		}
+		m_chains[ last ].next = index;
+	}
+	else
+	{
+		m_groups.Set( pose, index );
+	}
+	return index;
+}
+
+void IKSolver::SetTarget( uint32_t chain, const ae::Matrix4& targetTransform )
+{
+	m_chains[ chain ].targetTransform = targetTransform;
+}
+
+void IKSolver::Reset( uint32_t chain )
+{
+	m_chains[ chain ].warm = false;
+}
+
+void IKSolver::Clear()
+{
+	m_chains.Clear();
+	m_bones.Clear();
+	m_joints.Clear();
+	m_solutions.Clear();
+	m_working.Clear();
+	m_groups.Clear();
+	m_stats = Stats();
+}
+
+void IKSolver::Solve( ae::WorkerPool* workerPool )
+{
+	const double startTime = ae::GetTime();
+	const double deadline = ( timeBudget > 0.0 ) ? startTime + timeBudget : 0.0;
+	auto solveFn = [ this, deadline ]( uint32_t begin, uint32_t end )
+	{
+		for ( uint32_t i = begin; i < end; i++ )
+		{
+			for ( uint32_t chain = m_groups.GetValue( i ); chain != ae::Skeleton::kInvalidIndex; chain = m_chains[ chain ].next )
+			{
+				m_SolveChain( chain, deadline );
+			}
+		}
+	};
+	if ( workerPool )
+	{
+		workerPool->Run( m_groups.Length(), 1, solveFn );
+	}
+	else
+	{
+		solveFn( 0, m_groups.Length() );
+	}
+	
+	m_stats = Stats();
+	m_stats.chainCount = m_chains.Length();
+	for ( const Chain& chain : m_chains )
+	{
+		m_stats.iterationCount += chain.iterations;
+		m_stats.convergedCount += chain.converged ? 1 : 0;
+		m_stats.budgetExceededCount += chain.budgetExceeded ? 1 : 0;
+	}
+	m_stats.solveTime = ae::GetTime() - startTime;
+}
+
+void IKSolver::m_SolveChain( uint32_t index, double deadline )
+{
+	Chain* chain = &m_chains[ index ];
+	const uint32_t* bones = m_bones.Data() + chain->bonesOffset;
+	const ae::IKConstraints* joints = m_joints.Data() + chain->jointsOffset;
+	ae::_IKBone* solution = m_solutions.Data() + chain->bonesOffset;
+	ae::_IKBone* work = m_working.Data() + chain->bonesOffset;
+	const ae::Matrix4 parentTransform = chain->pose->GetBoneByIndex( bones[ 0 ] )->parent->transform;
+	const ae::Quaternion parentRotation = parentTransform.GetRotation();
+	
+	// Bone lengths and twists always come from the bind pose, and the root of
+	// the chain always starts at its current position
+	_InitIKBones( chain->bindPose, chain->pose, bones, chain->boneCount, joints, chain->jointCount, work );
+	if ( chain->warm )
+	{
+		// The previous solution is stored relative to the chain's parent so
+		// that it follows the character
+		work[ 0 ].rotation = parentRotation * solution[ 0 ].rotation;
+		for ( uint32_t i = 1; i < chain->boneCount; i++ )
+		{
+			work[ i ].pos = parentTransform.TransformPoint3x4( solution[ i ].pos );
+			work[ i ].rotation = parentRotation * solution[ i ].rotation;
+		}
+	}
+	
+	chain->iterations = _SolveIK( work, chain->boneCount, joints, chain->jointCount, chain->targetTransform, chain->warm ? 0 : 1, ae::Max( 1u, maxIterations ), tolerance, deadline, &chain->budgetExceeded, nullptr );
+	chain->converged = ( ( work[ chain->boneCount - 1 ].pos - chain->targetTransform.GetTranslation() ).Length() <= tolerance );
+	
+	const ae::Matrix4 invParentTransform = parentTransform.GetInverse();
+	const ae::Quaternion invParentRotation = parentRotation.GetInverse();
+	for ( uint32_t i = 0; i < chain->boneCount; i++ )
+	{
+		solution[ i ] = work[ i ];
+		solution[ i ].pos = invParentTransform.TransformPoint3x4( work[ i ].pos );
+		solution[ i ].rotation = invParentRotation * work[ i ].rotation;
+	}
+	chain->warm = true;
+	
+	_ApplyIK( m_tag, work, bones, chain->boneCount, chain->targetTransform, chain->pose );
+}
+
+//------------------------------------------------------------------------------
+// ae::Skin member functions
+//------------------------------------------------------------------------------
+void Skin::Initialize( const Skeleton& bindPose, const ae::Skin::Vertex* vertices, uint32_t vertexCount )
+{
+	AE_ASSERT( bindPose.GetBoneCount() );
+	m_bindPose.Initialize( &bindPose );
+	
+	m_verts.Clear();
+	m_verts.AppendArray( vertices, vertexCount );
+}
+
+const Skeleton& Skin::GetBindPose() const
+{
+	return m_bindPose;
+}
+
+ae::Matrix4 Skin::m_GetSkinTransform( const Skeleton* pose, uint32_t index ) const
+{
+	const ae::Bone* bone = pose->GetBoneByIndex( index );
+	const ae::Bone* bindPoseBone = m_bindPose.GetBoneByIndex( index );
+	if ( bone->parent ) { AE_ASSERT_MSG( bone->parent->index == bindPoseBone->parent->index, "Given ae::Skeleton pose does not match bind pose hierarchy" ); }
+	else { AE_ASSERT_MSG( !bindPoseBone->parent, "Given ae::Skeleton pose does not match bind pose hierarchy" ); }
+	return bone->transform * bindPoseBone->inverseTransform;
+}
+
+void Skin::GetPalette( const Skeleton* pose, ae::Skin::Bone3x4* paletteOut ) const
+{
+	AE_ASSERT_MSG( m_bindPose.GetBoneCount() == pose->GetBoneCount(), "Given ae::Skeleton pose does not match bind pose hierarchy" );
+	for ( uint32_t i = 0; i < pose->GetBoneCount(); i++ )
+	{
+		const ae::Matrix4 transform = m_GetSkinTransform( pose, i );
+		for ( uint32_t row = 0; row < 3; row++ )
+		{
+			paletteOut[ i ].rows[ row ] = transform.GetRow( row );
+		}
+	}
+}
+
+void Skin::GetPalette( const Skeleton* pose, ae::Skin::BoneDualQuaternion* paletteOut ) const
+{
+	AE_ASSERT_MSG( m_bindPose.GetBoneCount() == pose->GetBoneCount(), "Given ae::Skeleton pose does not match bind pose hierarchy" );
+	for ( uint32_t i = 0; i < pose->GetBoneCount(); i++ )
+	{
+		const ae::Matrix4 transform = m_GetSkinTransform( pose, i );
+		const ae::Quaternion real = transform.GetRotation().NormalizeCopy();
+		paletteOut[ i ].real = real;
+		paletteOut[ i ].dual = ( ae::Quaternion( transform.GetTranslation() ) * real ) * 0.5f;
+	}
+}
+
+void Skin::ApplyPoseToMesh( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool ) const
+{
+	AE_ASSERT_MSG( count == m_verts.Length(), "Given mesh data does not match skin vertex count" );
+	AE_ASSERT_MSG( m_bindPose.GetBoneCount() == pose->GetBoneCount(), "Given ae::Skeleton pose does not match bind pose hierarchy" );
+	switch ( m_mode )
+	{
+		case ae::Skin::Mode::LinearBlend:
+			m_ApplyLinearBlend( pose, positionsOut, normalsOut, positionStride, normalStride, positionsW, normalsW, count, workerPool );
+			break;
+		case ae::Skin::Mode::DualQuaternion:
+			m_ApplyDualQuaternion( pose, positionsOut, normalsOut, positionStride, normalStride, positionsW, normalsW, count, workerPool );
+			break;
+	}
+}
+
+void Skin::m_ApplyLinearBlend( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool ) const
+{
+	const uint32_t boneCount = pose->GetBoneCount();
+	ae::Scratch< ae::Skin::Bone3x4 > palette( boneCount );
+	GetPalette( pose, palette.Data() );
+	
+	// With rotation, translation, and uniform scale the normal matrix is the
+	// upper 3x3 of the bone transform divided by its squared scale, so a
+	// separate normal matrix palette is only built when a bone has non-uniform
+	// scale. Otherwise each bone's normal weight is just scaled.
+	ae::Scratch< float > normalScales( boneCount );
+	bool uniformScale = true;
+	for ( uint32_t i = 0; i < boneCount && uniformScale; i++ )
+	{
+		const ae::Vec4* rows = palette[ i ].rows;
+		const ae::Vec3 sq(
+			rows[ 0 ].x * rows[ 0 ].x + rows[ 1 ].x * rows[ 1 ].x + rows[ 2 ].x * rows[ 2 ].x,
+			rows[ 0 ].y * rows[ 0 ].y + rows[ 1 ].y * rows[ 1 ].y + rows[ 2 ].y * rows[ 2 ].y,
+			rows[ 0 ].z * rows[ 0 ].z + rows[ 1 ].z * rows[ 1 ].z + rows[ 2 ].z * rows[ 2 ].z
+		);
+		const float epsilon = 0.00001f * ae::Max( sq.x, sq.y, sq.z );
+		uniformScale = ( sq.x > 0.0f && ae::Abs( sq.x - sq.y ) <= epsilon && ae::Abs( sq.x - sq.z ) <= epsilon );
+		normalScales[ i ] = uniformScale ? 3.0f / ( sq.x + sq.y + sq.z ) : 1.0f;
+	}
+	ae::Scratch< ae::Skin::Bone3x4 > normalPalette( uniformScale ? 0 : boneCount );
+	for ( uint32_t i = 0; i < normalPalette.Length(); i++ )
+	{
+		const ae::Matrix4 normalMatrix = m_GetSkinTransform( pose, i ).GetNormalMatrix();
+		for ( uint32_t row = 0; row < 3; row++ )
+		{
+			normalPalette[ i ].rows[ row ] = normalMatrix.GetRow( row );
+		}
+		normalScales[ i ] = 1.0f;
+	}
+	
+	// Skinning is linear, so the weighted sum of each influence's transformed
+	// position is equal to the position transformed by the weighted sum of
+	// the influence transforms. Blending the transforms first means each
+	// vertex is only transformed once, and zero weight influences are skipped.
+	const ae::Skin::Bone3x4* bones = palette.Data();
+	const ae::Skin::Bone3x4* boneNorms = uniformScale ? palette.Data() : normalPalette.Data();
+	const float* boneNormScales = normalScales.Data();
+	const ae::Skin::Vertex* verts = m_verts.Data();
+	auto skinFn = [ = ]( uint32_t begin, uint32_t end )
+	{
+		const float kWeightScale = 1.0f / 255.0f;
+		for ( uint32_t i = begin; i < end; i++ )
+		{
+			const ae::Skin::Vertex& skinVert = verts[ i ];
+			ae::Skin::Bone3x4 m;
+			ae::Skin::Bone3x4 mn;
+#if _AE_SIMD_SSE_ || _AE_SIMD_NEON_
+			_ae_f4 m0 = _ae_f4_zero(), m1 = m0, m2 = m0;
+			_ae_f4 n0 = m0, n1 = m0, n2 = m0;
+			for ( uint32_t j = 0; j < kMaxSkinWeights; j++ )
+			{
+				if ( !skinVert.weights[ j ] )
+				{
+					continue;
+				}
+				const float weight = skinVert.weights[ j ] * kWeightScale;
+				const _ae_f4 w = _ae_f4_splat( weight );
+				const _ae_f4 wn = _ae_f4_splat( weight * boneNormScales[ skinVert.bones[ j ] ] );
+				const ae::Vec4* b = bones[ skinVert.bones[ j ] ].rows;
+				const ae::Vec4* bn = boneNorms[ skinVert.bones[ j ] ].rows;
+				m0 = _ae_f4_madd( m0, _ae_f4_load( b[ 0 ].data ), w );
+				m1 = _ae_f4_madd( m1, _ae_f4_load( b[ 1 ].data ), w );
+				m2 = _ae_f4_madd( m2, _ae_f4_load( b[ 2 ].data ), w );
+				n0 = _ae_f4_madd( n0, _ae_f4_load( bn[ 0 ].data ), wn );
+				n1 = _ae_f4_madd( n1, _ae_f4_load( bn[ 1 ].data ), wn );
+				n2 = _ae_f4_madd( n2, _ae_f4_load( bn[ 2 ].data ), wn );
+			}
+			_ae_f4_store( m.rows[ 0 ].data, m0 );
+			_ae_f4_store( m.rows[ 1 ].data, m1 );
+			_ae_f4_store( m.rows[ 2 ].data, m2 );
+			_ae_f4_store( mn.rows[ 0 ].data, n0 );
+			_ae_f4_store( mn.rows[ 1 ].data, n1 );
+			_ae_f4_store( mn.rows[ 2 ].data, n2 );
+#else
+			m.rows[ 0 ] = m.rows[ 1 ] = m.rows[ 2 ] = ae::Vec4( 0.0f );
+			mn.rows[ 0 ] = mn.rows[ 1 ] = mn.rows[ 2 ] = ae::Vec4( 0.0f );
+			for ( uint32_t j = 0; j < kMaxSkinWeights; j++ )
+			{
+				if ( !skinVert.weights[ j ] )
+				{
+					continue;
+				}
+				const float weight = skinVert.weights[ j ] * kWeightScale;
+				const ae::Vec4* b = bones[ skinVert.bones[ j ] ].rows;
+				const ae::Vec4* bn = boneNorms[ skinVert.bones[ j ] ].rows;
+				const float normalWeight = weight * boneNormScales[ skinVert.bones[ j ] ];
+				for ( uint32_t row = 0; row < 3; row++ )
+				{
+					m.rows[ row ] += b[ row ] * weight;
+					mn.rows[ row ] += bn[ row ] * normalWeight;
+				}
+			}
+#endif
+			const ae::Vec4 p4( skinVert.position, 1.0f );
+			const ae::Vec4 n4( skinVert.normal, 0.0f );
+			const ae::Vec3 position( m.rows[ 0 ].Dot( p4 ), m.rows[ 1 ].Dot( p4 ), m.rows[ 2 ].Dot( p4 ) );
+			ae::Vec3 normal( mn.rows[ 0 ].Dot( n4 ), mn.rows[ 1 ].Dot( n4 ), mn.rows[ 2 ].Dot( n4 ) );
+			normal.SafeNormalize();
+			
+			float* p = (float*)( (uint8_t*)positionsOut + ( i * positionStride ) );
+			float* n = (float*)( (uint8_t*)normalsOut + ( i * normalStride ) );
+			p[ 0 ] = position.x;
+			p[ 1 ] = position.y;
+			p[ 2 ] = position.z;
+			if( positionsW ) { p[ 3 ] = 1.0f; }
+			n[ 0 ] = normal.x;
+			n[ 1 ] = normal.y;
+			n[ 2 ] = normal.z;
+			if( normalsW ) { n[ 3 ] = 0.0f; }
+		}
+	};
+	if ( workerPool )
+	{
+		const uint32_t kChunkSize = 1024;
+		workerPool->Run( count, kChunkSize, skinFn );
 	}
-
-	poseOut->Initialize( &pose );
-	ae::Array< const ae::Bone* > outBones( tag, bones.Length() );
-	ae::Array< ae::Matrix4 > outTransforms( tag, bones.Length() );
-	AE_ASSERT( chain.Length() == bones.Length() );
-	for ( uint32_t i = 0; i < chain.Length(); i++ )
+	else
 	{
-		const uint32_t idx = chain[ i ];
-		const IKBone& ikBone = bones[ i ];
-
-		outBones.Append( poseOut->GetBoneByIndex( idx ) );
-		
-		ae::Matrix4 transform = ikBone.rotation.GetTransformMatrix();
-		transform.SetTranslation( ikBone.pos );
-		outTransforms.Append( transform );
+		skinFn( 0, count );
 	}
-
-	ae::Matrix4* finalTransform = &outTransforms[ outTransforms.Length() - 1 ];
-	*finalTransform = targetTransform;
-	// @TODO: Maintain the old bones scale
-	finalTransform->SetTranslation( bones[ bones.Length() - 1 ].pos );
-	poseOut->SetTransforms( outBones.Data(), outTransforms.Data(), chain.Length() );
-}
-
-//------------------------------------------------------------------------------
-// ae::Skin member functions
-//------------------------------------------------------------------------------
-void Skin::Initialize( const Skeleton& bindPose, const ae::Skin::Vertex* vertices, uint32_t vertexCount )
-{
-	AE_ASSERT( bindPose.GetBoneCount() );
-	m_bindPose.Initialize( &bindPose );
-	
-	m_verts.Clear();
-	m_verts.AppendArray( vertices, vertexCount );
-}
-
-const Skeleton& Skin::GetBindPose() const
-{
-	return m_bindPose;
 }
 
-void Skin::ApplyPoseToMesh( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count ) const
+void Skin::m_ApplyDualQuaternion( const Skeleton* pose, float* positionsOut, float* normalsOut, uint32_t positionStride, uint32_t normalStride, bool positionsW, bool normalsW, uint32_t count, ae::WorkerPool* workerPool ) const
 {
-	AE_ASSERT_MSG( count == m_verts.Length(), "Given mesh data does not match skin vertex count" );
-	AE_ASSERT_MSG( m_bindPose.GetBoneCount() == pose->GetBoneCount(), "Given ae::Skeleton pose does not match bind pose hierarchy" );
-	
-	const uint32_t boneCount = pose->GetBoneCount();
-	ae::Scratch< ae::Matrix4 > tempBones( boneCount );
-	ae::Scratch< ae::Matrix4 > tempBoneNorm( boneCount );
-	for ( uint32_t i = 0; i < boneCount; i++ )
-	{
-		const ae::Bone* bone = pose->GetBoneByIndex( i );
-		const ae::Bone* bindPoseBone = m_bindPose.GetBoneByIndex( i );
-		if ( bone->parent ) { AE_ASSERT_MSG( bone->parent->index == bindPoseBone->parent->index, "Given ae::Skeleton pose does not match bind pose hierarchy" ); }
-		else { AE_ASSERT_MSG( !bindPoseBone->parent, "Given ae::Skeleton pose does not match bind pose hierarchy" ); }
-		
-		ae::Matrix4 transform = bone->transform * bindPoseBone->inverseTransform;
-		tempBones[ i ] = transform;
-		tempBoneNorm[ i ] = transform.GetNormalMatrix();
-	}
+	ae::Scratch< ae::Skin::BoneDualQuaternion > palette( pose->GetBoneCount() );
+	GetPalette( pose, palette.Data() );
 	
-	for ( uint32_t i = 0; i < count; i++ )
+	const ae::Skin::BoneDualQuaternion* bones = palette.Data();
+	const ae::Skin::Vertex* verts = m_verts.Data();
+	auto skinFn = [ = ]( uint32_t begin, uint32_t end )
 	{
-		ae::Vec3 pos( 0.0f );
-		ae::Vec3 normal( 0.0f );
-		const ae::Skin::Vertex& skinVert = m_verts[ i ];
-		for ( uint32_t j = 0; j < 4; j++ )
+		const float kWeightScale = 1.0f / 255.0f;
+		for ( uint32_t i = begin; i < end; i++ )
 		{
-			const float weight = skinVert.weights[ j ] / 255.0f;
-			pos += ( tempBones[ skinVert.bones[ j ] ] * ae::Vec4( skinVert.position, 1.0f ) ).GetXYZ() * weight;
-			normal += ( tempBoneNorm[ skinVert.bones[ j ] ] * ae::Vec4( skinVert.normal, 0.0f ) ).GetXYZ() * weight;
+			const ae::Skin::Vertex& skinVert = verts[ i ];
+			ae::Vec4 real( 0.0f );
+			ae::Vec4 dual( 0.0f );
+			const ae::Quaternion* pivot = nullptr;
+			for ( uint32_t j = 0; j < kMaxSkinWeights; j++ )
+			{
+				if ( !skinVert.weights[ j ] )
+				{
+					continue;
+				}
+				const ae::Skin::BoneDualQuaternion& b = bones[ skinVert.bones[ j ] ];
+				if ( !pivot )
+				{
+					pivot = &b.real;
+				}
+				// Blend along the shortest path relative to the first influence
+				float weight = skinVert.weights[ j ] * kWeightScale;
+				weight = ( pivot->Dot( b.real ) < 0.0f ) ? -weight : weight;
+				real += ae::Vec4( b.real.data ) * weight;
+				dual += ae::Vec4( b.dual.data ) * weight;
+			}
+			
+			ae::Vec3 position( 0.0f );
+			ae::Vec3 normal( 0.0f );
+			const float length = real.Length();
+			if ( length > 0.0f )
+			{
+				const ae::Quaternion r( real.x / length, real.y / length, real.z / length, real.w / length );
+				const ae::Quaternion d( dual.x / length, dual.y / length, dual.z / length, dual.w / length );
+				const ae::Quaternion t = ( d * 2.0f ) * r.GetInverse();
+				position = r.Rotate( skinVert.position ) + ae::Vec3( t.i, t.j, t.k );
+				normal = r.Rotate( skinVert.normal ).SafeNormalizeCopy();
+			}
+			
+			float* p = (float*)( (uint8_t*)positionsOut + ( i * positionStride ) );
+			float* n = (float*)( (uint8_t*)normalsOut + ( i * normalStride ) );
+			p[ 0 ] = position.x;
+			p[ 1 ] = position.y;
+			p[ 2 ] = position.z;
+			if( positionsW ) { p[ 3 ] = 1.0f; }
+			n[ 0 ] = normal.x;
+			n[ 1 ] = normal.y;
+			n[ 2 ] = normal.z;
+			if( normalsW ) { n[ 3 ] = 0.0f; }
 		}
-		normal.SafeNormalize();
-		
-		float* p = (float*)( (uint8_t*)positionsOut + ( i * positionStride ) );
-		float* n = (float*)( (uint8_t*)normalsOut + ( i * normalStride ) );
-		p[ 0 ] = pos.x;
-		p[ 1 ] = pos.y;
-		p[ 2 ] = pos.z;
-		if( positionsW ) { p[ 3 ] = 1.0f; }
-		n[ 0 ] = normal.x;
-		n[ 1 ] = normal.y;
-		n[ 2 ] = normal.z;
-		if( normalsW ) { n[ 3 ] = 0.0f; }
+	};
+	if ( workerPool )
+	{
+		const uint32_t kChunkSize = 1024;
+		workerPool->Run( count, kChunkSize, skinFn );
+	}
+	else
+	{
+		skinFn( 0, count );
 	}
 }
 
@@ -25011,32 +27428,32 @@ void BinaryWriter::SerializeUint8( const uint8_t& v )
 
 void BinaryStream::SerializeUint16( uint16_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( &v, sizeof( v ) );
 }
 
 void BinaryWriter::SerializeUint16( const uint16_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( const_cast< uint16_t* >( &v ), sizeof( v ) );
 }
 
 void BinaryStream::SerializeUint32( uint32_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( &v, sizeof( v ) );
 }
 
 void BinaryWriter::SerializeUint32( const uint32_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( const_cast< uint32_t* >( &v ), sizeof( v ) );
 }
 
 void BinaryStream::SerializeUint64( uint64_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( &v, sizeof( v ) );
 }
 
 void BinaryWriter::SerializeUint64( const uint64_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( const_cast< uint64_t* >( &v ), sizeof( v ) );
 }
 
 void BinaryStream::SerializeInt8( int8_t& v )
@@ -25051,175 +27468,582 @@ void BinaryWriter::SerializeInt8( const int8_t& v )
 
 void BinaryStream::SerializeInt16( int16_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( &v, sizeof( v ) );
 }
 
 void BinaryWriter::SerializeInt16( const int16_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	m_SerializeScalar( const_cast< int16_t* >( &v ), sizeof( v ) );
+}
+
+void BinaryStream::SerializeInt32( int32_t& v )
+{
+	m_SerializeScalar( &v, sizeof( v ) );
+}
+
+void BinaryWriter::SerializeInt32( const int32_t& v )
+{
+	m_SerializeScalar( const_cast< int32_t* >( &v ), sizeof( v ) );
+}
+
+void BinaryStream::SerializeInt64( int64_t& v )
+{
+	m_SerializeScalar( &v, sizeof( v ) );
+}
+
+void BinaryWriter::SerializeInt64( const int64_t& v )
+{
+	m_SerializeScalar( const_cast< int64_t* >( &v ), sizeof( v ) );
+}
+
+void BinaryStream::SerializeFloat( float& v )
+{
+	m_SerializeScalar( &v, sizeof( v ) );
+}
+
+void BinaryWriter::SerializeFloat( const float& v )
+{
+	m_SerializeScalar( const_cast< float* >( &v ), sizeof( v ) );
+}
+
+void BinaryStream::SerializeDouble( double& v )
+{
+	m_SerializeScalar( &v, sizeof( v ) );
+}
+
+void BinaryWriter::SerializeDouble( const double& v )
+{
+	m_SerializeScalar( const_cast< double* >( &v ), sizeof( v ) );
+}
+
+void BinaryStream::SerializeBool( bool& v )
+{
+	SerializeRaw( (uint8_t*)&v, sizeof( v ) );
+}
+
+void BinaryWriter::SerializeBool( const bool& v )
+{
+	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+}
+
+void BinaryStream::SerializeString( char* strInOut, uint32_t bufferSize )
+{
+	AE_ASSERT( bufferSize );
+	if( ae::BinaryReader* reader = AsReader() )
+	{
+		if( auto end = (const uint8_t*)memchr( reader->PeekReadData(), '\0', GetRemainingBytes() ) )
+		{
+			const uint32_t strLength = (uint32_t)( end - reader->PeekReadData() );
+			if( strLength < bufferSize )
+			{
+				SerializeRaw( strInOut, strLength + 1 );
+			}
+			else
+			{
+				Invalidate();
+			}
+		}
+		else
+		{
+			Invalidate();
+		}
+		if( !IsValid() )
+		{
+			strInOut[ 0 ] = '\0';
+		}
+	}
+	else if( AsWriter() )
+	{
+		const uint32_t strLength = (uint32_t)strlen( strInOut );
+		if( strLength < bufferSize )
+		{
+			SerializeRaw( strInOut, strLength + 1 );
+		}
+		else
+		{
+			Invalidate();
+		}
+	}
+}
+
+void BinaryWriter::SerializeString( const char* strIn )
+{
+	const uint32_t strLength = (uint32_t)strlen( strIn );
+	SerializeRaw( strIn, strLength + 1 );
+}
+
+void BinaryStream::SerializeRaw( void* data, uint32_t length )
+{
+	m_bitOffset = 0;
+	if( !m_isValid )
+	{
+		return;
+	}
+	else if( m_mode == Mode::ReadBuffer )
+	{
+		if( m_offset + length <= m_length )
+		{
+			memcpy( data, m_data + m_offset, length );
+			m_offset += length;
+		}
+		else
+		{
+			Invalidate();
+		}
+	}
+	else if( m_mode == Mode::WriteBuffer )
+	{
+		if( m_data )
+		{
+			if( length <= GetRemainingBytes() )
+			{
+				memcpy( m_data + m_offset, data, length );
+				m_offset += length;
+			}
+			else
+			{
+				Invalidate();
+			}
+		}
+		else
+		{
+			AE_ASSERT( m_extArray );
+			m_extArray->AppendArray( (uint8_t*)data, length );
+			m_offset = m_extArray->Length();
+			m_length = m_extArray->Size();
+		}
+	}
+}
+
+void BinaryWriter::SerializeRaw( const void* data, uint32_t length )
+{
+	BinaryStream::SerializeRaw( const_cast< void* >( data ), length );
+}
+
+void BinaryStream::m_SerializeElements( void* data, uint32_t count, uint32_t stride, uint32_t componentSize, uint32_t componentCount )
+{
+	const uint32_t elementSize = componentSize * componentCount;
+	AE_ASSERT( elementSize && elementSize <= stride );
+	const uint64_t length64 = (uint64_t)count * elementSize;
+	m_bitOffset = 0;
+	if( length64 > UINT32_MAX )
+	{
+		Invalidate();
+	}
+	if( !m_isValid )
+	{
+		return;
+	}
+	const uint32_t length = (uint32_t)length64;
+	// Tightly packed elements match the stream layout on little endian platforms
+	if( stride == elementSize && ( !_AE_BIG_ENDIAN_ || componentSize == 1 ) )
+	{
+		SerializeRaw( data, length );
+		return;
+	}
+	const bool reading = ( m_mode == Mode::ReadBuffer );
+	uint8_t* stream = nullptr;
+	if( m_mode == Mode::ReadBuffer || m_data )
+	{
+		if( length > m_length - m_offset )
+		{
+			Invalidate();
+			return;
+		}
+		stream = m_data + m_offset;
+	}
+	else
+	{
+		AE_ASSERT( m_mode == Mode::WriteBuffer && m_extArray );
+		m_extArray->Append( 0, length );
+		m_length = m_extArray->Size();
+		stream = m_extArray->Data() + m_offset;
+	}
+	uint8_t* element = (uint8_t*)data;
+	for( uint32_t i = 0; i < count; i++, element += stride )
+	{
+#if _AE_BIG_ENDIAN_
+		uint8_t* component = element;
+		for( uint32_t j = 0; j < componentCount; j++, component += componentSize, stream += componentSize )
+		{
+			uint8_t* dst = reading ? component : stream;
+			const uint8_t* src = reading ? stream : component;
+			for( uint32_t k = 0; k < componentSize; k++ )
+			{
+				dst[ k ] = src[ componentSize - k - 1 ];
+			}
+		}
+#else
+		memcpy( reading ? element : stream, reading ? stream : element, elementSize );
+		stream += elementSize;
+#endif
+	}
+	m_offset += length;
+}
+
+void BinaryStream::m_SerializeScalar( void* data, uint32_t size )
+{
+#if _AE_BIG_ENDIAN_
+	m_SerializeElements( data, 1, size, size, 1 );
+#else
+	SerializeRaw( data, size );
+#endif
+}
+
+void BinaryStream::SerializeBits( uint32_t& v, uint32_t bitCount )
+{
+	AE_ASSERT_MSG( bitCount && bitCount <= 32, "Invalid bit count: #", bitCount );
+	uint32_t result = 0;
+	uint32_t done = 0;
+	while ( done < bitCount )
+	{
+		if ( !m_bitOffset )
+		{
+			// Start a new byte, zeroed when writing
+			uint8_t byte = 0;
+			SerializeRaw( &byte, 1 );
+		}
+		if ( !m_isValid )
+		{
+			return;
+		}
+		uint8_t* byte = ( m_extArray ? m_extArray->Data() : m_data ) + m_offset - 1;
+		const uint32_t count = ae::Min( 8 - m_bitOffset, bitCount - done );
+		const uint32_t mask = ( 1u << count ) - 1;
+		if ( m_mode == Mode::WriteBuffer )
+		{
+			*byte |= (uint8_t)( ( ( v >> done ) & mask ) << m_bitOffset );
+		}
+		else
+		{
+			result |= ( ( *byte >> m_bitOffset ) & mask ) << done;
+		}
+		done += count;
+		m_bitOffset = ( m_bitOffset + count ) % 8;
+	}
+	if ( m_mode == Mode::ReadBuffer )
+	{
+		v = result;
+	}
+}
+
+void BinaryWriter::SerializeBits( const uint32_t& v, uint32_t bitCount )
+{
+	uint32_t value = v;
+	BinaryStream::SerializeBits( value, bitCount );
 }
 
-void BinaryStream::SerializeInt32( int32_t& v )
+void BinaryStream::SerializeVarUint64( uint64_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	if ( m_mode == Mode::WriteBuffer )
+	{
+		uint8_t bytes[ 10 ];
+		uint32_t count = 0;
+		uint64_t value = v;
+		do
+		{
+			bytes[ count ] = (uint8_t)( value & 0x7F );
+			value >>= 7;
+			bytes[ count ] |= value ? 0x80 : 0;
+			count++;
+		} while ( value );
+		SerializeRaw( bytes, count );
+	}
+	else if ( m_mode == Mode::ReadBuffer )
+	{
+		uint64_t value = 0;
+		for ( uint32_t shift = 0; shift < 64; shift += 7 )
+		{
+			uint8_t byte = 0;
+			SerializeRaw( &byte, 1 );
+			if ( !m_isValid )
+			{
+				return;
+			}
+			value |= (uint64_t)( byte & 0x7F ) << shift;
+			if ( !( byte & 0x80 ) )
+			{
+				v = value;
+				return;
+			}
+		}
+		Invalidate(); // Too many bytes
+	}
 }
 
-void BinaryWriter::SerializeInt32( const int32_t& v )
+void BinaryWriter::SerializeVarUint64( const uint64_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	uint64_t value = v;
+	BinaryStream::SerializeVarUint64( value );
 }
 
-void BinaryStream::SerializeInt64( int64_t& v )
+void BinaryStream::SerializeVarUint32( uint32_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof(v) );
+	uint64_t value = v;
+	SerializeVarUint64( value );
+	if ( m_mode == Mode::ReadBuffer && m_isValid )
+	{
+		if ( value <= ae::MaxValue< uint32_t >() )
+		{
+			v = (uint32_t)value;
+		}
+		else
+		{
+			Invalidate();
+		}
+	}
 }
 
-void BinaryWriter::SerializeInt64( const int64_t& v )
+void BinaryWriter::SerializeVarUint32( const uint32_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof( v ) );
+	uint64_t value = v;
+	BinaryStream::SerializeVarUint64( value );
 }
 
-void BinaryStream::SerializeFloat( float& v )
+void BinaryStream::SerializeVarInt64( int64_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof( v ) );
+	uint64_t value = ( (uint64_t)v << 1 ) ^ (uint64_t)( v >> 63 );
+	SerializeVarUint64( value );
+	if ( m_mode == Mode::ReadBuffer && m_isValid )
+	{
+		v = (int64_t)( ( value >> 1 ) ^ ( ~( value & 1 ) + 1 ) );
+	}
 }
 
-void BinaryWriter::SerializeFloat( const float& v )
+void BinaryWriter::SerializeVarInt64( const int64_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof( v ) );
+	int64_t value = v;
+	BinaryStream::SerializeVarInt64( value );
 }
 
-void BinaryStream::SerializeDouble( double& v )
+void BinaryStream::SerializeVarInt32( int32_t& v )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof( v ) );
+	int64_t value = v;
+	SerializeVarInt64( value );
+	if ( m_mode == Mode::ReadBuffer && m_isValid )
+	{
+		if ( value >= ae::MinValue< int32_t >() && value <= ae::MaxValue< int32_t >() )
+		{
+			v = (int32_t)value;
+		}
+		else
+		{
+			Invalidate();
+		}
+	}
 }
 
-void BinaryWriter::SerializeDouble( const double& v )
+void BinaryWriter::SerializeVarInt32( const int32_t& v )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof( v ) );
+	int64_t value = v;
+	BinaryStream::SerializeVarInt64( value );
 }
 
-void BinaryStream::SerializeBool( bool& v )
+void BinaryStream::SerializeQuantizedFloat( float& v, float min, float max, uint32_t bitCount )
 {
-	SerializeRaw( (uint8_t*)&v, sizeof( v ) );
+	AE_ASSERT_MSG( min < max, "Invalid quantization range: [#, #]", min, max );
+	AE_ASSERT_MSG( bitCount > 0 && bitCount <= 32, "Invalid bit count: #", bitCount );
+	const double maxQuantized = (double)( ae::MaxValue< uint32_t >() >> ( 32 - bitCount ) );
+	uint32_t quantized = 0;
+	if ( m_mode == Mode::WriteBuffer )
+	{
+		double t = ( (double)v - min ) / ( (double)max - min );
+		t = !( t > 0.0 ) ? 0.0 : ( ( t < 1.0 ) ? t : 1.0 ); // Also handles NaN
+		quantized = (uint32_t)( t * maxQuantized + 0.5 );
+	}
+	SerializeBits( quantized, bitCount );
+	if ( m_mode == Mode::ReadBuffer && m_isValid )
+	{
+		v = (float)( min + ( (double)max - min ) * ( quantized / maxQuantized ) );
+	}
 }
 
-void BinaryWriter::SerializeBool( const bool& v )
+void BinaryWriter::SerializeQuantizedFloat( const float& v, float min, float max, uint32_t bitCount )
 {
-	SerializeRaw( (const uint8_t*)&v, sizeof(v) );
+	float value = v;
+	BinaryStream::SerializeQuantizedFloat( value, min, max, bitCount );
 }
 
-void BinaryStream::SerializeString( char* strInOut, uint32_t bufferSize )
+void BinaryStream::SerializeQuaternion( ae::Quaternion& q, uint32_t bitsPerComponent )
 {
-	AE_ASSERT( bufferSize );
-	if( ae::BinaryReader* reader = AsReader() )
+	// The largest component is omitted, so the others are at most 1 / sqrt( 2 )
+	const float kRange = 0.70710678f;
+	ae::Quaternion value = q;
+	uint32_t largest = 0;
+	if ( m_mode == Mode::WriteBuffer )
 	{
-		if( auto end = (const uint8_t*)memchr( reader->PeekReadData(), '\0', GetRemainingBytes() ) )
+		for ( uint32_t i = 1; i < 4; i++ )
 		{
-			const uint32_t strLength = (uint32_t)( end - reader->PeekReadData() );
-			if( strLength < bufferSize )
-			{
-				SerializeRaw( strInOut, strLength + 1 );
-			}
-			else
+			if ( ae::Abs( value.data[ i ] ) > ae::Abs( value.data[ largest ] ) )
 			{
-				Invalidate();
+				largest = i;
 			}
 		}
-		else
-		{
-			Invalidate();
-		}
-		if( !IsValid() )
+		if ( value.data[ largest ] < 0.0f )
 		{
-			strInOut[ 0 ] = '\0';
+			value = -value; // Same rotation, so the omitted component is always positive
 		}
 	}
-	else if( AsWriter() )
+	SerializeBits( largest, 2 );
+	float lengthSq = 0.0f;
+	for ( uint32_t i = 0; i < 4; i++ )
 	{
-		const uint32_t strLength = (uint32_t)strlen( strInOut );
-		if( strLength < bufferSize )
-		{
-			SerializeRaw( strInOut, strLength + 1 );
-		}
-		else
+		if ( i != largest )
 		{
-			Invalidate();
+			SerializeQuantizedFloat( value.data[ i ], -kRange, kRange, bitsPerComponent );
+			lengthSq += value.data[ i ] * value.data[ i ];
 		}
 	}
+	if ( m_mode == Mode::ReadBuffer && m_isValid )
+	{
+		value.data[ largest ] = std::sqrt( ae::Max( 0.0f, 1.0f - lengthSq ) );
+		q = value.NormalizeCopy();
+	}
 }
 
-void BinaryWriter::SerializeString( const char* strIn )
+void BinaryWriter::SerializeQuaternion( const ae::Quaternion& q, uint32_t bitsPerComponent )
 {
-	const uint32_t strLength = (uint32_t)strlen( strIn );
-	SerializeRaw( strIn, strLength + 1 );
+	ae::Quaternion value = q;
+	BinaryStream::SerializeQuaternion( value, bitsPerComponent );
 }
 
-void BinaryStream::SerializeRaw( void* data, uint32_t length )
+const uint8_t* BinaryReader::PeekReadData() const
 {
-	if( !m_isValid )
+	return IsValid() ? GetData() + m_offset : nullptr;
+}
+
+void BinaryReader::DiscardReadData( uint32_t length )
+{
+	m_bitOffset = 0;
+	if ( !length || !IsValid() )
 	{
 		return;
 	}
-	else if( m_mode == Mode::ReadBuffer )
+	else if ( GetRemainingBytes() < length )
 	{
-		if( m_offset + length <= m_length )
+		Invalidate();
+	}
+	else
+	{
+		m_offset += length;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Sync data delta encoding
+//------------------------------------------------------------------------------
+// Deltas are the XOR of new sync data and the previous sync data (baseline),
+// encoded as runs. Control bytes 0x00-0x7F skip 1-128 unchanged bytes, and
+// control bytes 0x80-0xFF are followed by 1-128 XOR'd bytes. Trailing
+// unchanged bytes are omitted.
+void _NetEncodeDelta( const uint8_t* data, uint32_t length, const uint8_t* baseline, uint32_t baselineLength, ae::Array< uint8_t >* deltaOut )
+{
+	auto xorFn = [ & ]( uint32_t i ) -> uint8_t
+	{
+		return data[ i ] ^ ( ( i < baselineLength ) ? baseline[ i ] : 0 );
+	};
+	uint32_t end = length;
+	while ( end && !xorFn( end - 1 ) )
+	{
+		end--;
+	}
+	uint32_t i = 0;
+	while ( i < end )
+	{
+		if ( !xorFn( i ) )
 		{
-			memcpy( data, m_data + m_offset, length );
-			m_offset += length;
+			uint32_t run = 0;
+			while ( !xorFn( i ) && run < 128 ) // Always ends before 'end'
+			{
+				i++;
+				run++;
+			}
+			deltaOut->Append( (uint8_t)( run - 1 ) );
 		}
 		else
 		{
-			Invalidate();
+			// Gaps of less than three unchanged bytes are cheaper as literals
+			const uint32_t start = i;
+			while ( i < end && i - start < 128 )
+			{
+				if ( !xorFn( i ) && i + 2 < end && !xorFn( i + 1 ) && !xorFn( i + 2 ) )
+				{
+					break;
+				}
+				i++;
+			}
+			deltaOut->Append( (uint8_t)( 0x80 | ( i - start - 1 ) ) );
+			for ( uint32_t j = start; j < i; j++ )
+			{
+				deltaOut->Append( xorFn( j ) );
+			}
 		}
 	}
-	else if( m_mode == Mode::WriteBuffer )
+}
+
+bool _NetApplyDelta( const uint8_t* delta, uint32_t deltaLength, uint32_t length, ae::Array< uint8_t >* baselineInOut )
+{
+	if ( baselineInOut->Length() > length )
 	{
-		if( m_data )
+		baselineInOut->Remove( length, baselineInOut->Length() - length );
+	}
+	else if ( baselineInOut->Length() < length )
+	{
+		baselineInOut->Append( 0, length - baselineInOut->Length() );
+	}
+	uint8_t* data = baselineInOut->Data();
+	uint32_t offset = 0;
+	for ( uint32_t i = 0; i < deltaLength; )
+	{
+		const uint8_t control = delta[ i++ ];
+		const uint32_t count = ( control & 0x7F ) + 1u;
+		if ( offset + count > length )
 		{
-			if( length <= GetRemainingBytes() )
+			return false;
+		}
+		if ( control & 0x80 )
+		{
+			if ( i + count > deltaLength )
 			{
-				memcpy( m_data + m_offset, data, length );
-				m_offset += length;
+				return false;
 			}
-			else
+			for ( uint32_t j = 0; j < count; j++ )
 			{
-				Invalidate();
+				data[ offset + j ] ^= delta[ i + j ];
 			}
+			i += count;
 		}
-		else
-		{
-			AE_ASSERT( m_extArray );
-			m_extArray->AppendArray( (uint8_t*)data, length );
-			m_offset = m_extArray->Length();
-			m_length = m_extArray->Size();
-		}
+		offset += count;
 	}
+	return true;
 }
 
-void BinaryWriter::SerializeRaw( const void* data, uint32_t length )
-{
-	BinaryStream::SerializeRaw( const_cast< void* >( data ), length );
-}
-
-const uint8_t* BinaryReader::PeekReadData() const
+// Update entries are a NetId, a varint of the sync data length and mode
+// (length << 2 | mode), and then the raw data or a varint delta length and
+// delta. Deltas are against the data last sent to the client, or zeros.
+enum class _NetSyncMode : uint32_t
 {
-	return IsValid() ? GetData() + m_offset : nullptr;
-}
+	Raw,
+	Delta,
+	DeltaFromZero
+};
 
-void BinaryReader::DiscardReadData( uint32_t length )
+void _NetWriteUpdate( ae::BinaryWriter* wStream, NetId id, const uint8_t* data, uint32_t length, const ae::Array< uint8_t >* baseline, ae::Array< uint8_t >* deltaScratch )
 {
-	if ( !length || !IsValid() )
-	{
-		return;
-	}
-	else if ( GetRemainingBytes() < length )
+	deltaScratch->Clear();
+	_NetEncodeDelta( data, length, baseline ? baseline->Data() : nullptr, baseline ? baseline->Length() : 0, deltaScratch );
+	wStream->SerializeObject( id );
+	if ( deltaScratch->Length() + 1 < length )
 	{
-		Invalidate();
+		const _NetSyncMode mode = baseline ? _NetSyncMode::Delta : _NetSyncMode::DeltaFromZero;
+		wStream->SerializeVarUint32( ( length << 2 ) | (uint32_t)mode );
+		wStream->SerializeVarUint32( deltaScratch->Length() );
+		wStream->SerializeRaw( deltaScratch->Data(), deltaScratch->Length() );
 	}
 	else
 	{
-		m_offset += length;
+		wStream->SerializeVarUint32( ( length << 2 ) | (uint32_t)_NetSyncMode::Raw );
+		wStream->SerializeRaw( data, length );
 	}
 }
 
@@ -25229,8 +28053,17 @@ void BinaryReader::DiscardReadData( uint32_t length )
 void NetObject::SetSyncData( const void* data, uint32_t length )
 {
 	AE_ASSERT_MSG( IsAuthority(), "Cannot set net data from client. The NetObjectConnection has exclusive ownership." );
+	if ( m_data.Length() == length && ( !length || memcmp( m_data.Data(), data, length ) == 0 ) )
+	{
+		return;
+	}
 	m_data.Clear();
 	m_data.AppendArray( (const uint8_t*)data, length );
+	if ( !m_dirty && m_server )
+	{
+		m_dirty = true;
+		m_server->m_dirtyObjects.Append( this );
+	}
 }
 
 // @HACK: Should rearrange file so windows.h is included with as little logic as possible after it
@@ -25239,6 +28072,10 @@ void NetObject::SetSyncData( const void* data, uint32_t length )
 #endif
 void NetObject::SendMessage( const void* data, uint32_t length )
 {
+	if ( !m_messageDataOut.Length() && m_server )
+	{
+		m_server->m_messageObjects.Append( this );
+	}
 	uint16_t lengthU16 = (uint16_t)length;
 	m_messageDataOut.Reserve( m_messageDataOut.Length() + sizeof( lengthU16 ) + length );
 	m_messageDataOut.AppendArray( (uint8_t*)&lengthU16, sizeof( lengthU16 ) );
@@ -25330,18 +28167,6 @@ void NetObject::m_ReceiveMessages( const uint8_t* data, uint32_t length )
 	m_messageDataIn.AppendArray( data, length );
 }
 
-void NetObject::m_UpdateHash()
-{
-	if ( m_data.Length() )
-	{
-		m_hash = ae::Hash().HashData( &m_data[ 0 ], m_data.Length() ).Get();
-	}
-	else
-	{
-		m_hash = 0;
-	}
-}
-
 //------------------------------------------------------------------------------
 // ae::NetObjectClient member functions
 //------------------------------------------------------------------------------
@@ -25403,7 +28228,7 @@ void NetObjectClient::ReceiveData( const uint8_t* data, uint32_t length )
 				}
 				
 				uint32_t length = 0;
-				rStream.SerializeUint32( length );
+				rStream.SerializeVarUint32( length );
 				for ( uint32_t i = 0; i < length && rStream.IsValid(); i++ )
 				{
 					NetObject* created = m_CreateNetObject( &rStream, allowResolve );
@@ -25441,27 +28266,48 @@ void NetObjectClient::ReceiveData( const uint8_t* data, uint32_t length )
 			case NetObjectConnection::EventType::Update:
 			{
 				uint32_t netObjectCount = 0;
-				rStream.SerializeUint32( netObjectCount );
-				for ( uint32_t i = 0; i < netObjectCount; i++ )
+				rStream.SerializeVarUint32( netObjectCount );
+				for ( uint32_t i = 0; i < netObjectCount && rStream.IsValid(); i++ )
 				{
 					RemoteId remoteId;
-					uint32_t dataLen = 0;
 					rStream.SerializeObject( remoteId );
-					rStream.SerializeUint32( dataLen );
+					uint32_t header = 0;
+					rStream.SerializeVarUint32( header );
+					const uint32_t syncLength = ( header >> 2 );
+					const _NetSyncMode mode = (_NetSyncMode)( header & 3 );
+					uint32_t dataLen = syncLength;
+					if ( mode != _NetSyncMode::Raw )
+					{
+						rStream.SerializeVarUint32( dataLen );
+					}
+					if ( rStream.GetRemainingBytes() < dataLen || (uint32_t)mode > (uint32_t)_NetSyncMode::DeltaFromZero )
+					{
+						rStream.Invalidate();
+						break;
+					}
 
 					NetId localId;
 					NetObject* netObject = nullptr;
-					if ( dataLen
-						&& m_remoteToLocalIdMap.TryGet( remoteId, &localId )
+					if ( m_remoteToLocalIdMap.TryGet( remoteId, &localId )
 						&& m_netObjects.TryGet( localId, &netObject ) )
 					{
-						if ( rStream.GetRemainingBytes() >= dataLen )
+						ae::Array< uint8_t >* baseline = &netObject->m_syncBaseline;
+						if ( mode != _NetSyncMode::Delta )
 						{
-							netObject->m_SetClientData( rStream.PeekReadData(), dataLen );
+							baseline->Clear();
 						}
-						else
+						if ( mode == _NetSyncMode::Raw )
+						{
+							baseline->AppendArray( rStream.PeekReadData(), dataLen );
+						}
+						else if ( !_NetApplyDelta( rStream.PeekReadData(), dataLen, syncLength, baseline ) )
 						{
 							rStream.Invalidate();
+							break;
+						}
+						if ( syncLength )
+						{
+							netObject->m_SetClientData( baseline->Data(), syncLength );
 						}
 					}
 
@@ -25472,13 +28318,13 @@ void NetObjectClient::ReceiveData( const uint8_t* data, uint32_t length )
 			case NetObjectConnection::EventType::Messages:
 			{
 				uint32_t netObjectCount = 0;
-				rStream.SerializeUint32( netObjectCount );
+				rStream.SerializeVarUint32( netObjectCount );
 				for ( uint32_t i = 0; i < netObjectCount; i++ )
 				{
 					RemoteId remoteId;
 					uint32_t dataLen = 0;
 					rStream.SerializeObject( remoteId );
-					rStream.SerializeUint32( dataLen );
+					rStream.SerializeVarUint32( dataLen );
 
 					NetId localId;
 					NetObject* netObject = nullptr;
@@ -25568,6 +28414,8 @@ NetObject* NetObjectClient::m_CreateNetObject( ae::BinaryReader* rStream, bool a
 		{
 			netObject = m_netObjects.Get( localId );
 			AE_ASSERT( netObject );
+			// The new connection has no baselines, so the next update is complete
+			netObject->m_syncBaseline.Clear();
 			uint16_t initDataLength = 0;
 			rStream->SerializeUint16( initDataLength );
 			if( rStream->IsValid() )
@@ -25622,50 +28470,157 @@ void NetObjectClient::m_StartNetObjectDestruction( NetObject* netObject )
 void NetObjectConnection::m_UpdateSendData()
 {
 	AE_ASSERT( m_replicaDB );
-
-	ae::Array< NetObject* > toSync = AE_ALLOC_TAG_NET;
-	uint32_t netObjectMessageCount = 0;
-	for ( uint32_t i = 0; i < m_replicaDB->GetNetObjectCount(); i++ )
+	NetObjectServer* server = m_replicaDB;
+	if ( m_interest.Length() < server->m_slotCount )
+	{
+		m_interest.Append( {}, server->m_slotCount - m_interest.Length() );
+	}
+	
+	ae::BinaryWriter wStream( &m_connData );
+	m_candidates.Clear();
+	auto visitFn = [ & ]( NetObject* netObject )
+	{
+		const float priority = m_priorityFn ? m_priorityFn( netObject ) : 1.0f;
+		Interest* interest = &m_interest[ netObject->m_slot ];
+		if ( priority <= 0.0f )
+		{
+			if ( interest->state == Interest::State::Created )
+			{
+				wStream.SerializeEnum( NetObjectConnection::EventType::Destroy );
+				wStream.SerializeObject( netObject->GetId() );
+			}
+			*interest = {};
+			return;
+		}
+		
+		if ( interest->state == Interest::State::None )
+		{
+			interest->state = Interest::State::Pending;
+		}
+		if ( interest->state == Interest::State::Pending || interest->version != netObject->m_version )
+		{
+			interest->priority += priority;
+			m_candidates.Append( { netObject, interest->priority } );
+		}
+	};
+	if ( m_upToDate && !m_priorityFn )
 	{
-		NetObject* netObject = m_replicaDB->GetNetObject( i );
-		if ( m_first || netObject->m_Changed() )
+		// Only new and changed objects need to be sent
+		for ( NetObject* netObject : server->m_changedObjects )
 		{
-			toSync.Append( netObject );
+			visitFn( netObject );
 		}
-
-		if ( netObject->m_messageDataOut.Length() )
+		for ( NetObject* netObject : server->m_newObjects )
 		{
-			netObjectMessageCount++;
+			if ( !netObject->m_Changed() )
+			{
+				visitFn( netObject );
+			}
 		}
 	}
-
-	ae::BinaryWriter wStream( &m_connData );
-
-	if ( toSync.Length() )
+	else
 	{
-		wStream.SerializeEnum( NetObjectConnection::EventType::Update );
-		wStream.SerializeUint32( toSync.Length() );
-		for ( uint32_t i = 0; i < toSync.Length(); i++ )
+		for ( uint32_t i = 0; i < server->GetNetObjectCount(); i++ )
 		{
-			NetObject* netObject = toSync[ i ];
-			wStream.SerializeObject( netObject->GetId() );
-			wStream.SerializeUint32( netObject->SyncDataLength() );
-			wStream.SerializeRaw( netObject->GetSyncData(), netObject->SyncDataLength() );
+			visitFn( server->GetNetObject( i ) );
+		}
+	}
+	if ( m_bandwidthBudget )
+	{
+		std::sort( m_candidates.begin(), m_candidates.end(), []( const Candidate& a, const Candidate& b ) { return a.priority > b.priority; } );
+	}
+	
+	// Copy creates and updates for the highest priority objects. Updates
+	// are shared by all connections that were sent the previous version of
+	// the object's sync data, otherwise all of the sync data is sent.
+	m_createData.Clear();
+	m_updateData.Clear();
+	ae::BinaryWriter createStream( &m_createData );
+	uint32_t createCount = 0;
+	uint32_t updateCount = 0;
+	m_upToDate = !m_priorityFn; // Irrelevant objects aren't up to date
+	for ( const Candidate& candidate : m_candidates )
+	{
+		NetObject* netObject = candidate.netObject;
+		Interest* interest = &m_interest[ netObject->m_slot ];
+		const uint32_t prevCreateLength = m_createData.Length();
+		const uint32_t prevUpdateLength = m_updateData.Length();
+		if ( interest->state == Interest::State::Pending )
+		{
+			if ( !m_first )
+			{
+				createStream.SerializeEnum( NetObjectConnection::EventType::Create );
+			}
+			createStream.SerializeObject( netObject->GetId() );
+			AE_ASSERT( netObject->m_initData.Length() <= ae::MaxValue< uint16_t >() );
+			const uint16_t initDataLength = (uint16_t)netObject->m_initData.Length();
+			createStream.SerializeUint16( initDataLength );
+			createStream.SerializeRaw( netObject->m_initData.Data(), initDataLength );
+		}
+		
+		const bool hasUpdate = ( interest->version != netObject->m_version );
+		if ( hasUpdate )
+		{
+			const bool canDelta = ( interest->version + 1 == netObject->m_version && netObject->m_Changed() );
+			const NetObject::SharedEntry& entry = canDelta ? netObject->m_deltaEntry : server->m_GetFullEntry( netObject );
+			m_updateData.AppendArray( server->m_sharedData.Data() + entry.offset, entry.length );
 		}
+		
+		const uint32_t sentLength = m_createData.Length() + m_updateData.Length();
+		if ( m_bandwidthBudget && sentLength > m_bandwidthBudget && ( prevCreateLength || prevUpdateLength ) )
+		{
+			// Over budget, keep the accumulated priority and try again next tick
+			m_createData.Remove( prevCreateLength, m_createData.Length() - prevCreateLength );
+			m_updateData.Remove( prevUpdateLength, m_updateData.Length() - prevUpdateLength );
+			m_upToDate = false;
+			break;
+		}
+		
+		if ( interest->state == Interest::State::Pending )
+		{
+			interest->state = Interest::State::Created;
+			createCount++;
+		}
+		if ( hasUpdate )
+		{
+			interest->version = netObject->m_version;
+			updateCount++;
+		}
+		interest->priority = 0.0f;
+	}
+	
+	if ( m_first )
+	{
+		// Clients destroy any previously replicated objects not included here
+		wStream.SerializeEnum( NetObjectConnection::EventType::Connect );
+		wStream.SerializeUint32( server->m_signature );
+		wStream.SerializeVarUint32( createCount );
+	}
+	wStream.SerializeRaw( m_createData.Data(), m_createData.Length() );
+	
+	if ( updateCount )
+	{
+		wStream.SerializeEnum( NetObjectConnection::EventType::Update );
+		wStream.SerializeVarUint32( updateCount );
+		wStream.SerializeRaw( m_updateData.Data(), m_updateData.Length() );
 	}
 
+	// Messages are only sent for objects that exist on the client
+	uint32_t netObjectMessageCount = 0;
+	for ( const NetObject* netObject : server->m_messageObjects )
+	{
+		netObjectMessageCount += IsReplicated( netObject ) ? 1 : 0;
+	}
 	if ( netObjectMessageCount )
 	{
 		wStream.SerializeEnum( NetObjectConnection::EventType::Messages );
-		wStream.SerializeUint32( netObjectMessageCount );
-		for ( uint32_t i = 0; i < m_replicaDB->GetNetObjectCount(); i++ )
+		wStream.SerializeVarUint32( netObjectMessageCount );
+		for ( const NetObject* netObject : server->m_messageObjects )
 		{
-			NetObject* netObject = m_replicaDB->GetNetObject( i );
-			if ( netObject->m_messageDataOut.Length() )
+			if ( IsReplicated( netObject ) )
 			{
-				wStream.SerializeObject( netObject->GetId() );
-				wStream.SerializeUint32( netObject->m_messageDataOut.Length() );
-				wStream.SerializeRaw( &netObject->m_messageDataOut[ 0 ], netObject->m_messageDataOut.Length() );
+				const NetObject::SharedEntry& entry = netObject->m_messageEntry;
+				wStream.SerializeRaw( server->m_sharedData.Data() + entry.offset, entry.length );
 			}
 		}
 	}
@@ -25674,6 +28629,29 @@ void NetObjectConnection::m_UpdateSendData()
 	m_first = false;
 }
 
+void NetObjectConnection::m_DestroyNetObject( const NetObject* netObject )
+{
+	if ( netObject->m_slot < m_interest.Length() )
+	{
+		Interest* interest = &m_interest[ netObject->m_slot ];
+		if ( interest->state == Interest::State::Created )
+		{
+			m_ClearPending(); // @TODO: Should this queue up like m_pendingCreate?
+			ae::BinaryWriter wStream( &m_connData );
+			wStream.SerializeEnum( NetObjectConnection::EventType::Destroy );
+			wStream.SerializeObject( netObject->GetId() );
+		}
+		*interest = {};
+	}
+}
+
+bool NetObjectConnection::IsReplicated( const ae::NetObject* netObject ) const
+{
+	return netObject
+		&& netObject->m_slot < m_interest.Length()
+		&& m_interest[ netObject->m_slot ].state == Interest::State::Created;
+}
+
 void NetObjectConnection::m_ClearPending()
 {
 	if ( m_pendingClear )
@@ -25708,6 +28686,7 @@ NetObject* NetObjectServer::CreateNetObject()
 {
 	NetObject* netObject = ae::New< NetObject >( AE_ALLOC_TAG_NET );
 	netObject->m_SetLocal();
+	netObject->m_server = this;
 	netObject->m_id = NetId( ++m_lastNetId );
 	m_pendingCreate.Append( netObject );
 	return netObject;
@@ -25720,6 +28699,24 @@ void NetObjectServer::DestroyNetObject( NetObject* netObject )
 		return;
 	}
 	
+	if ( netObject->m_dirty )
+	{
+		const int32_t dirtyIdx = m_dirtyObjects.Find( netObject );
+		AE_DEBUG_ASSERT( dirtyIdx >= 0 );
+		if ( dirtyIdx >= 0 )
+		{
+			m_dirtyObjects.Remove( dirtyIdx );
+		}
+	}
+	if ( netObject->m_messageDataOut.Length() )
+	{
+		const int32_t messageIdx = m_messageObjects.Find( netObject );
+		if ( messageIdx >= 0 )
+		{
+			m_messageObjects.Remove( messageIdx );
+		}
+	}
+	
 	int32_t pendingIdx = m_pendingCreate.Find( netObject );
 	if ( pendingIdx >= 0 )
 	{
@@ -25735,12 +28732,9 @@ void NetObjectServer::DestroyNetObject( NetObject* netObject )
 
 	for ( uint32_t i = 0; i < m_connections.Length(); i++ )
 	{
-		NetObjectConnection* conn = m_connections[ i ];
-		conn->m_ClearPending(); // @TODO: Should this queue up like m_pendingCreate?
-		ae::BinaryWriter wStream( &conn->m_connData );
-		wStream.SerializeEnum( NetObjectConnection::EventType::Destroy );
-		wStream.SerializeObject( id );
+		m_connections[ i ]->m_DestroyNetObject( netObject );
 	}
+	m_freeSlots.Append( netObject->m_slot );
 
 	ae::Delete( netObject );
 }
@@ -25750,23 +28744,8 @@ NetObjectConnection* NetObjectServer::CreateConnection()
 	NetObjectConnection* conn = m_connections.Append( ae::New< NetObjectConnection >( AE_ALLOC_TAG_NET ) );
 	AE_ASSERT( !conn->m_pendingClear );
 	conn->m_replicaDB = this;
-
-	// Send initial net datas
-	ae::BinaryWriter wStream( &conn->m_connData );
-	wStream.SerializeEnum( NetObjectConnection::EventType::Connect );
-	wStream.SerializeUint32( m_signature );
-	wStream.SerializeUint32( m_netObjects.Length() );
-	for ( uint32_t i = 0; i < m_netObjects.Length(); i++ )
-	{
-		const NetObject* netObject = m_netObjects.GetValue( i );
-		wStream.SerializeObject( netObject->GetId() );
-
-		AE_ASSERT( netObject->m_initData.Length() <= ae::MaxValue< uint16_t >() );
-		const uint16_t initDataLength = (uint16_t)netObject->m_initData.Length();
-		wStream.SerializeUint16( initDataLength );
-		wStream.SerializeRaw( netObject->m_initData.Data(), initDataLength );
-	}
-
+	// Initial objects are sent with the Connect event during the next
+	// UpdateSendData(), once the connection's priority function is set
 	return conn;
 }
 
@@ -25794,32 +28773,67 @@ void NetObjectServer::UpdateSendData()
 	}
 	
 	// Send info about new objects (delayed until Update in case objects initData need to reference each other)
+	m_newObjects.Clear();
 	for ( NetObject* netObject : m_pendingCreate )
 	{
 		if ( !netObject->IsPendingInit() )
 		{
-			// Add net data to list, remove all initialized net datas from m_pendingCreate at once below
+			// Add net data to list, remove all initialized net datas from m_pendingCreate at once below.
+			// Each connection sends a create message once the object is relevant to it.
 			m_netObjects.Set( netObject->GetId(), netObject );
-			
-			// Send create messages on existing server connections
-			for ( uint32_t i = 0; i < m_connections.Length(); i++ )
+			if ( m_freeSlots.Length() )
 			{
-				ae::BinaryWriter wStream( &m_connections[ i ]->m_connData );
-				wStream.SerializeEnum( NetObjectConnection::EventType::Create );
-				wStream.SerializeObject( netObject->GetId() );
-				AE_ASSERT( netObject->m_initData.Length() <= ae::MaxValue< uint16_t >() );
-				const uint16_t initDataLength = (uint16_t)netObject->m_initData.Length();
-				wStream.SerializeUint16( initDataLength );
-				wStream.SerializeRaw( netObject->m_initData.Data(), initDataLength );
+				netObject->m_slot = m_freeSlots[ m_freeSlots.Length() - 1 ];
+				m_freeSlots.Remove( m_freeSlots.Length() - 1 );
 			}
+			else
+			{
+				netObject->m_slot = m_slotCount++;
+			}
+			m_newObjects.Append( netObject );
 		}
 	}
 	// Remove all pending net datas that were just initialized
 	m_pendingCreate.RemoveAllFn( []( const NetObject* netObject ){ return !netObject->IsPendingInit(); } );
 	
-	for ( uint32_t i = 0; i < m_netObjects.Length(); i++ )
+	// Encode updates and messages once for all connections. Only objects
+	// modified since the last tick are visited, objects pending init wait
+	// until the next tick.
+	m_tick++;
+	m_sharedData.Clear();
+	m_changedObjects.Clear();
+	ae::BinaryWriter sharedStream( &m_sharedData );
+	ae::Array< uint8_t > delta = AE_ALLOC_TAG_NET;
+	for ( NetObject* netObject : m_dirtyObjects )
+	{
+		const uint32_t length = netObject->m_data.Length();
+		if ( netObject->IsPendingInit()
+			|| ( length == netObject->m_prevData.Length() && ( !length || memcmp( netObject->m_data.Data(), netObject->m_prevData.Data(), length ) == 0 ) ) )
+		{
+			continue; // Changed back to the previously sent data
+		}
+		netObject->m_changed = true;
+		netObject->m_version++;
+		netObject->m_deltaEntry.offset = m_sharedData.Length();
+		_NetWriteUpdate( &sharedStream, netObject->GetId(), netObject->GetSyncData(), length, &netObject->m_prevData, &delta );
+		netObject->m_deltaEntry.length = m_sharedData.Length() - netObject->m_deltaEntry.offset;
+		m_changedObjects.Append( netObject );
+	}
+	m_dirtyObjects.RemoveAllFn( []( NetObject* netObject )
+	{
+		netObject->m_dirty = netObject->IsPendingInit();
+		return !netObject->m_dirty;
+	} );
+	for ( NetObject* netObject : m_messageObjects )
 	{
-		m_netObjects.GetValue( i )->m_UpdateHash();
+		if ( !netObject->IsPendingInit() )
+		{
+			netObject->m_messageEntry.offset = m_sharedData.Length();
+			sharedStream.SerializeObject( netObject->GetId() );
+			sharedStream.SerializeVarUint32( netObject->m_messageDataOut.Length() );
+			sharedStream.SerializeRaw( netObject->m_messageDataOut.Data(), netObject->m_messageDataOut.Length() );
+			netObject->m_messageEntry.length = m_sharedData.Length() - netObject->m_messageEntry.offset;
+		}
 	}
 
 	for ( uint32_t i = 0; i < m_connections.Length(); i++ )
@@ -25827,12 +28841,35 @@ void NetObjectServer::UpdateSendData()
 		m_connections[ i ]->m_UpdateSendData();
 	}
 
-	for ( uint32_t i = 0; i < m_netObjects.Length(); i++ )
+	for ( NetObject* netObject : m_changedObjects )
+	{
+		netObject->m_prevData = netObject->m_data;
+		netObject->m_changed = false;
+	}
+	m_messageObjects.RemoveAllFn( []( NetObject* netObject )
 	{
-		NetObject* netObject = m_netObjects.GetValue( i );
-		netObject->m_prevHash = netObject->m_hash;
+		if ( netObject->IsPendingInit() )
+		{
+			return false;
+		}
 		netObject->m_messageDataOut.Clear();
+		return true;
+	} );
+}
+
+const NetObject::SharedEntry& NetObjectServer::m_GetFullEntry( NetObject* netObject )
+{
+	// Encoded at most once per tick, only when a connection needs it
+	if ( netObject->m_fullEntryTick != m_tick )
+	{
+		ae::Array< uint8_t > delta = AE_ALLOC_TAG_NET;
+		ae::BinaryWriter sharedStream( &m_sharedData );
+		netObject->m_fullEntry.offset = m_sharedData.Length();
+		_NetWriteUpdate( &sharedStream, netObject->GetId(), netObject->GetSyncData(), netObject->SyncDataLength(), nullptr, &delta );
+		netObject->m_fullEntry.length = m_sharedData.Length() - netObject->m_fullEntry.offset;
+		netObject->m_fullEntryTick = m_tick;
 	}
+	return netObject->m_fullEntry;
 }
 
 } // ae end
@@ -26089,195 +29126,748 @@ bool ae::Var::SetObjectValueFromString( ae::Object* obj, const char* value, int3
 		}
 		case BasicType::Matrix4:
 		{
-			AE_ASSERT( m_size == sizeof(ae::Matrix4) );
-			ae::Matrix4* v = (ae::Matrix4*)varData;
-			// @TODO: Should match GetObjectValueAsString() which uses ae::Str::Format
-			*v = ae::FromString< ae::Matrix4 >( value, ae::Matrix4::Identity() );
-			return true;
+			AE_ASSERT( m_size == sizeof(ae::Matrix4) );
+			ae::Matrix4* v = (ae::Matrix4*)varData;
+			// @TODO: Should match GetObjectValueAsString() which uses ae::Str::Format
+			*v = ae::FromString< ae::Matrix4 >( value, ae::Matrix4::Identity() );
+			return true;
+		}
+		case BasicType::Color:
+		{
+			AE_ASSERT( m_size == sizeof(ae::Color) );
+			ae::Color* v = (ae::Color*)varData;
+			// @TODO: Should match GetObjectValueAsString() which uses ae::Str::Format
+			*v = ae::FromString< ae::Color >( value, ae::Color::Black() );
+			return true;
+		}
+		case BasicType::Enum:
+		{
+			if ( !value[ 0 ] )
+			{
+				return false;
+			}
+			
+			const class Enum* enumType = GetEnum();
+			
+			if ( enumType->TypeIsSigned() )
+			{
+				switch ( enumType->TypeSize() )
+				{
+				case 1:
+					return enumType->GetValueFromString( value, reinterpret_cast< int8_t* >( varData ) );
+				case 2:
+					return enumType->GetValueFromString( value, reinterpret_cast< int16_t* >( varData ) );
+				case 4:
+					return enumType->GetValueFromString( value, reinterpret_cast< int32_t* >( varData ) );
+				case 8:
+					return enumType->GetValueFromString( value, reinterpret_cast< int64_t* >( varData ) );
+				default:
+					AE_FAIL();
+					return false;
+				}
+			}
+			else
+			{
+				switch ( enumType->TypeSize() )
+				{
+				case 1:
+					return enumType->GetValueFromString( value, reinterpret_cast< uint8_t* >( varData ) );
+				case 2:
+					return enumType->GetValueFromString( value, reinterpret_cast< uint16_t* >( varData ) );
+				case 4:
+					return enumType->GetValueFromString( value, reinterpret_cast< uint32_t* >( varData ) );
+				case 8:
+					return enumType->GetValueFromString( value, reinterpret_cast< uint64_t* >( varData ) );
+				default:
+					AE_FAIL();
+					return false;
+				}
+			}
+			return false;
+		}
+		case BasicType::Pointer:
+		{
+			AE_ASSERT_MSG( _Globals::Get()->varSerializerInitialized, "Must provide mapping function with ae::Var::SetSerializer() for pointer types when calling SetObjectValueFromString" );
+			AE_ASSERT_MSG( _Globals::Get()->varSerializer, "ae::Var::Serializer was set, but has been destroyed" );
+
+			class ae::Object* obj = nullptr;
+			if ( _Globals::Get()->varSerializer->StringToObjectPointer( value, &obj ) )
+			{
+				if ( obj )
+				{
+					const ae::Type* refType = GetSubType();
+					const ae::Type* objType = ae::GetTypeFromObject( obj );
+					AE_ASSERT( objType );
+					if ( !objType->IsType( refType ) )
+					{
+						return false;
+					}
+				}
+				class ae::Object** varPtr = reinterpret_cast< class ae::Object** >( varData );
+				*varPtr = obj;
+				return true;
+			}
+			return false;
+		}
+		case BasicType::CustomRef:
+		{
+			return m_varType->SetRef( varData, value, this );
+		}
+	}
+	return false;
+}
+
+bool ae::Var::HasProperty( const char* prop ) const { return GetPropertyIndex( prop ) >= 0; }
+int32_t ae::Var::GetPropertyIndex( const char* prop ) const { return m_props.GetIndex( prop ); }
+int32_t ae::Var::GetPropertyCount() const { return m_props.Length(); }
+const char* ae::Var::GetPropertyName( int32_t propIndex ) const { return m_props.GetKey( propIndex ).c_str(); }
+uint32_t ae::Var::GetPropertyValueCount( int32_t propIndex ) const { return m_props.GetValue( propIndex ).Length(); }
+uint32_t ae::Var::GetPropertyValueCount( const char* propName ) const { auto* props = m_props.TryGet( propName ); return props ? props->Length() : 0; }
+const char* ae::Var::GetPropertyValue( int32_t propIndex, uint32_t valueIndex ) const
+{
+	const auto* vals = ( propIndex < m_props.Length() ) ? &m_props.GetValue( propIndex ) : nullptr;
+	return ( vals && valueIndex < vals->Length() ) ? (*vals)[ valueIndex ].c_str() : "";
+}
+const char* ae::Var::GetPropertyValue( const char* propName, uint32_t valueIndex ) const
+{
+	const auto* vals = m_props.TryGet( propName );
+	return ( vals && valueIndex < vals->Length() ) ? (*vals)[ valueIndex ].c_str() : "";
+}
+
+const ae::VarTypeArray* ae::Var::m_TryGetArrayAdapter() const
+{
+	const bool isArray = ( m_varType->GetAdapterType() == ae::VarAdapterType::Array );
+	return isArray ? static_cast< const ae::VarTypeArray* >( m_varType ) : nullptr;
+}
+
+void ae::Var::m_AddProp( const char* prop, const char* value )
+{
+	auto* props = m_props.TryGet( prop );
+	if ( !props )
+	{
+		props = &m_props.Set( prop, {} );
+	}
+	if ( value && value[ 0 ] ) // 'm_props' will have an empty array for properties when no value is specified
+	{
+		props->Append( value );
+	}
+}
+
+uint32_t ae::Type::GetVarCount( bool parents ) const
+{
+	if ( !parents )
+	{
+		return (uint32_t)m_vars.size();
+	}
+	m_UpdateHierarchy();
+	return (uint32_t)m_allVars.size();
+}
+
+const ae::Var* ae::Type::GetVarByIndex( uint32_t i, bool parents ) const
+{
+	if ( !parents )
+	{
+		AE_ASSERT( i < m_vars.size() );
+		return &m_vars[ i ];
+	}
+	m_UpdateHierarchy();
+	AE_ASSERT( i < m_allVars.size() );
+	return m_allVars[ i ];
+}
+
+const ae::Var* ae::Type::GetVarByName( const char* name, bool parents ) const
+{
+	m_UpdateHierarchy();
+	if ( m_varLookup.empty() )
+	{
+		return nullptr;
+	}
+	const uint32_t mask = (uint32_t)m_varLookup.size() - 1;
+	for ( uint32_t i = ae::GetHash( name ) & mask; m_varLookup[ i ] >= 0; i = ( i + 1 ) & mask )
+	{
+		const ae::Var* var = m_allVars[ m_varLookup[ i ] ];
+		if ( var->m_name == name && ( parents || var->m_owner == this ) )
+		{
+			return var;
+		}
+	}
+	return nullptr;
+}
+
+const ae::Type* ae::Type::GetParentType() const
+{
+	m_UpdateHierarchy();
+	return m_parentType;
+}
+
+uint32_t ae::Type::GetInheritanceDepth() const
+{
+	m_UpdateHierarchy();
+	return m_depth;
+}
+
+bool ae::Type::IsType( const Type* otherType ) const
+{
+	AE_ASSERT( otherType );
+	m_UpdateHierarchy();
+	return m_preOrder >= otherType->m_preOrder && m_preOrder <= otherType->m_lastDescendant;
+}
+
+//! Serialized size of each element of a var of the given type, or 0 if the
+//! size is variable
+static uint32_t _GetVarWireSize( ae::BasicType type )
+{
+	switch ( type )
+	{
+		case ae::BasicType::UInt8: return 1;
+		case ae::BasicType::UInt16: return 2;
+		case ae::BasicType::UInt32: return 4;
+		case ae::BasicType::UInt64: return 8;
+		case ae::BasicType::Int8: return 1;
+		case ae::BasicType::Int16: return 2;
+		case ae::BasicType::Int32: return 4;
+		case ae::BasicType::Int64: return 8;
+		case ae::BasicType::Int2: return 8;
+		case ae::BasicType::Int3: return 12;
+		case ae::BasicType::Bool: return 1;
+		case ae::BasicType::Float: return 4;
+		case ae::BasicType::Double: return 8;
+		case ae::BasicType::Vec2: return 8;
+		case ae::BasicType::Vec3: return 12;
+		case ae::BasicType::Vec4: return 16;
+		case ae::BasicType::Matrix4: return 64;
+		case ae::BasicType::Color: return 16;
+		default: return 0;
+	}
+}
+
+void ae::Type::InvalidateCachedInfo()
+{
+	_Globals::Get()->metaCacheSeq++;
+}
+
+void ae::Type::m_UpdateHierarchy()
+{
+	_Globals* globals = _Globals::Get();
+	if ( globals->typeHierarchySeq.load( std::memory_order_acquire ) == globals->metaCacheSeq )
+	{
+		return;
+	}
+	std::lock_guard< std::mutex > lock( globals->typeHierarchyLock );
+	if ( globals->typeHierarchySeq.load( std::memory_order_relaxed ) == globals->metaCacheSeq )
+	{
+		return; // Built by another thread
+	}
+	for ( const ae::Type* type : globals->types )
+	{
+		type->m_firstChild = nullptr;
+		type->m_nextSibling = nullptr;
+	}
+	// Link children in reverse so siblings end up in registration order
+	for ( int32_t i = globals->types.Length() - 1; i >= 0; i-- )
+	{
+		const ae::Type* type = globals->types[ i ];
+		type->m_parentType = GetTypeByName( type->m_parent.c_str() );
+		if ( type->m_parentType )
+		{
+			type->m_nextSibling = type->m_parentType->m_firstChild;
+			type->m_parentType->m_firstChild = type;
+		}
+	}
+	uint32_t preOrder = 0;
+	for ( const ae::Type* type : globals->types )
+	{
+		if ( !type->m_parentType )
+		{
+			preOrder = type->m_NumberHierarchy( preOrder, 0 );
+		}
+	}
+	AE_ASSERT( preOrder == globals->types.Length() );
+	globals->typeHierarchySeq.store( globals->metaCacheSeq, std::memory_order_release );
+}
+
+uint32_t ae::Type::m_NumberHierarchy( uint32_t preOrder, uint32_t depth ) const
+{
+	m_preOrder = preOrder++;
+	m_depth = depth;
+	
+	// Parents are always numbered first, so their var tables are already built
+	m_allVars.clear();
+	if ( m_parentType )
+	{
+		m_allVars = m_parentType->m_allVars;
+	}
+	for ( const ae::Var& var : m_vars )
+	{
+		m_allVars.push_back( &var );
+	}
+	uint32_t lookupSize = m_allVars.size() ? 4 : 0;
+	while ( lookupSize < m_allVars.size() * 2 )
+	{
+		lookupSize *= 2;
+	}
+	m_varLookup.assign( lookupSize, -1 );
+	// Insert the most derived vars first so they're found first by GetVarByName()
+	for ( int32_t i = (int32_t)m_allVars.size() - 1; i >= 0; i-- )
+	{
+		const uint32_t mask = lookupSize - 1;
+		uint32_t slot = ae::GetHash( m_allVars[ i ]->m_name.c_str() ) & mask;
+		while ( m_varLookup[ slot ] >= 0 )
+		{
+			slot = ( slot + 1 ) & mask;
+		}
+		m_varLookup[ slot ] = i;
+	}
+	
+	m_serializeOps.clear();
+	for ( const ae::Var* var : m_allVars )
+	{
+		SerializeOp op;
+		op.var = var;
+		op.array = var->m_TryGetArrayAdapter();
+		op.subType = ( var->m_type == ae::BasicType::Class ) ? var->GetSubType() : nullptr;
+		op.nameHash = ae::GetHash( var->m_name.c_str() );
+		AE_ASSERT_MSG( var->m_owner->m_depth <= 0xFF, "Type '#' inheritance depth is too large to serialize", var->m_owner->GetName() );
+		op.ownerDepth = (uint8_t)var->m_owner->m_depth;
+		op.offset = var->m_offset;
+		op.size = var->m_size;
+		op.wireSize = _GetVarWireSize( var->m_type );
+		op.tag = (uint8_t)var->m_type | ( op.array ? kArrayTag : 0 );
+		const ae::Enum* enumType = ( var->m_type == ae::BasicType::Enum ) ? var->GetEnum() : nullptr;
+		op.isSigned = enumType && enumType->TypeIsSigned();
+		m_serializeOps.push_back( op );
+	}
+	
+	m_copyOps.clear();
+	std::vector< CopyOp > runs;
+	for ( uint32_t i = 0; i < m_serializeOps.size(); i++ )
+	{
+		const SerializeOp& op = m_serializeOps[ i ];
+		const ae::BasicType basicType = op.var->m_type;
+		if ( basicType == ae::BasicType::Class || basicType == ae::BasicType::CustomRef || ( op.array && !op.array->IsFixedLength() ) )
+		{
+			m_copyOps.push_back( { (int32_t)i, op.offset, op.size } );
 		}
-		case BasicType::Color:
+		else
 		{
-			AE_ASSERT( m_size == sizeof(ae::Color) );
-			ae::Color* v = (ae::Color*)varData;
-			// @TODO: Should match GetObjectValueAsString() which uses ae::Str::Format
-			*v = ae::FromString< ae::Color >( value, ae::Color::Black() );
-			return true;
+			runs.push_back( { -1, op.offset, op.size * ( op.array ? op.array->GetMaxLength() : 1 ) } );
 		}
-		case BasicType::Enum:
+	}
+	std::sort( runs.begin(), runs.end(), []( const CopyOp& a, const CopyOp& b ){ return a.offset < b.offset; } );
+	for ( const CopyOp& run : runs )
+	{
+		CopyOp* prev = m_copyOps.size() ? &m_copyOps.back() : nullptr;
+		if ( prev && prev->serializeOp < 0 && run.offset <= prev->offset + prev->size )
 		{
-			if ( !value[ 0 ] )
-			{
-				return false;
-			}
-			
-			const class Enum* enumType = GetEnum();
-			
-			if ( enumType->TypeIsSigned() )
-			{
-				switch ( enumType->TypeSize() )
-				{
-				case 1:
-					return enumType->GetValueFromString( value, reinterpret_cast< int8_t* >( varData ) );
-				case 2:
-					return enumType->GetValueFromString( value, reinterpret_cast< int16_t* >( varData ) );
-				case 4:
-					return enumType->GetValueFromString( value, reinterpret_cast< int32_t* >( varData ) );
-				case 8:
-					return enumType->GetValueFromString( value, reinterpret_cast< int64_t* >( varData ) );
-				default:
-					AE_FAIL();
-					return false;
-				}
-			}
-			else
-			{
-				switch ( enumType->TypeSize() )
-				{
-				case 1:
-					return enumType->GetValueFromString( value, reinterpret_cast< uint8_t* >( varData ) );
-				case 2:
-					return enumType->GetValueFromString( value, reinterpret_cast< uint16_t* >( varData ) );
-				case 4:
-					return enumType->GetValueFromString( value, reinterpret_cast< uint32_t* >( varData ) );
-				case 8:
-					return enumType->GetValueFromString( value, reinterpret_cast< uint64_t* >( varData ) );
-				default:
-					AE_FAIL();
-					return false;
-				}
-			}
-			return false;
+			prev->size = ae::Max( prev->offset + prev->size, run.offset + run.size ) - prev->offset;
 		}
-		case BasicType::Pointer:
+		else
 		{
-			AE_ASSERT_MSG( _Globals::Get()->varSerializerInitialized, "Must provide mapping function with ae::Var::SetSerializer() for pointer types when calling SetObjectValueFromString" );
-			AE_ASSERT_MSG( _Globals::Get()->varSerializer, "ae::Var::Serializer was set, but has been destroyed" );
+			m_copyOps.push_back( run );
+		}
+	}
+	
+	for ( const ae::Type* child = m_firstChild; child; child = child->m_nextSibling )
+	{
+		preOrder = child->m_NumberHierarchy( preOrder, depth + 1 );
+	}
+	m_lastDescendant = preOrder - 1;
+	return preOrder;
+}
 
-			class ae::Object* obj = nullptr;
-			if ( _Globals::Get()->varSerializer->StringToObjectPointer( value, &obj ) )
+void ae::Type::SerializeObject( ae::BinaryStream* stream, ae::Object* obj ) const
+{
+	AE_ASSERT( obj );
+	AE_DEBUG_ASSERT_MSG( ae::GetTypeFromObject( obj )->IsType( this ), "Can't serialize object of type '#' as '#'", ae::GetTypeFromObject( obj )->GetName(), GetName() );
+	m_UpdateHierarchy();
+	uint32_t count = (uint32_t)m_serializeOps.size();
+	stream->SerializeVarUint32( count );
+	if ( ae::BinaryReader* reader = stream->AsReader() )
+	{
+		const uint32_t mask = (uint32_t)m_varLookup.size() - 1;
+		for ( uint32_t i = 0; i < count && reader->IsValid(); i++ )
+		{
+			uint32_t nameHash = 0;
+			uint8_t ownerDepth = 0;
+			uint8_t tag = 0;
+			reader->SerializeUint32( nameHash );
+			reader->SerializeUint8( ownerDepth );
+			reader->SerializeUint8( tag );
+			// Find the var with the given name hash, which might have moved or
+			// been removed. Prefer the var declared at the same inheritance
+			// depth so shadowed vars are read into the correct var, otherwise
+			// use the most derived var with the given name.
+			const SerializeOp* op = nullptr;
+			if ( m_varLookup.size() )
 			{
-				if ( obj )
+				for ( uint32_t slot = nameHash & mask; m_varLookup[ slot ] >= 0; slot = ( slot + 1 ) & mask )
 				{
-					const ae::Type* refType = GetSubType();
-					const ae::Type* objType = ae::GetTypeFromObject( obj );
-					AE_ASSERT( objType );
-					if ( !objType->IsType( refType ) )
+					const SerializeOp* slotOp = &m_serializeOps[ m_varLookup[ slot ] ];
+					if ( slotOp->nameHash == nameHash )
 					{
-						return false;
+						op = op ? op : slotOp;
+						if ( slotOp->ownerDepth == ownerDepth )
+						{
+							op = slotOp;
+							break;
+						}
 					}
 				}
-				class ae::Object** varPtr = reinterpret_cast< class ae::Object** >( varData );
-				*varPtr = obj;
-				return true;
 			}
-			return false;
+			if ( op && op->tag == tag )
+			{
+				m_SerializeOp( stream, *op, obj );
+			}
+			else
+			{
+				m_SkipOp( reader, tag );
+			}
 		}
-		case BasicType::CustomRef:
+	}
+	else
+	{
+		ae::BinaryWriter* writer = stream->AsWriter();
+		for ( const SerializeOp& op : m_serializeOps )
 		{
-			return m_varType->SetRef( varData, value, this );
+			writer->SerializeUint32( op.nameHash );
+			writer->SerializeUint8( op.ownerDepth );
+			writer->SerializeUint8( op.tag );
+			m_SerializeOp( stream, op, obj );
 		}
 	}
-	return false;
 }
 
-bool ae::Var::HasProperty( const char* prop ) const { return GetPropertyIndex( prop ) >= 0; }
-int32_t ae::Var::GetPropertyIndex( const char* prop ) const { return m_props.GetIndex( prop ); }
-int32_t ae::Var::GetPropertyCount() const { return m_props.Length(); }
-const char* ae::Var::GetPropertyName( int32_t propIndex ) const { return m_props.GetKey( propIndex ).c_str(); }
-uint32_t ae::Var::GetPropertyValueCount( int32_t propIndex ) const { return m_props.GetValue( propIndex ).Length(); }
-uint32_t ae::Var::GetPropertyValueCount( const char* propName ) const { auto* props = m_props.TryGet( propName ); return props ? props->Length() : 0; }
-const char* ae::Var::GetPropertyValue( int32_t propIndex, uint32_t valueIndex ) const
+void ae::Type::SerializeObject( ae::BinaryWriter* stream, const ae::Object* obj ) const
 {
-	const auto* vals = ( propIndex < m_props.Length() ) ? &m_props.GetValue( propIndex ) : nullptr;
-	return ( vals && valueIndex < vals->Length() ) ? (*vals)[ valueIndex ].c_str() : "";
+	SerializeObject( static_cast< ae::BinaryStream* >( stream ), const_cast< ae::Object* >( obj ) );
 }
-const char* ae::Var::GetPropertyValue( const char* propName, uint32_t valueIndex ) const
+
+void ae::Type::SerializeVars( ae::BinaryWriter* stream, const ae::Object* obj, const ae::Var* const* vars, uint32_t varCount ) const
 {
-	const auto* vals = m_props.TryGet( propName );
-	return ( vals && valueIndex < vals->Length() ) ? (*vals)[ valueIndex ].c_str() : "";
+	AE_ASSERT( obj );
+	AE_DEBUG_ASSERT_MSG( ae::GetTypeFromObject( obj )->IsType( this ), "Can't serialize object of type '#' as '#'", ae::GetTypeFromObject( obj )->GetName(), GetName() );
+	m_UpdateHierarchy();
+	stream->SerializeVarUint32( varCount );
+	const uint32_t mask = (uint32_t)m_varLookup.size() - 1;
+	for ( uint32_t i = 0; i < varCount; i++ )
+	{
+		// Shadowed vars share a name hash, so compare vars to find the exact one
+		const SerializeOp* op = nullptr;
+		if ( m_varLookup.size() )
+		{
+			for ( uint32_t slot = ae::GetHash( vars[ i ]->m_name.c_str() ) & mask; m_varLookup[ slot ] >= 0; slot = ( slot + 1 ) & mask )
+			{
+				if ( m_serializeOps[ m_varLookup[ slot ] ].var == vars[ i ] )
+				{
+					op = &m_serializeOps[ m_varLookup[ slot ] ];
+					break;
+				}
+			}
+		}
+		AE_ASSERT_MSG( op, "'#' is not a var of type '#'", vars[ i ]->GetName(), GetName() );
+		stream->SerializeUint32( op->nameHash );
+		stream->SerializeUint8( op->ownerDepth );
+		stream->SerializeUint8( op->tag );
+		m_SerializeOp( stream, *op, const_cast< ae::Object* >( obj ) );
+	}
 }
 
-const ae::VarTypeArray* ae::Var::m_TryGetArrayAdapter() const
+void ae::Type::m_SerializeOp( ae::BinaryStream* stream, const SerializeOp& op, ae::Object* obj ) const
 {
-	const bool isArray = ( m_varType->GetAdapterType() == ae::VarAdapterType::Array );
-	return isArray ? static_cast< const ae::VarTypeArray* >( m_varType ) : nullptr;
+	void* data = (uint8_t*)obj + op.offset;
+	if ( !op.array )
+	{
+		m_SerializeElements( stream, op, obj, data, 1 );
+		return;
+	}
+	uint32_t length = op.array->GetLength( data );
+	stream->SerializeVarUint32( length );
+	uint32_t extra = 0;
+	if ( ae::BinaryReader* reader = stream->AsReader() )
+	{
+		if ( !reader->IsValid() )
+		{
+			return;
+		}
+		// Every element takes at least one byte, so reject lengths that can't
+		// fit in the remaining data before resizing the array
+		if ( (uint64_t)length * ae::Max( op.wireSize, 1u ) > reader->GetRemainingBytes() )
+		{
+			reader->Invalidate();
+			return;
+		}
+		// Elements that don't fit in the array are skipped
+		const uint32_t readLength = length;
+		length = ae::Min( length, op.array->GetMaxLength() );
+		length = ae::Min( op.array->Resize( data, length ), length );
+		extra = readLength - length;
+	}
+	if ( length )
+	{
+		m_SerializeElements( stream, op, obj, op.array->GetElement( data, 0 ), length );
+	}
+	if ( extra )
+	{
+		m_SkipOp( stream->AsReader(), (uint8_t)( op.tag & ~kArrayTag ), extra );
+	}
 }
 
-void ae::Var::m_AddProp( const char* prop, const char* value )
+template< uint32_t N >
+static void _SerializeVarStr( ae::BinaryStream* stream, void* data, uint32_t count )
 {
-	auto* props = m_props.TryGet( prop );
-	if ( !props )
+	ae::Str< N >* strs = (ae::Str< N >*)data;
+	for ( uint32_t i = 0; i < count; i++ )
 	{
-		props = &m_props.Set( prop, {} );
+		uint32_t length = strs[ i ].Length();
+		stream->SerializeVarUint32( length );
+		if ( ae::BinaryReader* reader = stream->AsReader() )
+		{
+			const char* str = (const char*)reader->PeekReadData();
+			if ( !str || length > reader->GetRemainingBytes() )
+			{
+				reader->Invalidate();
+				return;
+			}
+			strs[ i ] = ae::Str< N >( ae::Min( length, ae::Str< N >::MaxLength() ), str );
+			reader->DiscardReadData( length );
+		}
+		else
+		{
+			stream->SerializeRaw( (void*)strs[ i ].c_str(), length );
+		}
 	}
-	if ( value && value[ 0 ] ) // 'm_props' will have an empty array for properties when no value is specified
+}
+
+void ae::Type::m_SerializeElements( ae::BinaryStream* stream, const SerializeOp& op, ae::Object* obj, void* data, uint32_t count )
+{
+	switch ( op.var->m_type )
 	{
-		props->Append( value );
+		case BasicType::UInt8: stream->SerializeArray( (uint8_t*)data, count ); break;
+		case BasicType::UInt16: stream->SerializeArray( (uint16_t*)data, count ); break;
+		case BasicType::UInt32: stream->SerializeArray( (uint32_t*)data, count ); break;
+		case BasicType::UInt64: stream->SerializeArray( (uint64_t*)data, count ); break;
+		case BasicType::Int8: stream->SerializeArray( (int8_t*)data, count ); break;
+		case BasicType::Int16: stream->SerializeArray( (int16_t*)data, count ); break;
+		case BasicType::Int32: stream->SerializeArray( (int32_t*)data, count ); break;
+		case BasicType::Int64: stream->SerializeArray( (int64_t*)data, count ); break;
+		case BasicType::Int2: stream->SerializeArray( (ae::Int2*)data, count ); break;
+		case BasicType::Int3: stream->SerializeArray( (ae::Int3*)data, count ); break;
+		case BasicType::Bool: stream->SerializeArray( (bool*)data, count ); break;
+		case BasicType::Float: stream->SerializeArray( (float*)data, count ); break;
+		case BasicType::Double: stream->SerializeArray( (double*)data, count ); break;
+		case BasicType::Vec2: stream->SerializeArray( (ae::Vec2*)data, count ); break;
+		case BasicType::Vec3: stream->SerializeArray( (ae::Vec3*)data, count ); break;
+		case BasicType::Vec4: stream->SerializeArray( (ae::Vec4*)data, count ); break;
+		case BasicType::Matrix4: stream->SerializeArray( (ae::Matrix4*)data, count ); break;
+		case BasicType::Color: stream->SerializeArray( (ae::Color*)data, count ); break;
+		case BasicType::String:
+			switch ( op.size )
+			{
+				case 16: _SerializeVarStr< 16 >( stream, data, count ); break;
+				case 32: _SerializeVarStr< 32 >( stream, data, count ); break;
+				case 64: _SerializeVarStr< 64 >( stream, data, count ); break;
+				case 128: _SerializeVarStr< 128 >( stream, data, count ); break;
+				case 256: _SerializeVarStr< 256 >( stream, data, count ); break;
+				case 512: _SerializeVarStr< 512 >( stream, data, count ); break;
+				default: AE_FAIL_MSG( "Invalid string size '#'", op.size ); break;
+			}
+			break;
+		case BasicType::Enum:
+			// Enums are written as variable length integers so the underlying type can change
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				uint8_t* e = (uint8_t*)data + i * op.size;
+				int64_t value = 0;
+				switch ( op.size )
+				{
+					case 1: value = op.isSigned ? *(int8_t*)e : *(uint8_t*)e; break;
+					case 2: value = op.isSigned ? *(int16_t*)e : *(uint16_t*)e; break;
+					case 4: value = op.isSigned ? *(int32_t*)e : *(uint32_t*)e; break;
+					case 8: value = *(int64_t*)e; break;
+					default: AE_FAIL(); break;
+				}
+				stream->SerializeVarInt64( value );
+				if ( stream->AsReader() )
+				{
+					switch ( op.size )
+					{
+						case 1: *(int8_t*)e = (int8_t)value; break;
+						case 2: *(int16_t*)e = (int16_t)value; break;
+						case 4: *(int32_t*)e = (int32_t)value; break;
+						case 8: *(int64_t*)e = value; break;
+					}
+				}
+			}
+			break;
+		case BasicType::Class:
+			AE_ASSERT_MSG( op.subType, "Class var '#' type is not registered", op.var->GetName() );
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				op.subType->SerializeObject( stream, (ae::Object*)( (uint8_t*)data + i * op.size ) );
+			}
+			break;
+		case BasicType::Pointer:
+		case BasicType::CustomRef:
+			// References are converted to strings by the application
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				const int32_t arrayIdx = op.array ? (int32_t)i : -1;
+				if ( ae::BinaryReader* reader = stream->AsReader() )
+				{
+					uint32_t length = 0;
+					reader->SerializeVarUint32( length );
+					const char* str = (const char*)reader->PeekReadData();
+					if ( !str || length > reader->GetRemainingBytes() )
+					{
+						reader->Invalidate();
+						return;
+					}
+					op.var->SetObjectValueFromString( obj, std::string( str, length ).c_str(), arrayIdx );
+					reader->DiscardReadData( length );
+				}
+				else
+				{
+					const std::string value = op.var->GetObjectValueAsString( obj, arrayIdx );
+					stream->AsWriter()->SerializeVarUint32( (uint32_t)value.size() );
+					stream->AsWriter()->SerializeRaw( value.c_str(), (uint32_t)value.size() );
+				}
+			}
+			break;
 	}
 }
 
-uint32_t ae::Type::GetVarCount( bool parents ) const
+void ae::Type::m_SkipObject( ae::BinaryReader* stream )
 {
-	const ae::Type* parent = ( parents ? GetParentType() : nullptr );
-	return m_vars.Length() + ( parent ? parent->GetVarCount( parents ) : 0 );
+	uint32_t count = 0;
+	stream->SerializeVarUint32( count );
+	for ( uint32_t i = 0; i < count && stream->IsValid(); i++ )
+	{
+		uint32_t nameHash = 0;
+		uint8_t ownerDepth = 0;
+		uint8_t tag = 0;
+		stream->SerializeUint32( nameHash );
+		stream->SerializeUint8( ownerDepth );
+		stream->SerializeUint8( tag );
+		m_SkipOp( stream, tag );
+	}
 }
 
-const ae::Var* ae::Type::GetVarByIndex( uint32_t i, bool parents ) const
+void ae::Type::m_SkipOp( ae::BinaryReader* stream, uint8_t tag, uint32_t count )
 {
-	if ( !parents )
+	if ( tag & kArrayTag )
 	{
-		return &m_vars[ i ];
+		stream->SerializeVarUint32( count );
 	}
-	// @HACK: This whole function should be re-written to avoid recreating this array and all of this recursion
-	ae::Array< const ae::Var*, kMaxMetaVars > vars;
-	auto fn = [&vars]( auto fn, const ae::Type* type ) -> void
+	const ae::BasicType type = (ae::BasicType)( tag & ~kArrayTag );
+	if ( const uint32_t wireSize = _GetVarWireSize( type ) )
 	{
-		if ( const ae::Type* parent = type->GetParentType() )
+		if ( (uint64_t)count * wireSize > stream->GetRemainingBytes() )
 		{
-			fn( fn, parent );
+			stream->Invalidate();
 		}
-		for ( const ae::Var& v : type->m_vars )
+		stream->DiscardReadData( count * wireSize );
+		return;
+	}
+	for ( uint32_t i = 0; i < count && stream->IsValid(); i++ )
+	{
+		switch ( type )
 		{
-			vars.Append( &v );
+			case BasicType::Enum:
+			{
+				int64_t value;
+				stream->SerializeVarInt64( value );
+				break;
+			}
+			case BasicType::String:
+			case BasicType::Pointer:
+			case BasicType::CustomRef:
+			{
+				uint32_t length = 0;
+				stream->SerializeVarUint32( length );
+				stream->DiscardReadData( length );
+				break;
+			}
+			case BasicType::Class:
+				m_SkipObject( stream );
+				break;
+			default:
+				stream->Invalidate(); // Unknown type
+				break;
 		}
-	};
-	fn( fn, this );
-	return vars[ i ];
+	}
 }
 
-const ae::Var* ae::Type::GetVarByName( const char* name, bool parents ) const
+void ae::Type::CopyVars( ae::Object* dst, const ae::Object* src ) const
 {
-	int32_t i = m_vars.FindFn( [name]( const ae::Var& v )
+	AE_ASSERT( dst && src );
+	AE_DEBUG_ASSERT_MSG( ae::GetTypeFromObject( dst )->IsType( this ), "Can't copy vars to object of type '#' as '#'", ae::GetTypeFromObject( dst )->GetName(), GetName() );
+	AE_DEBUG_ASSERT_MSG( ae::GetTypeFromObject( src )->IsType( this ), "Can't copy vars from object of type '#' as '#'", ae::GetTypeFromObject( src )->GetName(), GetName() );
+	if ( dst == src )
 	{
-		return v.m_name == name;
-	} );
-	if ( i >= 0 )
+		return;
+	}
+	m_UpdateHierarchy();
+	uint8_t* dstData = (uint8_t*)dst;
+	const uint8_t* srcData = (const uint8_t*)src;
+	for ( const CopyOp& copyOp : m_copyOps )
 	{
-		return &m_vars[ i ];
+		if ( copyOp.serializeOp < 0 )
+		{
+			memcpy( dstData + copyOp.offset, srcData + copyOp.offset, copyOp.size );
+			continue;
+		}
+		const SerializeOp& op = m_serializeOps[ copyOp.serializeOp ];
+		void* dstVar = dstData + op.offset;
+		const void* srcVar = srcData + op.offset;
+		if ( !op.array )
+		{
+			m_CopyElements( op, dstVar, srcVar, 1 );
+			continue;
+		}
+		const uint32_t srcLength = op.array->GetLength( srcVar );
+		const uint32_t length = ae::Min( op.array->Resize( dstVar, srcLength ), srcLength );
+		if ( length )
+		{
+			m_CopyElements( op, op.array->GetElement( dstVar, 0 ), op.array->GetElement( srcVar, 0 ), length );
+		}
 	}
-	else if ( const ae::Type* parent = ( parents ? GetParentType() : nullptr ) )
+}
+
+void ae::Type::m_CopyElements( const SerializeOp& op, void* dst, const void* src, uint32_t count )
+{
+	switch ( op.var->m_type )
 	{
-		return parent->GetVarByName( name, parents );
+		case BasicType::Class:
+			AE_ASSERT( op.subType );
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				op.subType->CopyVars( (ae::Object*)( (uint8_t*)dst + i * op.size ), (const ae::Object*)( (const uint8_t*)src + i * op.size ) );
+			}
+			break;
+		case BasicType::CustomRef:
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				const std::string ref = op.var->m_varType->GetStringFromRef( (const uint8_t*)src + i * op.size );
+				op.var->m_varType->SetRef( (uint8_t*)dst + i * op.size, ref.c_str(), op.var );
+			}
+			break;
+		default:
+			// Array elements are contiguous
+			memcpy( dst, src, op.size * count );
+			break;
 	}
-	return nullptr;
 }
 
-const ae::Type* ae::Type::GetParentType() const
+void ae::Serialize( ae::BinaryStream* stream, ae::Object* obj )
 {
-	return GetTypeByName( m_parent.c_str() );
+	AE_ASSERT( obj );
+	ae::GetTypeFromObject( obj )->SerializeObject( stream, obj );
 }
 
-bool ae::Type::IsType( const Type* otherType ) const
+void ae::Serialize( ae::BinaryWriter* stream, const ae::Object* obj )
 {
-	AE_ASSERT( otherType );
-	for ( const ae::Type* baseType = this; baseType; baseType = baseType->GetParentType() )
-	{
-		if ( baseType == otherType )
-		{
-			return true;
-		}
-	}
-	return false;
+	AE_ASSERT( obj );
+	ae::GetTypeFromObject( obj )->SerializeObject( stream, obj );
 }
 
 const class ae::Enum* ae::Var::GetEnum() const
@@ -26631,12 +30221,12 @@ void ae::Type::m_AddProp( const char* prop, const char* value )
 
 void ae::Type::m_AddVar( const Var& var )
 {
-	AE_ASSERT_MSG( m_vars.Length() < m_vars.Size(), "Set/increase AE_MAX_META_VARS_CONFIG (Currently: #)", m_vars.Size() );
-	m_vars.Append( var );
+	m_vars.push_back( var );
 	std::sort( m_vars.begin(), m_vars.end(), []( const auto& a, const auto& b )
 	{
 		return a.GetOffset() < b.GetOffset();
 	} );
+	_Globals::Get()->metaCacheSeq++;
 }
 
 #endif // AE_MAIN
@@ -8,6 +8,7 @@
 //------------------------------------------------------------------------------
 #include "ae/Editor.h"
 #include "ae/Entity.h"
+#include "EditorLevel.h"
 // @TODO: Remove ImGui dependencies
 #include "ae/aeImGui.h"
 #include "ImGuizmo.h"
@@ -70,12 +71,70 @@ const float kEditorViewDistance = 25000.0f;
 //------------------------------------------------------------------------------
 // Serialization helpers
 //------------------------------------------------------------------------------
-void GetComponentTypePrereqs( const ae::Type* type, ae::Array< const ae::Type* >* prereqs );
 void JsonToComponent( const ae::Matrix4& transform, const rapidjson::Value& jsonComponent, Component* component );
 void JsonToRegistry( const ae::Map< ae::Entity, ae::Entity >& entityMap, const rapidjson::Value& jsonObjects, ae::Registry* registry );
+void JsonObjectToRegistry( const ae::Map< ae::Entity, ae::Entity >& entityMap, const rapidjson::Value& jsonObject, ae::Registry* registry );
 void ComponentToJson( const Component* component, const Component* defaultComponent, rapidjson::Document::AllocatorType& allocator, rapidjson::Value* jsonComponent );
 bool ValidateLevel( const rapidjson::Value& jsonLevel );
 
+//------------------------------------------------------------------------------
+// EditorLevelLoader class
+//------------------------------------------------------------------------------
+//! Loads a json or binary level into the ae::Editor registry over multiple
+//! calls to Update(). Json levels can be parsed on a background thread. Then all
+//! entities are created, followed by serializing their components (second
+//! phase to handle references), stopping whenever the time budget runs out.
+class EditorLevelLoader
+{
+public:
+	EditorLevelLoader( const ae::Tag& tag, const ae::EditorParams* params, const char* levelPath );
+	~EditorLevelLoader();
+	//! Starts loading a binary level. Returns false (and doesn't take
+	//! ownership of \p binaryLevel) if the binary level is out of date.
+	bool Start( EditorFileMapping* binaryLevel );
+	//! Starts loading a json level. \p jsonLevel must be null terminated and
+	//! must remain valid until Update() returns true.
+	void Start( const char* jsonLevel, bool parseInBackground );
+	//! Loads entities until ae::GetTime() reaches \p endTime, which is only
+	//! checked after at least one entity has been loaded. Returns true once
+	//! the level has been loaded or has failed to load.
+	bool Update( double endTime );
+	//! Stops loading and destroys the entities that have been created so far.
+	//! Blocks until a background json parse has finished, since it can't be
+	//! interrupted and reads the json level passed to Start().
+	void Cancel();
+	//! Returns the fraction of the level that's been loaded (0-1)
+	float GetProgress() const;
+	//! Returns true once the level has been validated and entities are
+	//! being created
+	bool HasBegun() const { return m_begun; }
+	const char* GetLevelPath() const { return m_levelPath.c_str(); }
+
+private:
+	enum class Stage { Parse, Create, Serialize, Done };
+	void m_Begin( uint32_t entityCount );
+	void m_CreateJsonEntity( const rapidjson::Value& jsonObject );
+	const ae::Tag m_tag;
+	const ae::EditorParams* m_params;
+	const ae::Str256 m_levelPath;
+	Stage m_stage = Stage::Parse;
+	bool m_begun = false;
+	uint32_t m_entityCount = 0;
+	uint32_t m_entityIndex = 0;
+	// Binary levels
+	EditorFileMapping* m_binaryLevel = nullptr;
+	BinaryLevelReader* m_binaryReader = nullptr;
+	// Json levels
+	const char* m_jsonLevel = nullptr;
+	rapidjson::Document m_document;
+	rapidjson::ParseResult m_parseResult;
+	std::thread m_parseThread;
+	std::atomic< bool > m_parsed = { false };
+	ae::Map< ae::Entity, ae::Entity > m_entityMap;
+	ae::Array< ae::Entity > m_jsonEntities;
+	ae::Array< const ae::Type* > m_prereqs;
+};
+
 //------------------------------------------------------------------------------
 // EditorMsg
 //------------------------------------------------------------------------------
@@ -83,10 +142,39 @@ enum class EditorMsg : uint8_t
 {
 	None,
 	Heartbeat,
-	Modification,
+	VarChanges,
+	Transforms,
 	Load
 };
 
+//! Which part of an entity transform is sent in an EditorMsg::Transforms record
+enum class TransformLayout : uint8_t
+{
+	Translation, // The rest of the matrix is identity
+	Affine, // Axes and translation, the bottom row is ( 0, 0, 0, 1 )
+	Matrix
+};
+
+//------------------------------------------------------------------------------
+// Live update helpers
+//------------------------------------------------------------------------------
+// Modifications made in the editor are sent to the game in batches once per
+// frame. EditorMsg::VarChanges messages contain records of the changed vars of
+// a component written with ae::Type::SerializeVars(), so vars are identified by
+// name hash and the game doesn't need to parse any strings. Entity transform
+// changes are sent separately in EditorMsg::Transforms messages, which the game
+// applies to each component of the entity the same way as when loading a level.
+// Transform records only include the axes and bottom row of the matrix when
+// they aren't identity, see TransformLayout.
+void VarChangesToBinary( const ae::Component* component, const ae::Var* const* vars, uint32_t varCount, ae::Array< uint8_t >* binary );
+void TransformToBinary( ae::Entity entity, const ae::Matrix4& transform, ae::Array< uint8_t >* binary );
+//! Applies every record of an EditorMsg::VarChanges message. Records of
+//! components that don't exist are skipped. Returns false on error.
+bool BinaryToVarChanges( ae::BinaryReader* reader, ae::Registry* registry );
+//! Applies every record of an EditorMsg::Transforms message. Returns false on
+//! error.
+bool BinaryToTransforms( const ae::Tag& tag, ae::BinaryReader* reader, ae::Registry* registry );
+
 //------------------------------------------------------------------------------
 // EditorServerMesh class
 //------------------------------------------------------------------------------
@@ -161,7 +249,11 @@ public:
 		m_meshVisibleVars( tag ),
 		m_typeMesh( tag ),
 		m_typeInvisible( tag ),
-		m_connections( tag )
+		m_connections( tag ),
+		m_varChanges( tag ),
+		m_transformChanges( tag ),
+		m_modificationMsg( tag ),
+		m_modificationRecord( tag )
 	{}
 	void Initialize( class EditorProgram* program );
 	void Terminate( class EditorProgram* program );
@@ -211,6 +303,10 @@ private:
 	void m_ShowEditorObject( EditorProgram* program, ae::Entity entity, ae::Color color );
 	ae::Color m_GetColor( ae::Entity entity, bool lines ) const;
 	void m_LoadLevel( class EditorProgram* program );
+	void m_SaveBinaryLevel( class EditorProgram* program, const char* json, uint32_t jsonLength ) const;
+	void m_SendModifications();
+	void m_QueueModificationRecord( EditorMsg msgType );
+	void m_QueueModificationMsg();
 	
 	const ae::Tag m_tag;
 	bool m_first = true;
@@ -245,6 +341,17 @@ private:
 	double m_nextHeartbeat = 0.0;
 	ae::Array< EditorConnection* > m_connections;
 	uint8_t m_msgBuffer[ kMaxEditorMessageSize ];
+	// Modifications are batched and sent to clients once per frame by m_SendModifications()
+	struct VarChange
+	{
+		ae::Entity entity;
+		const ae::Type* type;
+		const ae::Var* var;
+	};
+	ae::Array< VarChange > m_varChanges;
+	ae::Map< ae::Entity, ae::Matrix4 > m_transformChanges;
+	ae::Array< uint8_t > m_modificationMsg;
+	ae::Array< uint8_t > m_modificationRecord;
 	
 	// Selection
 	struct SelectRef
@@ -815,6 +922,8 @@ void Editor::Terminate()
 	m_sock.Disconnect();
 #endif
 
+	ae::Delete( m_levelLoader );
+	m_levelLoader = nullptr;
 	if( m_pendingLevel )
 	{
 		m_fileSystem.Destroy( m_pendingLevel );
@@ -851,7 +960,7 @@ void Editor::Update()
 	while ( ( msgLength = m_sock.ReceiveMsg( m_msgBuffer, sizeof(m_msgBuffer) ) ) )
 	{
 		EditorMsg msgType = EditorMsg::None;
-		ae::BinaryReader rStream( m_msgBuffer, sizeof(m_msgBuffer) );
+		ae::BinaryReader rStream( m_msgBuffer, msgLength );
 		rStream.SerializeEnum( msgType );
 		switch ( msgType )
 		{
@@ -860,28 +969,19 @@ void Editor::Update()
 				// Nothing
 				break;
 			}
-			case EditorMsg::Modification:
-			{
-				ae::Entity entity;
-				ae::TypeId typeId;
-				ae::Str32 varName;
-				ae::Str256 varValue;
-				rStream.SerializeUint32( entity );
-				rStream.SerializeUint32( typeId );
-				rStream.SerializeString( varName );
-				rStream.SerializeString( varValue );
-				if( rStream.IsValid() )
+			case EditorMsg::VarChanges:
+			{
+				if( !BinaryToVarChanges( &rStream, m_params->registry ) )
 				{
-					if( const ae::Type* type = ae::GetTypeById( typeId ) )
-					{
-						if( ae::Component* component = m_params->registry->TryGetComponent( entity, type ) )
-						{
-							if( const ae::Var* var = type->GetVarByName( varName.c_str(), true ) )
-							{
-								var->SetObjectValueFromString( component, varValue.c_str() );
-							}
-						}
-					}
+					AE_WARN( "Could not read ae::Editor var changes" );
+				}
+				break;
+			}
+			case EditorMsg::Transforms:
+			{
+				if( !BinaryToTransforms( m_tag, &rStream, m_params->registry ) )
+				{
+					AE_WARN( "Could not read ae::Editor transforms" );
 				}
 				break;
 			}
@@ -901,15 +1001,52 @@ void Editor::Update()
 void Editor::QueueRead( const char* levelPath )
 {
 	AE_ASSERT_MSG( m_params, "Must call Editor::Initialize()" );
+	if( m_levelLoader )
+	{
+		AE_WARN( "Cancelling level load '#'", m_levelLoader->GetLevelPath() );
+		m_levelLoader->Cancel();
+		ae::Delete( m_levelLoader );
+		m_levelLoader = nullptr;
+	}
 	if ( m_pendingLevel )
 	{
 		AE_WARN( "Cancelling level read '#'", m_pendingLevel->GetUrl() );
 		m_fileSystem.Destroy( m_pendingLevel );
+		m_pendingLevel = nullptr;
+	}
+	
+	// Prefer the binary level written by the editor
+	ae::Str256 absolutePath = levelPath;
+	m_fileSystem.GetAbsolutePath( ae::FileSystem::Root::Data, levelPath, &absolutePath );
+	EditorFileMapping* binaryLevel = ae::New< EditorFileMapping >( m_tag );
+	if( binaryLevel->Open( GetBinaryLevelPath( absolutePath.c_str() ).c_str() ) )
+	{
+		m_levelLoader = ae::New< EditorLevelLoader >( m_tag, m_tag, m_params, absolutePath.c_str() );
+		if( m_levelLoader->Start( binaryLevel ) )
+		{
+			AE_INFO( "Queuing binary level load '#'", absolutePath );
+			return;
+		}
+		AE_INFO( "Binary level is out of date, loading '#'", absolutePath );
+		ae::Delete( m_levelLoader );
+		m_levelLoader = nullptr;
 	}
+	ae::Delete( binaryLevel );
+	
 	m_pendingLevel = m_fileSystem.Read( ae::FileSystem::Root::Data, levelPath, 2.0f );
 	AE_INFO( "Queuing level load '#'", m_pendingLevel->GetUrl() );
 }
 
+bool Editor::IsLoadingLevel() const
+{
+	return m_pendingLevel || m_levelLoader;
+}
+
+float Editor::GetLevelLoadProgress() const
+{
+	return m_levelLoader ? m_levelLoader->GetProgress() : 0.0f;
+}
+
 void Editor::SetFunctionPointers( const ae::EditorFunctionPointers& functionPointers )
 {
 	AE_ASSERT_MSG( m_params, "Must call Editor::Initialize()" );
@@ -919,81 +1056,259 @@ void Editor::SetFunctionPointers( const ae::EditorFunctionPointers& functionPoin
 // @TODO: Combine. EditorServer::m_LoadLevel(), Editor::m_Read(), and EditorServer::m_PasteFromClipboard() are very similar
 void Editor::m_Read()
 {
-	if ( !m_pendingLevel || m_pendingLevel->GetStatus() == ae::File::Status::Pending )
+	const double budget = m_params->levelLoadTimeBudget;
+	const double endTime = ( budget > 0.0 ) ? ae::GetTime() + budget : INFINITY;
+	if( !m_levelLoader && m_pendingLevel && m_pendingLevel->GetStatus() != ae::File::Status::Pending )
 	{
-		return;
+		if( !m_pendingLevel->GetLength() )
+		{
+			m_fileSystem.Destroy( m_pendingLevel );
+			m_pendingLevel = nullptr;
+			return;
+		}
+		const char* jsonBuffer = (const char*)m_pendingLevel->GetData();
+		AE_ASSERT( jsonBuffer[ m_pendingLevel->GetLength() ] == 0 );
+		m_levelLoader = ae::New< EditorLevelLoader >( m_tag, m_tag, m_params, m_pendingLevel->GetUrl() );
+		m_levelLoader->Start( jsonBuffer, budget > 0.0 );
 	}
-	ae::RunOnDestroy destroyFile{ [this]()
+	
+	if( m_levelLoader && m_levelLoader->Update( endTime ) )
 	{
-		m_fileSystem.Destroy( m_pendingLevel );
-		m_pendingLevel = nullptr;
-	} };
-	uint32_t fileSize = m_pendingLevel->GetLength();
-	if ( !fileSize )
+		if( m_levelLoader->HasBegun() )
+		{
+			m_lastLoadedLevel = m_levelLoader->GetLevelPath();
+		}
+		ae::Delete( m_levelLoader );
+		m_levelLoader = nullptr;
+		// The json level data is kept until loading is complete
+		if( m_pendingLevel )
+		{
+			m_fileSystem.Destroy( m_pendingLevel );
+			m_pendingLevel = nullptr;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// EditorLevelLoader member functions
+//------------------------------------------------------------------------------
+EditorLevelLoader::EditorLevelLoader( const ae::Tag& tag, const ae::EditorParams* params, const char* levelPath ) :
+	m_tag( tag ),
+	m_params( params ),
+	m_levelPath( levelPath ),
+	m_entityMap( tag ),
+	m_jsonEntities( tag ),
+	m_prereqs( tag )
+{}
+
+EditorLevelLoader::~EditorLevelLoader()
+{
+	if( m_parseThread.joinable() )
 	{
-		return;
+		m_parseThread.join();
 	}
+	ae::Delete( m_binaryReader );
+	ae::Delete( m_binaryLevel );
+}
 
-	const char* jsonBuffer = (const char*)m_pendingLevel->GetData();
-	AE_ASSERT( jsonBuffer[ m_pendingLevel->GetLength() ] == 0 );
-	rapidjson::Document document;
-	rapidjson::ParseResult parseResult = document.Parse( jsonBuffer );
-	if( parseResult.IsError() )
+bool EditorLevelLoader::Start( EditorFileMapping* binaryLevel )
+{
+	AE_ASSERT( m_stage == Stage::Parse && !m_binaryReader && !m_jsonLevel );
+	m_binaryReader = ae::New< BinaryLevelReader >( m_tag, m_tag, binaryLevel->GetData(), binaryLevel->GetLength() );
+	// The json level is only hashed to check that the binary level is up to date
+	EditorFileMapping jsonLevel;
+	if( !jsonLevel.Open( m_levelPath.c_str() ) || !m_binaryReader->Validate( jsonLevel.GetData(), jsonLevel.GetLength() ) )
 	{
-		AE_ERR( "Could not parse json '#' Error:# (#)",
-			m_pendingLevel->GetUrl(),
-			rapidjson::GetParseError_En( parseResult.Code() ),
-			parseResult.Offset()
-		);
-		return;
+		ae::Delete( m_binaryReader );
+		m_binaryReader = nullptr;
+		return false;
 	}
+	m_binaryLevel = binaryLevel;
+	return true;
+}
 
-	if( !ValidateLevel( document ) )
+void EditorLevelLoader::Start( const char* jsonLevel, bool parseInBackground )
+{
+	AE_ASSERT( m_stage == Stage::Parse && !m_binaryReader && !m_jsonLevel );
+	m_jsonLevel = jsonLevel;
+	auto parseFn = [ this ]()
 	{
-		AE_ERR( "Invalid level data format '#'", m_pendingLevel->GetUrl() );
+		m_parseResult = m_document.Parse( m_jsonLevel );
+		m_parsed = true;
+	};
+#if !_AE_EMSCRIPTEN_
+	if( parseInBackground )
+	{
+		m_parseThread = std::thread( parseFn );
 		return;
 	}
+#endif
+	parseFn();
+}
 
-	m_lastLoadedLevel = m_pendingLevel->GetUrl();
-	if( m_params->functionPointers.onLevelLoadStartFn )
+bool EditorLevelLoader::Update( double endTime )
+{
+	if( m_stage == Stage::Parse )
 	{
-		m_params->functionPointers.onLevelLoadStartFn( m_params->functionPointers.userData, m_pendingLevel->GetUrl() );
+		if( m_jsonLevel )
+		{
+			if( !m_parsed )
+			{
+				return false;
+			}
+			if( m_parseThread.joinable() )
+			{
+				m_parseThread.join();
+			}
+			if( m_parseResult.IsError() )
+			{
+				AE_ERR( "Could not parse json '#' Error:# (#)",
+					m_levelPath,
+					rapidjson::GetParseError_En( m_parseResult.Code() ),
+					m_parseResult.Offset()
+				);
+				m_stage = Stage::Done;
+				return true;
+			}
+			if( !ValidateLevel( m_document ) )
+			{
+				AE_ERR( "Invalid level data format '#'", m_levelPath );
+				m_stage = Stage::Done;
+				return true;
+			}
+			m_Begin( m_document[ "objects" ].Size() );
+		}
+		else
+		{
+			AE_ASSERT( m_binaryReader );
+			m_Begin( m_binaryReader->GetEntityCount() );
+		}
 	}
 
-	// State for loading
-	ae::Array< const ae::Type* > prereqs = m_tag;
-	ae::Map< ae::Entity, ae::Entity > entityMap = m_tag; 
-	const auto& jsonObjects = document[ "objects" ];
-
-	// Create all components
-	for( const auto& jsonObject : jsonObjects.GetArray() )
+	ae::Registry* registry = m_params->registry;
+	while( m_stage == Stage::Create || m_stage == Stage::Serialize )
 	{
-		const char* entityName = jsonObject.HasMember( "name" ) ? jsonObject[ "name" ].GetString() : "";
-		const ae::Matrix4 entityTransform = ae::FromString< ae::Matrix4 >( jsonObject[ "transform" ].GetString(), ae::Matrix4::Identity() );
-		const ae::Entity jsonEntity = jsonObject[ "id" ].GetUint();
-		const ae::Entity entity = m_params->registry->CreateEntity( jsonEntity, entityName );
-		if( entity != jsonEntity )
+		if( m_entityIndex == m_entityCount )
 		{
-			entityMap.Set( jsonEntity, entity );
+			m_stage = ( m_stage == Stage::Create ) ? Stage::Serialize : Stage::Done;
+			m_entityIndex = 0;
+			continue;
 		}
-		for( const auto& componentIter : jsonObject[ "components" ].GetObject() )
+		
+		bool success = true;
+		if( m_stage == Stage::Create )
 		{
-			AE_ASSERT( componentIter.value.IsObject() );
-			const ae::Type* type = ae::GetTypeByName( componentIter.name.GetString() );
-			AE_ASSERT_MSG( type, "Type '#' not found. Register with AE_REGISTER_CLASS(), or if the class isn't directly referenced you may need to use AE_FORCE_LINK().", componentIter.name.GetString() );
-			GetComponentTypePrereqs( type, &prereqs );
-			for( const ae::Type* prereq : prereqs )
+			if( m_binaryReader )
 			{
-				m_params->registry->AddComponent( entity, prereq );
+				success = m_binaryReader->CreateEntity( registry );
+			}
+			else
+			{
+				m_CreateJsonEntity( m_document[ "objects" ][ m_entityIndex ] );
+			}
+		}
+		else
+		{
+			// Serialize all components (second phase to handle references)
+			if( m_binaryReader )
+			{
+				success = m_binaryReader->SerializeEntity( registry );
+			}
+			else
+			{
+				JsonObjectToRegistry( m_entityMap, m_document[ "objects" ][ m_entityIndex ], registry );
 			}
-			m_params->registry->AddComponent( entity, type );
 		}
+		m_entityIndex++;
+		
+		if( !success )
+		{
+			// The level can't be reloaded from json once entities have been
+			// created, so this is only reported
+			AE_ERR( "Could not read binary level '#'", GetBinaryLevelPath( m_levelPath.c_str() ) );
+			m_stage = Stage::Done;
+			return true;
+		}
+		if( ae::GetTime() >= endTime )
+		{
+			break;
+		}
+	}
+	
+	if( m_stage == Stage::Done )
+	{
+		AE_INFO( "Loaded level '#'", m_levelPath );
+		return true;
 	}
+	return false;
+}
 
-	// Serialize all components (second phase to handle references)
-	JsonToRegistry( entityMap, jsonObjects, m_params->registry );
+void EditorLevelLoader::Cancel()
+{
+	if( m_parseThread.joinable() )
+	{
+		m_parseThread.join();
+	}
+	if( m_stage == Stage::Create || m_stage == Stage::Serialize )
+	{
+		// Entities destroyed by the game during loading are ignored by Destroy()
+		ae::Registry* registry = m_params->registry;
+		const ae::Array< ae::Entity >& entities = m_binaryReader ? m_binaryReader->GetEntities() : m_jsonEntities;
+		for( ae::Entity entity : entities )
+		{
+			registry->Destroy( entity );
+		}
+	}
+	m_stage = Stage::Done;
+}
 
-	AE_INFO( "Loaded level '#'", m_pendingLevel->GetUrl() );
+float EditorLevelLoader::GetProgress() const
+{
+	switch( m_stage )
+	{
+		case Stage::Parse: return 0.0f;
+		case Stage::Create: return 0.5f * m_entityIndex / (float)m_entityCount;
+		case Stage::Serialize: return 0.5f + 0.5f * m_entityIndex / (float)m_entityCount;
+		case Stage::Done: return 1.0f;
+	}
+	return 0.0f;
+}
+
+void EditorLevelLoader::m_Begin( uint32_t entityCount )
+{
+	if( m_params->functionPointers.onLevelLoadStartFn )
+	{
+		m_params->functionPointers.onLevelLoadStartFn( m_params->functionPointers.userData, m_levelPath.c_str() );
+	}
+	m_begun = true;
+	m_entityCount = entityCount;
+	m_entityIndex = 0;
+	m_stage = Stage::Create;
+}
+
+void EditorLevelLoader::m_CreateJsonEntity( const rapidjson::Value& jsonObject )
+{
+	ae::Registry* registry = m_params->registry;
+	const char* entityName = jsonObject.HasMember( "name" ) ? jsonObject[ "name" ].GetString() : "";
+	const ae::Entity jsonEntity = jsonObject[ "id" ].GetUint();
+	const ae::Entity entity = registry->CreateEntity( jsonEntity, entityName );
+	m_jsonEntities.Append( entity );
+	if( entity != jsonEntity )
+	{
+		m_entityMap.Set( jsonEntity, entity );
+	}
+	for( const auto& componentIter : jsonObject[ "components" ].GetObject() )
+	{
+		AE_ASSERT( componentIter.value.IsObject() );
+		const ae::Type* type = ae::GetTypeByName( componentIter.name.GetString() );
+		AE_ASSERT_MSG( type, "Type '#' not found. Register with AE_REGISTER_CLASS(), or if the class isn't directly referenced you may need to use AE_FORCE_LINK().", componentIter.name.GetString() );
+		GetComponentTypePrereqs( type, &m_prereqs );
+		for( const ae::Type* prereq : m_prereqs )
+		{
+			registry->AddComponent( entity, prereq );
+		}
+		registry->AddComponent( entity, type );
+	}
 }
 
 void Editor::m_Connect()
@@ -1307,6 +1622,7 @@ void EditorServer::Update( EditorProgram* program )
 		m_nextHeartbeat = currentTime + 0.1;
 	}
 	
+	m_SendModifications();
 	for( EditorConnection* (&conn) : m_connections )
 	{
 		if( conn->sock->IsConnected() )
@@ -2303,6 +2619,10 @@ void EditorServer::HandleTransformChange( EditorProgram* program, ae::Entity ent
 {
 	EditorServerObject* editorObject = GetObject( entity );
 	AE_ASSERT( editorObject );
+	if( m_connections.Length() )
+	{
+		m_transformChanges.Set( entity, transform );
+	}
 	const uint32_t typeCounts = m_registry.GetTypeCount();
 	for( uint32_t i = 0; i < typeCounts; i++ )
 	{
@@ -2321,27 +2641,95 @@ void EditorServer::HandleTransformChange( EditorProgram* program, ae::Entity ent
 
 void EditorServer::BroadcastVarChange( const ae::Var* var, const ae::Component* component )
 {
-	if( var->IsArray() )
+	if( m_connections.Length() )
+	{
+		m_varChanges.Append( { component->GetEntity(), ae::GetTypeFromObject( component ), var } );
+	}
+}
+
+void EditorServer::m_SendModifications()
+{
+	if( !m_connections.Length() )
 	{
-		// @TODO: Broadcast array element changes
+		m_varChanges.Clear();
+		m_transformChanges.Clear();
 		return;
 	}
-	ae::BinaryWriter wStream( m_msgBuffer, sizeof(m_msgBuffer) );
-	wStream.SerializeEnum( EditorMsg::Modification );
-	wStream.SerializeUint32( component->GetEntity() );
-	wStream.SerializeUint32( ae::GetObjectTypeId( component ) );
-	wStream.SerializeString( var->GetName() );
-	wStream.SerializeString( var->GetObjectValueAsString( component ).c_str() );
-	if( wStream.IsValid() )
+	
+	// Transforms
+	for( const auto& transformChange : m_transformChanges )
+	{
+		TransformToBinary( transformChange.key, transformChange.value, &m_modificationRecord );
+		m_QueueModificationRecord( EditorMsg::Transforms );
+	}
+	m_QueueModificationMsg();
+	
+	// Group changed vars by component, skipping vars already sent with the entity transform
+	std::sort( m_varChanges.begin(), m_varChanges.end(), []( const VarChange& a, const VarChange& b )
 	{
-		for ( EditorConnection* conn : m_connections )
+		if( a.entity != b.entity ) { return a.entity < b.entity; }
+		if( a.type != b.type ) { return a.type->GetId() < b.type->GetId(); }
+		return a.var < b.var;
+	} );
+	ae::Array< const ae::Var* > vars = m_tag;
+	for( uint32_t i = 0; i < m_varChanges.Length(); )
+	{
+		const ae::Entity entity = m_varChanges[ i ].entity;
+		const ae::Type* type = m_varChanges[ i ].type;
+		const EntityTransformVars transformVars = m_transformChanges.TryGet( entity ) ? EntityTransformVars( type ) : EntityTransformVars();
+		vars.Clear();
+		for( ; i < m_varChanges.Length() && m_varChanges[ i ].entity == entity && m_varChanges[ i ].type == type; i++ )
+		{
+			const ae::Var* var = m_varChanges[ i ].var;
+			if( ( !vars.Length() || vars[ vars.Length() - 1 ] != var ) && !transformVars.Contains( var ) )
+			{
+				vars.Append( var );
+			}
+		}
+		const ae::Component* component = m_registry.TryGetComponent( entity, type );
+		if( component && vars.Length() )
 		{
-			conn->sock->QueueMsg( wStream.GetData(), (uint16_t)wStream.GetOffset() );
+			VarChangesToBinary( component, vars.Data(), vars.Length(), &m_modificationRecord );
+			m_QueueModificationRecord( EditorMsg::VarChanges );
 		}
 	}
-	else
+	m_QueueModificationMsg();
+	
+	m_varChanges.Clear();
+	m_transformChanges.Clear();
+}
+
+void EditorServer::m_QueueModificationRecord( EditorMsg msgType )
+{
+	const uint32_t recordLength = m_modificationRecord.Length();
+	if( recordLength + sizeof(msgType) > kMaxEditorMessageSize )
+	{
+		AE_WARN( "Modification is too large to send (# bytes)", recordLength );
+		m_modificationRecord.Clear();
+		return;
+	}
+	if( m_modificationMsg.Length() + recordLength > kMaxEditorMessageSize )
+	{
+		m_QueueModificationMsg();
+	}
+	if( !m_modificationMsg.Length() )
 	{
-		AE_WARN( "Could not serialize modification message" );
+		ae::BinaryWriter wStream( &m_modificationMsg );
+		wStream.SerializeEnum( msgType );
+	}
+	m_modificationMsg.AppendArray( m_modificationRecord.Data(), recordLength );
+	m_modificationRecord.Clear();
+}
+
+void EditorServer::m_QueueModificationMsg()
+{
+	if( m_modificationMsg.Length() )
+	{
+		for( EditorConnection* conn : m_connections )
+		{
+			conn->sock->QueueMsg( m_modificationMsg.Data(), (uint16_t)m_modificationMsg.Length() );
+		}
+		m_modificationMsg.Clear();
 	}
 }
 
@@ -2417,9 +2805,34 @@ bool EditorServer::SaveLevel( EditorProgram* program, bool saveAs )
 		ae::ShowMessage( msg.c_str() );
 		return false;
 	}
+	m_SaveBinaryLevel( program, buffer.GetString(), buffer.GetSize() );
 	return true;
 }
 
+void EditorServer::m_SaveBinaryLevel( EditorProgram* program, const char* json, uint32_t jsonLength ) const
+{
+	const ae::Str256 binaryPath = GetBinaryLevelPath( m_levelPath.c_str() );
+	if( program->params.functionPointers.preFileEditFn
+		&& !program->params.functionPointers.preFileEditFn( program->params.functionPointers.userData, binaryPath.c_str() ) )
+	{
+		AE_WARN( "Binary level failed per edit check '#'", binaryPath );
+		return;
+	}
+
+	ae::Array< uint8_t > binary = m_tag;
+	LevelHeaderToBinary( &m_registry, m_objects.Length(), json, jsonLength, &binary );
+	for( const auto& _obj : m_objects )
+	{
+		EntityToBinary( &m_registry, _obj.value->entity, _obj.value->GetTransform(), &binary );
+	}
+
+	// ae::Editor falls back to the json level if this fails
+	if( !program->fileSystem.Write( ae::FileSystem::Root::Data, binaryPath.c_str(), binary.Data(), binary.Length(), false ) )
+	{
+		AE_WARN( "Failed to write binary level '#'", binaryPath );
+	}
+}
+
 void EditorServer::OpenLevelDialog( EditorProgram* program )
 {
 	ae::FileDialogParams params;
@@ -3030,34 +3443,6 @@ ae::Color EditorServer::m_GetColor( ae::Entity entity, bool lines ) const
 	return color;
 }
 
-void GetComponentTypePrereqs( const ae::Type* type, ae::Array< const ae::Type* >* prereqs )
-{
-	AE_ASSERT( type );
-	prereqs->Clear();
-	auto fn = [&]( auto& fn, const ae::Type* t ) -> void
-	{
-		if( t->GetParentType() )
-		{
-			fn( fn, t->GetParentType() );
-		}
-		const int32_t propIdx = t->GetPropertyIndex( "ae_editor_dep" );
-		const uint32_t propCount = ( propIdx >= 0 ) ? t->GetPropertyValueCount( propIdx ) : 0;
-		for( uint32_t i = 0; i < propCount; i++ )
-		{
-			const ae::Type* prereq = ae::GetTypeByName( t->GetPropertyValue( propIdx, i ) );
-			if( type != prereq && prereqs->Find( prereq ) < 0 )
-			{
-				// @TODO: Handle missing types
-				if( prereq )
-				{
-					prereqs->Append( prereq );
-				}
-			}
-		}
-	};
-	fn( fn, type );
-}
-
 void JsonToComponent( const ae::Matrix4& transform, const rapidjson::Value& jsonComponent, Component* component )
 {
 	const ae::Type* type = ae::GetTypeFromObject( component );
@@ -3107,21 +3492,29 @@ void JsonToRegistry( const ae::Map< ae::Entity, ae::Entity >& entityMap, const r
 	// Serialize all components (second phase to handle references)
 	for( const auto& jsonObject : jsonObjects.GetArray() )
 	{
-		const ae::Entity jsonEntity = jsonObject[ "id" ].GetUint();
-		const ae::Entity entity = entityMap.Get( jsonEntity, jsonEntity );
-		const ae::Matrix4 transform = ae::FromString< ae::Matrix4 >( jsonObject[ "transform" ].GetString(), ae::Matrix4::Identity() );
-		for( const auto& componentIter : jsonObject[ "components" ].GetObject() )
+		JsonObjectToRegistry( entityMap, jsonObject, registry );
+	}
+}
+
+void JsonObjectToRegistry( const ae::Map< ae::Entity, ae::Entity >& entityMap, const rapidjson::Value& jsonObject, ae::Registry* registry )
+{
+	const ae::Entity jsonEntity = jsonObject[ "id" ].GetUint();
+	const ae::Entity entity = entityMap.Get( jsonEntity, jsonEntity );
+	const ae::Matrix4 transform = ae::FromString< ae::Matrix4 >( jsonObject[ "transform" ].GetString(), ae::Matrix4::Identity() );
+	for( const auto& componentIter : jsonObject[ "components" ].GetObject() )
+	{
+		if( !componentIter.value.IsObject() )
+		{
+			continue;
+		}
+		const ae::Type* type = ae::GetTypeByName( componentIter.name.GetString() );
+		if( !type )
+		{
+			continue;
+		}
+		// Skip components removed by the game while a level is streamed in
+		if( ae::Component* component = registry->TryGetComponent( entity, type ) )
 		{
-			if( !componentIter.value.IsObject() )
-			{
-				continue;
-			}
-			const ae::Type* type = ae::GetTypeByName( componentIter.name.GetString() );
-			if( !type )
-			{
-				continue;
-			}
-			ae::Component* component = &registry->GetComponent( entity, type );
 			ae::JsonToComponent( transform, componentIter.value, component );
 		}
 	}
@@ -3237,6 +3630,149 @@ bool ValidateLevel( const rapidjson::Value& jsonLevel )
 	return true;
 }
 
+void VarChangesToBinary( const ae::Component* component, const ae::Var* const* vars, uint32_t varCount, ae::Array< uint8_t >* binary )
+{
+	ae::TypeId typeId = ae::GetObjectTypeId( component );
+	ae::Entity entity = component->GetEntity();
+	ae::BinaryWriter writer( binary );
+	writer.SerializeUint32( typeId );
+	writer.SerializeVarUint32( entity );
+	const uint32_t lengthOffset = writer.GetOffset();
+	ae::GetTypeById( typeId )->SerializeVars( &writer, component, vars, varCount );
+	// The length is inserted before the vars so the game can skip unknown components
+	uint8_t lengthData[ 5 ];
+	ae::BinaryWriter lengthWriter( lengthData, sizeof(lengthData) );
+	lengthWriter.SerializeVarUint32( writer.GetOffset() - lengthOffset );
+	binary->InsertArray( lengthOffset, lengthData, lengthWriter.GetOffset() );
+}
+
+void TransformToBinary( ae::Entity entity, const ae::Matrix4& transform, ae::Array< uint8_t >* binary )
+{
+	// Most edits only move entities, so the rest of the matrix is only sent
+	// when it's needed. No layout loses precision.
+	TransformLayout layout = TransformLayout::Translation;
+	if( transform.GetRow( 3 ) != ae::Vec4( 0.0f, 0.0f, 0.0f, 1.0f ) )
+	{
+		layout = TransformLayout::Matrix;
+	}
+	else if( transform.GetAxis( 0 ) != ae::Vec3( 1.0f, 0.0f, 0.0f )
+		|| transform.GetAxis( 1 ) != ae::Vec3( 0.0f, 1.0f, 0.0f )
+		|| transform.GetAxis( 2 ) != ae::Vec3( 0.0f, 0.0f, 1.0f ) )
+	{
+		layout = TransformLayout::Affine;
+	}
+	ae::BinaryWriter writer( binary );
+	writer.SerializeVarUint32( entity );
+	writer.SerializeEnum( layout );
+	switch( layout )
+	{
+		case TransformLayout::Translation:
+		{
+			const ae::Vec3 translation = transform.GetTranslation();
+			writer.SerializeArray( &translation, 1 );
+			break;
+		}
+		case TransformLayout::Affine:
+		{
+			const ae::Vec3 columns[] = { transform.GetAxis( 0 ), transform.GetAxis( 1 ), transform.GetAxis( 2 ), transform.GetTranslation() };
+			writer.SerializeArray( columns, countof(columns) );
+			break;
+		}
+		case TransformLayout::Matrix:
+			writer.SerializeArray( &transform, 1 );
+			break;
+	}
+}
+
+bool BinaryToVarChanges( ae::BinaryReader* reader, ae::Registry* registry )
+{
+	while( reader->IsValid() && reader->GetRemainingBytes() )
+	{
+		ae::TypeId typeId = ae::kInvalidTypeId;
+		ae::Entity entity = ae::kInvalidEntity;
+		uint32_t length = 0;
+		reader->SerializeUint32( typeId );
+		reader->SerializeVarUint32( entity );
+		reader->SerializeVarUint32( length );
+		if( !reader->IsValid() )
+		{
+			break;
+		}
+		const ae::Type* type = ae::GetTypeById( typeId );
+		ae::Component* component = type ? registry->TryGetComponent( entity, type ) : nullptr;
+		if( component )
+		{
+			const uint32_t end = reader->GetOffset() + length;
+			type->SerializeObject( reader, component );
+			if( reader->GetOffset() != end )
+			{
+				return false;
+			}
+		}
+		else
+		{
+			reader->DiscardReadData( length );
+		}
+	}
+	return reader->IsValid();
+}
+
+bool BinaryToTransforms( const ae::Tag& tag, ae::BinaryReader* reader, ae::Registry* registry )
+{
+	const uint32_t typeCount = registry->GetTypeCount();
+	ae::Array< EntityTransformVars > transformVars( tag, typeCount );
+	for( uint32_t i = 0; i < typeCount; i++ )
+	{
+		transformVars.Append( EntityTransformVars( registry->GetTypeByIndex( i ) ) );
+	}
+	while( reader->IsValid() && reader->GetRemainingBytes() )
+	{
+		ae::Entity entity = ae::kInvalidEntity;
+		TransformLayout layout = TransformLayout::Translation;
+		ae::Matrix4 transform = ae::Matrix4::Identity();
+		reader->SerializeVarUint32( entity );
+		reader->SerializeEnum( layout );
+		switch( layout )
+		{
+			case TransformLayout::Translation:
+			{
+				ae::Vec3 translation;
+				reader->SerializeArray( &translation, 1 );
+				transform.SetTranslation( translation );
+				break;
+			}
+			case TransformLayout::Affine:
+			{
+				ae::Vec3 columns[ 4 ];
+				reader->SerializeArray( columns, countof(columns) );
+				for( uint32_t i = 0; i < countof(columns); i++ )
+				{
+					transform.SetAxis( i, columns[ i ] );
+				}
+				break;
+			}
+			case TransformLayout::Matrix:
+				reader->SerializeArray( &transform, 1 );
+				break;
+			default:
+				reader->Invalidate();
+				break;
+		}
+		if( !reader->IsValid() )
+		{
+			break;
+		}
+		for( uint32_t i = 0; i < typeCount; i++ )
+		{
+			if( ae::Component* component = registry->TryGetComponent( entity, registry->GetTypeByIndex( i ) ) )
+			{
+				transformVars[ i ].Set( component, transform );
+			}
+		}
+	}
+	return reader->IsValid();
+}
+
 } // End ae namespace
 
 #if _AE_APPLE_
@@ -0,0 +1,372 @@
+//------------------------------------------------------------------------------
+// EditorLevel.cpp
+//------------------------------------------------------------------------------
+// Copyright (c) 2024 John Hughes
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include "EditorLevel.h"
+
+namespace ae {
+
+//------------------------------------------------------------------------------
+// Binary level helpers
+//------------------------------------------------------------------------------
+void GetComponentTypePrereqs( const ae::Type* type, ae::Array< const ae::Type* >* prereqs )
+{
+	AE_ASSERT( type );
+	prereqs->Clear();
+	auto fn = [&]( auto& fn, const ae::Type* t ) -> void
+	{
+		if( t->GetParentType() )
+		{
+			fn( fn, t->GetParentType() );
+		}
+		const int32_t propIdx = t->GetPropertyIndex( "ae_editor_dep" );
+		const uint32_t propCount = ( propIdx >= 0 ) ? t->GetPropertyValueCount( propIdx ) : 0;
+		for( uint32_t i = 0; i < propCount; i++ )
+		{
+			const ae::Type* prereq = ae::GetTypeByName( t->GetPropertyValue( propIdx, i ) );
+			if( type != prereq && prereqs->Find( prereq ) < 0 )
+			{
+				// @TODO: Handle missing types
+				if( prereq )
+				{
+					prereqs->Append( prereq );
+				}
+			}
+		}
+	};
+	fn( fn, type );
+}
+
+ae::Str256 GetBinaryLevelPath( const char* levelPath )
+{
+	return ae::Str256::Format( "#.bin", levelPath );
+}
+
+uint32_t GetTypeSchemaHash( const ae::Type* type )
+{
+	ae::Hash hash;
+	hash.HashString( type->GetName() );
+	const uint32_t varCount = type->GetVarCount( true );
+	for( uint32_t i = 0; i < varCount; i++ )
+	{
+		const ae::Var* var = type->GetVarByIndex( i, true );
+		hash.HashString( var->GetName() );
+		hash.HashBasicType( (uint32_t)var->GetType() );
+		hash.HashBasicType( var->IsArray() );
+		if( var->GetType() == ae::BasicType::Class )
+		{
+			hash.HashBasicType( GetTypeSchemaHash( var->GetSubType() ) );
+		}
+	}
+	return hash.Get();
+}
+
+void LevelHeaderToBinary( const ae::Registry* registry, uint32_t entityCount, const void* json, uint32_t jsonLength, ae::Array< uint8_t >* binary )
+{
+	ae::BinaryWriter writer( binary );
+	writer.SerializeUint32( kBinaryLevelMagic );
+	writer.SerializeUint32( kBinaryLevelVersion );
+	writer.SerializeUint32( jsonLength );
+	writer.SerializeUint32( ae::Hash().HashData( json, jsonLength ).Get() );
+	// Schema, components refer to these types by index
+	const uint32_t typeCount = registry->GetTypeCount();
+	writer.SerializeVarUint32( typeCount );
+	for( uint32_t i = 0; i < typeCount; i++ )
+	{
+		const ae::Type* type = registry->GetTypeByIndex( i );
+		writer.SerializeString( type->GetName() );
+		writer.SerializeUint32( GetTypeSchemaHash( type ) );
+	}
+	writer.SerializeVarUint32( entityCount );
+}
+
+void EntityToBinary( const ae::Registry* registry, ae::Entity entity, const ae::Matrix4& transform, ae::Array< uint8_t >* binary )
+{
+	const uint32_t typeCount = registry->GetTypeCount();
+	uint32_t componentCount = 0;
+	for( uint32_t i = 0; i < typeCount; i++ )
+	{
+		componentCount += registry->TryGetComponent( entity, registry->GetTypeByIndex( i ) ) ? 1 : 0;
+	}
+
+	ae::BinaryWriter writer( binary );
+	writer.SerializeVarUint32( entity );
+	writer.SerializeString( registry->GetNameByEntity( entity ) );
+	writer.SerializeArray( &transform, 1 );
+	writer.SerializeVarUint32( componentCount );
+	for( uint32_t i = 0; i < typeCount; i++ )
+	{
+		const ae::Type* type = registry->GetTypeByIndex( i );
+		if( const ae::Component* component = registry->TryGetComponent( entity, type ) )
+		{
+			writer.SerializeVarUint32( i );
+			// Fixed size length so it can be written after the component, which
+			// allows components to be skipped without deserializing them
+			const uint32_t lengthOffset = writer.GetOffset();
+			writer.SerializeUint32( 0u );
+			type->SerializeObject( &writer, component );
+			const uint32_t componentLength = writer.GetOffset() - lengthOffset - sizeof( uint32_t );
+			ae::BinaryWriter( binary->Data() + lengthOffset, sizeof( uint32_t ) ).SerializeUint32( componentLength );
+		}
+	}
+}
+
+BinaryLevelReader::BinaryLevelReader( const ae::Tag& tag, const uint8_t* data, uint32_t length ) :
+	m_reader( data, length ),
+	m_componentReader( data, length ),
+	m_types( tag ),
+	m_prereqs( tag ),
+	m_prereqStart( tag ),
+	m_transformVars( tag ),
+	m_entities( tag )
+{}
+
+bool BinaryLevelReader::Validate( const void* json, uint32_t jsonLength )
+{
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t levelJsonLength = 0;
+	uint32_t levelJsonHash = 0;
+	m_reader.SerializeUint32( magic );
+	m_reader.SerializeUint32( version );
+	m_reader.SerializeUint32( levelJsonLength );
+	m_reader.SerializeUint32( levelJsonHash );
+	if( !m_reader.IsValid() || magic != kBinaryLevelMagic || version != kBinaryLevelVersion )
+	{
+		return false;
+	}
+	// Length is checked first to avoid hashing the json level when possible
+	if( levelJsonLength != jsonLength || levelJsonHash != ae::Hash().HashData( json, jsonLength ).Get() )
+	{
+		AE_INFO( "Json level has been modified since the binary level was saved" );
+		return false;
+	}
+
+	uint32_t typeCount = 0;
+	m_reader.SerializeVarUint32( typeCount );
+	m_types.Clear();
+	for( uint32_t i = 0; i < typeCount && m_reader.IsValid(); i++ )
+	{
+		ae::Str128 typeName;
+		uint32_t schemaHash = 0;
+		m_reader.SerializeString( typeName );
+		m_reader.SerializeUint32( schemaHash );
+		const ae::Type* type = ae::GetTypeByName( typeName.c_str() );
+		if( !type )
+		{
+			AE_INFO( "Binary level type '#' not found", typeName );
+			return false;
+		}
+		if( GetTypeSchemaHash( type ) != schemaHash )
+		{
+			AE_INFO( "Binary level type '#' vars have changed", typeName );
+			return false;
+		}
+		m_types.Append( type );
+	}
+	m_reader.SerializeVarUint32( m_entityCount );
+	if( !m_reader.IsValid() )
+	{
+		return false;
+	}
+	// Components are serialized in a second pass
+	m_componentReader.DiscardReadData( m_reader.GetOffset() );
+
+	ae::Array< const ae::Type* > prereqs = m_prereqs.Tag();
+	for( const ae::Type* type : m_types )
+	{
+		GetComponentTypePrereqs( type, &prereqs );
+		m_prereqStart.Append( m_prereqs.Length() );
+		m_prereqs.AppendArray( prereqs.Data(), prereqs.Length() );
+		m_transformVars.Append( EntityTransformVars( type ) );
+	}
+	m_prereqStart.Append( m_prereqs.Length() );
+	return true;
+}
+
+bool BinaryLevelReader::CreateEntity( ae::Registry* registry )
+{
+	ae::Entity levelEntity = ae::kInvalidEntity;
+	ae::Str16 entityName;
+	ae::Matrix4 transform;
+	uint32_t componentCount = 0;
+	m_reader.SerializeVarUint32( levelEntity );
+	m_reader.SerializeString( entityName );
+	m_reader.SerializeArray( &transform, 1 );
+	m_reader.SerializeVarUint32( componentCount );
+	if( !m_reader.IsValid() )
+	{
+		return false;
+	}
+	const ae::Entity entity = registry->CreateEntity( levelEntity, entityName.c_str() );
+	for( uint32_t i = 0; i < componentCount; i++ )
+	{
+		uint32_t typeIndex = 0;
+		uint32_t componentLength = 0;
+		m_reader.SerializeVarUint32( typeIndex );
+		m_reader.SerializeUint32( componentLength );
+		m_reader.DiscardReadData( componentLength );
+		if( !m_reader.IsValid() || typeIndex >= m_types.Length() )
+		{
+			return false;
+		}
+		for( uint32_t j = m_prereqStart[ typeIndex ]; j < m_prereqStart[ typeIndex + 1 ]; j++ )
+		{
+			registry->AddComponent( entity, m_prereqs[ j ] );
+		}
+		registry->AddComponent( entity, m_types[ typeIndex ] );
+	}
+	m_entities.Append( entity );
+	return true;
+}
+
+bool BinaryLevelReader::SerializeEntity( ae::Registry* registry )
+{
+	ae::Entity levelEntity = ae::kInvalidEntity;
+	ae::Str16 entityName;
+	ae::Matrix4 transform;
+	uint32_t componentCount = 0;
+	m_componentReader.SerializeVarUint32( levelEntity );
+	m_componentReader.SerializeString( entityName );
+	m_componentReader.SerializeArray( &transform, 1 );
+	m_componentReader.SerializeVarUint32( componentCount );
+	if( !m_componentReader.IsValid() || m_entityIndex >= m_entities.Length() )
+	{
+		return false;
+	}
+	const ae::Entity entity = m_entities[ m_entityIndex++ ];
+	for( uint32_t i = 0; i < componentCount; i++ )
+	{
+		uint32_t typeIndex = 0;
+		uint32_t componentLength = 0;
+		m_componentReader.SerializeVarUint32( typeIndex );
+		m_componentReader.SerializeUint32( componentLength );
+		const uint32_t componentEnd = m_componentReader.GetOffset() + componentLength;
+		if( !m_componentReader.IsValid() || typeIndex >= m_types.Length() )
+		{
+			return false;
+		}
+		ae::Component* component = registry->TryGetComponent( entity, m_types[ typeIndex ] );
+		if( !component )
+		{
+			// Removed by the game since it was created
+			m_componentReader.DiscardReadData( componentLength );
+			continue;
+		}
+		m_types[ typeIndex ]->SerializeObject( &m_componentReader, component );
+		if( !m_componentReader.IsValid() || m_componentReader.GetOffset() != componentEnd )
+		{
+			return false;
+		}
+		m_transformVars[ typeIndex ].Set( component, transform );
+	}
+	return m_componentReader.IsValid();
+}
+
+EntityTransformVars::EntityTransformVars( const ae::Type* type )
+{
+	transform = type->GetVarByName( "transform", true );
+	position = type->GetVarByName( "position", true );
+	scale = type->GetVarByName( "scale", true );
+	transform = ( transform && !transform->IsArray() && transform->GetType() == ae::BasicType::Matrix4 ) ? transform : nullptr;
+	position = ( position && !position->IsArray() && position->GetType() == ae::BasicType::Vec3 ) ? position : nullptr;
+	scale = ( scale && !scale->IsArray() && scale->GetType() == ae::BasicType::Vec3 ) ? scale : nullptr;
+}
+
+void EntityTransformVars::Set( ae::Component* component, const ae::Matrix4& entityTransform ) const
+{
+	if( transform )
+	{
+		transform->SetObjectValue( component, entityTransform );
+	}
+	if( position )
+	{
+		position->SetObjectValue( component, entityTransform.GetTranslation() );
+	}
+	if( scale )
+	{
+		scale->SetObjectValue( component, entityTransform.GetScale() );
+	}
+}
+
+} // End ae namespace
+
+//------------------------------------------------------------------------------
+// EditorFileMapping member functions
+//------------------------------------------------------------------------------
+#if _AE_WINDOWS_
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+#if _AE_APPLE_ || _AE_LINUX_
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ae {
+
+bool EditorFileMapping::Open( const char* filePath )
+{
+	Close();
+#if _AE_APPLE_ || _AE_LINUX_
+	const int fd = open( filePath, O_RDONLY );
+	if( fd < 0 )
+	{
+		return false;
+	}
+	struct stat fileStat;
+	if( fstat( fd, &fileStat ) == 0 && fileStat.st_size > 0 && fileStat.st_size <= UINT32_MAX )
+	{
+		void* data = mmap( nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( data != MAP_FAILED )
+		{
+			m_data = (const uint8_t*)data;
+			m_length = (uint32_t)fileStat.st_size;
+		}
+	}
+	// The mapping remains valid after the file is closed
+	close( fd );
+#elif _AE_WINDOWS_
+	HANDLE file = CreateFileA( filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if( file == INVALID_HANDLE_VALUE )
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart > 0 && fileSize.QuadPart <= UINT32_MAX )
+	{
+		HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		if( mapping )
+		{
+			m_data = (const uint8_t*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+			m_length = m_data ? (uint32_t)fileSize.QuadPart : 0;
+			// The view remains valid after the handles are closed
+			CloseHandle( mapping );
+		}
+	}
+	CloseHandle( file );
+#endif
+	return m_data != nullptr;
+}
+
+void EditorFileMapping::Close()
+{
+	if( !m_data )
+	{
+		return;
+	}
+#if _AE_APPLE_ || _AE_LINUX_
+	munmap( (void*)m_data, m_length );
+#elif _AE_WINDOWS_
+	UnmapViewOfFile( m_data );
+#endif
+	m_data = nullptr;
+	m_length = 0;
+}
+
+} // End ae namespace
@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// EditorLevel.h
+//------------------------------------------------------------------------------
+// Copyright (c) 2024 John Hughes
+//------------------------------------------------------------------------------
+// Binary level reading and writing shared by Editor.cpp and the unit tests.
+// Unlike Editor.cpp this doesn't depend on rapidjson or ImGui.
+//------------------------------------------------------------------------------
+#ifndef EDITORLEVEL_H
+#define EDITORLEVEL_H
+
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include "ae/Entity.h"
+
+namespace ae {
+
+//! Sets \p prereqs to the types that must be added to an entity before
+//! \p type, from the 'ae_editor_dep' properties of it and its parents
+void GetComponentTypePrereqs( const ae::Type* type, ae::Array< const ae::Type* >* prereqs );
+
+//------------------------------------------------------------------------------
+// Binary level helpers
+//------------------------------------------------------------------------------
+// The editor writes a binary copy of each level next to the json level file,
+// which ae::Editor loads instead of the json level when it's up to date. The
+// binary level starts with a header containing the size and a hash of the
+// contents of the json level and a schema of each component type, followed by
+// every entity and its components serialized with ae::Type::SerializeObject().
+// The json level is loaded instead if the json level has been modified or if
+// any registered component type no longer matches the schema.
+const uint32_t kBinaryLevelMagic = 0x424C4541; // 'AELB'
+const uint32_t kBinaryLevelVersion = 3;
+ae::Str256 GetBinaryLevelPath( const char* levelPath );
+uint32_t GetTypeSchemaHash( const ae::Type* type );
+void LevelHeaderToBinary( const ae::Registry* registry, uint32_t entityCount, const void* json, uint32_t jsonLength, ae::Array< uint8_t >* binary );
+void EntityToBinary( const ae::Registry* registry, ae::Entity entity, const ae::Matrix4& transform, ae::Array< uint8_t >* binary );
+
+//------------------------------------------------------------------------------
+// EntityTransformVars struct
+//------------------------------------------------------------------------------
+//! Vars of a component type that are set from the entity transform, see
+//! JsonToComponent()
+struct EntityTransformVars
+{
+	EntityTransformVars() = default;
+	EntityTransformVars( const ae::Type* type );
+	//! Returns true if \p var is set by Set()
+	bool Contains( const ae::Var* var ) const { return var && ( var == transform || var == position || var == scale ); }
+	void Set( ae::Component* component, const ae::Matrix4& entityTransform ) const;
+	const ae::Var* transform = nullptr;
+	const ae::Var* position = nullptr;
+	const ae::Var* scale = nullptr;
+};
+
+//------------------------------------------------------------------------------
+// BinaryLevelReader class
+//------------------------------------------------------------------------------
+//! Reads a binary level written with LevelHeaderToBinary() and
+//! EntityToBinary() one entity at a time. All entities must be created before
+//! their components are serialized (to handle references).
+class BinaryLevelReader
+{
+public:
+	BinaryLevelReader( const ae::Tag& tag, const uint8_t* data, uint32_t length );
+	//! Reads the header and schema. Returns false if the level was saved with
+	//! a json level with different contents than \p json or if any of the
+	//! component types no longer match the registered types.
+	bool Validate( const void* json, uint32_t jsonLength );
+	//! Creates the next entity and its components. Returns false on error.
+	bool CreateEntity( ae::Registry* registry );
+	//! Serializes the components of the next entity. Components that have been
+	//! removed since CreateEntity() are skipped. Returns false on error.
+	bool SerializeEntity( ae::Registry* registry );
+	uint32_t GetEntityCount() const { return m_entityCount; }
+	//! Entities created so far by CreateEntity()
+	const ae::Array< ae::Entity >& GetEntities() const { return m_entities; }
+	
+private:
+	ae::BinaryReader m_reader;
+	ae::BinaryReader m_componentReader;
+	uint32_t m_entityCount = 0;
+	ae::Array< const ae::Type* > m_types;
+	// Prereqs of m_types[ i ] are m_prereqs[ m_prereqStart[ i ] ] to m_prereqs[ m_prereqStart[ i + 1 ] - 1 ]
+	ae::Array< const ae::Type* > m_prereqs;
+	ae::Array< uint32_t > m_prereqStart;
+	ae::Array< EntityTransformVars > m_transformVars;
+	// Created entities in the order they are serialized. Components are looked
+	// up again when serialized since the game may remove them in between.
+	ae::Array< ae::Entity > m_entities;
+	uint32_t m_entityIndex = 0;
+};
+
+//------------------------------------------------------------------------------
+// EditorFileMapping class
+//------------------------------------------------------------------------------
+//! Read only memory mapped view of a file. Open() always fails with emscripten.
+class EditorFileMapping
+{
+public:
+	~EditorFileMapping() { Close(); }
+	bool Open( const char* filePath );
+	void Close();
+	const uint8_t* GetData() const { return m_data; }
+	uint32_t GetLength() const { return m_length; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	uint32_t m_length = 0;
+};
+
+} // End ae namespace
+
+#endif
@@ -59,13 +59,19 @@ Registry::Registry( const ae::Tag& tag ) :
 
 Registry::~Registry()
 {
-	bool error = false;
 	for( const auto& componentMap : m_components )
 	{
-		if( componentMap.value.Length() )
+		const ComponentStorage* components = componentMap.value;
+		if( components->Length() )
 		{
 			AE_ERR( "Component type '#' not properly cleaned up", ae::GetTypeById( componentMap.key )->GetName() );
+			// Storage only releases component memory
+			for( uint32_t i = 0; i < components->Length(); i++ )
+			{
+				components->GetComponent( i )->~Component();
+			}
 		}
+		ae::Delete( componentMap.value );
 	}
 }
 
@@ -81,11 +87,16 @@ void Registry::SetOnDestroyFn( void* userData, void(*fn)(void*, Component*) )
 	m_onDestroyUserData = userData;
 }
 
+void Registry::SetComponentPoolPageSize( uint32_t pageSize )
+{
+	AE_ASSERT_MSG( !m_components.Length(), "Component pool page size must be set before any components are added" );
+	m_componentPoolPageSize = pageSize;
+}
+
 Entity Registry::CreateEntity( const char* name )
 {
 	AE_ASSERT_MSG( !m_destroying, "Cannot create an entity while destroying" );
-	m_lastEntity++;
-	Entity entity = m_lastEntity;
+	Entity entity = ++m_lastEntity;
 	
 	if ( name && name[ 0 ] )
 	{
@@ -128,6 +139,7 @@ Component* Registry::AddComponent( Entity entity, const char* typeName )
 Component* Registry::AddComponent( Entity entity, const ae::Type* type )
 {
 	AE_ASSERT_MSG( !m_destroying, "Cannot add a component while destroying" );
+	AE_ASSERT_MSG( !m_queryDepth, "Cannot add a component during a query, use an ae::RegistryCommandBuffer instead" );
 	if( !type )
 	{
 		return nullptr;
@@ -140,18 +152,18 @@ Component* Registry::AddComponent( Entity entity, const ae::Type* type )
 		return nullptr;
 	}
 
-	ae::Component* component = (ae::Component*)ae::Allocate( m_tag, type->GetSize(), type->GetAlignment() );
+	ComponentStorage* components = m_components.Get( type->GetId(), nullptr );
+	if( !components )
+	{
+		components = ae::New< ComponentStorage >( m_tag, m_tag, type, m_componentPoolPageSize );
+		m_components.Set( type->GetId(), components );
+	}
+	ae::Component* component = components->Allocate();
 	AE_ASSERT( component );
 	type->New( component );
 	component->m_entity = entity;
 	component->m_reg = this;
-	
-	ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() );
-	if( !components )
-	{
-		components = &m_components.Set( type->GetId(), m_tag );
-	}
-	components->Set( entity, component );
+	components->Add( entity, component );
 	
 	if( m_onCreateFn )
 	{
@@ -208,9 +220,9 @@ const Component* Registry::TryGetComponent( Entity entity, const ae::Type* type
 		return nullptr;
 	}
 	
-	if ( const ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() ) )
+	if ( const ComponentStorage* components = m_components.Get( type->GetId(), nullptr ) )
 	{
-		return components->Get( entity, nullptr );
+		return components->TryGet( entity );
 	}
 	
 	return nullptr;
@@ -299,31 +311,32 @@ uint32_t Registry::GetComponentCountByIndex( int32_t typeIndex ) const
 	{
 		return 0;
 	}
-	return m_components.GetValue( typeIndex ).Length();
+	return m_components.GetValue( typeIndex )->Length();
 }
 
 const Component& Registry::GetComponentByIndex( int32_t typeIndex, uint32_t componentIndex ) const
 {
 	AE_ASSERT( typeIndex >= 0 && typeIndex < m_components.Length() );
-	return *m_components.GetValue( typeIndex ).GetValue( componentIndex );
+	return *m_components.GetValue( typeIndex )->GetComponent( componentIndex );
 }
 
 Component& Registry::GetComponentByIndex( int32_t typeIndex, uint32_t componentIndex )
 {
 	AE_ASSERT( typeIndex >= 0 && typeIndex < m_components.Length() );
-	return *m_components.GetValue( typeIndex ).GetValue( componentIndex );
+	return *m_components.GetValue( typeIndex )->GetComponent( componentIndex );
 }
 
 void Registry::Destroy( Entity entity )
 {
 	AE_ASSERT_MSG( !m_destroying, "Recursive destruction of objects or components is not supported" );
+	AE_ASSERT_MSG( !m_queryDepth, "Cannot destroy an entity during a query, use an ae::RegistryCommandBuffer instead" );
 	m_destroying = true;
 
 	// Get components each loop because m_components could grow at any iteration
 	for ( uint32_t i = 0; i < m_components.Length(); i++ )
 	{
 		Component* c;
-		ae::Map< Entity, Component* >* components = &m_components.GetValue( i );
+		ComponentStorage* components = m_components.GetValue( i );
 		if ( components->Remove( entity, &c ) )
 		{
 			if( m_onDestroyFn )
@@ -331,7 +344,7 @@ void Registry::Destroy( Entity entity )
 				m_onDestroyFn( m_onDestroyUserData, c );
 			}
 			c->~Component();
-			ae::Free( c );
+			components->Free( c );
 		}
 	}
 	const char* name = GetNameByEntity( entity );
@@ -348,15 +361,17 @@ void Registry::DestroyComponent( Component* component )
 	if( component )
 	{
 		AE_ASSERT_MSG( !m_destroying, "Recursive destruction of objects or components is not supported" );
+		AE_ASSERT_MSG( !m_queryDepth, "Cannot destroy a component during a query, use an ae::RegistryCommandBuffer instead" );
 		m_destroying = true;
 
 		const ae::TypeId typeId = ae::GetObjectTypeId( component );
 		const ae::Entity entity = component->GetEntity();
-		const bool removeSuccess = m_components.Get( typeId ).Remove( entity );
+		ComponentStorage* components = m_components.Get( typeId );
+		const bool removeSuccess = components->Remove( entity, nullptr );
 		AE_ASSERT( removeSuccess );
 
 		component->~Component();
-		ae::Free( component );
+		components->Free( component );
 
 		m_destroying = false;
 	}
@@ -365,18 +380,23 @@ void Registry::DestroyComponent( Component* component )
 void Registry::Clear()
 {
 	AE_ASSERT_MSG( !m_destroying, "Recursive destruction of objects or components is not supported" );
+	AE_ASSERT_MSG( !m_queryDepth, "Cannot clear the registry during a query" );
 	m_destroying = true;
 
 	// Get components each loop because m_components could grow at any iteration
 	for ( uint32_t i = 0; i < m_components.Length(); i++ )
 	{
-		for ( uint32_t j = 0; j < m_components.GetValue( i ).Length(); j++ )
+		const ComponentStorage* components = m_components.GetValue( i );
+		for ( uint32_t j = 0; j < components->Length(); j++ )
 		{
-			Component* c = m_components.GetValue( i ).GetValue( j );
-			c->~Component();
-			ae::Free( c );
+			components->GetComponent( j )->~Component();
 		}
 	}
+	// Component memory is released with its storage
+	for ( uint32_t i = 0; i < m_components.Length(); i++ )
+	{
+		ae::Delete( m_components.GetValue( i ) );
+	}
 	m_components.Clear();
 	m_lastEntity = kInvalidEntity;
 	m_entityNames.Clear();
@@ -384,4 +404,223 @@ void Registry::Clear()
 	m_destroying = false;
 }
 
+//------------------------------------------------------------------------------
+// RegistryCommandBuffer member functions
+//------------------------------------------------------------------------------
+RegistryCommandBuffer::RegistryCommandBuffer( Registry* registry ) :
+	m_registry( registry ),
+	m_commands( registry->m_tag )
+{
+	AE_ASSERT( registry );
+}
+
+RegistryCommandBuffer::~RegistryCommandBuffer()
+{
+	AE_ASSERT_MSG( !m_commands.Length(), "# registry commands were never applied", m_commands.Length() );
+}
+
+Entity RegistryCommandBuffer::CreateEntity( const char* name )
+{
+	const Entity entity = ++m_registry->m_lastEntity;
+	if ( name && name[ 0 ] )
+	{
+		m_Add( { CommandType::CreateEntity, entity, nullptr, name, nullptr } );
+	}
+	return entity;
+}
+
+void RegistryCommandBuffer::Destroy( Entity entity )
+{
+	m_Add( { CommandType::Destroy, entity, nullptr, "", nullptr } );
+}
+
+void RegistryCommandBuffer::AddComponent( Entity entity, const ae::Type* type, std::function< void( Component* ) > initFn )
+{
+	AE_ASSERT( type );
+	m_Add( { CommandType::AddComponent, entity, type, "", std::move( initFn ) } );
+}
+
+void RegistryCommandBuffer::DestroyComponent( Entity entity, const ae::Type* type )
+{
+	AE_ASSERT( type );
+	m_Add( { CommandType::DestroyComponent, entity, type, "", nullptr } );
+}
+
+void RegistryCommandBuffer::Apply()
+{
+	AE_ASSERT_MSG( !m_registry->m_queryDepth, "Cannot apply registry commands during a query" );
+	ae::Array< Command > commands = m_registry->m_tag;
+	// Later commands for destroyed entities are skipped so they don't leave
+	// orphaned components or names behind
+	ae::Map< Entity, bool > destroyed = m_registry->m_tag;
+	while ( true )
+	{
+		// Commands recorded while applying are handled by the next loop
+		{
+			std::lock_guard< std::mutex > lock( m_mutex );
+			if ( !m_commands.Length() )
+			{
+				break;
+			}
+			std::swap( commands, m_commands );
+		}
+		for ( Command& command : commands )
+		{
+			if ( destroyed.TryGet( command.entity ) )
+			{
+				continue;
+			}
+			switch ( command.commandType )
+			{
+				case CommandType::CreateEntity:
+					AE_ASSERT_MSG( !m_registry->GetEntityByName( command.name.c_str() ), "Entity with name '#' already exists", command.name );
+					m_registry->SetEntityName( command.entity, command.name.c_str() );
+					break;
+				case CommandType::Destroy:
+					m_registry->Destroy( command.entity );
+					destroyed.Set( command.entity, true );
+					break;
+				case CommandType::AddComponent:
+					if ( Component* component = m_registry->AddComponent( command.entity, command.type ) )
+					{
+						if ( command.initFn )
+						{
+							command.initFn( component );
+						}
+					}
+					break;
+				case CommandType::DestroyComponent:
+					m_registry->DestroyComponent( m_registry->TryGetComponent( command.entity, command.type ) );
+					break;
+			}
+		}
+		commands.Clear();
+	}
+}
+
+uint32_t RegistryCommandBuffer::GetCommandCount() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+	return m_commands.Length();
+}
+
+void RegistryCommandBuffer::m_Add( Command&& command )
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+	m_commands.Append( std::move( command ) );
+}
+
+//------------------------------------------------------------------------------
+// Registry::ComponentStorage member functions
+//------------------------------------------------------------------------------
+Registry::ComponentStorage::ComponentStorage( const ae::Tag& tag, const ae::Type* type, uint32_t poolPageSize ) :
+	m_tag( tag ),
+	m_type( type ),
+	m_components( tag ),
+	m_entities( tag ),
+	m_sparse( tag )
+{
+	if ( poolPageSize )
+	{
+		m_pool = ae::New< ae::OpaquePool >( m_tag, m_tag, type->GetSize(), type->GetAlignment(), poolPageSize, true );
+	}
+}
+
+Registry::ComponentStorage::~ComponentStorage()
+{
+	// Components are destructed by the Registry, this only releases memory
+	if ( m_pool )
+	{
+		m_pool->FreeAll();
+		ae::Delete( m_pool );
+	}
+	else
+	{
+		for ( Component* c : m_components )
+		{
+			ae::Free( c );
+		}
+	}
+	for ( uint32_t* page : m_sparse )
+	{
+		ae::Free( page );
+	}
+}
+
+Component* Registry::ComponentStorage::Allocate()
+{
+	if ( m_pool )
+	{
+		return (Component*)m_pool->Allocate();
+	}
+	return (Component*)ae::Allocate( m_tag, m_type->GetSize(), m_type->GetAlignment() );
+}
+
+void Registry::ComponentStorage::Free( Component* component )
+{
+	if ( m_pool )
+	{
+		m_pool->Free( component );
+	}
+	else
+	{
+		ae::Free( component );
+	}
+}
+
+void Registry::ComponentStorage::Add( Entity entity, Component* component )
+{
+	AE_ASSERT( entity != kInvalidEntity );
+	AE_ASSERT( !TryGet( entity ) );
+	const uint32_t pageIndex = entity / kSparsePageSize;
+	while ( m_sparse.Length() <= pageIndex )
+	{
+		m_sparse.Append( nullptr );
+	}
+	uint32_t*& page = m_sparse[ pageIndex ];
+	if ( !page )
+	{
+		page = (uint32_t*)ae::Allocate( m_tag, kSparsePageSize * sizeof(uint32_t), alignof(uint32_t) );
+		memset( page, 0, kSparsePageSize * sizeof(uint32_t) );
+	}
+	m_components.Append( component );
+	m_entities.Append( entity );
+	page[ entity % kSparsePageSize ] = m_components.Length();
+}
+
+bool Registry::ComponentStorage::Remove( Entity entity, Component** componentOut )
+{
+	const uint32_t pageIndex = entity / kSparsePageSize;
+	uint32_t* page = ( pageIndex < m_sparse.Length() ) ? m_sparse[ pageIndex ] : nullptr;
+	if ( !page || !page[ entity % kSparsePageSize ] )
+	{
+		return false;
+	}
+	const uint32_t index = page[ entity % kSparsePageSize ] - 1;
+	page[ entity % kSparsePageSize ] = 0;
+	if ( componentOut )
+	{
+		*componentOut = m_components[ index ];
+	}
+	const uint32_t lastIndex = m_components.Length() - 1;
+	if ( index != lastIndex )
+	{
+		const Entity lastEntity = m_entities[ lastIndex ];
+		m_components[ index ] = m_components[ lastIndex ];
+		m_entities[ index ] = lastEntity;
+		m_sparse[ lastEntity / kSparsePageSize ][ lastEntity % kSparsePageSize ] = index + 1;
+	}
+	m_components.Remove( lastIndex );
+	m_entities.Remove( lastIndex );
+	return true;
+}
+
+Component* Registry::ComponentStorage::TryGet( Entity entity ) const
+{
+	const uint32_t pageIndex = entity / kSparsePageSize;
+	const uint32_t* page = ( pageIndex < m_sparse.Length() ) ? m_sparse[ pageIndex ] : nullptr;
+	const uint32_t index = page ? page[ entity % kSparsePageSize ] : 0;
+	return index ? m_components[ index - 1 ] : nullptr;
+}
+
 } // End ae namespace
@@ -421,7 +421,7 @@ void TerrainJob::Do()
     rStream.SerializeUint32( m_vertexCount.Get() );
     rStream.SerializeUint32( m_indexCount );
     rStream.SerializeRaw( &m_vertices[ 0 ], (uint32_t)m_vertexCount * sizeof(m_vertices[ 0 ]) );
-    rStream.SerializeRaw( &m_indices[ 0 ], m_indexCount * sizeof(m_indices[ 0 ]) );
+    rStream.SerializeArray( &m_indices[ 0 ], m_indexCount );
     rStream.SerializeObject( *m_chunk );
   }
   else
@@ -450,7 +450,7 @@ void TerrainJob::Do()
       wStream.SerializeUint32( m_vertexCount.Get() );
       wStream.SerializeUint32( m_indexCount );
       wStream.SerializeRaw( &m_vertices[ 0 ], (uint32_t)m_vertexCount * sizeof(m_vertices[ 0 ]) );
-      wStream.SerializeRaw( &m_indices[ 0 ], m_indexCount * sizeof(m_indices[ 0 ]) );
+      wStream.SerializeArray( &m_indices[ 0 ], m_indexCount );
       wStream.SerializeObject( *m_chunk );
       if ( !m_p.vfs->Write( ae::FileSystem::Root::Cache, filePath.c_str(), wStream.GetData(), wStream.GetOffset(), true ) )
       {
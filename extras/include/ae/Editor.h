@@ -104,6 +104,11 @@ struct EditorParams
 	//! paths. This field will be ignored if a level is specified on the command
 	//! line with '--level'.
 	ae::Str256 levelPath;
+	//! The maximum time in seconds that ae::Editor::Update() will spend
+	//! loading a level each frame. When non-zero, json levels are also parsed
+	//! on a background thread (except with emscripten). Zero loads a level in
+	//! a single frame as soon as the file has been read.
+	float levelLoadTimeBudget = 0.0f;
 };
 
 //------------------------------------------------------------------------------
@@ -120,7 +125,25 @@ public:
 	void Update();
 	void Launch();
 	bool IsConnected() const { return m_sock.IsConnected(); }
+	//! Loads the level at \p levelPath into the registry during later calls
+	//! to Update(). The binary level saved next to it by the editor
+	//! ('levelPath.bin') is memory mapped and loaded instead when it's up to
+	//! date with the level file and all registered component types.
 	void QueueRead( const char* levelPath );
+	//! Returns true from QueueRead() until the level has been completely
+	//! loaded, which can take multiple frames, see
+	//! ae::EditorParams::levelLoadTimeBudget. While loading, entities and
+	//! components of the level are created before any of their vars are set,
+	//! so they are visible in the registry with default values until loading
+	//! finishes. Components removed by the game during loading are skipped.
+	//! Calling QueueRead() while a level is loading cancels that load and
+	//! destroys the entities it had already created. Cancelling waits for the
+	//! level's json to finish parsing if it's being parsed in the background.
+	bool IsLoadingLevel() const;
+	//! Returns the fraction of the level being loaded that's been loaded so
+	//! far (0-1), or 0 if no level is loading. Progress restarts from 0 when a
+	//! load is cancelled by QueueRead().
+	float GetLevelLoadProgress() const;
 
 private:
 	friend class EditorServer;
@@ -132,6 +155,7 @@ private:
 	ae::Str256 m_lastLoadedLevel;
 	ae::FileSystem m_fileSystem;
 	const ae::File* m_pendingLevel = nullptr;
+	class EditorLevelLoader* m_levelLoader = nullptr;
 	ae::Socket m_sock;
 	uint8_t m_msgBuffer[ kMaxEditorMessageSize ];
 };
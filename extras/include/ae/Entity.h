@@ -45,6 +45,9 @@ private:
 	Entity m_entity = kInvalidEntity;
 };
 
+template < typename... Ts > class RegistryQuery;
+class RegistryCommandBuffer;
+
 //------------------------------------------------------------------------------
 // ae::Registry
 //------------------------------------------------------------------------------
@@ -55,6 +58,12 @@ public:
 	~Registry();
 	void SetOnCreateFn( void* userData, void(*fn)(void*, Component*) );
 	void SetOnDestroyFn( void* userData, void(*fn)(void*, Component*) );
+	//! By default each component is allocated individually. When \p pageSize
+	//! is non-zero, components of each type are instead packed contiguously in
+	//! an ae::OpaquePool with pages of \p pageSize components, which is much
+	//! faster to iterate with CallFn() etc. Components never move once added
+	//! in either mode. Must be called before any components are added.
+	void SetComponentPoolPageSize( uint32_t pageSize );
 	
 	// Creation
 	Entity CreateEntity( const char* name = "" );
@@ -109,6 +118,11 @@ public:
 	template < typename T, typename Fn > uint32_t CallFn( Fn fn ) const;
 	template < typename T, typename Fn > uint32_t CallFn( Entity entity, Fn fn );
 	template < typename T, typename Fn > uint32_t CallFn( Entity entity, Fn fn ) const;
+	//! Returns a query over all entities that have every one of the component
+	//! types Ts, eg. Query< const Transform, Velocity >().ForEach( fn ).
+	//! Unlike CallFn(), component types are matched exactly as with
+	//! TryGetComponent(), and not by inheritance.
+	template < typename... Ts > RegistryQuery< Ts... > Query();
 
 	// Removal
 	void Destroy( Entity entity );
@@ -116,10 +130,49 @@ public:
 	void Clear();
 
 private:
+	template < typename... Ts > friend class RegistryQuery;
+	friend class RegistryCommandBuffer;
+	//! All components of a single type. Components and their entities are
+	//! stored in dense parallel arrays, and entities are mapped to dense
+	//! indices with a sparse array. The sparse array is allocated in pages so
+	//! that large entity ids don't require large allocations.
+	class ComponentStorage
+	{
+	public:
+		ComponentStorage( const ae::Tag& tag, const ae::Type* type, uint32_t poolPageSize );
+		~ComponentStorage();
+		//! Returns memory for a new component of this type
+		Component* Allocate();
+		//! Releases memory returned by Allocate() after the component is destructed
+		void Free( Component* component );
+		void Add( Entity entity, Component* component );
+		//! Swaps the last component into the removed components index
+		bool Remove( Entity entity, Component** componentOut );
+		Component* TryGet( Entity entity ) const;
+		uint32_t Length() const { return m_components.Length(); }
+		Entity GetEntity( uint32_t index ) const { return m_entities[ index ]; }
+		Component* GetComponent( uint32_t index ) const { return m_components[ index ]; }
+	private:
+		ComponentStorage( const ComponentStorage& ) = delete;
+		void operator=( const ComponentStorage& ) = delete;
+		static const uint32_t kSparsePageSize = 1024;
+		const ae::Tag m_tag;
+		const ae::Type* m_type;
+		ae::OpaquePool* m_pool = nullptr;
+		ae::Array< Component* > m_components;
+		ae::Array< Entity > m_entities;
+		// Dense index + 1 for each entity, 0 if the entity has no component
+		ae::Array< uint32_t* > m_sparse;
+	};
 	const ae::Tag m_tag;
-	Entity m_lastEntity = kInvalidEntity;
+	// Atomic so ae::RegistryCommandBuffer can reserve entities from any thread
+	std::atomic< Entity > m_lastEntity = { kInvalidEntity };
+	uint32_t m_componentPoolPageSize = 0;
+	// Components can't be added or removed while queries are iterating
+	uint32_t m_queryDepth = 0;
 	ae::Map< ae::Str16, Entity > m_entityNames;
-	ae::Map< ae::TypeId, ae::Map< Entity, Component* > > m_components;
+	// Storage is allocated individually so it doesn't move while m_components grows
+	ae::Map< ae::TypeId, ComponentStorage* > m_components;
 	void(*m_onCreateFn)(void*, Component*) = nullptr;
 	void* m_onCreateUserData = nullptr;
 	void(*m_onDestroyFn)(void*, Component*) = nullptr;
@@ -127,6 +180,105 @@ private:
 	bool m_destroying = false;
 };
 
+//------------------------------------------------------------------------------
+// ae::RegistryQuery
+//------------------------------------------------------------------------------
+//! Iterates over all entities that have every one of the component types Ts.
+//! Created with ae::Registry::Query(). Component types declared const are
+//! only read by the query, and are passed to callbacks as const pointers.
+//! Components can't be added to or removed from the registry during
+//! iteration, use an ae::RegistryCommandBuffer to defer these changes.
+template < typename... Ts >
+class RegistryQuery
+{
+public:
+	//! Calls \p fn( ae::Entity, Ts*... ) for each matching entity and returns
+	//! the number of matches. Iteration is over the component type with the
+	//! fewest components, and the other types are looked up per entity.
+	template < typename Fn > uint32_t ForEach( Fn fn ) const;
+	//! Same as ForEach( Fn ), except that matches are split into batches of
+	//! \p batchSize and \p fn is called concurrently from all threads of
+	//! \p workerPool. Each entity is visited once, so \p fn may write to the
+	//! non-const components it is passed, but it must not modify anything
+	//! else that is shared without synchronization.
+	template < typename Fn > uint32_t ForEach( ae::WorkerPool* workerPool, uint32_t batchSize, Fn fn ) const;
+
+private:
+	friend class Registry;
+	static const uint32_t kCount = sizeof...(Ts);
+	RegistryQuery( Registry* registry );
+	template < typename Fn, size_t... Is >
+	static void m_Call( Fn& fn, Entity entity, Component* const* components, std::index_sequence< Is... > );
+	bool m_GetMatch( uint32_t index, Entity* entityOut, Component** componentsOut ) const;
+	Registry* m_registry;
+	const Registry::ComponentStorage* m_storage[ kCount ] = {};
+	int32_t m_smallest = -1;
+};
+
+//------------------------------------------------------------------------------
+// ae::RegistryCommandBuffer
+//------------------------------------------------------------------------------
+//! Records entity and component creation and destruction so that they can be
+//! applied to an ae::Registry later, all at once. This allows structural
+//! changes to be requested while iterating over a ae::RegistryQuery, including
+//! from ae::WorkerPool threads. All recording functions are thread safe.
+class RegistryCommandBuffer
+{
+public:
+	RegistryCommandBuffer( Registry* registry );
+	//! All commands must be applied before the buffer is destroyed
+	~RegistryCommandBuffer();
+
+	//! Returns a new entity immediately so that other commands can refer to it.
+	//! The entity is named when the buffer is applied.
+	Entity CreateEntity( const char* name = "" );
+	//! Destroys \p entity and all of its components when applied
+	void Destroy( Entity entity );
+	//! Adds a component of \p type to \p entity when applied. If \p initFn
+	//! is provided it's called with the new component after it's added. As with
+	//! ae::Registry::AddComponent(), nothing happens if the entity already has
+	//! a component of this type.
+	void AddComponent( Entity entity, const ae::Type* type, std::function< void( Component* ) > initFn = nullptr );
+	template < typename T > void AddComponent( Entity entity );
+	template < typename T, typename Fn > void AddComponent( Entity entity, Fn initFn );
+	//! Destroys the component of \p type attached to \p entity when applied,
+	//! if there is one
+	void DestroyComponent( Entity entity, const ae::Type* type );
+	template < typename T > void DestroyComponent( Entity entity );
+
+	//! Applies all commands in the order they were recorded. Commands
+	//! recorded while applying, eg. from ae::Registry::SetOnDestroyFn()
+	//! callbacks, are also applied. Commands for an entity that come after a
+	//! Destroy() of the same entity are skipped. Must not be called during
+	//! iteration or concurrently with any other registry functions.
+	void Apply();
+	//! Returns the number of commands waiting to be applied
+	uint32_t GetCommandCount() const;
+
+private:
+	RegistryCommandBuffer( const RegistryCommandBuffer& ) = delete;
+	void operator=( const RegistryCommandBuffer& ) = delete;
+	enum class CommandType
+	{
+		CreateEntity,
+		Destroy,
+		AddComponent,
+		DestroyComponent
+	};
+	struct Command
+	{
+		CommandType commandType;
+		Entity entity;
+		const ae::Type* type;
+		ae::Str16 name;
+		std::function< void( Component* ) > initFn;
+	};
+	void m_Add( Command&& command );
+	Registry* m_registry;
+	mutable std::mutex m_mutex;
+	ae::Array< Command > m_commands;
+};
+
 //------------------------------------------------------------------------------
 // ae::Component member functions
 //------------------------------------------------------------------------------
@@ -235,9 +387,9 @@ const T* Registry::TryGetComponent( Entity entity ) const
 	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
 	const ae::Type* type = ae::GetType< T >();
 	AE_ASSERT_MSG( type, "No registered type" );
-	if ( const ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() ) )
+	if ( const ComponentStorage* components = m_components.Get( type->GetId(), nullptr ) )
 	{
-		return static_cast< T* >( components->Get( entity, nullptr ) );
+		return static_cast< const T* >( components->TryGet( entity ) );
 	}
 	return nullptr;
 }
@@ -273,7 +425,7 @@ uint32_t Registry::GetComponentCount() const
 	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
 	const ae::Type* type = ae::GetType< T >();
 	AE_ASSERT_MSG( type, "No registered type" );
-	const ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() );
+	const ComponentStorage* components = m_components.Get( type->GetId(), nullptr );
 	return components ? components->Length() : 0;
 }
 
@@ -283,9 +435,9 @@ Entity Registry::GetEntityByIndex( uint32_t index )
 	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
 	const ae::Type* type = ae::GetType< T >();
 	AE_ASSERT_MSG( type, "No registered type" );
-	const ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() );
-	AE_ASSERT_MSG( "No components of type '#'", type->GetName() );
-	return components->GetKey( index );
+	const ComponentStorage* components = m_components.Get( type->GetId(), nullptr );
+	AE_ASSERT_MSG( components, "No components of type '#'", type->GetName() );
+	return components->GetEntity( index );
 }
 
 template < typename T >
@@ -300,9 +452,9 @@ const T& Registry::GetComponentByIndex( uint32_t index ) const
 	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
 	const ae::Type* type = ae::GetType< T >();
 	AE_ASSERT_MSG( type, "No registered type" );
-	const ae::Map< Entity, Component* >* components = m_components.TryGet( type->GetId() );
-	AE_ASSERT_MSG( "No components of type '#'", type->GetName() );
-	return *(const T*)components->GetValue( index );
+	const ComponentStorage* components = m_components.Get( type->GetId(), nullptr );
+	AE_ASSERT_MSG( components, "No components of type '#'", type->GetName() );
+	return *(const T*)components->GetComponent( index );
 }
 
 template < typename T >
@@ -321,10 +473,12 @@ uint32_t Registry::CallFn( Fn fn )
 		const ae::Type* componentType = ae::GetTypeById( m_components.GetKey( i ) );
 		if ( componentType->IsType( type ) )
 		{
-			// Get components each loop because m_components could grow at any iteration
-			for ( uint32_t j = 0; j < m_components.GetValue( i ).Length(); j++ )
+			// Storage doesn't move when m_components grows, but components
+			// could be added to it at any iteration
+			const ComponentStorage* components = m_components.GetValue( i );
+			for ( uint32_t j = 0; j < components->Length(); j++ )
 			{
-				fn( (T*)m_components.GetValue( i ).GetValue( j ) );
+				fn( (T*)components->GetComponent( j ) );
 				result++;
 			}
 		}
@@ -342,10 +496,12 @@ uint32_t Registry::CallFn( Fn fn ) const
 		const ae::Type* componentType = ae::GetTypeById( m_components.GetKey( i ) );
 		if ( componentType->IsType( type ) )
 		{
-			// Get components each loop because m_components could grow at any iteration
-			for ( uint32_t j = 0; j < m_components.GetValue( i ).Length(); j++ )
+			// Storage doesn't move when m_components grows, but components
+			// could be added to it at any iteration
+			const ComponentStorage* components = m_components.GetValue( i );
+			for ( uint32_t j = 0; j < components->Length(); j++ )
 			{
-				fn( (const T*)m_components.GetValue( i ).GetValue( j ) );
+				fn( (const T*)components->GetComponent( j ) );
 				result++;
 			}
 		}
@@ -359,8 +515,7 @@ uint32_t Registry::CallFn( Entity entity, Fn fn )
 	uint32_t result = 0;
 	for( uint32_t i = 0; i < m_components.Length(); i++ )
 	{
-		const ae::Map< Entity, Component* >* components = &m_components.GetValue( i );
-		if( Component* _c = components->Get( entity, nullptr ) )
+		if( Component* _c = m_components.GetValue( i )->TryGet( entity ) )
 		{
 			if( T* c = ae::Cast< T >( _c ) )
 			{
@@ -378,8 +533,7 @@ uint32_t Registry::CallFn( Entity entity, Fn fn ) const
 	uint32_t result = 0;
 	for( uint32_t i = 0; i < m_components.Length(); i++ )
 	{
-		const ae::Map< Entity, Component* >* components = &m_components.GetValue( i );
-		if( Component* _c = components->Get( entity, nullptr ) )
+		if( Component* _c = m_components.GetValue( i )->TryGet( entity ) )
 		{
 			if( const T* c = ae::Cast< T >( _c ) )
 			{
@@ -391,6 +545,153 @@ uint32_t Registry::CallFn( Entity entity, Fn fn ) const
 	return result;
 }
 
+template < typename... Ts >
+RegistryQuery< Ts... > Registry::Query()
+{
+	return RegistryQuery< Ts... >( this );
+}
+
+//------------------------------------------------------------------------------
+// ae::RegistryQuery member functions
+//------------------------------------------------------------------------------
+template < typename... Ts >
+RegistryQuery< Ts... >::RegistryQuery( Registry* registry ) :
+	m_registry( registry )
+{
+	AE_STATIC_ASSERT( sizeof...(Ts) > 0 );
+	AE_STATIC_ASSERT( (std::is_base_of< Component, Ts >::value && ...) );
+	const ae::Type* types[] = { ae::GetType< typename std::remove_const< Ts >::type >()... };
+	uint32_t smallestLength = 0;
+	for ( uint32_t i = 0; i < kCount; i++ )
+	{
+		AE_ASSERT_MSG( types[ i ], "No registered type" );
+		const Registry::ComponentStorage* storage = registry->m_components.Get( types[ i ]->GetId(), nullptr );
+		if ( !storage || !storage->Length() )
+		{
+			// No entity can match
+			m_smallest = -1;
+			return;
+		}
+		if ( m_smallest < 0 || storage->Length() < smallestLength )
+		{
+			m_smallest = i;
+			smallestLength = storage->Length();
+		}
+		m_storage[ i ] = storage;
+	}
+}
+
+template < typename... Ts >
+bool RegistryQuery< Ts... >::m_GetMatch( uint32_t index, Entity* entityOut, Component** componentsOut ) const
+{
+	const Registry::ComponentStorage* smallest = m_storage[ m_smallest ];
+	const Entity entity = smallest->GetEntity( index );
+	for ( uint32_t i = 0; i < kCount; i++ )
+	{
+		componentsOut[ i ] = ( (int32_t)i == m_smallest ) ? smallest->GetComponent( index ) : m_storage[ i ]->TryGet( entity );
+		if ( !componentsOut[ i ] )
+		{
+			return false;
+		}
+	}
+	*entityOut = entity;
+	return true;
+}
+
+template < typename... Ts >
+template < typename Fn, size_t... Is >
+void RegistryQuery< Ts... >::m_Call( Fn& fn, Entity entity, Component* const* components, std::index_sequence< Is... > )
+{
+	fn( entity, static_cast< Ts* >( components[ Is ] )... );
+}
+
+template < typename... Ts >
+template < typename Fn >
+uint32_t RegistryQuery< Ts... >::ForEach( Fn fn ) const
+{
+	if ( m_smallest < 0 )
+	{
+		return 0;
+	}
+	uint32_t result = 0;
+	const Registry::ComponentStorage* smallest = m_storage[ m_smallest ];
+	const uint32_t length = smallest->Length();
+	m_registry->m_queryDepth++;
+	for ( uint32_t i = 0; i < length; i++ )
+	{
+		Entity entity;
+		Component* components[ kCount ];
+		if ( m_GetMatch( i, &entity, components ) )
+		{
+			m_Call( fn, entity, components, std::index_sequence_for< Ts... >() );
+			result++;
+		}
+	}
+	m_registry->m_queryDepth--;
+	return result;
+}
+
+template < typename... Ts >
+template < typename Fn >
+uint32_t RegistryQuery< Ts... >::ForEach( ae::WorkerPool* workerPool, uint32_t batchSize, Fn fn ) const
+{
+	if ( m_smallest < 0 )
+	{
+		return 0;
+	}
+	AE_ASSERT( workerPool );
+	// Collect matches up front so they can be split evenly between threads
+	struct Match
+	{
+		Entity entity;
+		Component* components[ kCount ];
+	};
+	const Registry::ComponentStorage* smallest = m_storage[ m_smallest ];
+	ae::Array< Match > matches( m_registry->m_tag, smallest->Length() );
+	for ( uint32_t i = 0; i < smallest->Length(); i++ )
+	{
+		Match match;
+		if ( m_GetMatch( i, &match.entity, match.components ) )
+		{
+			matches.Append( match );
+		}
+	}
+	m_registry->m_queryDepth++;
+	workerPool->Run( matches.Length(), batchSize, [ &matches, &fn ]( uint32_t begin, uint32_t end )
+	{
+		for ( uint32_t i = begin; i < end; i++ )
+		{
+			m_Call( fn, matches[ i ].entity, matches[ i ].components, std::index_sequence_for< Ts... >() );
+		}
+	} );
+	m_registry->m_queryDepth--;
+	return matches.Length();
+}
+
+//------------------------------------------------------------------------------
+// ae::RegistryCommandBuffer member functions
+//------------------------------------------------------------------------------
+template < typename T >
+void RegistryCommandBuffer::AddComponent( Entity entity )
+{
+	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
+	AddComponent( entity, ae::GetType< T >() );
+}
+
+template < typename T, typename Fn >
+void RegistryCommandBuffer::AddComponent( Entity entity, Fn initFn )
+{
+	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
+	AddComponent( entity, ae::GetType< T >(), [ initFn ]( Component* c ) mutable { initFn( static_cast< T* >( c ) ); } );
+}
+
+template < typename T >
+void RegistryCommandBuffer::DestroyComponent( Entity entity )
+{
+	AE_STATIC_ASSERT( (std::is_base_of< Component, T >::value) );
+	DestroyComponent( entity, ae::GetType< T >() );
+}
+
 } // End ae namespace
 
 #endif
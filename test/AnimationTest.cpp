@@ -0,0 +1,737 @@
+//------------------------------------------------------------------------------
+// AnimationTest.cpp
+//------------------------------------------------------------------------------
+// Copyright (c) 2024 John Hughes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include "aether.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//------------------------------------------------------------------------------
+// Animation test helpers
+//------------------------------------------------------------------------------
+const ae::Tag TAG_ANIMATION_TEST = "animation_test";
+
+static bool AnimationTest_IsClose( const ae::Matrix4& m0, const ae::Matrix4& m1, float epsilon = 0.0001f )
+{
+	for ( uint32_t i = 0; i < 16; i++ )
+	{
+		if ( std::abs( m0.data[ i ] - m1.data[ i ] ) > epsilon )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool AnimationTest_IsClose( const ae::Skeleton& s0, const ae::Skeleton& s1, float epsilon = 0.0001f )
+{
+	if ( s0.GetBoneCount() != s1.GetBoneCount() )
+	{
+		return false;
+	}
+	for ( uint32_t i = 0; i < s0.GetBoneCount(); i++ )
+	{
+		if ( !AnimationTest_IsClose( s0.GetBoneByIndex( i )->transform, s1.GetBoneByIndex( i )->transform, epsilon ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// root -> hips -> spine -> neck, spine -> arm -> hand
+static void AnimationTest_BuildSkeleton( ae::Skeleton* skeleton )
+{
+	skeleton->Initialize( 8 );
+	const ae::Bone* hips = skeleton->AddBone( skeleton->GetRoot(), "hips", ae::Matrix4::Translation( 0.0f, 1.0f, 0.0f ) );
+	const ae::Bone* spine = skeleton->AddBone( hips, "spine", ae::Matrix4::Translation( 0.0f, 0.5f, 0.0f ) );
+	skeleton->AddBone( spine, "neck", ae::Matrix4::Translation( 0.0f, 0.5f, 0.0f ) );
+	const ae::Bone* arm = skeleton->AddBone( spine, "arm", ae::Matrix4::Translation( 0.5f, 0.25f, 0.0f ) );
+	skeleton->AddBone( arm, "hand", ae::Matrix4::Translation( 0.5f, 0.0f, 0.0f ) );
+}
+
+static void AnimationTest_BuildAnimation( const ae::Skeleton& skeleton, float angle, ae::Animation* animation )
+{
+	animation->duration = 1.0f;
+	animation->loop = true;
+	for ( uint32_t i = 0; i < skeleton.GetBoneCount(); i++ )
+	{
+		const ae::Bone* bone = skeleton.GetBoneByIndex( i );
+		ae::Array< ae::Keyframe >& track = animation->keyframes.Set( bone->name, ae::Array< ae::Keyframe >( TAG_ANIMATION_TEST ) );
+		for ( uint32_t f = 0; f < 4; f++ )
+		{
+			ae::Keyframe keyframe( bone->localTransform );
+			keyframe.rotation = ae::Quaternion( ae::Vec3( 0.0f, 0.0f, 1.0f ), angle * f );
+			keyframe.scale = ae::Vec3( 1.0f + f * 0.1f );
+			track.Append( keyframe );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::PoseBuffer tests
+//------------------------------------------------------------------------------
+TEST_CASE( "PoseBuffer initializes from skeleton local transforms", "[ae::PoseBuffer]" )
+{
+	ae::Skeleton skeleton = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &skeleton );
+	ae::PoseBuffer pose = TAG_ANIMATION_TEST;
+	pose.Initialize( &skeleton );
+	REQUIRE( pose.GetBoneCount() == skeleton.GetBoneCount() );
+	
+	ae::Skeleton result = TAG_ANIMATION_TEST;
+	result.Initialize( &skeleton );
+	result.SetLocalPose( pose );
+	REQUIRE( AnimationTest_IsClose( result, skeleton ) );
+}
+
+TEST_CASE( "PoseBuffer blending", "[ae::PoseBuffer]" )
+{
+	ae::PoseBuffer pose0 = TAG_ANIMATION_TEST;
+	ae::PoseBuffer pose1 = TAG_ANIMATION_TEST;
+	ae::PoseBuffer result = TAG_ANIMATION_TEST;
+	pose0.Initialize( 2u );
+	pose1.Initialize( 2u );
+	pose1.translations[ 0 ] = ae::Vec3( 2.0f, 0.0f, 0.0f );
+	pose1.translations[ 1 ] = ae::Vec3( 0.0f, 4.0f, 0.0f );
+	pose1.scales[ 1 ] = ae::Vec3( 3.0f );
+
+	SECTION( "lerp" )
+	{
+		ae::PoseBuffer::Lerp( pose0, pose1, 0.5f, &result );
+		REQUIRE( result.translations[ 0 ] == ae::Vec3( 1.0f, 0.0f, 0.0f ) );
+		REQUIRE( result.translations[ 1 ] == ae::Vec3( 0.0f, 2.0f, 0.0f ) );
+		REQUIRE( result.scales[ 1 ] == ae::Vec3( 2.0f ) );
+	}
+
+	SECTION( "layer only affects weighted bones" )
+	{
+		const float weights[] = { 0.0f, 1.0f };
+		ae::PoseBuffer::Layer( pose0, pose1, weights, 1.0f, &result );
+		REQUIRE( result.translations[ 0 ] == ae::Vec3( 0.0f ) );
+		REQUIRE( result.translations[ 1 ] == ae::Vec3( 0.0f, 4.0f, 0.0f ) );
+	}
+
+	SECTION( "additive with matching reference leaves base unchanged" )
+	{
+		ae::PoseBuffer::Additive( pose1, pose0, pose0, 1.0f, &result );
+		REQUIRE( result.translations[ 0 ] == pose1.translations[ 0 ] );
+		REQUIRE( result.translations[ 1 ] == pose1.translations[ 1 ] );
+		REQUIRE( result.scales[ 1 ] == pose1.scales[ 1 ] );
+	}
+
+	SECTION( "additive applies difference from reference" )
+	{
+		ae::PoseBuffer::Additive( pose1, pose1, pose0, 0.5f, &result );
+		REQUIRE( result.translations[ 0 ] == ae::Vec3( 3.0f, 0.0f, 0.0f ) );
+		REQUIRE( result.scales[ 1 ] == ae::Vec3( 6.0f ) );
+	}
+
+	SECTION( "output can alias an input" )
+	{
+		ae::PoseBuffer::Lerp( pose0, pose1, 0.5f, &pose0 );
+		REQUIRE( pose0.translations[ 0 ] == ae::Vec3( 1.0f, 0.0f, 0.0f ) );
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::BlendTree tests
+//------------------------------------------------------------------------------
+TEST_CASE( "BlendTree clip matches Animation::AnimateByPercent", "[ae::BlendTree]" )
+{
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &bindPose );
+	ae::Animation animation = TAG_ANIMATION_TEST;
+	AnimationTest_BuildAnimation( bindPose, 0.3f, &animation );
+
+	ae::BlendTree tree = TAG_ANIMATION_TEST;
+	tree.Initialize( &bindPose );
+	tree.AddClip( &animation );
+	REQUIRE( tree.GetNodeCount() == 1 );
+
+	ae::Skeleton expected = TAG_ANIMATION_TEST;
+	expected.Initialize( &bindPose );
+	animation.AnimateByPercent( &expected, 0.4f, 1.0f, nullptr, 0 );
+
+	const float params[] = { 0.4f };
+	ae::Skeleton result = TAG_ANIMATION_TEST;
+	result.Initialize( &bindPose );
+	ae::BlendTree::Character character;
+	character.params = params;
+	character.skeleton = &result;
+	tree.Update( &character, 1 );
+	REQUIRE( AnimationTest_IsClose( result, expected ) );
+}
+
+TEST_CASE( "BlendTree lerp and layer nodes", "[ae::BlendTree]" )
+{
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &bindPose );
+	ae::Animation anim0 = TAG_ANIMATION_TEST;
+	ae::Animation anim1 = TAG_ANIMATION_TEST;
+	AnimationTest_BuildAnimation( bindPose, 0.3f, &anim0 );
+	AnimationTest_BuildAnimation( bindPose, -0.2f, &anim1 );
+
+	ae::BlendTree tree = TAG_ANIMATION_TEST;
+	tree.Initialize( &bindPose );
+	const uint32_t clip0 = tree.AddClip( &anim0 );
+	const uint32_t clip1 = tree.AddClip( &anim1 );
+	
+	ae::Array< ae::PoseBuffer > scratch = TAG_ANIMATION_TEST;
+	ae::PoseBuffer result = TAG_ANIMATION_TEST;
+
+	SECTION( "lerp" )
+	{
+		tree.AddLerp( clip0, clip1 );
+		const float params[] = { 0.25f, 0.5f, 0.3f };
+		tree.Evaluate( params, &scratch, &result );
+		REQUIRE( result.GetBoneCount() == bindPose.GetBoneCount() );
+		for ( uint32_t i = 0; i < bindPose.GetBoneCount(); i++ )
+		{
+			const char* name = bindPose.GetBoneByIndex( i )->name.c_str();
+			const ae::Keyframe expected = anim0.GetKeyframeByPercent( name, 0.25f ).Lerp( anim1.GetKeyframeByPercent( name, 0.5f ), 0.3f );
+			REQUIRE( AnimationTest_IsClose( result.GetKeyframe( i ).GetLocalTransform(), expected.GetLocalTransform() ) );
+		}
+	}
+
+	SECTION( "layer" )
+	{
+		ae::Array< float > weights( TAG_ANIMATION_TEST, 0.0f, bindPose.GetBoneCount() );
+		weights[ bindPose.GetBoneByName( "arm" )->index ] = 1.0f;
+		weights[ bindPose.GetBoneByName( "hand" )->index ] = 1.0f;
+		tree.AddLayer( clip0, clip1, weights.Data() );
+		const float params[] = { 0.25f, 0.5f, 1.0f };
+		tree.Evaluate( params, &scratch, &result );
+		for ( uint32_t i = 0; i < bindPose.GetBoneCount(); i++ )
+		{
+			const char* name = bindPose.GetBoneByIndex( i )->name.c_str();
+			const ae::Animation& source = weights[ i ] ? anim1 : anim0;
+			const ae::Keyframe expected = source.GetKeyframeByPercent( name, weights[ i ] ? 0.5f : 0.25f );
+			REQUIRE( AnimationTest_IsClose( result.GetKeyframe( i ).GetLocalTransform(), expected.GetLocalTransform() ) );
+		}
+	}
+}
+
+TEST_CASE( "BlendTree parallel update matches serial update", "[ae::BlendTree]" )
+{
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &bindPose );
+	ae::Animation anim0 = TAG_ANIMATION_TEST;
+	ae::Animation anim1 = TAG_ANIMATION_TEST;
+	AnimationTest_BuildAnimation( bindPose, 0.3f, &anim0 );
+	AnimationTest_BuildAnimation( bindPose, -0.2f, &anim1 );
+
+	ae::BlendTree tree = TAG_ANIMATION_TEST;
+	tree.Initialize( &bindPose );
+	const uint32_t clip0 = tree.AddClip( &anim0 );
+	const uint32_t clip1 = tree.AddClip( &anim1 );
+	tree.AddAdditive( clip0, clip1, clip0 );
+
+	const uint32_t kCharacterCount = 64;
+	ae::Array< float > params = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skeleton* > serial = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skeleton* > parallel = TAG_ANIMATION_TEST;
+	ae::Array< ae::BlendTree::Character > serialCharacters = TAG_ANIMATION_TEST;
+	ae::Array< ae::BlendTree::Character > parallelCharacters = TAG_ANIMATION_TEST;
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		params.Append( i / (float)kCharacterCount );
+		params.Append( 1.0f - i / (float)kCharacterCount );
+		params.Append( 0.5f );
+	}
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		serial.Append( ae::New< ae::Skeleton >( TAG_ANIMATION_TEST, TAG_ANIMATION_TEST ) )->Initialize( &bindPose );
+		parallel.Append( ae::New< ae::Skeleton >( TAG_ANIMATION_TEST, TAG_ANIMATION_TEST ) )->Initialize( &bindPose );
+		serialCharacters.Append( { params.Data() + i * 3, serial[ i ] } );
+		parallelCharacters.Append( { params.Data() + i * 3, parallel[ i ] } );
+	}
+
+	ae::WorkerPool workerPool( TAG_ANIMATION_TEST );
+	workerPool.Initialize( 3 );
+	tree.Update( serialCharacters.Data(), kCharacterCount );
+	tree.Update( parallelCharacters.Data(), kCharacterCount, &workerPool );
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		REQUIRE( AnimationTest_IsClose( *serial[ i ], *parallel[ i ], 0.0f ) );
+	}
+	REQUIRE( !AnimationTest_IsClose( *serial[ 0 ], *serial[ kCharacterCount / 2 ] ) );
+
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		ae::Delete( serial[ i ] );
+		ae::Delete( parallel[ i ] );
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::Skin tests
+//------------------------------------------------------------------------------
+static void AnimationTest_BuildSkin( uint32_t boneCount, uint32_t vertexCount, ae::Skin* skin, ae::Skeleton* pose, ae::Array< ae::Skin::Vertex >* verticesOut )
+{
+	ae::RandomValue< float > random( -1.0f, 1.0f );
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	bindPose.Initialize( boneCount );
+	const ae::Bone* parent = bindPose.GetRoot();
+	for ( uint32_t i = 1; i < boneCount; i++ )
+	{
+		parent = bindPose.AddBone( ( i % 3 ) ? parent : bindPose.GetRoot(), ae::Str64::Format( "bone#", i ).c_str(), ae::Matrix4::Translation( 0.0f, 0.1f, 0.0f ) * ae::Matrix4::RotationZ( 0.1f ) );
+	}
+
+	verticesOut->Clear();
+	for ( uint32_t i = 0; i < vertexCount; i++ )
+	{
+		// Between one and four influences per vertex, the remaining weights are zero
+		ae::Skin::Vertex vertex;
+		vertex.position = ae::Vec3( random.Get(), random.Get(), random.Get() );
+		vertex.normal = ae::Vec3( random.Get(), random.Get(), random.Get() ).SafeNormalizeCopy();
+		const uint32_t influences = 1 + i % ae::kMaxSkinWeights;
+		uint32_t remaining = 255;
+		for ( uint32_t j = 0; j < ae::kMaxSkinWeights; j++ )
+		{
+			const uint32_t weight = ( j + 1 == influences ) ? remaining : ( j < influences ? remaining / 2 : 0 );
+			vertex.bones[ j ] = ( i + j * 7 ) % boneCount;
+			vertex.weights[ j ] = (uint8_t)weight;
+			remaining -= weight;
+		}
+		verticesOut->Append( vertex );
+	}
+	skin->Initialize( bindPose, verticesOut->Data(), verticesOut->Length() );
+
+	pose->Initialize( &bindPose );
+	for ( uint32_t i = 1; i < boneCount; i++ )
+	{
+		const ae::Bone* bone = pose->GetBoneByIndex( i );
+		pose->SetLocalTransform( bone, bone->localTransform * ae::Matrix4::RotationX( 0.05f * i ) * ae::Matrix4::Scaling( 1.01f ) );
+	}
+}
+
+TEST_CASE( "Skin::ApplyPoseToMesh matches per influence skinning", "[ae::Skin]" )
+{
+	const uint32_t kBoneCount = 26;
+	const uint32_t kVertexCount = 5000;
+	ae::Skin skin = TAG_ANIMATION_TEST;
+	ae::Skeleton pose = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skin::Vertex > verts = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkin( kBoneCount, kVertexCount, &skin, &pose, &verts );
+	ae::WorkerPool workerPool( TAG_ANIMATION_TEST );
+	ae::Array< ae::Vec4 > positions( TAG_ANIMATION_TEST, ae::Vec4( 0.0f ), kVertexCount );
+	ae::Array< ae::Vec3 > normals( TAG_ANIMATION_TEST, ae::Vec3( 0.0f ), kVertexCount );
+	
+	SECTION( "single threaded" )
+	{
+		skin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec4), sizeof(ae::Vec3), true, false, kVertexCount );
+	}
+	SECTION( "worker pool" )
+	{
+		workerPool.Initialize( 3 );
+		skin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec4), sizeof(ae::Vec3), true, false, kVertexCount, &workerPool );
+	}
+	
+	// Compare with the original implementation, which transforms the vertex by each influence
+	for ( uint32_t i = 0; i < kVertexCount; i++ )
+	{
+		ae::Vec3 pos( 0.0f );
+		ae::Vec3 normal( 0.0f );
+		for ( uint32_t j = 0; j < ae::kMaxSkinWeights; j++ )
+		{
+			const uint32_t boneIdx = verts[ i ].bones[ j ];
+			const ae::Matrix4 transform = pose.GetBoneByIndex( boneIdx )->transform * skin.GetBindPose().GetBoneByIndex( boneIdx )->inverseTransform;
+			const float weight = verts[ i ].weights[ j ] / 255.0f;
+			pos += ( transform * ae::Vec4( verts[ i ].position, 1.0f ) ).GetXYZ() * weight;
+			normal += ( transform.GetNormalMatrix() * ae::Vec4( verts[ i ].normal, 0.0f ) ).GetXYZ() * weight;
+		}
+		normal.SafeNormalize();
+		REQUIRE( ( positions[ i ].GetXYZ() - pos ).Length() < 0.0001f );
+		REQUIRE( positions[ i ].w == 1.0f );
+		REQUIRE( ( normals[ i ] - normal ).Length() < 0.0001f );
+	}
+}
+
+TEST_CASE( "Skin palettes match bone transforms", "[ae::Skin]" )
+{
+	const uint32_t kBoneCount = 26;
+	ae::Skin skin = TAG_ANIMATION_TEST;
+	ae::Skeleton pose = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skin::Vertex > verts = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkin( kBoneCount, 16, &skin, &pose, &verts );
+	
+	ae::Array< ae::Skin::Bone3x4 > palette( TAG_ANIMATION_TEST, ae::Skin::Bone3x4(), kBoneCount );
+	ae::Array< ae::Skin::BoneDualQuaternion > dqPalette( TAG_ANIMATION_TEST, ae::Skin::BoneDualQuaternion(), kBoneCount );
+	skin.GetPalette( &pose, palette.Data() );
+	skin.GetPalette( &pose, dqPalette.Data() );
+	for ( uint32_t i = 0; i < kBoneCount; i++ )
+	{
+		const ae::Matrix4 transform = pose.GetBoneByIndex( i )->transform * skin.GetBindPose().GetBoneByIndex( i )->inverseTransform;
+		const ae::Vec4 p( 0.3f, -0.2f, 0.5f, 1.0f );
+		const ae::Vec3 expected = ( transform * p ).GetXYZ();
+		const ae::Vec4* rows = palette[ i ].rows;
+		REQUIRE( ( ae::Vec3( rows[ 0 ].Dot( p ), rows[ 1 ].Dot( p ), rows[ 2 ].Dot( p ) ) - expected ).Length() < 0.0001f );
+		
+		// Dual quaternions store rotation and translation only
+		const ae::Quaternion& real = dqPalette[ i ].real;
+		const ae::Quaternion t = ( dqPalette[ i ].dual * 2.0f ) * real.GetInverse();
+		REQUIRE( ae::Abs( real.Dot( real ) - 1.0f ) < 0.0001f );
+		REQUIRE( ( ae::Vec3( t.i, t.j, t.k ) - transform.GetTranslation() ).Length() < 0.0001f );
+		REQUIRE( ( real.Rotate( ae::Vec3( 0.0f, 1.0f, 0.0f ) ) - ( transform.GetRotation().Rotate( ae::Vec3( 0.0f, 1.0f, 0.0f ) ) ) ).Length() < 0.0001f );
+	}
+}
+
+TEST_CASE( "Skin dual quaternion mode", "[ae::Skin]" )
+{
+	const uint32_t kBoneCount = 26;
+	const uint32_t kVertexCount = 1000;
+	ae::Skin blendedSkin = TAG_ANIMATION_TEST;
+	ae::Skeleton pose = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skin::Vertex > verts = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkin( kBoneCount, kVertexCount, &blendedSkin, &pose, &verts );
+	// Rigid pose, dual quaternion skinning ignores scale
+	pose.Initialize( &blendedSkin.GetBindPose() );
+	for ( uint32_t i = 1; i < kBoneCount; i++ )
+	{
+		const ae::Bone* bone = pose.GetBoneByIndex( i );
+		pose.SetLocalTransform( bone, bone->localTransform * ae::Matrix4::RotationX( 0.05f * i ) );
+	}
+	ae::Array< ae::Vec3 > positions( TAG_ANIMATION_TEST, ae::Vec3( 0.0f ), kVertexCount );
+	ae::Array< ae::Vec3 > normals( TAG_ANIMATION_TEST, ae::Vec3( 0.0f ), kVertexCount );
+	ae::Array< ae::Vec3 > expectedPositions( TAG_ANIMATION_TEST, ae::Vec3( 0.0f ), kVertexCount );
+	ae::Array< ae::Vec3 > expectedNormals( TAG_ANIMATION_TEST, ae::Vec3( 0.0f ), kVertexCount );
+	
+	REQUIRE( blendedSkin.GetMode() == ae::Skin::Mode::LinearBlend );
+	
+	SECTION( "rigid vertices match linear blend skinning" )
+	{
+		for ( ae::Skin::Vertex& vert : verts )
+		{
+			vert.weights[ 0 ] = 255;
+			for ( uint32_t j = 1; j < ae::kMaxSkinWeights; j++ )
+			{
+				vert.weights[ j ] = 0;
+			}
+		}
+		ae::Skin skin = TAG_ANIMATION_TEST;
+		skin.Initialize( blendedSkin.GetBindPose(), verts.Data(), verts.Length() );
+		skin.ApplyPoseToMesh( &pose, expectedPositions[ 0 ].data, expectedNormals[ 0 ].data, sizeof(ae::Vec3), sizeof(ae::Vec3), false, false, kVertexCount );
+		skin.SetMode( ae::Skin::Mode::DualQuaternion );
+		REQUIRE( skin.GetMode() == ae::Skin::Mode::DualQuaternion );
+		skin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec3), sizeof(ae::Vec3), false, false, kVertexCount );
+		for ( uint32_t i = 0; i < kVertexCount; i++ )
+		{
+			REQUIRE( ( positions[ i ] - expectedPositions[ i ] ).Length() < 0.0001f );
+			REQUIRE( ( normals[ i ] - expectedNormals[ i ] ).Length() < 0.0001f );
+		}
+	}
+	SECTION( "blended vertices in parallel" )
+	{
+		blendedSkin.SetMode( ae::Skin::Mode::DualQuaternion );
+		ae::WorkerPool workerPool( TAG_ANIMATION_TEST );
+		workerPool.Initialize( 3 );
+		blendedSkin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec3), sizeof(ae::Vec3), false, false, kVertexCount, &workerPool );
+		for ( uint32_t i = 0; i < kVertexCount; i++ )
+		{
+			REQUIRE( ae::Abs( normals[ i ].Length() - 1.0f ) < 0.0001f );
+			const uint32_t boneIdx = verts[ i ].bones[ 0 ];
+			const ae::Matrix4 transform = pose.GetBoneByIndex( boneIdx )->transform * blendedSkin.GetBindPose().GetBoneByIndex( boneIdx )->inverseTransform;
+			if ( verts[ i ].weights[ 1 ] == 0 )
+			{
+				REQUIRE( ( positions[ i ] - transform.TransformPoint3x4( verts[ i ].position ) ).Length() < 0.0001f );
+			}
+		}
+	}
+}
+
+TEST_CASE( "Skin::ApplyPoseToMesh benchmark", "[.benchmark][ae::Skin]" )
+{
+	// Roughly the size of character.fbx from 16_SkinnedMesh, which has 26
+	// bones and 10308 polygon vertices, skinned for 100 instances
+	const uint32_t kBoneCount = 26;
+	const uint32_t kVertexCount = 10308;
+	const uint32_t kInstanceCount = 100;
+	ae::Skin skin = TAG_ANIMATION_TEST;
+	ae::Skeleton pose = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skin::Vertex > verts = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkin( kBoneCount, kVertexCount, &skin, &pose, &verts );
+	ae::Array< ae::Vec4 > positions( TAG_ANIMATION_TEST, ae::Vec4( 0.0f ), kVertexCount );
+	ae::Array< ae::Vec4 > normals( TAG_ANIMATION_TEST, ae::Vec4( 0.0f ), kVertexCount );
+	ae::WorkerPool workerPool( TAG_ANIMATION_TEST );
+	workerPool.Initialize( ae::Max( 1u, ae::GetMaxConcurrentThreads() ) - 1 );
+
+	BENCHMARK( "100 instances" )
+	{
+		for ( uint32_t i = 0; i < kInstanceCount; i++ )
+		{
+			skin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec4), sizeof(ae::Vec4), true, true, kVertexCount );
+		}
+		return positions[ 0 ].x;
+	};
+	BENCHMARK( "100 instances with worker pool" )
+	{
+		for ( uint32_t i = 0; i < kInstanceCount; i++ )
+		{
+			skin.ApplyPoseToMesh( &pose, positions[ 0 ].data, normals[ 0 ].data, sizeof(ae::Vec4), sizeof(ae::Vec4), true, true, kVertexCount, &workerPool );
+		}
+		return positions[ 0 ].x;
+	};
+}
+
+//------------------------------------------------------------------------------
+// ae::Skeleton tests
+//------------------------------------------------------------------------------
+// Bones are added in an interleaved order so that subtrees are not contiguous
+static void AnimationTest_BuildWideSkeleton( uint32_t limbCount, uint32_t limbLength, ae::Skeleton* skeleton )
+{
+	skeleton->Initialize( 1 + limbCount * limbLength );
+	ae::Array< const ae::Bone* > tips = TAG_ANIMATION_TEST;
+	tips.Append( skeleton->GetRoot(), limbCount );
+	for ( uint32_t i = 0; i < limbLength; i++ )
+	{
+		for ( uint32_t j = 0; j < limbCount; j++ )
+		{
+			const ae::Matrix4 local = ae::Matrix4::Translation( 0.1f * j, 0.2f, 0.0f ) * ae::Matrix4::RotationZ( 0.05f * j );
+			tips[ j ] = skeleton->AddBone( tips[ j ], ae::Str64::Format( "limb#_#", j, i ).c_str(), local );
+		}
+	}
+}
+
+static bool AnimationTest_IsHierarchyValid( const ae::Skeleton& skeleton )
+{
+	for ( uint32_t i = 0; i < skeleton.GetBoneCount(); i++ )
+	{
+		const ae::Bone* bone = skeleton.GetBoneByIndex( i );
+		const ae::Matrix4 expected = bone->parent ? bone->parent->transform * bone->localTransform : bone->localTransform;
+		if ( !AnimationTest_IsClose( bone->transform, expected )
+			|| !AnimationTest_IsClose( bone->inverseTransform, expected.GetInverse() ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST_CASE( "Skeleton parent indices", "[ae::Skeleton]" )
+{
+	ae::Skeleton skeleton = TAG_ANIMATION_TEST;
+	AnimationTest_BuildWideSkeleton( 3, 4, &skeleton );
+	const uint32_t* parents = skeleton.GetParentIndices();
+	REQUIRE( parents[ 0 ] == ae::Skeleton::kInvalidIndex );
+	for ( uint32_t i = 1; i < skeleton.GetBoneCount(); i++ )
+	{
+		REQUIRE( parents[ i ] == skeleton.GetBoneByIndex( i )->parent->index );
+		REQUIRE( parents[ i ] < i );
+	}
+}
+
+TEST_CASE( "Skeleton partial updates", "[ae::Skeleton]" )
+{
+	ae::Skeleton skeleton = TAG_ANIMATION_TEST;
+	AnimationTest_BuildWideSkeleton( 3, 4, &skeleton );
+	const ae::Bone* limb1 = skeleton.GetBoneByName( "limb1_1" );
+	const ae::Bone* limb2 = skeleton.GetBoneByName( "limb2_2" );
+	REQUIRE( limb1 );
+	REQUIRE( limb2 );
+	
+	SECTION( "local transforms update descendants" )
+	{
+		const ae::Matrix4 untouched = skeleton.GetBoneByName( "limb0_3" )->transform;
+		const ae::Bone* targets[] = { limb2, limb1 };
+		const ae::Matrix4 transforms[] = { ae::Matrix4::RotationX( 0.5f ), ae::Matrix4::RotationY( 0.25f ) };
+		skeleton.SetLocalTransforms( targets, transforms, 2 );
+		REQUIRE( AnimationTest_IsClose( limb1->localTransform, transforms[ 1 ] ) );
+		REQUIRE( AnimationTest_IsClose( limb2->localTransform, transforms[ 0 ] ) );
+		REQUIRE( AnimationTest_IsHierarchyValid( skeleton ) );
+		REQUIRE( AnimationTest_IsClose( skeleton.GetBoneByName( "limb0_3" )->transform, untouched ) );
+		
+		skeleton.SetLocalTransform( skeleton.GetRoot(), ae::Matrix4::Translation( 1.0f, 2.0f, 3.0f ) );
+		REQUIRE( AnimationTest_IsHierarchyValid( skeleton ) );
+		REQUIRE( !AnimationTest_IsClose( skeleton.GetBoneByName( "limb0_3" )->transform, untouched ) );
+	}
+	SECTION( "model transforms keep descendants in place" )
+	{
+		const ae::Bone* child = skeleton.GetBoneByName( "limb1_2" );
+		const ae::Bone* grandchild = skeleton.GetBoneByName( "limb1_3" );
+		const ae::Matrix4 childTransform = child->transform;
+		const ae::Matrix4 grandchildLocal = grandchild->localTransform;
+		const ae::Matrix4 transform = ae::Matrix4::Translation( 0.0f, 5.0f, 0.0f ) * ae::Matrix4::RotationZ( 1.0f );
+		skeleton.SetTransform( limb1, transform );
+		REQUIRE( AnimationTest_IsClose( limb1->transform, transform ) );
+		REQUIRE( AnimationTest_IsClose( child->transform, childTransform ) );
+		REQUIRE( AnimationTest_IsClose( grandchild->localTransform, grandchildLocal ) );
+		REQUIRE( AnimationTest_IsHierarchyValid( skeleton ) );
+	}
+}
+
+TEST_CASE( "Skeleton partial update benchmark", "[.benchmark][ae::Skeleton]" )
+{
+	// A 65 bone character with IK applied to the three bones of one arm
+	ae::Skeleton skeleton = TAG_ANIMATION_TEST;
+	AnimationTest_BuildWideSkeleton( 8, 8, &skeleton );
+	ae::PoseBuffer pose = TAG_ANIMATION_TEST;
+	pose.Initialize( &skeleton );
+	const ae::Bone* arm[] = {
+		skeleton.GetBoneByName( "limb3_5" ),
+		skeleton.GetBoneByName( "limb3_6" ),
+		skeleton.GetBoneByName( "limb3_7" )
+	};
+	ae::Matrix4 armTransforms[] = { arm[ 0 ]->localTransform, arm[ 1 ]->localTransform, arm[ 2 ]->localTransform };
+	
+	BENCHMARK( "full pose" )
+	{
+		skeleton.SetLocalPose( pose );
+		return skeleton.GetBoneByIndex( 1 )->transform.data[ 0 ];
+	};
+	BENCHMARK( "one arm" )
+	{
+		skeleton.SetLocalTransforms( arm, armTransforms, 3 );
+		return arm[ 2 ]->transform.data[ 0 ];
+	};
+}
+
+//------------------------------------------------------------------------------
+// ae::IKSolver tests
+//------------------------------------------------------------------------------
+static void AnimationTest_GetArmChain( const ae::Skeleton& skeleton, uint32_t (&chainOut)[ 3 ] )
+{
+	chainOut[ 0 ] = skeleton.GetBoneByName( "spine" )->index;
+	chainOut[ 1 ] = skeleton.GetBoneByName( "arm" )->index;
+	chainOut[ 2 ] = skeleton.GetBoneByName( "hand" )->index;
+}
+
+TEST_CASE( "IKSolver matches IK::Run", "[ae::IKSolver]" )
+{
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &bindPose );
+	uint32_t chain[ 3 ];
+	AnimationTest_GetArmChain( bindPose, chain );
+	const ae::Matrix4 target = ae::Matrix4::Translation( 0.75f, 1.9f, 0.25f );
+	
+	ae::IK ik = TAG_ANIMATION_TEST;
+	ik.chain.AppendArray( chain, 3 );
+	ik.bindPose = &bindPose;
+	ik.pose.Initialize( &bindPose );
+	ik.targetTransform = target;
+	ae::Skeleton expected = TAG_ANIMATION_TEST;
+	ik.Run( 10, &expected );
+	
+	ae::Skeleton pose = TAG_ANIMATION_TEST;
+	pose.Initialize( &bindPose );
+	ae::IKSolver solver = TAG_ANIMATION_TEST;
+	const uint32_t handle = solver.AddChain( &pose, &bindPose, chain, 3 );
+	solver.SetTarget( handle, target );
+	solver.Solve();
+	REQUIRE( AnimationTest_IsClose( pose, expected ) );
+	REQUIRE( solver.GetStats().chainCount == 1 );
+	REQUIRE( solver.GetStats().iterationCount >= 1 );
+	REQUIRE( solver.GetStats().iterationCount <= 10 );
+	REQUIRE( solver.GetStats().budgetExceededCount == 0 );
+	REQUIRE( solver.GetStats().solveTime >= 0.0 );
+	
+	SECTION( "warm start" )
+	{
+		// The animated pose is restored every frame, the previous solution is reused
+		const uint32_t coldIterations = solver.GetStats().iterationCount;
+		pose.Initialize( &bindPose );
+		solver.Solve();
+		REQUIRE( solver.GetStats().iterationCount <= coldIterations );
+		if ( solver.GetStats().convergedCount )
+		{
+			REQUIRE( solver.GetStats().iterationCount == 0 );
+			REQUIRE( AnimationTest_IsClose( pose, expected ) );
+		}
+		
+		solver.Reset( handle );
+		pose.Initialize( &bindPose );
+		solver.Solve();
+		REQUIRE( solver.GetStats().iterationCount == coldIterations );
+		REQUIRE( AnimationTest_IsClose( pose, expected ) );
+	}
+}
+
+TEST_CASE( "IKSolver many characters", "[ae::IKSolver]" )
+{
+	const uint32_t kCharacterCount = 32;
+	ae::Skeleton bindPose = TAG_ANIMATION_TEST;
+	AnimationTest_BuildSkeleton( &bindPose );
+	uint32_t arm[ 3 ];
+	AnimationTest_GetArmChain( bindPose, arm );
+	const uint32_t neck[] = { bindPose.GetBoneByName( "neck" )->index };
+	ae::IKConstraints constraints;
+	constraints.primaryAxis = ae::Axis::Y;
+	
+	ae::Array< ae::Skeleton* > serialPoses = TAG_ANIMATION_TEST;
+	ae::Array< ae::Skeleton* > parallelPoses = TAG_ANIMATION_TEST;
+	ae::IKSolver serial = TAG_ANIMATION_TEST;
+	ae::IKSolver parallel = TAG_ANIMATION_TEST;
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		ae::Skeleton* poses[] = {
+			serialPoses.Append( ae::New< ae::Skeleton >( TAG_ANIMATION_TEST, TAG_ANIMATION_TEST ) ),
+			parallelPoses.Append( ae::New< ae::Skeleton >( TAG_ANIMATION_TEST, TAG_ANIMATION_TEST ) )
+		};
+		ae::IKSolver* solvers[] = { &serial, &parallel };
+		for ( uint32_t j = 0; j < 2; j++ )
+		{
+			poses[ j ]->Initialize( &bindPose );
+			const uint32_t armHandle = solvers[ j ]->AddChain( poses[ j ], &bindPose, arm, 3 );
+			const uint32_t neckHandle = solvers[ j ]->AddChain( poses[ j ], &bindPose, neck, 1, &constraints, 1 );
+			solvers[ j ]->SetTarget( armHandle, ae::Matrix4::Translation( 0.5f + i * 0.01f, 1.9f, 0.25f ) );
+			solvers[ j ]->SetTarget( neckHandle, ae::Matrix4::Translation( 0.0f, 2.0f, 0.0f ) );
+		}
+	}
+	REQUIRE( serial.GetChainCount() == kCharacterCount * 2 );
+	
+	ae::WorkerPool workerPool( TAG_ANIMATION_TEST );
+	workerPool.Initialize( 3 );
+	serial.Solve();
+	parallel.Solve( &workerPool );
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		REQUIRE( AnimationTest_IsClose( *serialPoses[ i ], *parallelPoses[ i ] ) );
+	}
+	REQUIRE( serial.GetStats().iterationCount == parallel.GetStats().iterationCount );
+	REQUIRE( serial.GetStats().GetAverageIterations() > 0.0f );
+	
+	SECTION( "time budget" )
+	{
+		// Every chain still gets a single iteration once the budget is exceeded
+		serial.Clear();
+		for ( uint32_t i = 0; i < kCharacterCount; i++ )
+		{
+			serialPoses[ i ]->Initialize( &bindPose );
+			const uint32_t handle = serial.AddChain( serialPoses[ i ], &bindPose, arm, 3 );
+			serial.SetTarget( handle, ae::Matrix4::Translation( 5.0f, 5.0f, 5.0f ) );
+		}
+		serial.timeBudget = 0.000000001;
+		serial.Solve( &workerPool );
+		REQUIRE( serial.GetStats().chainCount == kCharacterCount );
+		REQUIRE( serial.GetStats().convergedCount == 0 );
+		REQUIRE( serial.GetStats().budgetExceededCount == kCharacterCount );
+		REQUIRE( serial.GetStats().iterationCount == kCharacterCount );
+	}
+	
+	for ( uint32_t i = 0; i < kCharacterCount; i++ )
+	{
+		ae::Delete( serialPoses[ i ] );
+		ae::Delete( parallelPoses[ i ] );
+	}
+}
@@ -0,0 +1,357 @@
+//------------------------------------------------------------------------------
+// EditorLevelTest.cpp
+// Copyright (c) John Hughes on 10/18/26. All rights reserved.
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "aether.h"
+#include "ae/Entity.h"
+#include "../extras/EditorLevel.h"
+
+const ae::Tag TAG_EDITOR_LEVEL_TEST = "EditorLevelTest";
+
+//------------------------------------------------------------------------------
+// Test components
+//------------------------------------------------------------------------------
+class EditorLevelTestTransform : public ae::Inheritor< ae::Component, EditorLevelTestTransform >
+{
+public:
+	ae::Matrix4 transform = ae::Matrix4::Identity();
+};
+
+class EditorLevelTestRender : public ae::Inheritor< ae::Component, EditorLevelTestRender >
+{
+public:
+	ae::Str32 mesh;
+	float lod = 0.0f;
+	ae::Array< float, 8 > weights;
+};
+
+AE_REGISTER_CLASS( EditorLevelTestTransform );
+AE_REGISTER_CLASS_VAR( EditorLevelTestTransform, transform );
+AE_REGISTER_CLASS( EditorLevelTestRender );
+AE_REGISTER_CLASS_VAR( EditorLevelTestRender, mesh );
+AE_REGISTER_CLASS_VAR( EditorLevelTestRender, lod );
+AE_REGISTER_CLASS_VAR( EditorLevelTestRender, weights );
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+// The json level is only hashed by the binary level, so its contents don't matter
+const char* kEditorLevelTestJson = "{ \"objects\": [] }";
+
+ae::Matrix4 EditorLevelTest_GetTransform( uint32_t i )
+{
+	return ae::Matrix4::Translation( ae::Vec3( (float)i, i * 2.0f, 3.0f ) );
+}
+
+void EditorLevelTest_FillRegistry( ae::Registry* registry, uint32_t entityCount )
+{
+	for ( uint32_t i = 0; i < entityCount; i++ )
+	{
+		const ae::Entity entity = registry->CreateEntity( ( i % 10 == 0 ) ? ae::Str16::Format( "e#", i ).c_str() : "" );
+		// The transform var is set from the entity transform when loading
+		registry->AddComponent< EditorLevelTestTransform >( entity );
+		if ( i % 2 )
+		{
+			EditorLevelTestRender* render = registry->AddComponent< EditorLevelTestRender >( entity );
+			render->mesh = ae::Str32::Format( "mesh#", i % 50 );
+			render->lod = i * 0.1f;
+			for ( uint32_t j = 0; j < i % 5; j++ )
+			{
+				render->weights.Append( j * 0.5f );
+			}
+		}
+	}
+}
+
+void EditorLevelTest_WriteLevel( const ae::Registry* registry, uint32_t entityCount, const char* json, ae::Array< uint8_t >* binary )
+{
+	ae::LevelHeaderToBinary( registry, entityCount, json, (uint32_t)strlen( json ), binary );
+	for ( uint32_t i = 0; i < entityCount; i++ )
+	{
+		ae::EntityToBinary( registry, i + 1, EditorLevelTest_GetTransform( i ), binary );
+	}
+}
+
+bool EditorLevelTest_ReadLevel( const uint8_t* data, uint32_t length, const void* json, uint32_t jsonLength, ae::Registry* registry )
+{
+	ae::BinaryLevelReader reader( TAG_EDITOR_LEVEL_TEST, data, length );
+	if ( !reader.Validate( json, jsonLength ) )
+	{
+		return false;
+	}
+	for ( uint32_t i = 0; i < reader.GetEntityCount(); i++ )
+	{
+		if ( !reader.CreateEntity( registry ) )
+		{
+			return false;
+		}
+	}
+	for ( uint32_t i = 0; i < reader.GetEntityCount(); i++ )
+	{
+		if ( !reader.SerializeEntity( registry ) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void EditorLevelTest_CheckRegistry( const ae::Registry& registry, uint32_t entityCount )
+{
+	REQUIRE( registry.GetComponentCount< EditorLevelTestTransform >() == entityCount );
+	REQUIRE( registry.GetComponentCount< EditorLevelTestRender >() == entityCount / 2 );
+	for ( uint32_t i = 0; i < entityCount; i++ )
+	{
+		const ae::Entity entity = i + 1;
+		REQUIRE( registry.GetNameByEntity( entity ) == ( ( i % 10 == 0 ) ? ae::Str16::Format( "e#", i ) : ae::Str16() ) );
+		REQUIRE( registry.GetComponent< EditorLevelTestTransform >( entity ).transform == EditorLevelTest_GetTransform( i ) );
+		const EditorLevelTestRender* render = registry.TryGetComponent< EditorLevelTestRender >( entity );
+		REQUIRE( ( render != nullptr ) == ( i % 2 == 1 ) );
+		if ( render )
+		{
+			REQUIRE( render->mesh == ae::Str32::Format( "mesh#", i % 50 ) );
+			REQUIRE( render->lod == i * 0.1f );
+			REQUIRE( render->weights.Length() == i % 5 );
+			for ( uint32_t j = 0; j < render->weights.Length(); j++ )
+			{
+				REQUIRE( render->weights[ j ] == j * 0.5f );
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::BinaryLevelReader tests
+//------------------------------------------------------------------------------
+TEST_CASE( "Binary levels have a versioned header", "[ae::BinaryLevelReader]" )
+{
+	ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+	EditorLevelTest_FillRegistry( &registry, 10 );
+	ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+	EditorLevelTest_WriteLevel( &registry, 10, kEditorLevelTestJson, &binary );
+
+	ae::BinaryReader reader( binary.Data(), binary.Length() );
+	uint32_t magic = 0, version = 0, jsonLength = 0, jsonHash = 0, typeCount = 0;
+	reader.SerializeUint32( magic );
+	reader.SerializeUint32( version );
+	reader.SerializeUint32( jsonLength );
+	reader.SerializeUint32( jsonHash );
+	reader.SerializeVarUint32( typeCount );
+	REQUIRE( reader.IsValid() );
+	REQUIRE( magic == ae::kBinaryLevelMagic );
+	REQUIRE( version == 3 ); // Update along with kBinaryLevelVersion when the format changes
+	REQUIRE( version == ae::kBinaryLevelVersion );
+	REQUIRE( jsonLength == strlen( kEditorLevelTestJson ) );
+	REQUIRE( jsonHash == ae::Hash().HashData( kEditorLevelTestJson, jsonLength ).Get() );
+	REQUIRE( typeCount == registry.GetTypeCount() );
+	for ( uint32_t i = 0; i < typeCount; i++ )
+	{
+		ae::Str128 typeName;
+		uint32_t schemaHash = 0;
+		reader.SerializeString( typeName );
+		reader.SerializeUint32( schemaHash );
+		REQUIRE( reader.IsValid() );
+		const ae::Type* type = ae::GetTypeByName( typeName.c_str() );
+		REQUIRE( type );
+		REQUIRE( schemaHash == ae::GetTypeSchemaHash( type ) );
+	}
+	registry.Clear();
+}
+
+#if !_AE_EMSCRIPTEN_ // EditorFileMapping::Open() always fails with emscripten
+TEST_CASE( "Binary levels can be loaded from a memory mapped file", "[ae::BinaryLevelReader]" )
+{
+	const uint32_t kEntityCount = 100;
+	const char* levelPath = "EditorLevelTest.level";
+	const ae::Str256 binaryLevelPath = ae::GetBinaryLevelPath( levelPath );
+	REQUIRE( binaryLevelPath == "EditorLevelTest.level.bin" );
+	{
+		ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+		EditorLevelTest_FillRegistry( &registry, kEntityCount );
+		ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+		EditorLevelTest_WriteLevel( &registry, kEntityCount, kEditorLevelTestJson, &binary );
+		registry.Clear();
+		const uint32_t jsonLength = (uint32_t)strlen( kEditorLevelTestJson );
+		REQUIRE( ae::FileSystem::Write( levelPath, kEditorLevelTestJson, jsonLength, false ) == jsonLength );
+		REQUIRE( ae::FileSystem::Write( binaryLevelPath.c_str(), binary.Data(), binary.Length(), false ) == binary.Length() );
+	}
+
+	ae::EditorFileMapping jsonLevel;
+	ae::EditorFileMapping binaryLevel;
+	REQUIRE( jsonLevel.Open( levelPath ) );
+	REQUIRE( binaryLevel.Open( binaryLevelPath.c_str() ) );
+	REQUIRE( jsonLevel.GetLength() == strlen( kEditorLevelTestJson ) );
+
+	ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+	REQUIRE( EditorLevelTest_ReadLevel( binaryLevel.GetData(), binaryLevel.GetLength(), jsonLevel.GetData(), jsonLevel.GetLength(), &registry ) );
+	EditorLevelTest_CheckRegistry( registry, kEntityCount );
+	registry.Clear();
+
+	binaryLevel.Close();
+	REQUIRE( !binaryLevel.GetData() );
+	REQUIRE( !binaryLevel.GetLength() );
+	REQUIRE( !binaryLevel.Open( "EditorLevelTest.missing.level.bin" ) );
+}
+#endif
+
+TEST_CASE( "Binary levels are rejected when the json level has changed", "[ae::BinaryLevelReader]" )
+{
+	ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+	EditorLevelTest_FillRegistry( &registry, 10 );
+	ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+	EditorLevelTest_WriteLevel( &registry, 10, kEditorLevelTestJson, &binary );
+	registry.Clear();
+
+	// Up to date
+	ae::Str64 json = kEditorLevelTestJson;
+	REQUIRE( EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), json.c_str(), json.Length(), &registry ) );
+	EditorLevelTest_CheckRegistry( registry, 10 );
+	registry.Clear();
+	// Same length edit, only detected by the json hash
+	json[ 3 ] = 'O';
+	REQUIRE( json.Length() == strlen( kEditorLevelTestJson ) );
+	REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), json.c_str(), json.Length(), &registry ) );
+	// Different length
+	json = ae::Str64::Format( "# ", kEditorLevelTestJson );
+	REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), json.c_str(), json.Length(), &registry ) );
+	REQUIRE( registry.GetComponentCount< EditorLevelTestTransform >() == 0 );
+	// Older versions
+	ae::BinaryWriter( binary.Data() + sizeof( uint32_t ), sizeof( uint32_t ) ).SerializeUint32( ae::kBinaryLevelVersion - 1 );
+	REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, (uint32_t)strlen( kEditorLevelTestJson ), &registry ) );
+	REQUIRE( registry.GetComponentCount< EditorLevelTestTransform >() == 0 );
+}
+
+TEST_CASE( "Binary levels are rejected when a component type has changed", "[ae::BinaryLevelReader]" )
+{
+	const ae::Type* type = ae::GetType< EditorLevelTestRender >();
+	const uint32_t jsonLength = (uint32_t)strlen( kEditorLevelTestJson );
+	auto writeHeader = [ & ]( const char* typeName, uint32_t schemaHash, ae::Array< uint8_t >* binary )
+	{
+		binary->Clear();
+		ae::BinaryWriter writer( binary );
+		writer.SerializeUint32( ae::kBinaryLevelMagic );
+		writer.SerializeUint32( ae::kBinaryLevelVersion );
+		writer.SerializeUint32( jsonLength );
+		writer.SerializeUint32( ae::Hash().HashData( kEditorLevelTestJson, jsonLength ).Get() );
+		writer.SerializeVarUint32( 1u );
+		writer.SerializeString( typeName );
+		writer.SerializeUint32( schemaHash );
+		writer.SerializeVarUint32( 0u ); // Entity count
+	};
+	ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+	ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+
+	writeHeader( type->GetName(), ae::GetTypeSchemaHash( type ), &binary );
+	REQUIRE( EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, jsonLength, &registry ) );
+	writeHeader( type->GetName(), ae::GetTypeSchemaHash( type ) + 1, &binary );
+	REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, jsonLength, &registry ) );
+	writeHeader( "EditorLevelTestMissing", ae::GetTypeSchemaHash( type ), &binary );
+	REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, jsonLength, &registry ) );
+
+	// The schema depends on var names, types, and the type name
+	REQUIRE( ae::GetTypeSchemaHash( type ) == ae::GetTypeSchemaHash( type ) );
+	REQUIRE( ae::GetTypeSchemaHash( type ) != ae::GetTypeSchemaHash( ae::GetType< EditorLevelTestTransform >() ) );
+}
+
+TEST_CASE( "Truncated binary levels fail to load", "[ae::BinaryLevelReader]" )
+{
+	ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+	EditorLevelTest_FillRegistry( &registry, 10 );
+	ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+	EditorLevelTest_WriteLevel( &registry, 10, kEditorLevelTestJson, &binary );
+	registry.Clear();
+	const uint32_t jsonLength = (uint32_t)strlen( kEditorLevelTestJson );
+	for ( uint32_t length = 0; length < binary.Length(); length++ )
+	{
+		REQUIRE( !EditorLevelTest_ReadLevel( binary.Data(), length, kEditorLevelTestJson, jsonLength, &registry ) );
+		registry.Clear();
+	}
+	REQUIRE( EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, jsonLength, &registry ) );
+	registry.Clear();
+}
+
+TEST_CASE( "Binary level load benchmark", "[.benchmark][ae::BinaryLevelReader]" )
+{
+	// Compares loading a binary level with setting each var from a string,
+	// which is how json levels are loaded once parsed. Parsing isn't included.
+	const uint32_t kEntityCount = 50000;
+	const uint32_t jsonLength = (uint32_t)strlen( kEditorLevelTestJson );
+	ae::Array< uint8_t > binary = TAG_EDITOR_LEVEL_TEST;
+	struct StringVar { const ae::Var* var; ae::Array< std::string > values; };
+	struct StringComponent { ae::Entity entity; const ae::Type* type; ae::Array< StringVar > vars; };
+	ae::Array< StringComponent > stringLevel = TAG_EDITOR_LEVEL_TEST;
+	{
+		ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+		EditorLevelTest_FillRegistry( &registry, kEntityCount );
+		EditorLevelTest_WriteLevel( &registry, kEntityCount, kEditorLevelTestJson, &binary );
+		for ( uint32_t i = 0; i < kEntityCount; i++ )
+		{
+			for ( uint32_t t = 0; t < registry.GetTypeCount(); t++ )
+			{
+				const ae::Type* type = registry.GetTypeByIndex( t );
+				if ( const ae::Component* component = registry.TryGetComponent( i + 1, type ) )
+				{
+					StringComponent& stringComponent = stringLevel.Append( { i + 1, type, TAG_EDITOR_LEVEL_TEST } );
+					for ( uint32_t v = 0; v < type->GetVarCount( true ); v++ )
+					{
+						const ae::Var* var = type->GetVarByIndex( v, true );
+						StringVar& stringVar = stringComponent.vars.Append( { var, TAG_EDITOR_LEVEL_TEST } );
+						const uint32_t length = var->IsArray() ? var->GetArrayLength( component ) : 1;
+						for ( uint32_t j = 0; j < length; j++ )
+						{
+							stringVar.values.Append( var->GetObjectValueAsString( component, var->IsArray() ? j : -1 ) );
+						}
+					}
+				}
+			}
+		}
+		registry.Clear();
+	}
+
+	BENCHMARK( "Load binary level" )
+	{
+		ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+		EditorLevelTest_ReadLevel( binary.Data(), binary.Length(), kEditorLevelTestJson, jsonLength, &registry );
+		const uint32_t count = registry.GetComponentCount< EditorLevelTestRender >();
+		registry.Clear();
+		return count;
+	};
+	BENCHMARK( "Load level from strings" )
+	{
+		ae::Registry registry( TAG_EDITOR_LEVEL_TEST );
+		for ( uint32_t i = 0; i < kEntityCount; i++ )
+		{
+			registry.CreateEntity( i + 1 );
+		}
+		for ( const StringComponent& stringComponent : stringLevel )
+		{
+			registry.AddComponent( stringComponent.entity, stringComponent.type );
+		}
+		for ( const StringComponent& stringComponent : stringLevel )
+		{
+			ae::Component* component = &registry.GetComponent( stringComponent.entity, stringComponent.type );
+			for ( const StringVar& stringVar : stringComponent.vars )
+			{
+				if ( stringVar.var->IsArray() )
+				{
+					stringVar.var->SetArrayLength( component, stringVar.values.Length() );
+					for ( uint32_t j = 0; j < stringVar.values.Length(); j++ )
+					{
+						stringVar.var->SetObjectValueFromString( component, stringVar.values[ j ].c_str(), j );
+					}
+				}
+				else
+				{
+					stringVar.var->SetObjectValueFromString( component, stringVar.values[ 0 ].c_str() );
+				}
+			}
+		}
+		const uint32_t count = registry.GetComponentCount< EditorLevelTestRender >();
+		registry.Clear();
+		return count;
+	};
+}
@@ -0,0 +1,430 @@
+//------------------------------------------------------------------------------
+// EntityTest.cpp
+// Copyright (c) John Hughes on 10/18/26. All rights reserved.
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "aether.h"
+#include "ae/Entity.h"
+
+const ae::Tag TAG_ENTITY_TEST = "EntityTest";
+
+//------------------------------------------------------------------------------
+// Test components
+//------------------------------------------------------------------------------
+class EntityTestPosition : public ae::Inheritor< ae::Component, EntityTestPosition >
+{
+public:
+	EntityTestPosition() { s_liveCount++; }
+	~EntityTestPosition() { s_liveCount--; }
+	ae::Vec3 position = ae::Vec3( 0.0f );
+	static int32_t s_liveCount;
+};
+int32_t EntityTestPosition::s_liveCount = 0;
+
+class EntityTestVelocity : public ae::Inheritor< ae::Component, EntityTestVelocity >
+{
+public:
+	ae::Vec3 velocity = ae::Vec3( 0.0f );
+};
+
+AE_REGISTER_CLASS( EntityTestPosition );
+AE_REGISTER_CLASS( EntityTestVelocity );
+
+//------------------------------------------------------------------------------
+// ae::Registry tests
+//------------------------------------------------------------------------------
+TEST_CASE( "Registry components can be added, found, and removed", "[ae::Registry]" )
+{
+	for ( uint32_t pageSize : { 0u, 4u } )
+	{
+		ae::Registry registry( TAG_ENTITY_TEST );
+		registry.SetComponentPoolPageSize( pageSize );
+		ae::Entity entities[ 10 ];
+		EntityTestPosition* positions[ 10 ];
+		for ( uint32_t i = 0; i < countof(entities); i++ )
+		{
+			entities[ i ] = registry.CreateEntity();
+			positions[ i ] = registry.AddComponent< EntityTestPosition >( entities[ i ] );
+			REQUIRE( positions[ i ] );
+			REQUIRE( positions[ i ]->GetEntity() == entities[ i ] );
+			positions[ i ]->position = ae::Vec3( (float)i );
+		}
+		REQUIRE( !registry.AddComponent< EntityTestPosition >( entities[ 0 ] ) ); // Already exists
+		REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 10 );
+		REQUIRE( EntityTestPosition::s_liveCount == 10 );
+		for ( uint32_t i = 0; i < countof(entities); i++ )
+		{
+			REQUIRE( registry.TryGetComponent< EntityTestPosition >( entities[ i ] ) == positions[ i ] );
+			REQUIRE( registry.GetEntityByIndex< EntityTestPosition >( i ) == entities[ i ] );
+			REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( entities[ i ] ) );
+		}
+
+		// The last component is swapped into the removed components index,
+		// and components don't move in memory
+		registry.DestroyComponent( positions[ 3 ] );
+		REQUIRE( EntityTestPosition::s_liveCount == 9 );
+		REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 9 );
+		REQUIRE( !registry.TryGetComponent< EntityTestPosition >( entities[ 3 ] ) );
+		REQUIRE( registry.GetEntityByIndex< EntityTestPosition >( 3 ) == entities[ 9 ] );
+		REQUIRE( &registry.GetComponentByIndex< EntityTestPosition >( 3 ) == positions[ 9 ] );
+		REQUIRE( registry.TryGetComponent< EntityTestPosition >( entities[ 9 ] ) == positions[ 9 ] );
+		REQUIRE( positions[ 9 ]->position == ae::Vec3( 9.0f ) );
+
+		// Removing the last component doesn't swap
+		registry.Destroy( entities[ 8 ] );
+		REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 8 );
+		REQUIRE( registry.GetEntityByIndex< EntityTestPosition >( 7 ) == entities[ 7 ] );
+		REQUIRE( registry.TryGetComponent< EntityTestPosition >( entities[ 9 ] ) == positions[ 9 ] );
+
+		// Removed entities can get new components
+		EntityTestPosition* readded = registry.AddComponent< EntityTestPosition >( entities[ 3 ] );
+		REQUIRE( readded );
+		REQUIRE( registry.TryGetComponent< EntityTestPosition >( entities[ 3 ] ) == readded );
+		REQUIRE( registry.GetEntityByIndex< EntityTestPosition >( 8 ) == entities[ 3 ] );
+
+		registry.Clear();
+		REQUIRE( EntityTestPosition::s_liveCount == 0 );
+		REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 0 );
+	}
+}
+
+TEST_CASE( "Registry lookups handle sparse entity ids", "[ae::Registry]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	const ae::Entity low = registry.CreateEntity( 5 );
+	const ae::Entity high = registry.CreateEntity( 5000000 );
+	REQUIRE( registry.AddComponent< EntityTestVelocity >( low ) );
+	EntityTestVelocity* velocity = registry.AddComponent< EntityTestVelocity >( high );
+	REQUIRE( velocity );
+	REQUIRE( registry.TryGetComponent< EntityTestVelocity >( high ) == velocity );
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( ae::kInvalidEntity ) );
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( 6 ) ); // Allocated page
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( 3000000 ) ); // Unallocated page
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( 9000000 ) ); // Past the last page
+	registry.Destroy( high );
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( high ) );
+	REQUIRE( registry.TryGetComponent< EntityTestVelocity >( low ) );
+	registry.Clear();
+}
+
+TEST_CASE( "Pooled registry components are allocated from pages", "[ae::Registry]" )
+{
+	const uint32_t kPageSize = 8;
+	ae::Registry registry( TAG_ENTITY_TEST );
+	registry.SetComponentPoolPageSize( kPageSize );
+	const EntityTestVelocity* first = registry.AddComponent< EntityTestVelocity >( registry.CreateEntity() );
+	for ( uint32_t i = 1; i < kPageSize; i++ )
+	{
+		// All components of the first page are within one page of the first component
+		const EntityTestVelocity* velocity = registry.AddComponent< EntityTestVelocity >( registry.CreateEntity() );
+		const uint8_t* begin = (const uint8_t*)first - ( kPageSize - 1 ) * sizeof(EntityTestVelocity);
+		const uint8_t* end = (const uint8_t*)first + kPageSize * sizeof(EntityTestVelocity);
+		REQUIRE( (const uint8_t*)velocity >= begin );
+		REQUIRE( (const uint8_t*)velocity < end );
+	}
+	REQUIRE_THROWS( registry.SetComponentPoolPageSize( 16 ) ); // Must be set before components are added
+	registry.Clear();
+}
+
+TEST_CASE( "Registry destroys remaining components when destroyed", "[ae::Registry]" )
+{
+	for ( uint32_t pageSize : { 0u, 4u } )
+	{
+		{
+			ae::Registry registry( TAG_ENTITY_TEST );
+			registry.SetComponentPoolPageSize( pageSize );
+			for ( uint32_t i = 0; i < 10; i++ )
+			{
+				registry.AddComponent< EntityTestPosition >( registry.CreateEntity() );
+			}
+			REQUIRE( EntityTestPosition::s_liveCount == 10 );
+		}
+		REQUIRE( EntityTestPosition::s_liveCount == 0 );
+	}
+}
+
+TEST_CASE( "Registry iteration benchmark", "[.benchmark][ae::Registry]" )
+{
+	const uint32_t kEntityCount = 100000;
+	for ( uint32_t pageSize : { 0u, 1024u } )
+	{
+		ae::Registry registry( TAG_ENTITY_TEST );
+		registry.SetComponentPoolPageSize( pageSize );
+		for ( uint32_t i = 0; i < kEntityCount; i++ )
+		{
+			const ae::Entity entity = registry.CreateEntity();
+			registry.AddComponent< EntityTestPosition >( entity );
+			registry.AddComponent< EntityTestVelocity >( entity )->velocity = ae::Vec3( 1.0f, 0.0f, (float)i );
+		}
+		BENCHMARK( pageSize ? "Iterate pooled components" : "Iterate individually allocated components" )
+		{
+			return registry.CallFn< EntityTestVelocity >( []( EntityTestVelocity* v )
+			{
+				v->velocity.x += 1.0f;
+			} );
+		};
+		BENCHMARK( pageSize ? "Look up pooled sibling components" : "Look up individually allocated sibling components" )
+		{
+			return registry.CallFn< EntityTestVelocity >( [ &registry ]( EntityTestVelocity* v )
+			{
+				registry.GetComponent< EntityTestPosition >( v->GetEntity() ).position += v->velocity;
+			} );
+		};
+		registry.Clear();
+	}
+}
+
+//------------------------------------------------------------------------------
+// ae::RegistryCommandBuffer tests
+//------------------------------------------------------------------------------
+TEST_CASE( "RegistryCommandBuffer applies commands in order", "[ae::RegistryCommandBuffer]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	const ae::Entity existing = registry.CreateEntity( "existing" );
+	registry.AddComponent< EntityTestVelocity >( existing );
+	{
+		ae::RegistryCommandBuffer commands( &registry );
+		const ae::Entity created = commands.CreateEntity( "created" );
+		REQUIRE( created != existing );
+		REQUIRE( !registry.GetEntityByName( "created" ) ); // Named when applied
+		commands.AddComponent< EntityTestPosition >( created, []( EntityTestPosition* p ){ p->position = ae::Vec3( 1.0f ); } );
+		commands.DestroyComponent< EntityTestPosition >( created );
+		commands.AddComponent< EntityTestPosition >( created, []( EntityTestPosition* p ){ p->position = ae::Vec3( 2.0f ); } );
+		commands.AddComponent< EntityTestPosition >( created, []( EntityTestPosition* p ){ p->position = ae::Vec3( 3.0f ); } ); // Already exists
+		commands.DestroyComponent< EntityTestVelocity >( existing );
+		REQUIRE( commands.GetCommandCount() == 6 );
+		REQUIRE( !registry.TryGetComponent< EntityTestPosition >( created ) );
+		REQUIRE( registry.TryGetComponent< EntityTestVelocity >( existing ) );
+		commands.Apply();
+		REQUIRE( commands.GetCommandCount() == 0 );
+		REQUIRE( registry.GetEntityByName( "created" ) == created );
+		REQUIRE( registry.GetComponent< EntityTestPosition >( created ).position == ae::Vec3( 2.0f ) );
+		REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( existing ) );
+	}
+	registry.Clear();
+	REQUIRE( EntityTestPosition::s_liveCount == 0 );
+}
+
+TEST_CASE( "RegistryCommandBuffer skips commands for destroyed entities", "[ae::RegistryCommandBuffer]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	const ae::Entity entity = registry.CreateEntity( "entity" );
+	registry.AddComponent< EntityTestVelocity >( entity );
+	ae::RegistryCommandBuffer commands( &registry );
+	commands.Destroy( entity );
+	commands.AddComponent< EntityTestPosition >( entity );
+	commands.AddComponent< EntityTestVelocity >( entity );
+	commands.Apply();
+	REQUIRE( !registry.GetEntityByName( "entity" ) );
+	REQUIRE( !registry.TryGetComponent< EntityTestPosition >( entity ) );
+	REQUIRE( !registry.TryGetComponent< EntityTestVelocity >( entity ) );
+	REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 0 );
+	REQUIRE( EntityTestPosition::s_liveCount == 0 );
+
+	// Also when the entity is created and destroyed by the same buffer
+	const ae::Entity created = commands.CreateEntity( "created" );
+	commands.AddComponent< EntityTestPosition >( created );
+	commands.Destroy( created );
+	commands.AddComponent< EntityTestPosition >( created );
+	commands.Apply();
+	REQUIRE( !registry.GetEntityByName( "created" ) );
+	REQUIRE( !registry.TryGetComponent< EntityTestPosition >( created ) );
+	REQUIRE( EntityTestPosition::s_liveCount == 0 );
+	registry.Clear();
+}
+
+TEST_CASE( "RegistryCommandBuffer commands can be recorded from worker threads", "[ae::RegistryCommandBuffer]" )
+{
+	const uint32_t kEntityCount = 1000;
+	ae::Registry registry( TAG_ENTITY_TEST );
+	for ( uint32_t i = 0; i < kEntityCount; i++ )
+	{
+		registry.AddComponent< EntityTestVelocity >( registry.CreateEntity() )->velocity = ae::Vec3( (float)i );
+	}
+	ae::WorkerPool workerPool( TAG_ENTITY_TEST );
+	workerPool.Initialize( 4 );
+	ae::RegistryCommandBuffer commands( &registry );
+	ae::Entity created[ kEntityCount ];
+	workerPool.Run( kEntityCount, 16, [ & ]( uint32_t begin, uint32_t end )
+	{
+		for ( uint32_t i = begin; i < end; i++ )
+		{
+			// Each entity gets a new entity with a position, where only the
+			// last component added in recording order remains
+			const ae::Entity source = registry.GetEntityByIndex< EntityTestVelocity >( i );
+			const ae::Vec3 velocity = registry.GetComponentByIndex< EntityTestVelocity >( i ).velocity;
+			created[ i ] = commands.CreateEntity();
+			commands.AddComponent< EntityTestPosition >( created[ i ], []( EntityTestPosition* p ){ p->position = ae::Vec3( -1.0f ); } );
+			commands.DestroyComponent< EntityTestPosition >( created[ i ] );
+			commands.AddComponent< EntityTestPosition >( created[ i ], [ velocity ]( EntityTestPosition* p ){ p->position = velocity; } );
+			if ( i % 2 )
+			{
+				commands.Destroy( source );
+			}
+		}
+	} );
+	workerPool.Terminate();
+	REQUIRE( commands.GetCommandCount() == kEntityCount * 3 + kEntityCount / 2 );
+	commands.Apply();
+
+	REQUIRE( registry.GetComponentCount< EntityTestVelocity >() == kEntityCount / 2 );
+	REQUIRE( registry.GetComponentCount< EntityTestPosition >() == kEntityCount );
+	for ( uint32_t i = 0; i < kEntityCount; i++ )
+	{
+		REQUIRE( registry.GetComponent< EntityTestPosition >( created[ i ] ).position == ae::Vec3( (float)i ) );
+	}
+	// Entities are reserved atomically, so each one is unique
+	std::sort( created, created + kEntityCount );
+	REQUIRE( created[ 0 ] > kEntityCount );
+	REQUIRE( std::adjacent_find( created, created + kEntityCount ) == created + kEntityCount );
+	registry.Clear();
+}
+
+TEST_CASE( "Registry changes are not allowed during queries", "[ae::RegistryCommandBuffer]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	for ( uint32_t i = 0; i < 4; i++ )
+	{
+		registry.AddComponent< EntityTestVelocity >( registry.CreateEntity() );
+	}
+	ae::RegistryCommandBuffer commands( &registry );
+	const uint32_t count = registry.Query< EntityTestVelocity >().ForEach( [ & ]( ae::Entity entity, EntityTestVelocity* v )
+	{
+		REQUIRE_THROWS( registry.AddComponent< EntityTestPosition >( entity ) );
+		REQUIRE_THROWS( registry.DestroyComponent( v ) );
+		REQUIRE_THROWS( registry.Destroy( entity ) );
+		REQUIRE_THROWS( registry.Clear() );
+		REQUIRE_THROWS( commands.Apply() );
+		commands.AddComponent< EntityTestPosition >( entity );
+	} );
+	REQUIRE( count == 4 );
+	REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 0 );
+	commands.Apply();
+	REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 4 );
+	registry.Clear();
+}
+
+//------------------------------------------------------------------------------
+// ae::RegistryQuery tests
+//------------------------------------------------------------------------------
+// Entities 1-100 have velocities, and every tenth entity also has a position.
+// Entities 101-105 only have positions.
+static void EntityTest_FillQueryRegistry( ae::Registry* registry )
+{
+	for ( uint32_t i = 1; i <= 105; i++ )
+	{
+		const ae::Entity entity = registry->CreateEntity();
+		if ( i <= 100 )
+		{
+			registry->AddComponent< EntityTestVelocity >( entity );
+		}
+		if ( i % 10 == 0 || i > 100 )
+		{
+			registry->AddComponent< EntityTestPosition >( entity )->position = ae::Vec3( (float)entity );
+		}
+	}
+}
+
+TEST_CASE( "RegistryQuery iterates over the smallest component set", "[ae::RegistryQuery]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	EntityTest_FillQueryRegistry( &registry );
+	REQUIRE( registry.GetComponentCount< EntityTestPosition >() == 15 );
+	ae::Array< ae::Entity > visited = TAG_ENTITY_TEST;
+	const uint32_t count = registry.Query< EntityTestVelocity, EntityTestPosition >().ForEach( [ & ]( ae::Entity entity, EntityTestVelocity* v, EntityTestPosition* p )
+	{
+		REQUIRE( v->GetEntity() == entity );
+		REQUIRE( p->GetEntity() == entity );
+		visited.Append( entity );
+	} );
+	// Matches are in position order, and entities without velocities are skipped
+	REQUIRE( count == 10 );
+	REQUIRE( visited.Length() == 10 );
+	for ( uint32_t i = 0; i < visited.Length(); i++ )
+	{
+		REQUIRE( visited[ i ] == registry.GetEntityByIndex< EntityTestPosition >( i ) );
+		REQUIRE( visited[ i ] == ( i + 1 ) * 10 );
+	}
+
+	// Same result with the types in the other order
+	visited.Clear();
+	REQUIRE( registry.Query< EntityTestPosition, EntityTestVelocity >().ForEach( [ & ]( ae::Entity entity, EntityTestPosition*, EntityTestVelocity* )
+	{
+		visited.Append( entity );
+	} ) == 10 );
+	REQUIRE( visited.Length() == 10 );
+	REQUIRE( visited[ 9 ] == 100 );
+
+	// Removing a component from a matching entity removes the match
+	registry.Destroy( 50 );
+	REQUIRE( registry.Query< EntityTestVelocity, EntityTestPosition >().ForEach( []( ae::Entity, EntityTestVelocity*, EntityTestPosition* ){} ) == 9 );
+	registry.Clear();
+}
+
+TEST_CASE( "RegistryQuery matches nothing when a component type has no components", "[ae::RegistryQuery]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	for ( uint32_t i = 0; i < 10; i++ )
+	{
+		registry.AddComponent< EntityTestVelocity >( registry.CreateEntity() );
+	}
+	uint32_t calls = 0;
+	REQUIRE( registry.Query< EntityTestVelocity, EntityTestPosition >().ForEach( [ & ]( ae::Entity, EntityTestVelocity*, EntityTestPosition* ){ calls++; } ) == 0 );
+	REQUIRE( calls == 0 );
+	REQUIRE( registry.Query< EntityTestVelocity >().ForEach( [ & ]( ae::Entity, EntityTestVelocity* ){ calls++; } ) == 10 );
+	REQUIRE( calls == 10 );
+	registry.Clear();
+}
+
+TEST_CASE( "RegistryQuery const component types are read only", "[ae::RegistryQuery]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	EntityTest_FillQueryRegistry( &registry );
+	const uint32_t count = registry.Query< const EntityTestPosition, EntityTestVelocity >().ForEach( []( ae::Entity, auto* p, auto* v )
+	{
+		static_assert( std::is_same< decltype( p ), const EntityTestPosition* >::value, "Const components are passed as const pointers" );
+		static_assert( std::is_same< decltype( v ), EntityTestVelocity* >::value, "Other components are passed as non-const pointers" );
+		v->velocity = p->position;
+	} );
+	REQUIRE( count == 10 );
+	for ( uint32_t i = 10; i <= 100; i += 10 )
+	{
+		REQUIRE( registry.GetComponent< EntityTestVelocity >( i ).velocity == ae::Vec3( (float)i ) );
+	}
+	registry.Clear();
+}
+
+TEST_CASE( "RegistryQuery visits each match once from worker threads", "[ae::RegistryQuery]" )
+{
+	ae::Registry registry( TAG_ENTITY_TEST );
+	for ( uint32_t i = 0; i < 1000; i++ )
+	{
+		const ae::Entity entity = registry.CreateEntity();
+		registry.AddComponent< EntityTestVelocity >( entity );
+		if ( i % 3 )
+		{
+			registry.AddComponent< EntityTestPosition >( entity );
+		}
+	}
+	ae::WorkerPool workerPool( TAG_ENTITY_TEST );
+	workerPool.Initialize( 4 );
+	std::atomic< uint32_t > calls = { 0 };
+	const uint32_t count = registry.Query< EntityTestVelocity, const EntityTestPosition >().ForEach( &workerPool, 7, [ & ]( ae::Entity, EntityTestVelocity* v, const EntityTestPosition* )
+	{
+		v->velocity.x += 1.0f;
+		calls++;
+	} );
+	workerPool.Terminate();
+	REQUIRE( count == 666 );
+	REQUIRE( calls == 666 );
+	for ( uint32_t i = 0; i < registry.GetComponentCount< EntityTestVelocity >(); i++ )
+	{
+		const ae::Entity entity = registry.GetEntityByIndex< EntityTestVelocity >( i );
+		const float expected = registry.TryGetComponent< EntityTestPosition >( entity ) ? 1.0f : 0.0f;
+		REQUIRE( registry.GetComponentByIndex< EntityTestVelocity >( i ).velocity.x == expected );
+	}
+	registry.Clear();
+}
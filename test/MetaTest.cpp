@@ -25,6 +25,7 @@
 //------------------------------------------------------------------------------
 #include "MetaTest.h"
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 //------------------------------------------------------------------------------
 // Types
@@ -165,6 +166,60 @@ TEST_CASE( "Class vars", "[aeMeta]" )
 	REQUIRE( strcmp( enumVar->GetPropertyValue( "prop1", 1 ), "val1" ) == 0 );
 }
 
+TEST_CASE( "Inherited class vars", "[aeMeta]" )
+{
+	const ae::Type* someType = ae::GetType< SomeClass >();
+	const ae::Type* namespaceType = ae::GetType< Namespace0::Namespace1::NamespaceClass >();
+	REQUIRE( namespaceType->GetVarCount( false ) == 0 );
+	REQUIRE( namespaceType->GetVarCount( true ) == someType->GetVarCount( false ) );
+	for ( uint32_t i = 0; i < someType->GetVarCount( false ); i++ )
+	{
+		const ae::Var* var = someType->GetVarByIndex( i, false );
+		REQUIRE( namespaceType->GetVarByIndex( i, true ) == var );
+		REQUIRE( namespaceType->GetVarByName( var->GetName(), true ) == var );
+		REQUIRE( namespaceType->GetVarByName( var->GetName(), false ) == nullptr );
+		REQUIRE( someType->GetVarByName( var->GetName(), false ) == var );
+	}
+	REQUIRE( namespaceType->GetVarByName( "missing", true ) == nullptr );
+	REQUIRE( someType->GetVarByName( "missing", false ) == nullptr );
+
+	const ae::Type* refAType = ae::GetType< RefTesterA >();
+	REQUIRE( refAType->GetVarCount( true ) == 3 );
+	REQUIRE( strcmp( refAType->GetVarByIndex( 0, true )->GetName(), "notRef" ) == 0 );
+	REQUIRE( strcmp( refAType->GetVarByIndex( 2, true )->GetName(), "refB" ) == 0 );
+	REQUIRE( refAType->GetVarByName( "refB", true ) == refAType->GetVarByIndex( 2, false ) );
+	REQUIRE( ae::GetType< RefTester >()->GetVarByName( "refB", true ) == nullptr );
+}
+
+TEST_CASE( "Var tables are built lazily from multiple threads", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	const ae::Type* parentType = ae::GetType< SomeClass >();
+	const uint32_t varCount = type->GetVarCount( true );
+	ae::WorkerPool workerPool( AE_ALLOC_TAG_META_TEST );
+	workerPool.Initialize( 4 );
+	for ( uint32_t run = 0; run < 16; run++ )
+	{
+		// The first accesses below rebuild the var tables
+		ae::Type::InvalidateCachedInfo();
+		std::atomic< uint32_t > failures = { 0 };
+		workerPool.Run( 64, 1, [ & ]( uint32_t begin, uint32_t end )
+		{
+			for ( uint32_t i = begin; i < end; i++ )
+			{
+				if ( type->GetVarCount( true ) != varCount
+					|| !type->GetVarByName( "intMember", true )
+					|| !type->IsType( parentType ) )
+				{
+					failures++;
+				}
+			}
+		} );
+		REQUIRE( failures == 0 );
+	}
+	workerPool.Terminate();
+}
+
 //------------------------------------------------------------------------------
 // NamespaceClass
 //------------------------------------------------------------------------------
@@ -175,6 +230,50 @@ TEST_CASE( "Class registration in namespaces", "[aeMeta]" )
 	REQUIRE( ae::GetType< Namespace0::Namespace1::NamespaceClass >() == ae::GetTypeByName( "Namespace0::Namespace1::NamespaceClass" ) );
 }
 
+TEST_CASE( "Class inheritance", "[aeMeta]" )
+{
+	const ae::Type* objectType = ae::GetTypeByName( "ae::Object" );
+	const ae::Type* someType = ae::GetType< SomeClass >();
+	const ae::Type* namespaceType = ae::GetType< Namespace0::Namespace1::NamespaceClass >();
+	const ae::Type* refType = ae::GetType< RefTester >();
+	const ae::Type* refAType = ae::GetType< RefTesterA >();
+	const ae::Type* refBType = ae::GetType< RefTesterB >();
+
+	REQUIRE( objectType->GetParentType() == nullptr );
+	REQUIRE( someType->GetParentType() == objectType );
+	REQUIRE( namespaceType->GetParentType() == someType );
+	REQUIRE( objectType->GetInheritanceDepth() == 0 );
+	REQUIRE( someType->GetInheritanceDepth() == 1 );
+	REQUIRE( namespaceType->GetInheritanceDepth() == 2 );
+	REQUIRE( refAType->GetInheritanceDepth() == 2 );
+
+	REQUIRE( namespaceType->IsType( namespaceType ) );
+	REQUIRE( namespaceType->IsType( someType ) );
+	REQUIRE( namespaceType->IsType( objectType ) );
+	REQUIRE( !someType->IsType( namespaceType ) );
+	REQUIRE( !objectType->IsType( someType ) );
+	REQUIRE( refAType->IsType< RefTester >() );
+	REQUIRE( !refAType->IsType( refBType ) );
+	REQUIRE( !refBType->IsType( refAType ) );
+	REQUIRE( !refType->IsType( someType ) );
+	REQUIRE( !namespaceType->IsType( refType ) );
+	for ( uint32_t i = 0; i < ae::GetTypeCount(); i++ )
+	{
+		REQUIRE( ae::GetTypeByIndex( i )->IsType( objectType ) );
+	}
+
+	Namespace0::Namespace1::NamespaceClass namespaceObj;
+	RefTesterA refAObj;
+	ae::Object* obj = &namespaceObj;
+	REQUIRE( ae::Cast< SomeClass >( obj ) == &namespaceObj );
+	REQUIRE( ae::Cast< Namespace0::Namespace1::NamespaceClass >( obj ) == &namespaceObj );
+	REQUIRE( ae::Cast< RefTester >( obj ) == nullptr );
+	obj = &refAObj;
+	REQUIRE( ae::Cast< RefTester >( obj ) == &refAObj );
+	REQUIRE( ae::Cast< RefTesterB >( obj ) == nullptr );
+	REQUIRE( ae::Cast< SomeClass >( obj ) == nullptr );
+}
+
 //------------------------------------------------------------------------------
 // PlayerState
 //------------------------------------------------------------------------------
@@ -860,3 +959,663 @@ TEST_CASE( "bitfield registration", "[aeMeta]" )
 	// REQUIRE( playerStateEnum->GetNameByIndex( 2 ) == "Jump" );
 	// REQUIRE( playerStateEnum->GetValueByIndex( 2 ) == 2 );
 }
+
+//------------------------------------------------------------------------------
+// Binary serialization
+//------------------------------------------------------------------------------
+static void FillSerializeClass( SerializeClass* obj, uint32_t seed )
+{
+	obj->intMember = -7 - (int32_t)seed;
+	obj->boolMember = true;
+	obj->enumTest = TestEnumClass::NegativeOne;
+	obj->floatMember = 1.5f + seed;
+	obj->doubleMember = -2.25 * seed;
+	obj->uint8Member = 200;
+	obj->int64Member = -( 1ll << 40 ) - seed;
+	obj->vec3Member = ae::Vec3( 1.0f, 2.0f, 3.0f + seed );
+	obj->matrixMember = ae::Matrix4::Translation( ae::Vec3( 4.0f, 5.0f, 6.0f ) ) * ae::Matrix4::Scaling( 2.0f );
+	obj->colorMember = ae::Color::RGBA( 0.25f, 0.5f, 0.75f, 1.0f );
+	obj->int3Member = ae::Int3( -1, 0, (int32_t)seed );
+	obj->strMember = ae::Str32::Format( "object #", seed );
+	obj->stateMember = PlayerState::Jump;
+	obj->points[ 0 ] = ae::Vec3( -1.0f );
+	obj->points[ 1 ] = ae::Vec3( 8.0f, 9.0f, 10.0f );
+	obj->names.Clear();
+	obj->names.Append( "alpha" );
+	obj->names.Append( "beta" );
+	obj->weights.Clear();
+	for ( uint32_t i = 0; i < 8; i++ )
+	{
+		obj->weights.Append( i * 0.125f );
+	}
+}
+
+static void RequireSerializeClassEqual( const SerializeClass& a, const SerializeClass& b )
+{
+	REQUIRE( a.intMember == b.intMember );
+	REQUIRE( a.boolMember == b.boolMember );
+	REQUIRE( a.enumTest == b.enumTest );
+	REQUIRE( a.floatMember == b.floatMember );
+	REQUIRE( a.doubleMember == b.doubleMember );
+	REQUIRE( a.uint8Member == b.uint8Member );
+	REQUIRE( a.int64Member == b.int64Member );
+	REQUIRE( a.vec3Member == b.vec3Member );
+	REQUIRE( a.matrixMember == b.matrixMember );
+	REQUIRE( a.colorMember.r == b.colorMember.r );
+	REQUIRE( a.colorMember.g == b.colorMember.g );
+	REQUIRE( a.colorMember.b == b.colorMember.b );
+	REQUIRE( a.colorMember.a == b.colorMember.a );
+	REQUIRE( a.int3Member == b.int3Member );
+	REQUIRE( a.strMember == b.strMember );
+	REQUIRE( a.stateMember == b.stateMember );
+	REQUIRE( a.points[ 0 ] == b.points[ 0 ] );
+	REQUIRE( a.points[ 1 ] == b.points[ 1 ] );
+	REQUIRE( a.names.Length() == b.names.Length() );
+	for ( uint32_t i = 0; i < a.names.Length(); i++ )
+	{
+		REQUIRE( a.names[ i ] == b.names[ i ] );
+	}
+	REQUIRE( a.weights.Length() == b.weights.Length() );
+	for ( uint32_t i = 0; i < a.weights.Length(); i++ )
+	{
+		REQUIRE( a.weights[ i ] == b.weights[ i ] );
+	}
+}
+
+TEST_CASE( "Registered vars can be serialized to a binary stream", "[aeMeta]" )
+{
+	SerializeClass src;
+	FillSerializeClass( &src, 3 );
+
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	{
+		ae::BinaryWriter writer( &data );
+		writer.SerializeObject( (const ae::Object&)src );
+		REQUIRE( writer.IsValid() );
+	}
+
+	SerializeClass dst;
+	dst.weights.Append( 99.0f, 20 );
+	{
+		ae::BinaryReader reader( data );
+		reader.SerializeObject( (ae::Object&)dst );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+	}
+	RequireSerializeClassEqual( src, dst );
+}
+
+TEST_CASE( "Nested objects and arrays can be serialized to a binary stream", "[aeMeta]" )
+{
+	ArrayClass src;
+	for ( uint32_t i = 0; i < 3; i++ )
+	{
+		src.intArray[ i ] = i + 1;
+		src.someClassArray[ i ].intMember = i + 10;
+		src.someClassArray[ i ].boolMember = ( i % 2 );
+		src.someClassArray[ i ].enumTest = TestEnumClass::Four;
+	}
+	src.intArray2.Append( 5, 4 );
+	src.intArray3.Append( 6, 17 );
+	src.someClassArray2.Append( src.someClassArray[ 1 ] );
+	src.someClassArray3.Append( src.someClassArray[ 2 ], 5 );
+
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	ae::BinaryWriter writer( &data );
+	ae::GetType< ArrayClass >()->SerializeObject( &writer, &src );
+	REQUIRE( writer.IsValid() );
+
+	ArrayClass dst;
+	ae::BinaryReader reader( data );
+	ae::GetType< ArrayClass >()->SerializeObject( &reader, &dst );
+	REQUIRE( reader.IsValid() );
+	REQUIRE( reader.GetRemainingBytes() == 0 );
+	for ( uint32_t i = 0; i < 3; i++ )
+	{
+		REQUIRE( dst.intArray[ i ] == src.intArray[ i ] );
+		REQUIRE( dst.someClassArray[ i ].intMember == src.someClassArray[ i ].intMember );
+		REQUIRE( dst.someClassArray[ i ].boolMember == src.someClassArray[ i ].boolMember );
+		REQUIRE( dst.someClassArray[ i ].enumTest == src.someClassArray[ i ].enumTest );
+	}
+	REQUIRE( dst.intArray2.Length() == 4 );
+	REQUIRE( dst.intArray3.Length() == 17 );
+	REQUIRE( dst.intArray3[ 16 ] == 6 );
+	REQUIRE( dst.someClassArray2.Length() == 1 );
+	REQUIRE( dst.someClassArray2[ 0 ].intMember == 11 );
+	REQUIRE( dst.someClassArray3.Length() == 5 );
+	REQUIRE( dst.someClassArray3[ 4 ].intMember == 12 );
+}
+
+TEST_CASE( "Binary object serialization skips unknown and mismatched vars", "[aeMeta]" )
+{
+	// Derived data read into the base type only fills the base vars
+	SerializeClass derived;
+	FillSerializeClass( &derived, 1 );
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	{
+		ae::BinaryWriter writer( &data );
+		ae::GetType< SerializeClass >()->SerializeObject( &writer, &derived );
+		REQUIRE( writer.IsValid() );
+	}
+	{
+		SomeClass base;
+		base.intMember = 0;
+		base.boolMember = false;
+		base.enumTest = TestEnumClass::Zero;
+		ae::BinaryReader reader( data );
+		ae::GetType< SomeClass >()->SerializeObject( &reader, &base );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+		REQUIRE( base.intMember == derived.intMember );
+		REQUIRE( base.boolMember );
+		REQUIRE( base.enumTest == TestEnumClass::NegativeOne );
+	}
+
+	// Base data read into the derived type leaves the new vars untouched
+	SerializeClass expected;
+	FillSerializeClass( &expected, 2 );
+	SerializeClass target;
+	FillSerializeClass( &target, 2 );
+	{
+		SomeClass base;
+		base.intMember = 123;
+		base.boolMember = false;
+		base.enumTest = TestEnumClass::Five;
+		expected.intMember = 123;
+		expected.boolMember = false;
+		expected.enumTest = TestEnumClass::Five;
+		data.Clear();
+		ae::BinaryWriter writer( &data );
+		ae::GetType< SomeClass >()->SerializeObject( &writer, &base );
+		ae::BinaryReader reader( data );
+		ae::GetType< SerializeClass >()->SerializeObject( &reader, &target );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+	}
+	RequireSerializeClassEqual( expected, target );
+
+	// Unrelated nested object data is skipped entirely
+	{
+		AggregateClass aggregate;
+		aggregate.someClass.intMember = 1;
+		aggregate.someClass.boolMember = true;
+		aggregate.someClass.enumTest = TestEnumClass::One;
+		aggregate.someClass1 = aggregate.someClass;
+		data.Clear();
+		ae::BinaryWriter writer( &data );
+		ae::GetType< AggregateClass >()->SerializeObject( &writer, &aggregate );
+		SomeClass some;
+		some.intMember = 55;
+		ae::BinaryReader reader( data );
+		ae::GetType< SomeClass >()->SerializeObject( &reader, &some );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+		REQUIRE( some.intMember == 55 );
+	}
+
+	// Truncated data invalidates the stream
+	{
+		ae::BinaryReader reader( data.Data(), data.Length() - 1 );
+		AggregateClass aggregate;
+		ae::GetType< AggregateClass >()->SerializeObject( &reader, &aggregate );
+		REQUIRE( !reader.IsValid() );
+	}
+}
+
+TEST_CASE( "Binary object serialization clamps array lengths", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< ArrayClass >();
+	const uint8_t ownerDepth = (uint8_t)type->GetInheritanceDepth();
+	const uint8_t intArrayTag = (uint8_t)ae::BasicType::Int32 | 0x80;
+	const uint8_t classArrayTag = (uint8_t)ae::BasicType::Class | 0x80;
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+
+	// Elements that don't fit in 'ae::Array< int32_t, 4 > intArray2' are skipped
+	{
+		ae::BinaryWriter writer( &data );
+		uint32_t count = 2;
+		writer.SerializeVarUint32( count );
+		writer.SerializeUint32( ae::GetHash( "intArray2" ) );
+		writer.SerializeUint8( ownerDepth );
+		writer.SerializeUint8( intArrayTag );
+		uint32_t length = 6;
+		writer.SerializeVarUint32( length );
+		for ( int32_t i = 0; i < (int32_t)length; i++ )
+		{
+			writer.SerializeInt32( i );
+		}
+		writer.SerializeUint32( ae::GetHash( "intArray3" ) );
+		writer.SerializeUint8( ownerDepth );
+		writer.SerializeUint8( intArrayTag );
+		length = 2;
+		writer.SerializeVarUint32( length );
+		writer.SerializeInt32( 7 );
+		writer.SerializeInt32( 8 );
+		REQUIRE( writer.IsValid() );
+	}
+	{
+		ArrayClass dst;
+		ae::BinaryReader reader( data );
+		type->SerializeObject( &reader, &dst );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+		REQUIRE( dst.intArray2.Length() == 4 );
+		for ( int32_t i = 0; i < 4; i++ )
+		{
+			REQUIRE( dst.intArray2[ i ] == i );
+		}
+		REQUIRE( dst.intArray3.Length() == 2 );
+		REQUIRE( dst.intArray3[ 0 ] == 7 );
+		REQUIRE( dst.intArray3[ 1 ] == 8 );
+	}
+
+	// Corrupt lengths invalidate the stream without resizing the array
+	for ( const char* varName : { "intArray3", "someClassArray3" } )
+	{
+		data.Clear();
+		ae::BinaryWriter writer( &data );
+		uint32_t count = 1;
+		writer.SerializeVarUint32( count );
+		writer.SerializeUint32( ae::GetHash( varName ) );
+		writer.SerializeUint8( ownerDepth );
+		writer.SerializeUint8( ( varName[ 0 ] == 'i' ) ? intArrayTag : classArrayTag );
+		uint32_t length = 0xFFFFFFF0;
+		writer.SerializeVarUint32( length );
+		writer.SerializeInt32( 1 );
+		REQUIRE( writer.IsValid() );
+
+		ArrayClass dst;
+		ae::BinaryReader reader( data );
+		type->SerializeObject( &reader, &dst );
+		REQUIRE( !reader.IsValid() );
+		REQUIRE( dst.intArray3.Length() == 0 );
+		REQUIRE( dst.someClassArray3.Length() == 0 );
+	}
+
+	// Truncated array data invalidates the stream
+	{
+		ArrayClass src;
+		src.intArray3.Append( 3, 8 );
+		data.Clear();
+		ae::BinaryWriter writer( &data );
+		type->SerializeObject( &writer, &src );
+		REQUIRE( writer.IsValid() );
+		for ( uint32_t length = 0; length < data.Length(); length++ )
+		{
+			ArrayClass dst;
+			ae::BinaryReader reader( data.Data(), length );
+			type->SerializeObject( &reader, &dst );
+			REQUIRE( !reader.IsValid() );
+		}
+	}
+}
+
+TEST_CASE( "Binary object serialization keeps shadowed vars separate", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< ShadowClass >();
+	REQUIRE( type->GetVarCount( true ) == 2 );
+	ShadowClass src;
+	static_cast< ShadowBaseClass& >( src ).x = 1;
+	src.x = 2;
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	ae::BinaryWriter writer( &data );
+	type->SerializeObject( &writer, &src );
+	REQUIRE( writer.IsValid() );
+	
+	ShadowClass dst;
+	ae::BinaryReader reader( data );
+	type->SerializeObject( &reader, &dst );
+	REQUIRE( reader.IsValid() );
+	REQUIRE( reader.GetRemainingBytes() == 0 );
+	REQUIRE( static_cast< ShadowBaseClass& >( dst ).x == 1 );
+	REQUIRE( dst.x == 2 );
+
+	// Only the shadowed parent var
+	const ae::Var* baseVar = ae::GetType< ShadowBaseClass >()->GetVarByName( "x", false );
+	REQUIRE( baseVar );
+	static_cast< ShadowBaseClass& >( src ).x = 3;
+	src.x = 4;
+	data.Clear();
+	ae::BinaryWriter varsWriter( &data );
+	type->SerializeVars( &varsWriter, &src, &baseVar, 1 );
+	REQUIRE( varsWriter.IsValid() );
+	ae::BinaryReader varsReader( data );
+	type->SerializeObject( &varsReader, &dst );
+	REQUIRE( varsReader.IsValid() );
+	REQUIRE( static_cast< ShadowBaseClass& >( dst ).x == 3 );
+	REQUIRE( dst.x == 2 );
+}
+
+TEST_CASE( "A subset of registered vars can be serialized to a binary stream", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	const ae::Var* vars[] =
+	{
+		type->GetVarByName( "intMember", true ), // Parent var
+		type->GetVarByName( "vec3Member", false ),
+		type->GetVarByName( "weights", false ),
+	};
+	REQUIRE( vars[ 0 ] );
+	REQUIRE( vars[ 1 ] );
+	REQUIRE( vars[ 2 ] );
+
+	SerializeClass src;
+	FillSerializeClass( &src, 4 );
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	{
+		ae::BinaryWriter writer( &data );
+		type->SerializeVars( &writer, &src, vars, countof(vars) );
+		REQUIRE( writer.IsValid() );
+	}
+
+	SerializeClass dst;
+	FillSerializeClass( &dst, 5 );
+	SerializeClass expected;
+	FillSerializeClass( &expected, 5 );
+	expected.intMember = src.intMember;
+	expected.vec3Member = src.vec3Member;
+	expected.weights = src.weights;
+	{
+		ae::BinaryReader reader( data );
+		type->SerializeObject( &reader, &dst );
+		REQUIRE( reader.IsValid() );
+		REQUIRE( reader.GetRemainingBytes() == 0 );
+	}
+	RequireSerializeClassEqual( expected, dst );
+}
+
+TEST_CASE( "Binary object serialization benchmark", "[.benchmark][aeMeta]" )
+{
+	const uint32_t kObjectCount = 1000;
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	ae::Array< SerializeClass > objects = AE_ALLOC_TAG_META_TEST;
+	objects.Reserve( kObjectCount );
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		FillSerializeClass( &objects.Append( {} ), i );
+	}
+
+	// String conversion of every var and array element, which is what the
+	// editor level format goes through on save and load
+	typedef ae::Array< ae::Str256 > ObjectStrings;
+	ae::Array< ObjectStrings > strings = AE_ALLOC_TAG_META_TEST;
+	auto saveStrings = [&]()
+	{
+		strings.Clear();
+		for ( const SerializeClass& obj : objects )
+		{
+			ObjectStrings& objStrings = strings.Append( AE_ALLOC_TAG_META_TEST );
+			for ( uint32_t i = 0; i < type->GetVarCount( true ); i++ )
+			{
+				const ae::Var* var = type->GetVarByIndex( i, true );
+				if ( var->IsArray() )
+				{
+					const uint32_t length = var->GetArrayLength( &obj );
+					objStrings.Append( ae::Str256::Format( "#", length ) );
+					for ( uint32_t j = 0; j < length; j++ )
+					{
+						objStrings.Append( var->GetObjectValueAsString( &obj, j ).c_str() );
+					}
+				}
+				else
+				{
+					objStrings.Append( var->GetObjectValueAsString( &obj ).c_str() );
+				}
+			}
+		}
+		return strings.Length();
+	};
+	auto loadStrings = [&]()
+	{
+		uint32_t count = 0;
+		for ( uint32_t o = 0; o < kObjectCount; o++ )
+		{
+			SerializeClass* obj = &objects[ o ];
+			const ObjectStrings& objStrings = strings[ o ];
+			uint32_t s = 0;
+			for ( uint32_t i = 0; i < type->GetVarCount( true ); i++ )
+			{
+				const ae::Var* var = type->GetVarByIndex( i, true );
+				if ( var->IsArray() )
+				{
+					const uint32_t length = var->SetArrayLength( obj, atoi( objStrings[ s++ ].c_str() ) );
+					for ( uint32_t j = 0; j < length; j++ )
+					{
+						var->SetObjectValueFromString( obj, objStrings[ s++ ].c_str(), j );
+					}
+				}
+				else
+				{
+					var->SetObjectValueFromString( obj, objStrings[ s++ ].c_str() );
+				}
+			}
+			count += s;
+		}
+		return count;
+	};
+
+	ae::Array< uint8_t > data = AE_ALLOC_TAG_META_TEST;
+	auto saveBinary = [&]()
+	{
+		data.Clear();
+		ae::BinaryWriter writer( &data );
+		for ( const SerializeClass& obj : objects )
+		{
+			type->SerializeObject( &writer, &obj );
+		}
+		return writer.IsValid();
+	};
+	auto loadBinary = [&]()
+	{
+		ae::BinaryReader reader( data );
+		for ( SerializeClass& obj : objects )
+		{
+			type->SerializeObject( &reader, &obj );
+		}
+		return reader.IsValid();
+	};
+
+	BENCHMARK( "Save strings" ) { return saveStrings(); };
+	BENCHMARK( "Load strings" ) { return loadStrings(); };
+	BENCHMARK( "Save binary" ) { return saveBinary(); };
+	BENCHMARK( "Load binary" ) { return loadBinary(); };
+}
+
+//------------------------------------------------------------------------------
+// Typed var access
+//------------------------------------------------------------------------------
+TEST_CASE( "VarAccessor validates type when bound", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	const ae::Var* floatVar = type->GetVarByName( "floatMember", false );
+	const ae::Var* strVar = type->GetVarByName( "strMember", false );
+	const ae::Var* weightsVar = type->GetVarByName( "weights", false );
+	const ae::Var* intVar = type->GetVarByName( "intMember", true );
+	REQUIRE( floatVar );
+	REQUIRE( strVar );
+	REQUIRE( weightsVar );
+	REQUIRE( intVar );
+
+	REQUIRE( !ae::VarAccessor< float >().IsBound() );
+	REQUIRE( !ae::VarAccessor< float >( nullptr ).IsBound() );
+	REQUIRE( ae::VarAccessor< float >( floatVar ).IsBound() );
+	REQUIRE( !ae::VarAccessor< double >( floatVar ).IsBound() );
+	REQUIRE( !ae::VarAccessor< int32_t >( floatVar ).IsBound() );
+	REQUIRE( ae::VarAccessor< ae::Str32 >( strVar ).IsBound() );
+	REQUIRE( !ae::VarAccessor< ae::Str16 >( strVar ).IsBound() );
+	REQUIRE( ae::VarAccessor< ae::Array< float > >( weightsVar ).IsBound() );
+	REQUIRE( !ae::VarAccessor< float >( weightsVar ).IsBound() );
+
+	ae::VarAccessor< float > floatAccessor( floatVar );
+	REQUIRE( floatAccessor.GetVar() == floatVar );
+	REQUIRE( !floatAccessor.Bind( intVar ) );
+	REQUIRE( !floatAccessor.IsBound() );
+	REQUIRE( floatAccessor.GetVar() == nullptr );
+}
+
+TEST_CASE( "VarAccessor can get and set var values", "[aeMeta]" )
+{
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	ae::VarAccessor< float > floatAccessor( type->GetVarByName( "floatMember", false ) );
+	ae::VarAccessor< int32_t > intAccessor( type->GetVarByName( "intMember", true ) );
+	ae::VarAccessor< ae::Str32 > strAccessor( type->GetVarByName( "strMember", false ) );
+	ae::VarAccessor< PlayerState > stateAccessor( type->GetVarByName( "stateMember", false ) );
+	ae::VarAccessor< ae::Array< float > > weightsAccessor( type->GetVarByName( "weights", false ) );
+	REQUIRE( floatAccessor.IsBound() );
+	REQUIRE( intAccessor.IsBound() );
+	REQUIRE( strAccessor.IsBound() );
+	REQUIRE( stateAccessor.IsBound() );
+	REQUIRE( weightsAccessor.IsBound() );
+
+	SerializeClass obj;
+	FillSerializeClass( &obj, 4 );
+	const ae::Object* constObj = &obj;
+	REQUIRE( floatAccessor.Get( constObj ) == obj.floatMember );
+	REQUIRE( intAccessor.Get( constObj ) == obj.intMember );
+	REQUIRE( strAccessor.Get( constObj ) == obj.strMember );
+	REQUIRE( stateAccessor.Get( constObj ) == PlayerState::Jump );
+	REQUIRE( &weightsAccessor.Get( constObj ) == &obj.weights );
+
+	floatAccessor.Set( &obj, 12.5f );
+	intAccessor.Set( &obj, -99 );
+	strAccessor.Set( &obj, "accessor" );
+	stateAccessor.Set( &obj, PlayerState::Run );
+	weightsAccessor.Get( &obj ).Append( 3.0f );
+	REQUIRE( obj.floatMember == 12.5f );
+	REQUIRE( obj.intMember == -99 );
+	REQUIRE( obj.strMember == "accessor" );
+	REQUIRE( obj.stateMember == PlayerState::Run );
+	REQUIRE( obj.weights.Length() == 9 );
+
+	// Vars of a base type can be accessed on derived objects
+	ae::VarAccessor< int32_t > baseIntAccessor( ae::GetType< SomeClass >()->GetVarByName( "intMember", false ) );
+	REQUIRE( baseIntAccessor.Get( constObj ) == -99 );
+}
+
+TEST_CASE( "Registered vars can be copied between objects", "[aeMeta]" )
+{
+	SerializeClass src;
+	FillSerializeClass( &src, 5 );
+	SerializeClass dst;
+	dst.weights.Append( 1.0f, 30 );
+	dst.names.Append( "extra", 4 );
+	ae::GetType< SerializeClass >()->CopyVars( &dst, &src );
+	RequireSerializeClassEqual( src, dst );
+
+	// Only the vars of the given type are copied
+	FillSerializeClass( &dst, 6 );
+	SerializeClass expected;
+	FillSerializeClass( &expected, 6 );
+	expected.intMember = src.intMember;
+	expected.boolMember = src.boolMember;
+	expected.enumTest = src.enumTest;
+	ae::GetType< SomeClass >()->CopyVars( &dst, &src );
+	RequireSerializeClassEqual( expected, dst );
+
+	// Nested objects and arrays
+	ArrayClass srcArrays;
+	for ( uint32_t i = 0; i < 3; i++ )
+	{
+		srcArrays.intArray[ i ] = i + 1;
+		srcArrays.someClassArray[ i ].intMember = i + 10;
+		srcArrays.someClassArray[ i ].boolMember = true;
+		srcArrays.someClassArray[ i ].enumTest = TestEnumClass::Two;
+	}
+	srcArrays.intArray2.Append( 7, 3 );
+	srcArrays.intArray3.Append( 8, 12 );
+	srcArrays.someClassArray2.Append( srcArrays.someClassArray[ 0 ], 2 );
+	srcArrays.someClassArray3.Append( srcArrays.someClassArray[ 2 ], 6 );
+	ArrayClass dstArrays;
+	dstArrays.intArray3.Append( 0, 40 );
+	ae::GetType< ArrayClass >()->CopyVars( &dstArrays, &srcArrays );
+	for ( uint32_t i = 0; i < 3; i++ )
+	{
+		REQUIRE( dstArrays.intArray[ i ] == srcArrays.intArray[ i ] );
+		REQUIRE( dstArrays.someClassArray[ i ].intMember == srcArrays.someClassArray[ i ].intMember );
+		REQUIRE( dstArrays.someClassArray[ i ].boolMember );
+		REQUIRE( dstArrays.someClassArray[ i ].enumTest == TestEnumClass::Two );
+	}
+	REQUIRE( dstArrays.intArray2.Length() == 3 );
+	REQUIRE( dstArrays.intArray3.Length() == 12 );
+	REQUIRE( dstArrays.intArray3[ 11 ] == 8 );
+	REQUIRE( dstArrays.someClassArray2.Length() == 2 );
+	REQUIRE( dstArrays.someClassArray2[ 1 ].intMember == 10 );
+	REQUIRE( dstArrays.someClassArray3.Length() == 6 );
+	REQUIRE( dstArrays.someClassArray3[ 5 ].intMember == 12 );
+}
+
+TEST_CASE( "Typed var access benchmark", "[.benchmark][aeMeta]" )
+{
+	const uint32_t kObjectCount = 1000;
+	const ae::Type* type = ae::GetType< SerializeClass >();
+	ae::Array< SerializeClass > objects = AE_ALLOC_TAG_META_TEST;
+	objects.Reserve( kObjectCount );
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		FillSerializeClass( &objects.Append( {} ), i );
+	}
+	const ae::Var* floatVar = type->GetVarByName( "floatMember", false );
+	const ae::Var* vecVar = type->GetVarByName( "vec3Member", false );
+
+	BENCHMARK( "Var::Get/SetObjectValue" )
+	{
+		float total = 0.0f;
+		for ( SerializeClass& obj : objects )
+		{
+			float f = 0.0f;
+			ae::Vec3 v;
+			floatVar->GetObjectValue( &obj, &f );
+			vecVar->GetObjectValue( &obj, &v );
+			floatVar->SetObjectValue( &obj, f + v.x );
+			total += f;
+		}
+		return total;
+	};
+	BENCHMARK( "VarAccessor::Get/Set" )
+	{
+		const ae::VarAccessor< float > floatAccessor( floatVar );
+		const ae::VarAccessor< ae::Vec3 > vecAccessor( vecVar );
+		float total = 0.0f;
+		for ( SerializeClass& obj : objects )
+		{
+			const float f = floatAccessor.Get( &obj );
+			floatAccessor.Set( &obj, f + vecAccessor.Get( &obj ).x );
+			total += f;
+		}
+		return total;
+	};
+
+	ae::Array< SerializeClass > copies = AE_ALLOC_TAG_META_TEST;
+	copies.Append( {}, kObjectCount );
+	BENCHMARK( "Copy vars with strings" )
+	{
+		for ( uint32_t o = 0; o < kObjectCount; o++ )
+		{
+			for ( uint32_t i = 0; i < type->GetVarCount( true ); i++ )
+			{
+				const ae::Var* var = type->GetVarByIndex( i, true );
+				if ( var->IsArray() )
+				{
+					const uint32_t length = var->SetArrayLength( &copies[ o ], var->GetArrayLength( &objects[ o ] ) );
+					for ( uint32_t j = 0; j < length; j++ )
+					{
+						var->SetObjectValueFromString( &copies[ o ], var->GetObjectValueAsString( &objects[ o ], j ).c_str(), j );
+					}
+				}
+				else
+				{
+					var->SetObjectValueFromString( &copies[ o ], var->GetObjectValueAsString( &objects[ o ] ).c_str() );
+				}
+			}
+		}
+		return copies.Length();
+	};
+	BENCHMARK( "Type::CopyVars" )
+	{
+		for ( uint32_t o = 0; o < kObjectCount; o++ )
+		{
+			type->CopyVars( &copies[ o ], &objects[ o ] );
+		}
+		return copies.Length();
+	};
+}
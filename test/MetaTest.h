@@ -105,6 +105,45 @@ public:
 	ae::Array< SomeClass > someClassArray3 = AE_ALLOC_TAG_META_TEST;
 };
 
+//------------------------------------------------------------------------------
+// SerializeClass
+//------------------------------------------------------------------------------
+class SerializeClass : public ae::Inheritor< SomeClass, SerializeClass >
+{
+public:
+	float floatMember = 0.0f;
+	double doubleMember = 0.0;
+	uint8_t uint8Member = 0;
+	int64_t int64Member = 0;
+	ae::Vec3 vec3Member = ae::Vec3( 0.0f );
+	ae::Matrix4 matrixMember = ae::Matrix4::Identity();
+	ae::Color colorMember = ae::Color::Black();
+	ae::Int3 int3Member = ae::Int3( 0 );
+	ae::Str32 strMember;
+	PlayerState stateMember = PlayerState::Idle;
+	ae::Vec3 points[ 2 ];
+	ae::Array< ae::Str16, 4 > names;
+	ae::Array< float > weights = AE_ALLOC_TAG_META_TEST;
+};
+
+//------------------------------------------------------------------------------
+// ShadowBaseClass
+//------------------------------------------------------------------------------
+class ShadowBaseClass : public ae::Inheritor< ae::Object, ShadowBaseClass >
+{
+public:
+	int32_t x = 0;
+};
+
+//------------------------------------------------------------------------------
+// ShadowClass
+//------------------------------------------------------------------------------
+class ShadowClass : public ae::Inheritor< ShadowBaseClass, ShadowClass >
+{
+public:
+	int32_t x = 0; // Shadows ShadowBaseClass::x
+};
+
 //------------------------------------------------------------------------------
 // SomeOldEnum
 //------------------------------------------------------------------------------
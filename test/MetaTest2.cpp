@@ -65,6 +65,32 @@ AE_REGISTER_CLASS_VAR( ArrayClass, someClassArray );
 AE_REGISTER_CLASS_VAR( ArrayClass, someClassArray2 );
 AE_REGISTER_CLASS_VAR( ArrayClass, someClassArray3 );
 
+//------------------------------------------------------------------------------
+// SerializeClass
+//------------------------------------------------------------------------------
+AE_REGISTER_CLASS( SerializeClass );
+AE_REGISTER_CLASS_VAR( SerializeClass, floatMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, doubleMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, uint8Member );
+AE_REGISTER_CLASS_VAR( SerializeClass, int64Member );
+AE_REGISTER_CLASS_VAR( SerializeClass, vec3Member );
+AE_REGISTER_CLASS_VAR( SerializeClass, matrixMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, colorMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, int3Member );
+AE_REGISTER_CLASS_VAR( SerializeClass, strMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, stateMember );
+AE_REGISTER_CLASS_VAR( SerializeClass, points );
+AE_REGISTER_CLASS_VAR( SerializeClass, names );
+AE_REGISTER_CLASS_VAR( SerializeClass, weights );
+
+//------------------------------------------------------------------------------
+// ShadowClass
+//------------------------------------------------------------------------------
+AE_REGISTER_CLASS( ShadowBaseClass );
+AE_REGISTER_CLASS_VAR( ShadowBaseClass, x );
+AE_REGISTER_CLASS( ShadowClass );
+AE_REGISTER_CLASS_VAR( ShadowClass, x );
+
 //------------------------------------------------------------------------------
 // SomeOldEnum
 //------------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 //------------------------------------------------------------------------------
 #include "aether.h"
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 //------------------------------------------------------------------------------
 // ae::NetObjectServer
@@ -18,3 +19,486 @@ TEST_CASE( "Create and destroy NetObjects", "[ae::NetObjectServer]" )
 	server.DestroyNetObject( netObj );
 	server.UpdateSendData();
 }
+
+//------------------------------------------------------------------------------
+// ae::NetObject sync data
+//------------------------------------------------------------------------------
+static uint32_t NetTest_Send( ae::NetObjectServer* server, ae::NetObjectConnection* conn, ae::NetObjectClient* client )
+{
+	server->UpdateSendData();
+	const uint32_t length = conn->GetSendLength();
+	client->ReceiveData( conn->GetSendData(), length );
+	return length;
+}
+
+TEST_CASE( "NetObject sync data is delta compressed", "[ae::NetObjectServer]" )
+{
+	ae::NetObjectServer server;
+	ae::NetObjectClient client;
+	ae::NetObjectConnection* conn = server.CreateConnection();
+	ae::NetObject* serverObj = server.CreateNetObject();
+	serverObj->SetInitData( nullptr, 0 );
+	uint8_t data[ 200 ];
+	for ( uint32_t i = 0; i < sizeof(data); i++ )
+	{
+		data[ i ] = (uint8_t)( i * 7 + 1 );
+	}
+	serverObj->SetSyncData( data, sizeof(data) );
+	REQUIRE( NetTest_Send( &server, conn, &client ) > sizeof(data) );
+	ae::NetObject* clientObj = client.PumpCreate();
+	REQUIRE( clientObj );
+	REQUIRE( clientObj->SyncDataLength() == sizeof(data) );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, sizeof(data) ) == 0 );
+	
+	// Unchanged data is not sent
+	REQUIRE( NetTest_Send( &server, conn, &client ) == 0 );
+	
+	// A single byte change is only a few bytes
+	data[ 100 ] = 0xFF;
+	serverObj->SetSyncData( data, sizeof(data) );
+	const uint32_t deltaLength = NetTest_Send( &server, conn, &client );
+	REQUIRE( deltaLength > 0 );
+	REQUIRE( deltaLength <= 16 );
+	REQUIRE( clientObj->SyncDataLength() == sizeof(data) );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, sizeof(data) ) == 0 );
+	
+	// Changes at the start and end, with small and large gaps between changes
+	data[ 0 ]++;
+	data[ 2 ]++;
+	data[ 150 ]++;
+	data[ 199 ]++;
+	serverObj->SetSyncData( data, sizeof(data) );
+	NetTest_Send( &server, conn, &client );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, sizeof(data) ) == 0 );
+	
+	// Clearing sync data on the client doesn't affect the delta baseline
+	clientObj->ClearSyncData();
+	data[ 50 ]++;
+	serverObj->SetSyncData( data, sizeof(data) );
+	NetTest_Send( &server, conn, &client );
+	REQUIRE( clientObj->SyncDataLength() == sizeof(data) );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, sizeof(data) ) == 0 );
+	
+	// Length changes
+	serverObj->SetSyncData( data, 120 );
+	NetTest_Send( &server, conn, &client );
+	REQUIRE( clientObj->SyncDataLength() == 120 );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, 120 ) == 0 );
+	serverObj->SetSyncData( data, sizeof(data) );
+	NetTest_Send( &server, conn, &client );
+	REQUIRE( clientObj->SyncDataLength() == sizeof(data) );
+	REQUIRE( memcmp( clientObj->GetSyncData(), data, sizeof(data) ) == 0 );
+	
+	// Mostly zero data is run length encoded even without a baseline
+	uint8_t sparse[ 200 ] = { 0 };
+	sparse[ 10 ] = 1;
+	sparse[ 190 ] = 2;
+	serverObj->SetSyncData( sparse, sizeof(sparse) );
+	ae::NetObjectClient lateClient;
+	ae::NetObjectConnection* lateConn = server.CreateConnection();
+	REQUIRE( NetTest_Send( &server, lateConn, &lateClient ) < 40 );
+	ae::NetObject* lateObj = lateClient.PumpCreate();
+	REQUIRE( lateObj );
+	REQUIRE( lateObj->SyncDataLength() == sizeof(sparse) );
+	REQUIRE( memcmp( lateObj->GetSyncData(), sparse, sizeof(sparse) ) == 0 );
+	client.ReceiveData( conn->GetSendData(), conn->GetSendLength() );
+	REQUIRE( memcmp( clientObj->GetSyncData(), sparse, sizeof(sparse) ) == 0 );
+	
+	server.DestroyNetObject( serverObj );
+	NetTest_Send( &server, conn, &client );
+	lateClient.ReceiveData( lateConn->GetSendData(), lateConn->GetSendLength() );
+	REQUIRE( clientObj->IsPendingDestroy() );
+	REQUIRE( lateObj->IsPendingDestroy() );
+	client.Destroy( clientObj );
+	lateClient.Destroy( lateObj );
+	server.DestroyConnection( conn );
+	server.DestroyConnection( lateConn );
+}
+
+TEST_CASE( "NetObject sync data dirty tracking", "[ae::NetObjectServer]" )
+{
+	ae::NetObjectServer server;
+	ae::NetObjectClient client;
+	ae::NetObjectConnection* conn = server.CreateConnection();
+	ae::NetObject* serverObj = server.CreateNetObject();
+	uint32_t value = 1;
+	// Sync data and messages before init are sent once the object is created
+	serverObj->SetSyncData( &value, sizeof(value) );
+	serverObj->SendMessage( &value, sizeof(value) );
+	REQUIRE( NetTest_Send( &server, conn, &client ) > 0 );
+	REQUIRE( !client.PumpCreate() );
+	serverObj->SetInitData( nullptr, 0 );
+	NetTest_Send( &server, conn, &client );
+	ae::NetObject* clientObj = client.PumpCreate();
+	REQUIRE( clientObj );
+	REQUIRE( clientObj->SyncDataLength() == sizeof(value) );
+	REQUIRE( *(const uint32_t*)clientObj->GetSyncData() == 1 );
+	ae::NetObject::Msg msg;
+	REQUIRE( clientObj->PumpMessages( &msg ) );
+	REQUIRE( *(const uint32_t*)msg.data == 1 );
+	
+	// Setting the same data doesn't send anything
+	serverObj->SetSyncData( &value, sizeof(value) );
+	REQUIRE( NetTest_Send( &server, conn, &client ) == 0 );
+	// Changing data and changing it back before the next tick doesn't either
+	value = 2;
+	serverObj->SetSyncData( &value, sizeof(value) );
+	value = 1;
+	serverObj->SetSyncData( &value, sizeof(value) );
+	REQUIRE( NetTest_Send( &server, conn, &client ) == 0 );
+	value = 3;
+	serverObj->SetSyncData( &value, sizeof(value) );
+	REQUIRE( NetTest_Send( &server, conn, &client ) > 0 );
+	REQUIRE( *(const uint32_t*)clientObj->GetSyncData() == 3 );
+	
+	// Destroying a modified object before the next tick
+	ae::NetObject* destroyed = server.CreateNetObject();
+	destroyed->SetSyncData( &value, sizeof(value) );
+	destroyed->SendMessage( &value, sizeof(value) );
+	server.DestroyNetObject( destroyed );
+	serverObj->SetSyncData( &value, 1 );
+	serverObj->SendMessage( &value, sizeof(value) );
+	server.DestroyNetObject( serverObj );
+	NetTest_Send( &server, conn, &client );
+	REQUIRE( clientObj->IsPendingDestroy() );
+	client.Destroy( clientObj );
+	server.DestroyConnection( conn );
+}
+
+// Tracks created client objects and destroys those removed by the server
+static void NetTest_Pump( ae::NetObjectClient* client, ae::Array< ae::NetObject* >* clientObjs )
+{
+	while ( ae::NetObject* netObj = client->PumpCreate() )
+	{
+		clientObjs->Append( netObj );
+	}
+	for ( int32_t i = clientObjs->FindFn( []( const ae::NetObject* o ){ return o->IsPendingDestroy(); } ); i >= 0; i = clientObjs->FindFn( []( const ae::NetObject* o ){ return o->IsPendingDestroy(); } ) )
+	{
+		client->Destroy( (*clientObjs)[ i ] );
+		clientObjs->Remove( i );
+	}
+}
+
+TEST_CASE( "NetObjectConnection interest management", "[ae::NetObjectServer]" )
+{
+	const uint32_t kObjectCount = 10;
+	ae::NetObjectServer server;
+	ae::NetObjectClient client;
+	ae::Array< ae::NetObject* > clientObjs = AE_ALLOC_TAG_NET;
+	ae::Array< ae::NetObject* > serverObjs = AE_ALLOC_TAG_NET;
+	ae::Map< const ae::NetObject*, float > positions = AE_ALLOC_TAG_NET;
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		ae::NetObject* netObj = serverObjs.Append( server.CreateNetObject() );
+		const uint8_t index = (uint8_t)i;
+		netObj->SetInitData( &index, 1 );
+		positions.Set( netObj, (float)i );
+	}
+	auto getIndexFn = []( const ae::NetObject* netObj ) { return netObj->GetInitData()[ 0 ]; };
+	
+	ae::NetObjectConnection* conn = server.CreateConnection();
+	float viewPosition = 0.0f;
+	conn->SetPriorityFn( [ & ]( const ae::NetObject* netObj )
+	{
+		const float distance = ae::Abs( positions.Get( netObj ) - viewPosition );
+		return ( distance < 4.5f ) ? 1.0f / ( 1.0f + distance ) : 0.0f;
+	} );
+	
+	SECTION( "relevancy" )
+	{
+		NetTest_Send( &server, conn, &client );
+		NetTest_Pump( &client, &clientObjs );
+		REQUIRE( clientObjs.Length() == 5 );
+		for ( ae::NetObject* netObj : clientObjs )
+		{
+			REQUIRE( getIndexFn( netObj ) < 5 );
+		}
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			REQUIRE( conn->IsReplicated( serverObjs[ i ] ) == ( i < 5 ) );
+		}
+		
+		// Objects leaving the area are destroyed, and entering are created
+		viewPosition = 9.0f;
+		NetTest_Send( &server, conn, &client );
+		NetTest_Pump( &client, &clientObjs );
+		REQUIRE( clientObjs.Length() == 5 );
+		for ( ae::NetObject* netObj : clientObjs )
+		{
+			REQUIRE( getIndexFn( netObj ) >= 5 );
+		}
+		
+		// Messages are only sent to clients where the object exists
+		serverObjs[ 0 ]->SendMessage( "a", 1 );
+		serverObjs[ 9 ]->SendMessage( "b", 1 );
+		NetTest_Send( &server, conn, &client );
+		uint32_t messageCount = 0;
+		for ( ae::NetObject* netObj : clientObjs )
+		{
+			ae::NetObject::Msg msg;
+			while ( netObj->PumpMessages( &msg ) )
+			{
+				REQUIRE( getIndexFn( netObj ) == 9 );
+				REQUIRE( msg.data[ 0 ] == 'b' );
+				messageCount++;
+			}
+		}
+		REQUIRE( messageCount == 1 );
+		
+		// Destroying irrelevant objects doesn't send anything
+		server.DestroyNetObject( serverObjs[ 0 ] );
+		serverObjs.Remove( 0 );
+		REQUIRE( NetTest_Send( &server, conn, &client ) == 0 );
+	}
+	
+	SECTION( "bandwidth budget" )
+	{
+		// All objects are relevant, with a budget of about one object per tick
+		viewPosition = 4.0f;
+		positions.Set( serverObjs[ 0 ], 4.5f );
+		positions.Set( serverObjs[ 9 ], 4.25f );
+		uint8_t data[ 200 ];
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			memset( data, (int)i + 1, sizeof(data) );
+			serverObjs[ i ]->SetSyncData( data, sizeof(data) );
+		}
+		conn->SetBandwidthBudget( 300 );
+		for ( uint32_t tick = 0; tick < kObjectCount; tick++ )
+		{
+			REQUIRE( NetTest_Send( &server, conn, &client ) <= 300 );
+			NetTest_Pump( &client, &clientObjs );
+			REQUIRE( clientObjs.Length() == tick + 1 );
+			// Closest objects first
+			if ( tick == 0 ) { REQUIRE( getIndexFn( clientObjs[ 0 ] ) == 4 ); }
+			if ( tick == 1 ) { REQUIRE( getIndexFn( clientObjs[ 1 ] ) == 9 ); }
+		}
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			REQUIRE( conn->IsReplicated( serverObjs[ i ] ) );
+			REQUIRE( clientObjs[ i ]->SyncDataLength() == sizeof(data) );
+			REQUIRE( clientObjs[ i ]->GetSyncData()[ 0 ] == getIndexFn( clientObjs[ i ] ) + 1 );
+		}
+		REQUIRE( NetTest_Send( &server, conn, &client ) == 0 );
+		
+		// Low priority objects aren't starved when everything changes each tick
+		uint32_t sentCounts[ kObjectCount ] = { 0 };
+		for ( uint32_t tick = 0; tick < 100; tick++ )
+		{
+			for ( uint32_t i = 0; i < kObjectCount; i++ )
+			{
+				memset( data, (int)( tick + i ), sizeof(data) );
+				serverObjs[ i ]->SetSyncData( data, sizeof(data) );
+			}
+			NetTest_Send( &server, conn, &client );
+			for ( ae::NetObject* netObj : clientObjs )
+			{
+				if ( netObj->SyncDataLength() )
+				{
+					sentCounts[ getIndexFn( netObj ) ]++;
+					netObj->ClearSyncData();
+				}
+			}
+		}
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			REQUIRE( sentCounts[ i ] > 0 );
+		}
+		REQUIRE( sentCounts[ 4 ] > sentCounts[ 8 ] );
+	}
+	
+	for ( ae::NetObject* netObj : serverObjs )
+	{
+		server.DestroyNetObject( netObj );
+	}
+	NetTest_Send( &server, conn, &client );
+	NetTest_Pump( &client, &clientObjs );
+	REQUIRE( !clientObjs.Length() );
+	server.DestroyConnection( conn );
+}
+
+TEST_CASE( "NetObject bandwidth benchmark", "[.benchmark][ae::NetObjectServer]" )
+{
+	// Objects with 200 bytes of sync data, where a position and a few other
+	// bytes change each tick
+	const uint32_t kObjectCount = 100;
+	struct SyncData
+	{
+		float position[ 3 ];
+		uint8_t state[ 188 ];
+	};
+	ae::NetObjectServer server;
+	ae::NetObjectClient client;
+	ae::NetObjectConnection* conn = server.CreateConnection();
+	ae::Array< ae::NetObject* > serverObjs = AE_ALLOC_TAG_NET;
+	ae::Array< SyncData > syncData = AE_ALLOC_TAG_NET;
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		ae::NetObject* netObj = serverObjs.Append( server.CreateNetObject() );
+		netObj->SetInitData( nullptr, 0 );
+		SyncData* data = &syncData.Append( {} );
+		memset( data, 0, sizeof(*data) );
+		for ( uint32_t j = 0; j < sizeof(data->state); j++ )
+		{
+			data->state[ j ] = (uint8_t)( i + j );
+		}
+		netObj->SetSyncData( data, sizeof(*data) );
+	}
+	NetTest_Send( &server, conn, &client );
+	ae::Array< ae::NetObject* > clientObjs = AE_ALLOC_TAG_NET;
+	while ( ae::NetObject* netObj = client.PumpCreate() )
+	{
+		clientObjs.Append( netObj );
+	}
+	REQUIRE( clientObjs.Length() == kObjectCount );
+	
+	uint32_t tick = 0;
+	uint64_t totalBytes = 0;
+	BENCHMARK( "update and receive" )
+	{
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			SyncData* data = &syncData[ i ];
+			data->position[ 0 ] = tick * 0.1f + i;
+			data->position[ 2 ] = tick * -0.05f;
+			data->state[ ( tick + i ) % sizeof(data->state) ]++;
+			serverObjs[ i ]->SetSyncData( data, sizeof(*data) );
+		}
+		tick++;
+		const uint32_t length = NetTest_Send( &server, conn, &client );
+		totalBytes += length;
+		return length;
+	};
+	const uint32_t fullBytes = kObjectCount * ( sizeof(SyncData) + 8 );
+	AE_INFO( "NetObject updates: # bytes per tick (# bytes without delta compression)", (uint32_t)( totalBytes / ae::Max( tick, 1u ) ), fullBytes );
+	
+	for ( ae::NetObject* netObj : serverObjs )
+	{
+		server.DestroyNetObject( netObj );
+	}
+	NetTest_Send( &server, conn, &client );
+	for ( ae::NetObject* netObj : clientObjs )
+	{
+		REQUIRE( netObj->IsPendingDestroy() );
+		client.Destroy( netObj );
+	}
+	server.DestroyConnection( conn );
+}
+
+TEST_CASE( "NetObjectServer connections benchmark", "[.benchmark][ae::NetObjectServer]" )
+{
+	// Server CPU per tick with many connections, where a tenth of the objects
+	// change each tick and send an occasional message
+	const uint32_t kConnectionCount = 64;
+	const uint32_t kObjectCount = 5000;
+	struct SyncData
+	{
+		float position[ 3 ];
+		uint8_t state[ 52 ];
+	};
+	ae::NetObjectServer server;
+	ae::Array< ae::NetObjectConnection* > conns = AE_ALLOC_TAG_NET;
+	ae::Array< ae::NetObject* > serverObjs = AE_ALLOC_TAG_NET;
+	ae::Array< SyncData > syncData = AE_ALLOC_TAG_NET;
+	for ( uint32_t i = 0; i < kConnectionCount; i++ )
+	{
+		conns.Append( server.CreateConnection() );
+	}
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		ae::NetObject* netObj = serverObjs.Append( server.CreateNetObject() );
+		netObj->SetInitData( &i, sizeof(i) );
+		SyncData* data = &syncData.Append( {} );
+		memset( data, 0, sizeof(*data) );
+		for ( uint32_t j = 0; j < sizeof(data->state); j++ )
+		{
+			data->state[ j ] = (uint8_t)( i + j );
+		}
+		netObj->SetSyncData( data, sizeof(*data) );
+	}
+	server.UpdateSendData();
+	
+	uint32_t tick = 0;
+	BENCHMARK( "UpdateSendData" )
+	{
+		for ( uint32_t i = tick % 10; i < kObjectCount; i += 10 )
+		{
+			SyncData* data = &syncData[ i ];
+			data->position[ 0 ] = tick * 0.1f + i;
+			data->position[ 1 ] = tick * -0.05f;
+			serverObjs[ i ]->SetSyncData( data, sizeof(*data) );
+			if ( i % 100 == 0 )
+			{
+				serverObjs[ i ]->SendMessage( &tick, sizeof(tick) );
+			}
+		}
+		tick++;
+		server.UpdateSendData();
+		return conns[ 0 ]->GetSendLength();
+	};
+	
+	for ( ae::NetObject* netObj : serverObjs )
+	{
+		server.DestroyNetObject( netObj );
+	}
+	for ( ae::NetObjectConnection* conn : conns )
+	{
+		server.DestroyConnection( conn );
+	}
+}
+
+TEST_CASE( "NetObjectServer idle objects benchmark", "[.benchmark][ae::NetObjectServer]" )
+{
+	// Server CPU per tick when only 1% of objects change, where idle objects
+	// still have their sync data set each tick
+	const uint32_t kObjectCount = 10000;
+	const uint32_t kConnectionCount = 4;
+	uint8_t data[ 128 ] = { 0 };
+	ae::NetObjectServer server;
+	ae::Array< ae::NetObjectConnection* > conns = AE_ALLOC_TAG_NET;
+	ae::Array< ae::NetObject* > serverObjs = AE_ALLOC_TAG_NET;
+	for ( uint32_t i = 0; i < kConnectionCount; i++ )
+	{
+		conns.Append( server.CreateConnection() );
+	}
+	for ( uint32_t i = 0; i < kObjectCount; i++ )
+	{
+		ae::NetObject* netObj = serverObjs.Append( server.CreateNetObject() );
+		netObj->SetInitData( nullptr, 0 );
+		netObj->SetSyncData( data, sizeof(data) );
+	}
+	server.UpdateSendData();
+	
+	uint32_t tick = 0;
+	BENCHMARK( "UpdateSendData" )
+	{
+		for ( uint32_t i = 0; i < kObjectCount; i++ )
+		{
+			memcpy( data, ( i % 100 == tick % 100 ) ? &tick : &i, sizeof(uint32_t) );
+			serverObjs[ i ]->SetSyncData( data, sizeof(data) );
+		}
+		tick++;
+		server.UpdateSendData();
+		return conns[ 0 ]->GetSendLength();
+	};
+	BENCHMARK( "UpdateSendData, only changed objects set" )
+	{
+		for ( uint32_t i = tick % 100; i < kObjectCount; i += 100 )
+		{
+			memcpy( data, &tick, sizeof(uint32_t) );
+			serverObjs[ i ]->SetSyncData( data, sizeof(data) );
+		}
+		tick++;
+		server.UpdateSendData();
+		return conns[ 0 ]->GetSendLength();
+	};
+	
+	for ( ae::NetObject* netObj : serverObjs )
+	{
+		server.DestroyNetObject( netObj );
+	}
+	for ( ae::NetObjectConnection* conn : conns )
+	{
+		server.DestroyConnection( conn );
+	}
+}
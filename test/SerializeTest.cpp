@@ -25,6 +25,7 @@
 //------------------------------------------------------------------------------
 #include "aether.h"
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 
 //------------------------------------------------------------------------------
 // Constants
@@ -722,6 +723,335 @@ TEST_CASE( "Reader: Member and static function Serialize() should be called by S
 	REQUIRE( rStream.GetOffset() == rStream.GetSize() );
 }
 
+//------------------------------------------------------------------------------
+// Compact encodings
+//------------------------------------------------------------------------------
+TEST_CASE( "BinaryStream bit packing", "[ae::BinaryStream]" )
+{
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	wStream.SerializeBits( 1u, 1 );
+	wStream.SerializeBits( 5u, 3 );
+	wStream.SerializeBits( 0x1FFu, 9 ); // Crosses a byte boundary
+	REQUIRE( wStream.GetOffset() == 2 );
+	wStream.SerializeBits( 0xDEADBEEFu, 32 );
+	REQUIRE( wStream.GetOffset() == 6 );
+	wStream.SerializeUint8( 0xAB ); // Starts the next byte
+	wStream.SerializeBits( 0u, 1 );
+	REQUIRE( wStream.IsValid() );
+	REQUIRE( wStream.GetOffset() == 8 );
+	
+	ae::BinaryReader rStream( buffer );
+	uint32_t value = 0;
+	rStream.SerializeBits( value, 1 );
+	REQUIRE( value == 1 );
+	rStream.SerializeBits( value, 3 );
+	REQUIRE( value == 5 );
+	rStream.SerializeBits( value, 9 );
+	REQUIRE( value == 0x1FF );
+	rStream.SerializeBits( value, 32 );
+	REQUIRE( value == 0xDEADBEEF );
+	uint8_t byte = 0;
+	rStream.SerializeUint8( byte );
+	REQUIRE( byte == 0xAB );
+	rStream.SerializeBits( value, 1 );
+	REQUIRE( value == 0 );
+	REQUIRE( rStream.IsValid() );
+	REQUIRE( rStream.GetOffset() == rStream.GetSize() );
+	rStream.SerializeBits( value, 8 );
+	REQUIRE( !rStream.IsValid() );
+}
+
+TEST_CASE( "BinaryStream variable length integers", "[ae::BinaryStream]" )
+{
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	auto lengthFn = [ & ]( auto fn ) { const uint32_t prev = wStream.GetOffset(); fn(); return wStream.GetOffset() - prev; };
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarUint32( 0u ); } ) == 1 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarUint32( 127u ); } ) == 1 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarUint32( 128u ); } ) == 2 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarUint32( ae::MaxValue< uint32_t >() ); } ) == 5 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarUint64( ae::MaxValue< uint64_t >() ); } ) == 10 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt32( -1 ); } ) == 1 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt32( 63 ); } ) == 1 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt32( -64 ); } ) == 1 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt32( 64 ); } ) == 2 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt32( ae::MinValue< int32_t >() ); } ) == 5 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt64( ae::MinValue< int64_t >() ); } ) == 10 );
+	REQUIRE( lengthFn( [ & ](){ wStream.SerializeVarInt64( ae::MaxValue< int64_t >() ); } ) == 10 );
+	wStream.SerializeVarUint64( 5000000000ull ); // Too large for SerializeVarUint32()
+	REQUIRE( wStream.IsValid() );
+	
+	ae::BinaryReader rStream( buffer );
+	uint32_t u32 = 1;
+	uint64_t u64 = 0;
+	int32_t i32 = 0;
+	int64_t i64 = 0;
+	rStream.SerializeVarUint32( u32 ); REQUIRE( u32 == 0 );
+	rStream.SerializeVarUint32( u32 ); REQUIRE( u32 == 127 );
+	rStream.SerializeVarUint32( u32 ); REQUIRE( u32 == 128 );
+	rStream.SerializeVarUint32( u32 ); REQUIRE( u32 == ae::MaxValue< uint32_t >() );
+	rStream.SerializeVarUint64( u64 ); REQUIRE( u64 == ae::MaxValue< uint64_t >() );
+	rStream.SerializeVarInt32( i32 ); REQUIRE( i32 == -1 );
+	rStream.SerializeVarInt32( i32 ); REQUIRE( i32 == 63 );
+	rStream.SerializeVarInt32( i32 ); REQUIRE( i32 == -64 );
+	rStream.SerializeVarInt32( i32 ); REQUIRE( i32 == 64 );
+	rStream.SerializeVarInt32( i32 ); REQUIRE( i32 == ae::MinValue< int32_t >() );
+	rStream.SerializeVarInt64( i64 ); REQUIRE( i64 == ae::MinValue< int64_t >() );
+	rStream.SerializeVarInt64( i64 ); REQUIRE( i64 == ae::MaxValue< int64_t >() );
+	REQUIRE( rStream.IsValid() );
+	u32 = 7;
+	rStream.SerializeVarUint32( u32 );
+	REQUIRE( !rStream.IsValid() );
+	REQUIRE( u32 == 7 );
+	
+	// Truncated data
+	const uint8_t truncated[] = { 0x80, 0x80 };
+	ae::BinaryReader truncatedStream( truncated, sizeof(truncated) );
+	truncatedStream.SerializeVarUint32( u32 );
+	REQUIRE( !truncatedStream.IsValid() );
+	REQUIRE( u32 == 7 );
+}
+
+TEST_CASE( "BinaryStream quantized floats", "[ae::BinaryStream]" )
+{
+	const float values[] = { -10.0f, -3.3f, 0.0f, 0.1f, 7.25f, 10.0f, 100.0f, -100.0f };
+	const float expected[] = { -10.0f, -3.3f, 0.0f, 0.1f, 7.25f, 10.0f, 10.0f, -10.0f }; // Clamped
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	for ( float v : values )
+	{
+		wStream.SerializeQuantizedFloat( v, -10.0f, 10.0f, 12 );
+	}
+	REQUIRE( wStream.GetOffset() == ( countof(values) * 12 + 7 ) / 8 );
+	
+	ae::BinaryReader rStream( buffer );
+	const float precision = 20.0f / 4095.0f;
+	for ( uint32_t i = 0; i < countof(values); i++ )
+	{
+		float v = 0.0f;
+		rStream.SerializeQuantizedFloat( v, -10.0f, 10.0f, 12 );
+		REQUIRE( ae::Abs( v - expected[ i ] ) <= precision * 0.5f + 0.00001f );
+	}
+	REQUIRE( rStream.IsValid() );
+}
+
+TEST_CASE( "BinaryStream smallest three quaternions", "[ae::BinaryStream]" )
+{
+	ae::Array< ae::Quaternion > quaternions = TAG_TEST;
+	quaternions.Append( ae::Quaternion::Identity() );
+	quaternions.Append( -ae::Quaternion::Identity() );
+	quaternions.Append( ae::Quaternion( ae::Vec3( 0.0f, 0.0f, 1.0f ), 2.0f ) );
+	quaternions.Append( ae::Quaternion( ae::Vec3( 1.0f, 2.0f, -3.0f ).NormalizeCopy(), -1.0f ) );
+	quaternions.Append( ae::Quaternion( 0.5f, 0.5f, 0.5f, 0.5f ) );
+	quaternions.Append( ae::Quaternion( 0.0f, -1.0f, 0.0f, 0.0f ) );
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	for ( const ae::Quaternion& q : quaternions )
+	{
+		wStream.SerializeQuaternion( q, 10 );
+	}
+	REQUIRE( wStream.GetOffset() == ( quaternions.Length() * 32 ) / 8 );
+	
+	ae::BinaryReader rStream( buffer );
+	for ( const ae::Quaternion& q : quaternions )
+	{
+		ae::Quaternion result;
+		rStream.SerializeQuaternion( result, 10 );
+		// The same rotation, where q and -q are equivalent
+		REQUIRE( ae::Abs( q.Dot( result ) ) > 0.9999f );
+		const ae::Vec3 v( 0.3f, -0.5f, 0.8f );
+		REQUIRE( ( q.Rotate( v ) - result.Rotate( v ) ).Length() < 0.005f );
+	}
+	REQUIRE( rStream.IsValid() );
+}
+
+class CompactSerializeClass
+{
+public:
+	void Serialize( ae::BinaryStream* stream )
+	{
+		stream->SerializeVarInt32( health );
+		stream->SerializeBits( team, 2 );
+		stream->SerializeQuantizedFloat( position.x, -512.0f, 512.0f, 16 );
+		stream->SerializeQuantizedFloat( position.y, -512.0f, 512.0f, 16 );
+		stream->SerializeQuaternion( rotation );
+		stream->SerializeVarUint32( id );
+	}
+	int32_t health = 0;
+	uint32_t team = 0;
+	ae::Vec2 position = ae::Vec2( 0.0f );
+	ae::Quaternion rotation = ae::Quaternion::Identity();
+	uint32_t id = 0;
+};
+
+TEST_CASE( "Compact encodings can be used with SerializeObject()", "[ae::BinaryStream]" )
+{
+	CompactSerializeClass obj;
+	obj.health = -5;
+	obj.team = 3;
+	obj.position = ae::Vec2( 100.5f, -30.25f );
+	obj.rotation = ae::Quaternion( ae::Vec3( 0.0f, 1.0f, 0.0f ), 0.5f );
+	obj.id = 300;
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	wStream.SerializeObject( obj );
+	REQUIRE( wStream.IsValid() );
+	REQUIRE( wStream.GetOffset() == 1 + ( 2 + 16 + 16 + 32 + 7 ) / 8 + 2 );
+	
+	CompactSerializeClass result;
+	ae::BinaryReader rStream( buffer );
+	rStream.SerializeObject( result );
+	REQUIRE( rStream.IsValid() );
+	REQUIRE( rStream.GetOffset() == rStream.GetSize() );
+	REQUIRE( result.health == -5 );
+	REQUIRE( result.team == 3 );
+	REQUIRE( ae::Abs( result.position.x - 100.5f ) < 0.01f );
+	REQUIRE( ae::Abs( result.position.y + 30.25f ) < 0.01f );
+	REQUIRE( ae::Abs( result.rotation.Dot( obj.rotation ) ) > 0.9999f );
+	REQUIRE( result.id == 300 );
+}
+
+TEST_CASE( "BinaryStream array serialization", "[ae::BinaryStream]" )
+{
+	const uint16_t indices[] = { 0, 1, 2, 2, 1, 3 };
+	const float weights[] = { 0.25f, -1.5f, 3.0f };
+	ae::Array< ae::Vec3, 4 > positions;
+	positions.Append( ae::Vec3( 1.0f, 2.0f, 3.0f ) );
+	positions.Append( ae::Vec3( -4.0f, 5.5f, 6.0f ) );
+	ae::Array< ae::Matrix4 > transforms = TAG_TEST;
+	transforms.Append( ae::Matrix4::Translation( 1.0f, 2.0f, 3.0f ) );
+	transforms.Append( ae::Matrix4::Scaling( 2.0f ) );
+
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	wStream.SerializeArray( indices, countof( indices ) );
+	wStream.SerializeArray( weights, countof( weights ) );
+	wStream.SerializeArray( positions );
+	wStream.SerializeArray( transforms );
+	REQUIRE( wStream.IsValid() );
+	// Vec3 is stored without padding
+	REQUIRE( wStream.GetOffset() == sizeof( indices ) + sizeof( weights ) + 1 + 2 * 12 + 1 + 2 * 64 );
+	// Values are stored little endian
+	REQUIRE( buffer[ 2 ] == 1 );
+	REQUIRE( buffer[ 3 ] == 0 );
+
+	uint16_t indicesResult[ countof( indices ) ];
+	float weightsResult[ countof( weights ) ];
+	ae::Array< ae::Vec3, 4 > positionsResult;
+	positionsResult.Append( ae::Vec3( 0.0f ) );
+	ae::Array< ae::Matrix4 > transformsResult = TAG_TEST;
+	ae::BinaryReader rStream( buffer );
+	rStream.SerializeArray( indicesResult, countof( indicesResult ) );
+	rStream.SerializeArray( weightsResult, countof( weightsResult ) );
+	rStream.SerializeArray( positionsResult );
+	rStream.SerializeArray( transformsResult );
+	REQUIRE( rStream.IsValid() );
+	REQUIRE( rStream.GetRemainingBytes() == 0 );
+	REQUIRE( memcmp( indices, indicesResult, sizeof( indices ) ) == 0 );
+	REQUIRE( memcmp( weights, weightsResult, sizeof( weights ) ) == 0 );
+	REQUIRE( positionsResult.Length() == 2 );
+	REQUIRE( positionsResult[ 0 ] == positions[ 0 ] );
+	REQUIRE( positionsResult[ 1 ] == positions[ 1 ] );
+	REQUIRE( transformsResult.Length() == 2 );
+	REQUIRE( transformsResult[ 0 ] == transforms[ 0 ] );
+	REQUIRE( transformsResult[ 1 ] == transforms[ 1 ] );
+}
+
+TEST_CASE( "BinaryStream array serialization length is validated", "[ae::BinaryStream]" )
+{
+	ae::Array< uint8_t > buffer = TAG_TEST;
+	ae::BinaryWriter wStream( &buffer );
+	wStream.SerializeVarUint32( 0xFFFFFFFF );
+	wStream.SerializeFloat( 1.0f );
+	REQUIRE( wStream.IsValid() );
+
+	SECTION( "length longer than data" )
+	{
+		ae::Array< float > result = TAG_TEST;
+		result.Append( 5.0f );
+		ae::BinaryReader rStream( buffer );
+		rStream.SerializeArray( result );
+		REQUIRE( !rStream.IsValid() );
+		REQUIRE( result.Length() == 1 );
+	}
+	SECTION( "length longer than static array" )
+	{
+		ae::Array< uint8_t > shortBuffer = TAG_TEST;
+		ae::BinaryWriter shortStream( &shortBuffer );
+		shortStream.SerializeArray( ae::Array< uint8_t, 8 >( 7, 8 ) );
+		ae::Array< uint8_t, 4 > result;
+		ae::BinaryReader rStream( shortBuffer );
+		rStream.SerializeArray( result );
+		REQUIRE( !rStream.IsValid() );
+		REQUIRE( result.Length() == 0 );
+	}
+	SECTION( "write past end of data buffer" )
+	{
+		uint8_t data[ 7 ];
+		const ae::Vec3 vecs[] = { ae::Vec3( 1.0f ) };
+		const int32_t ints[] = { 1, 2 };
+		ae::BinaryWriter shortStream( data, sizeof( data ) );
+		shortStream.SerializeArray( ints, countof( ints ) );
+		REQUIRE( !shortStream.IsValid() );
+		ae::BinaryWriter vecStream( data, sizeof( data ) );
+		vecStream.SerializeArray( vecs, countof( vecs ) );
+		REQUIRE( !vecStream.IsValid() );
+	}
+}
+
+TEST_CASE( "BinaryStream array serialization benchmark", "[.benchmark][ae::BinaryStream]" )
+{
+	const uint32_t count = 1000000;
+	ae::Array< float > values( TAG_TEST, 0.0f, count );
+	for( uint32_t i = 0; i < count; i++ )
+	{
+		values[ i ] = i * 0.5f;
+	}
+	ae::Array< uint8_t > buffer( TAG_TEST, count * sizeof( float ) + 8 );
+	ae::Array< float > result( TAG_TEST, count );
+
+	BENCHMARK( "write 1M floats with SerializeFloat()" )
+	{
+		buffer.Clear();
+		ae::BinaryWriter wStream( &buffer );
+		for( float f : values )
+		{
+			wStream.SerializeFloat( f );
+		}
+		return wStream.GetOffset();
+	};
+	BENCHMARK( "write 1M floats with SerializeArray()" )
+	{
+		buffer.Clear();
+		ae::BinaryWriter wStream( &buffer );
+		wStream.SerializeArray( values );
+		return wStream.GetOffset();
+	};
+	BENCHMARK( "read 1M floats with SerializeFloat()" )
+	{
+		result.Clear();
+		ae::BinaryReader rStream( buffer );
+		uint32_t length = 0;
+		rStream.SerializeVarUint32( length );
+		for( uint32_t i = 0; i < length; i++ )
+		{
+			float f;
+			rStream.SerializeFloat( f );
+			result.Append( f );
+		}
+		return rStream.GetOffset();
+	};
+	BENCHMARK( "read 1M floats with SerializeArray()" )
+	{
+		ae::BinaryReader rStream( buffer );
+		rStream.SerializeArray( result );
+		return rStream.GetOffset();
+	};
+	REQUIRE( result.Length() == count );
+	REQUIRE( result[ count - 1 ] == values[ count - 1 ] );
+}
+
 //! Use SerializeObjectConditional() when an object may not be available for
 //! serialization when writing or reading. This function correctly updates
 //! read/write offsets when skipping serialization. Sends slightly more data
@@ -0,0 +1,508 @@
+//------------------------------------------------------------------------------
+// SocketTest.cpp
+//------------------------------------------------------------------------------
+// Copyright (c) 2024 John Hughes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include "aether.h"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//------------------------------------------------------------------------------
+// Socket test helpers
+//------------------------------------------------------------------------------
+const ae::Tag TAG_SOCKET_TEST = "socket_test";
+
+// Connects \p count clients to \p listener over loopback, and appends the
+// clients and accepted server sockets in matching order.
+static bool SocketTest_Connect( ae::ListenerSocket* listener, uint32_t count, ae::Array< ae::Socket* >* clientsOut, ae::Array< ae::Socket* >* serverOut )
+{
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		ae::Socket* client = clientsOut->Append( ae::New< ae::Socket >( TAG_SOCKET_TEST, TAG_SOCKET_TEST ) );
+		ae::Socket* server = nullptr;
+		const double timeout = ae::GetTime() + 5.0;
+		while ( ( !client->IsConnected() || !server ) && ae::GetTime() < timeout )
+		{
+			if ( !client->IsConnected() )
+			{
+				client->Connect( listener->GetProtocol(), "localhost", listener->GetPort() );
+			}
+			if ( !server )
+			{
+				server = listener->Accept();
+			}
+		}
+		if ( !server || !client->IsConnected() )
+		{
+			return false;
+		}
+		serverOut->Append( server );
+	}
+	return true;
+}
+
+static void SocketTest_Destroy( ae::ListenerSocket* listener, ae::Array< ae::Socket* >* clients )
+{
+	for ( ae::Socket* client : *clients )
+	{
+		ae::Delete( client );
+	}
+	clients->Clear();
+	listener->DestroyAll();
+}
+
+//------------------------------------------------------------------------------
+// ae::SocketPoller tests
+//------------------------------------------------------------------------------
+TEST_CASE( "SocketPoller reports active sockets", "[ae::SocketPoller]" )
+{
+	const uint32_t kConnectionCount = 8;
+	ae::ListenerSocket listener = TAG_SOCKET_TEST;
+	REQUIRE( listener.Listen( ae::Socket::Protocol::TCP, false, 7320, kConnectionCount ) );
+	ae::SocketPoller poller = TAG_SOCKET_TEST;
+	REQUIRE( poller.Add( &listener ) );
+	
+	// Pending connections make the listener readable
+	ae::Socket pending = TAG_SOCKET_TEST;
+	pending.Connect( ae::Socket::Protocol::TCP, "localhost", 7320 );
+	REQUIRE( poller.Wait( 1.0f ) == 1 );
+	REQUIRE( poller.GetEvent( 0 ).listener == &listener );
+	REQUIRE( poller.GetEvent( 0 ).readable );
+	ae::Socket* accepted = listener.Accept();
+	REQUIRE( accepted );
+	listener.Destroy( accepted );
+	pending.Disconnect();
+	
+	ae::Array< ae::Socket* > clients = TAG_SOCKET_TEST;
+	ae::Array< ae::Socket* > server = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_Connect( &listener, kConnectionCount, &clients, &server ) );
+	for ( ae::Socket* sock : server )
+	{
+		REQUIRE( poller.Add( sock ) );
+	}
+	REQUIRE( poller.GetCount() == kConnectionCount + 1 );
+	REQUIRE( poller.Wait( 0.0f ) == 0 );
+	
+	SECTION( "readable" )
+	{
+		const uint32_t value = 42;
+		REQUIRE( clients[ 3 ]->QueueMsg( &value, sizeof(value) ) );
+		REQUIRE( clients[ 3 ]->SendAll() );
+		REQUIRE( poller.Wait( 1.0f ) == 1 );
+		const ae::SocketPoller::Event& event = poller.GetEvent( 0 );
+		REQUIRE( event.socket == server[ 3 ] );
+		REQUIRE( event.readable );
+		REQUIRE( !event.writable );
+		REQUIRE( !event.closed );
+		uint32_t received = 0;
+		REQUIRE( server[ 3 ]->ReceiveMsg( &received, sizeof(received) ) == sizeof(received) );
+		REQUIRE( received == value );
+		REQUIRE( poller.Wait( 0.0f ) == 0 );
+	}
+	SECTION( "writable" )
+	{
+		poller.SetWriteInterest( server[ 5 ], true );
+		REQUIRE( poller.Wait( 1.0f ) == 1 );
+		REQUIRE( poller.GetEvent( 0 ).socket == server[ 5 ] );
+		REQUIRE( poller.GetEvent( 0 ).writable );
+		poller.SetWriteInterest( server[ 5 ], false );
+		REQUIRE( poller.Wait( 0.0f ) == 0 );
+	}
+	SECTION( "closed" )
+	{
+		clients[ 1 ]->Disconnect();
+		REQUIRE( poller.Wait( 1.0f ) == 1 );
+		REQUIRE( poller.GetEvent( 0 ).socket == server[ 1 ] );
+		REQUIRE( ( poller.GetEvent( 0 ).closed || poller.GetEvent( 0 ).readable ) );
+		REQUIRE( server[ 1 ]->ReceiveMsg( nullptr, 0 ) == 0 );
+		REQUIRE( !server[ 1 ]->IsConnected() );
+		poller.Remove( server[ 1 ] );
+		REQUIRE( poller.GetCount() == kConnectionCount );
+	}
+	
+	poller.Remove( &listener );
+	for ( ae::Socket* sock : server )
+	{
+		poller.Remove( sock );
+	}
+	REQUIRE( poller.GetCount() == 0 );
+	SocketTest_Destroy( &listener, &clients );
+}
+
+//------------------------------------------------------------------------------
+// ae::Socket tests
+//------------------------------------------------------------------------------
+TEST_CASE( "Socket receives messages in place", "[ae::Socket]" )
+{
+	ae::ListenerSocket listener = TAG_SOCKET_TEST;
+	REQUIRE( listener.Listen( ae::Socket::Protocol::TCP, false, 7322, 1 ) );
+	ae::Array< ae::Socket* > clients = TAG_SOCKET_TEST;
+	ae::Array< ae::Socket* > server = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_Connect( &listener, 1, &clients, &server ) );
+	ae::Socket* client = clients[ 0 ];
+	ae::Socket* receiver = server[ 0 ];
+	
+	uint32_t length = 0;
+	REQUIRE( !receiver->PeekReceivedData( &length ) );
+	REQUIRE( length == 0 );
+	
+	// Message sizes vary so that messages straddle the end of the receive
+	// buffer and unread data is compacted
+	ae::Array< uint8_t > msg = TAG_SOCKET_TEST;
+	uint32_t sent = 0;
+	uint32_t received = 0;
+	const uint32_t kMsgCount = 400;
+	while ( received < kMsgCount )
+	{
+		for ( uint32_t i = 0; i < 8 && sent < kMsgCount; i++, sent++ )
+		{
+			msg.Clear();
+			for ( uint32_t j = 0; j < 1 + ( sent * 7919 ) % 9000; j++ )
+			{
+				msg.Append( (uint8_t)( sent + j ) );
+			}
+			REQUIRE( client->QueueMsg( msg.Data(), msg.Length() ) );
+		}
+		client->SendAll();
+		
+		uint16_t msgLength = 0;
+		while ( const uint8_t* data = receiver->PeekMsg( &msgLength ) )
+		{
+			REQUIRE( msgLength == 1 + ( received * 7919 ) % 9000 );
+			for ( uint32_t j = 0; j < msgLength; j++ )
+			{
+				REQUIRE( data[ j ] == (uint8_t)( received + j ) );
+			}
+			REQUIRE( receiver->DiscardMsg() );
+			received++;
+		}
+		REQUIRE( client->IsConnected() );
+		REQUIRE( receiver->IsConnected() );
+	}
+	uint16_t msgLength = 0;
+	REQUIRE( !receiver->PeekMsg( &msgLength ) );
+	
+	// Raw data span
+	const char hello[] = "hello";
+	REQUIRE( client->QueueData( hello, sizeof(hello) ) );
+	REQUIRE( client->SendAll() == sizeof(hello) );
+	const uint8_t* data = nullptr;
+	const double timeout = ae::GetTime() + 5.0;
+	while ( !( data = receiver->PeekReceivedData( &length ) ) && ae::GetTime() < timeout ) {}
+	REQUIRE( length == sizeof(hello) );
+	REQUIRE( memcmp( data, hello, sizeof(hello) ) == 0 );
+	REQUIRE( receiver->DiscardData( length ) );
+	REQUIRE( receiver->ReceiveDataLength() == 0 );
+	
+	SocketTest_Destroy( &listener, &clients );
+}
+
+// Pushes \p totalBytes through \p sender in small messages while \p receiver
+// reads, so the sender regularly fills the system send buffer
+static void SocketTest_Stream( ae::Socket* sender, ae::Socket* receiver, uint64_t totalBytes )
+{
+	const uint32_t kMaxPending = 4 * 1024 * 1024;
+	uint8_t msg[ 256 ];
+	uint64_t sentBytes = 0;
+	uint64_t receivedBytes = 0;
+	uint32_t sentCount = 0;
+	uint32_t receivedCount = 0;
+	bool sendFull = false;
+	while ( receivedBytes < totalBytes )
+	{
+		// Queue until the pending send data is too large
+		while ( sentBytes < totalBytes && sender->GetPendingSendLength() < kMaxPending )
+		{
+			const uint16_t length = 1 + sentCount % sizeof(msg);
+			memset( msg, (uint8_t)sentCount, length );
+			REQUIRE( sender->QueueMsg( msg, length ) );
+			sentBytes += length;
+			sentCount++;
+		}
+		sender->SendAll();
+		sendFull |= ( sender->GetPendingSendLength() != 0 );
+		REQUIRE( sender->IsConnected() );
+		
+		uint16_t length = 0;
+		while ( const uint8_t* data = receiver->PeekMsg( &length ) )
+		{
+			REQUIRE( length == 1 + receivedCount % sizeof(msg) );
+			REQUIRE( data[ 0 ] == (uint8_t)receivedCount );
+			REQUIRE( data[ length - 1 ] == (uint8_t)receivedCount );
+			receiver->DiscardMsg();
+			receivedBytes += length;
+			receivedCount++;
+		}
+		REQUIRE( receiver->IsConnected() );
+	}
+	REQUIRE( receivedCount == sentCount );
+	REQUIRE( sender->GetPendingSendLength() == 0 );
+	REQUIRE( sendFull ); // Partial sends were handled
+}
+
+TEST_CASE( "Socket partial sends", "[ae::Socket]" )
+{
+	ae::ListenerSocket listener = TAG_SOCKET_TEST;
+	REQUIRE( listener.Listen( ae::Socket::Protocol::TCP, false, 7323, 1 ) );
+	ae::Array< ae::Socket* > clients = TAG_SOCKET_TEST;
+	ae::Array< ae::Socket* > server = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_Connect( &listener, 1, &clients, &server ) );
+	REQUIRE( clients[ 0 ]->SetNoDelay( false ) );
+	REQUIRE( clients[ 0 ]->SetNoDelay( true ) );
+	SocketTest_Stream( clients[ 0 ], server[ 0 ], 32 * 1024 * 1024 );
+	SocketTest_Destroy( &listener, &clients );
+}
+
+TEST_CASE( "Socket 1GB stress test", "[.stress][ae::Socket]" )
+{
+	ae::ListenerSocket listener = TAG_SOCKET_TEST;
+	REQUIRE( listener.Listen( ae::Socket::Protocol::TCP, false, 7324, 1 ) );
+	ae::Array< ae::Socket* > clients = TAG_SOCKET_TEST;
+	ae::Array< ae::Socket* > server = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_Connect( &listener, 1, &clients, &server ) );
+	SECTION( "no delay" )
+	{
+		SocketTest_Stream( clients[ 0 ], server[ 0 ], 1024ull * 1024 * 1024 );
+	}
+	SECTION( "corked" )
+	{
+		clients[ 0 ]->SetCork( true );
+		SocketTest_Stream( clients[ 0 ], server[ 0 ], 1024ull * 1024 * 1024 );
+		clients[ 0 ]->SetCork( false );
+	}
+	SocketTest_Destroy( &listener, &clients );
+}
+
+TEST_CASE( "SocketPoller benchmark", "[.benchmark][ae::SocketPoller]" )
+{
+	// 1k mostly idle loopback connections where a few clients send each tick
+	const uint32_t kConnectionCount = 1000;
+	const uint32_t kActivePerTick = 10;
+	ae::ListenerSocket listener = TAG_SOCKET_TEST;
+	REQUIRE( listener.Listen( ae::Socket::Protocol::TCP, false, 7321, kConnectionCount ) );
+	ae::Array< ae::Socket* > clients = TAG_SOCKET_TEST;
+	ae::Array< ae::Socket* > server = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_Connect( &listener, kConnectionCount, &clients, &server ) );
+	ae::SocketPoller poller = TAG_SOCKET_TEST;
+	for ( ae::Socket* sock : server )
+	{
+		poller.Add( sock );
+	}
+	
+	uint32_t tick = 0;
+	auto sendFn = [ & ]()
+	{
+		for ( uint32_t i = 0; i < kActivePerTick; i++ )
+		{
+			ae::Socket* client = clients[ ( tick * 97 + i * 13 ) % kConnectionCount ];
+			client->QueueMsg( &tick, sizeof(tick) );
+			client->SendAll();
+		}
+		tick++;
+	};
+	
+	BENCHMARK( "receive from every socket" )
+	{
+		sendFn();
+		uint32_t received = 0;
+		uint32_t value;
+		while ( received < kActivePerTick )
+		{
+			for ( ae::Socket* sock : server )
+			{
+				while ( sock->ReceiveMsg( &value, sizeof(value) ) ) { received++; }
+			}
+		}
+		return received;
+	};
+	BENCHMARK( "receive from SocketPoller events" )
+	{
+		sendFn();
+		uint32_t received = 0;
+		uint32_t value;
+		while ( received < kActivePerTick )
+		{
+			poller.Wait( 1.0f );
+			for ( uint32_t i = 0; i < poller.GetEventCount(); i++ )
+			{
+				ae::Socket* sock = poller.GetEvent( i ).socket;
+				while ( sock->ReceiveMsg( &value, sizeof(value) ) ) { received++; }
+			}
+		}
+		return received;
+	};
+	
+	for ( ae::Socket* sock : server )
+	{
+		poller.Remove( sock );
+	}
+	SocketTest_Destroy( &listener, &clients );
+}
+
+//------------------------------------------------------------------------------
+// ae::DatagramSocket tests
+//------------------------------------------------------------------------------
+// Receives until \p count datagrams have been received or one second passes.
+static uint32_t SocketTest_ReceiveDatagrams( ae::DatagramSocket* sock, uint32_t count, ae::Array< ae::DatagramSocket::Datagram >* datagramsOut )
+{
+	const double timeout = ae::GetTime() + 1.0;
+	uint32_t received = 0;
+	while ( received < count && ae::GetTime() < timeout )
+	{
+		const uint32_t datagramCount = sock->Receive();
+		for ( uint32_t i = 0; i < datagramCount && datagramsOut; i++ )
+		{
+			datagramsOut->Append( sock->GetDatagram( i ) );
+		}
+		received += datagramCount;
+	}
+	return received;
+}
+
+TEST_CASE( "DatagramSocket preserves boundaries and addresses", "[ae::DatagramSocket]" )
+{
+	ae::DatagramSocket server = TAG_SOCKET_TEST;
+	ae::DatagramSocket client = TAG_SOCKET_TEST;
+	REQUIRE( server.Open( false, 0, 256 ) );
+	REQUIRE( client.Open( false, 0, 256 ) );
+	REQUIRE( server.GetPort() != 0 );
+	REQUIRE( client.GetPort() != 0 );
+	REQUIRE( server.GetPort() != client.GetPort() );
+	ae::DatagramSocket::Address serverAddress;
+	REQUIRE( ae::DatagramSocket::GetAddress( "127.0.0.1", server.GetPort(), &serverAddress ) );
+	REQUIRE( serverAddress.GetPort() == server.GetPort() );
+	REQUIRE( serverAddress.GetAddressString() == "127.0.0.1" );
+	
+	// More datagrams than a single batch, each with a different length
+	const uint32_t kCount = ae::DatagramSocket::kBatchSize + 10;
+	uint8_t buffer[ 256 ];
+	for ( uint32_t i = 0; i < kCount; i++ )
+	{
+		memset( buffer, (int)i, sizeof(buffer) );
+		REQUIRE( client.QueueDatagram( serverAddress, buffer, i + 1 ) );
+	}
+	REQUIRE( client.GetPendingSendCount() == kCount );
+	REQUIRE( client.SendAll() == kCount );
+	REQUIRE( client.GetPendingSendCount() == 0 );
+	
+	ae::Array< ae::DatagramSocket::Datagram > datagrams = TAG_SOCKET_TEST;
+	REQUIRE( SocketTest_ReceiveDatagrams( &server, kCount, &datagrams ) == kCount );
+	for ( uint32_t i = 0; i < kCount; i++ )
+	{
+		const ae::DatagramSocket::Datagram& datagram = datagrams[ i ];
+		REQUIRE( datagram.length == i + 1 );
+		REQUIRE( datagram.address.GetPort() == client.GetPort() );
+		REQUIRE( datagram.address.GetAddressString() == "127.0.0.1" );
+	}
+	// Only the most recent datagrams are guaranteed to still be valid
+	const ae::DatagramSocket::Datagram& last = server.GetDatagram( server.GetDatagramCount() - 1 );
+	REQUIRE( last.length == kCount );
+	REQUIRE( last.data[ 0 ] == kCount - 1 );
+	REQUIRE( last.data[ kCount - 1 ] == kCount - 1 );
+	
+	SECTION( "reply to source address" )
+	{
+		const ae::DatagramSocket::Address clientAddress = last.address;
+		const char reply[] = "pong";
+		REQUIRE( server.QueueDatagram( clientAddress, reply, sizeof(reply) ) );
+		REQUIRE( server.SendAll() == 1 );
+		REQUIRE( SocketTest_ReceiveDatagrams( &client, 1, nullptr ) == 1 );
+		REQUIRE( client.GetDatagram( 0 ).length == sizeof(reply) );
+		REQUIRE( memcmp( client.GetDatagram( 0 ).data, reply, sizeof(reply) ) == 0 );
+		REQUIRE( client.GetDatagram( 0 ).address == serverAddress );
+	}
+	
+	SECTION( "oversized datagrams are discarded" )
+	{
+		ae::DatagramSocket large = TAG_SOCKET_TEST;
+		REQUIRE( large.Open( false, 0, 1024 ) );
+		uint8_t largeBuffer[ 1024 ] = { 0 };
+		REQUIRE( large.QueueDatagram( serverAddress, largeBuffer, sizeof(largeBuffer) ) );
+		REQUIRE( large.QueueDatagram( serverAddress, largeBuffer, 16 ) );
+		REQUIRE( large.SendAll() == 2 );
+		REQUIRE( SocketTest_ReceiveDatagrams( &server, 1, nullptr ) == 1 );
+		REQUIRE( server.GetDatagram( 0 ).length == 16 );
+	}
+	
+	SECTION( "dual stack" )
+	{
+		ae::DatagramSocket remote = TAG_SOCKET_TEST;
+		REQUIRE( remote.Open( true, 0, 256 ) );
+		ae::DatagramSocket::Address remoteAddress;
+		REQUIRE( ae::DatagramSocket::GetAddress( "127.0.0.1", remote.GetPort(), &remoteAddress ) );
+		REQUIRE( client.QueueDatagram( remoteAddress, "hi", 2 ) );
+		REQUIRE( client.SendAll() == 1 );
+		REQUIRE( SocketTest_ReceiveDatagrams( &remote, 1, nullptr ) == 1 );
+		// IPv4 sources are reported as IPv4 addresses, not IPv4 mapped IPv6 addresses
+		ae::DatagramSocket::Address clientAddress;
+		REQUIRE( ae::DatagramSocket::GetAddress( "127.0.0.1", client.GetPort(), &clientAddress ) );
+		REQUIRE( remote.GetDatagram( 0 ).address == clientAddress );
+		REQUIRE( remote.GetDatagram( 0 ).address.GetAddressString() == "127.0.0.1" );
+		// Reply to the source address
+		REQUIRE( remote.GetDatagram( 0 ).address.GetPort() == client.GetPort() );
+		REQUIRE( remote.QueueDatagram( remote.GetDatagram( 0 ).address, "hello", 5 ) );
+		REQUIRE( remote.SendAll() == 1 );
+		REQUIRE( SocketTest_ReceiveDatagrams( &client, 1, nullptr ) == 1 );
+		REQUIRE( client.GetDatagram( 0 ).length == 5 );
+	}
+}
+
+TEST_CASE( "DatagramSocket benchmark", "[.benchmark][ae::DatagramSocket]" )
+{
+	// Sent in rounds small enough to not overflow the default loopback
+	// receive buffer, so every datagram arrives
+	const uint32_t kDatagramsPerRound = ae::DatagramSocket::kBatchSize;
+	const uint32_t kRounds = 16;
+	const uint32_t kDatagramSize = 64;
+	ae::DatagramSocket server = TAG_SOCKET_TEST;
+	ae::DatagramSocket client = TAG_SOCKET_TEST;
+	REQUIRE( server.Open( false, 0, kDatagramSize ) );
+	REQUIRE( client.Open( false, 0, kDatagramSize ) );
+	ae::DatagramSocket::Address serverAddress;
+	REQUIRE( ae::DatagramSocket::GetAddress( "127.0.0.1", server.GetPort(), &serverAddress ) );
+	uint8_t buffer[ kDatagramSize ] = { 0 };
+	
+	uint32_t totalReceived = 0;
+	double totalTime = 0.0;
+	BENCHMARK( "1024 datagrams" )
+	{
+		const double start = ae::GetTime();
+		uint32_t received = 0;
+		for ( uint32_t round = 0; round < kRounds; round++ )
+		{
+			for ( uint32_t i = 0; i < kDatagramsPerRound; i++ )
+			{
+				client.QueueDatagram( serverAddress, buffer, kDatagramSize );
+			}
+			client.SendAll();
+			received += SocketTest_ReceiveDatagrams( &server, kDatagramsPerRound, nullptr );
+		}
+		totalTime += ae::GetTime() - start;
+		totalReceived += received;
+		return received;
+	};
+	if ( totalTime > 0.0 )
+	{
+		AE_INFO( "DatagramSocket loopback: # datagrams/sec", (uint32_t)( totalReceived / totalTime ) );
+	}
+}
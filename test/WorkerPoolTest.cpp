@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+// WorkerPoolTest.cpp
+//------------------------------------------------------------------------------
+// Copyright (c) 2024 John Hughes
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files( the "Software" ), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//------------------------------------------------------------------------------
+// Headers
+//------------------------------------------------------------------------------
+#include "aether.h"
+#include <catch2/catch_test_macros.hpp>
+
+//------------------------------------------------------------------------------
+// ae::WorkerPool tests
+//------------------------------------------------------------------------------
+TEST_CASE( "WorkerPool visits every index exactly once", "[ae::WorkerPool]" )
+{
+	const uint32_t kCount = 10000;
+	ae::WorkerPool workerPool( "test" );
+	// Ranges never overlap within a single call to Run(), so no atomics are needed
+	ae::Array< uint32_t > visits( "test", 0u, kCount );
+
+	SECTION( "without worker threads" )
+	{
+		workerPool.Initialize( 0 );
+		REQUIRE( workerPool.GetWorkerCount() == 0 );
+	}
+	SECTION( "with worker threads" )
+	{
+		workerPool.Initialize( 4 );
+	}
+
+	for ( uint32_t run = 0; run < 3; run++ )
+	{
+		workerPool.Run( kCount, 7, [ &visits ]( uint32_t begin, uint32_t end )
+		{
+			for ( uint32_t i = begin; i < end; i++ )
+			{
+				visits[ i ]++;
+			}
+		} );
+	}
+	for ( uint32_t i = 0; i < kCount; i++ )
+	{
+		REQUIRE( visits[ i ] == 3 );
+	}
+}